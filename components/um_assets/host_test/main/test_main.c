@@ -0,0 +1,17 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_assets_valid_image(void);
+void test_um_assets_truncated_image(void);
+void test_um_assets_corrupt_header(void);
+void test_um_assets_corrupt_entry(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_assets_valid_image);
+    RUN_TEST(test_um_assets_truncated_image);
+    RUN_TEST(test_um_assets_corrupt_header);
+    RUN_TEST(test_um_assets_corrupt_entry);
+    exit(UNITY_END());
+}
@@ -0,0 +1,233 @@
+/*
+ * Проверка образа в um_assets_init(): обрезанный раздел и испорченные
+ * заголовок и записи индекса должны отвергаться без чтения за пределами
+ * раздела. Раздел отображается в буфер ровно его размера, поэтому выход за
+ * границу ловит AddressSanitizer (сборка linux с -fsanitize=address).
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "um_assets.h"
+
+#define PART_SIZE 4096
+
+static uint8_t s_image[PART_SIZE];
+static size_t s_part_size;
+static esp_partition_t s_partition;
+static void *s_mapped;
+
+const esp_partition_t *__wrap_esp_partition_find_first(esp_partition_type_t type,
+                                                        esp_partition_subtype_t subtype,
+                                                        const char *label)
+{
+    s_partition.size = s_part_size;
+    strncpy(s_partition.label, label, sizeof(s_partition.label) - 1);
+    return &s_partition;
+}
+
+esp_err_t __wrap_esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                                    esp_partition_mmap_memory_t memory, const void **out_ptr,
+                                    esp_partition_mmap_handle_t *out_handle)
+{
+    TEST_ASSERT_NULL(s_mapped);
+    s_mapped = malloc(size);
+    TEST_ASSERT_NOT_NULL(s_mapped);
+    memcpy(s_mapped, s_image + offset, size);
+    *out_ptr = s_mapped;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void __wrap_esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    free(s_mapped);
+    s_mapped = NULL;
+}
+
+static const char *const s_paths[] = {"/a.js", "/b.css", "/index.html"};
+static const char *const s_data[] = {"console.log(1)", "body{}", "<html></html>"};
+#define ASSET_COUNT (sizeof(s_paths) / sizeof(s_paths[0]))
+
+static um_assets_header_t *header(void)
+{
+    return (um_assets_header_t *)s_image;
+}
+
+static um_assets_entry_t *entry(size_t i)
+{
+    return (um_assets_entry_t *)(s_image + sizeof(um_assets_header_t)) + i;
+}
+
+static void update_index_crc(void)
+{
+    header()->index_crc = esp_rom_crc32_le(0, (const uint8_t *)entry(0),
+                                           header()->count * sizeof(um_assets_entry_t));
+}
+
+// Образ как у tools/mkassets.py: индекс по возрастанию пути, блобы выровнены на 4
+static void build_image(void)
+{
+    memset(s_image, 0xFF, sizeof(s_image));
+    uint32_t offset = sizeof(um_assets_header_t) + ASSET_COUNT * sizeof(um_assets_entry_t);
+    memset(header(), 0, sizeof(um_assets_header_t));
+    header()->magic = UM_ASSETS_MAGIC;
+    header()->version = UM_ASSETS_VERSION;
+    header()->entry_size = sizeof(um_assets_entry_t);
+    header()->count = ASSET_COUNT;
+    header()->data_offset = offset;
+
+    for (size_t i = 0; i < ASSET_COUNT; i++)
+    {
+        um_assets_entry_t *e = entry(i);
+        size_t len = strlen(s_data[i]);
+        memset(e, 0, sizeof(*e));
+        strcpy(e->path, s_paths[i]);
+        e->offset = offset;
+        e->size = len;
+        e->orig_size = len;
+        e->crc = esp_rom_crc32_le(0, (const uint8_t *)s_data[i], len);
+        memcpy(s_image + offset, s_data[i], len);
+        offset += (len + 3) & ~3u;
+    }
+    header()->image_size = offset;
+    update_index_crc();
+    s_part_size = PART_SIZE;
+}
+
+static void assert_rejected(void)
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_assets_init());
+    TEST_ASSERT_FALSE(um_assets_is_mounted());
+    TEST_ASSERT_NULL(s_mapped);
+
+    um_asset_t asset;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_assets_find("/index.html", &asset));
+}
+
+void test_um_assets_valid_image(void)
+{
+    build_image();
+    TEST_ASSERT_EQUAL(ESP_OK, um_assets_init());
+    TEST_ASSERT_EQUAL(ASSET_COUNT, um_assets_count());
+
+    for (size_t i = 0; i < ASSET_COUNT; i++)
+    {
+        um_asset_t asset;
+        TEST_ASSERT_EQUAL(ESP_OK, um_assets_find(s_paths[i], &asset));
+        TEST_ASSERT_EQUAL(strlen(s_data[i]), asset.size);
+        TEST_ASSERT_EQUAL_MEMORY(s_data[i], asset.data, asset.size);
+    }
+    um_asset_t asset;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, um_assets_find("/missing", &asset));
+    TEST_ASSERT_EQUAL(ESP_OK, um_assets_verify());
+
+    um_assets_deinit();
+    TEST_ASSERT_NULL(s_mapped);
+}
+
+void test_um_assets_truncated_image(void)
+{
+    // Раздел короче образа (прошит в раздел другого размера)
+    build_image();
+    s_part_size = header()->image_size - 1;
+    assert_rejected();
+
+    // Раздел короче заголовка
+    build_image();
+    s_part_size = sizeof(um_assets_header_t) - 1;
+    assert_rejected();
+
+    // Образ обрывается посреди индекса
+    build_image();
+    header()->image_size = sizeof(um_assets_header_t) + sizeof(um_assets_entry_t);
+    assert_rejected();
+
+    // Пустой раздел (стёртая flash)
+    build_image();
+    memset(s_image, 0xFF, sizeof(s_image));
+    assert_rejected();
+}
+
+void test_um_assets_corrupt_header(void)
+{
+    // 0x04000001 * 64 на 32-битном size_t - это 64: индекс "помещается"
+    static const uint32_t bad_counts[] = {0x04000001, 0xFFFFFFFF, (PART_SIZE / 64) + 1};
+    for (size_t i = 0; i < sizeof(bad_counts) / sizeof(bad_counts[0]); i++)
+    {
+        build_image();
+        header()->count = bad_counts[i];
+        assert_rejected();
+    }
+
+    build_image();
+    header()->image_size = PART_SIZE + 1;
+    assert_rejected();
+
+    build_image();
+    header()->image_size = 0xFFFFFFFF;
+    assert_rejected();
+
+    build_image();
+    header()->image_size = 3;
+    assert_rejected();
+
+    // Данные начинаются раньше конца индекса
+    build_image();
+    header()->data_offset = sizeof(um_assets_header_t) + sizeof(um_assets_entry_t);
+    assert_rejected();
+
+    build_image();
+    header()->data_offset = header()->image_size + 4;
+    assert_rejected();
+
+    build_image();
+    header()->version = UM_ASSETS_VERSION + 1;
+    assert_rejected();
+
+    build_image();
+    header()->entry_size = 32;
+    assert_rejected();
+}
+
+void test_um_assets_corrupt_entry(void)
+{
+    // offset + size переполняет uint32_t и "попадает" в образ
+    build_image();
+    entry(1)->size = 0xFFFFFFFF - entry(1)->offset + 2;
+    update_index_crc();
+    assert_rejected();
+
+    build_image();
+    entry(2)->size = header()->image_size - entry(2)->offset + 1;
+    update_index_crc();
+    assert_rejected();
+
+    build_image();
+    entry(0)->offset = 0;
+    update_index_crc();
+    assert_rejected();
+
+    build_image();
+    entry(0)->offset = 0xFFFFFFF0;
+    update_index_crc();
+    assert_rejected();
+
+    // Путь без завершающего нуля
+    build_image();
+    memset(entry(1)->path, 'x', UM_ASSETS_PATH_MAX);
+    update_index_crc();
+    assert_rejected();
+
+    // Порядок путей нарушен - двоичный поиск был бы неверным
+    build_image();
+    strcpy(entry(0)->path, "/z.js");
+    update_index_crc();
+    assert_rejected();
+
+    // Запись испорчена, CRC индекса не пересчитан
+    build_image();
+    entry(1)->size += 4;
+    assert_rejected();
+}
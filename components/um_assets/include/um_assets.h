@@ -0,0 +1,164 @@
+/**
+ * @file um_assets.h
+ * @brief Read-only asset image mapped from the "assets" partition
+ * @version 1.0.0
+ *
+ * Образ собирается на хосте (tools/mkassets.py) из каталога assets/ и
+ * прошивается в отдельный раздел. При старте раздел отображается в адресное
+ * пространство через esp_partition_mmap(), поэтому данные ассетов отдаются
+ * прямо из flash без копирования в кучу.
+ *
+ * Формат (little-endian):
+ *   [header 32 B][entry 64 B × count, по возрастанию path][blobs, выровнены на 4]
+ */
+
+#ifndef UM_ASSETS_H
+#define UM_ASSETS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UM_ASSETS_MAGIC 0x53414D55 // "UMAS"
+#define UM_ASSETS_VERSION 1
+#define UM_ASSETS_PATH_MAX 44
+
+/** Blob is gzip-compressed (serve with Content-Encoding: gzip) */
+#define UM_ASSETS_FLAG_GZIP (1 << 0)
+
+/**
+ * @brief Image header (32 bytes)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_size;   /**< sizeof(um_assets_entry_t) */
+    uint32_t count;        /**< Number of entries */
+    uint32_t data_offset;  /**< First blob offset */
+    uint32_t image_size;   /**< Total image size */
+    uint32_t index_crc;    /**< CRC32 of the entry table */
+    uint32_t reserved[2];
+} um_assets_header_t;
+
+/**
+ * @brief Index entry (64 bytes)
+ */
+typedef struct __attribute__((packed)) {
+    char path[UM_ASSETS_PATH_MAX]; /**< "/index.html", null-terminated */
+    uint32_t offset;               /**< Blob offset from image start */
+    uint32_t size;                 /**< Stored (possibly compressed) size */
+    uint32_t orig_size;            /**< Uncompressed size */
+    uint32_t crc;                  /**< CRC32 of stored blob */
+    uint32_t flags;                /**< UM_ASSETS_FLAG_* */
+} um_assets_entry_t;
+
+/**
+ * @brief Asset view (points into flash-mapped memory)
+ */
+typedef struct {
+    const char* path;
+    const uint8_t* data; /**< Valid until um_assets_deinit() */
+    size_t size;
+    size_t orig_size;
+    uint32_t crc;        /**< Usable as ETag */
+    bool gzip;
+    const char* etag;         /**< Precomputed quoted ETag (bundle), NULL for the image */
+    const char* content_type; /**< Precomputed MIME type (bundle), NULL for the image */
+} um_asset_t;
+
+/**
+ * @brief Bundle entry (generated by tools/mkwebui.py)
+ */
+typedef struct {
+    const char* path;         /**< NULL - empty slot */
+    uint32_t offset;          /**< Blob offset in um_assets_bundle_t::data */
+    uint32_t size;
+    uint32_t orig_size;
+    uint32_t flags;           /**< UM_ASSETS_FLAG_* */
+    const char* etag;
+    const char* content_type;
+} um_assets_bundle_entry_t;
+
+/**
+ * @brief Assets embedded into the firmware image
+ *
+ * Slot of a path is FNV-1a(seed, path) % slot_count; the generator picks a
+ * seed without collisions, so lookup is one hash and one strcmp.
+ */
+typedef struct {
+    const uint8_t* data;
+    const um_assets_bundle_entry_t* slots;
+    uint16_t slot_count;
+    uint16_t count;
+    uint32_t seed;
+} um_assets_bundle_t;
+
+/**
+ * @brief Map the assets partition and validate its index
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND if there is no partition,
+ *         ESP_ERR_INVALID_STATE if the partition holds no valid image
+ */
+esp_err_t um_assets_init(void);
+
+/**
+ * @brief Unmap the partition; previously returned pointers become invalid
+ */
+void um_assets_deinit(void);
+
+/**
+ * @brief Check whether a valid image is mapped
+ */
+bool um_assets_is_mounted(void);
+
+/**
+ * @brief Find asset by path in the image, then in the bundle (no allocation)
+ *
+ * @param path Path starting with '/', e.g. "/index.html"
+ * @param[out] asset Asset view
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND,
+ *         ESP_ERR_INVALID_STATE if neither an image nor a bundle is present
+ */
+esp_err_t um_assets_find(const char* path, um_asset_t* asset);
+
+/**
+ * @brief Add the bundle embedded into the firmware
+ *
+ * um_assets_find() looks in the partition image first and falls back to the
+ * bundle, so a flashed image can override the built-in UI.
+ *
+ * @param bundle Bundle with static storage duration
+ */
+void um_assets_register_bundle(const um_assets_bundle_t* bundle);
+
+/**
+ * @brief Number of assets in the image (the bundle is not listed)
+ */
+size_t um_assets_count(void);
+
+/**
+ * @brief Get asset by index (in path order)
+ *
+ * @param index 0 .. um_assets_count() - 1
+ * @param[out] asset Asset view
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE
+ */
+esp_err_t um_assets_get(size_t index, um_asset_t* asset);
+
+/**
+ * @brief Check CRC of every blob (reads the whole image)
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_CRC, ESP_ERR_INVALID_STATE
+ */
+esp_err_t um_assets_verify(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UM_ASSETS_H
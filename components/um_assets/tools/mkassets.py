@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+# Сборка и проверка образа ассетов для раздела "assets" (см. um_assets.h)
+#
+#   mkassets.py build <dir> -o assets.bin [--size 0x40000] [--no-gzip]
+#   mkassets.py verify assets.bin [--dir <dir>]
+
+import argparse
+import gzip
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x53414D55  # "UMAS"
+VERSION = 1
+PATH_MAX = 44
+FLAG_GZIP = 1 << 0
+
+HEADER = struct.Struct('<IHHIIII8x')
+ENTRY = struct.Struct('<%dsIIIII' % PATH_MAX)
+
+# Уже сжатые форматы не пережимаем
+NO_GZIP_EXT = {'.png', '.jpg', '.jpeg', '.gif', '.webp', '.gz', '.woff', '.woff2', '.zip'}
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+def collect(src_dir):
+    files = []
+    for root, dirs, names in os.walk(src_dir):
+        dirs[:] = sorted(d for d in dirs if not d.startswith('.'))
+        for name in sorted(names):
+            if name.startswith('.'):
+                continue
+            full = os.path.join(root, name)
+            rel = '/' + os.path.relpath(full, src_dir).replace(os.sep, '/')
+            if len(rel.encode()) >= PATH_MAX:
+                sys.exit('error: path too long (max %d): %s' % (PATH_MAX - 1, rel))
+            files.append((rel, full))
+    # Прошивка ищет двоичным поиском по strcmp - сортируем по байтам
+    files.sort(key=lambda f: f[0].encode())
+    return files
+
+
+def build(args):
+    files = collect(args.dir)
+    data_offset = align4(HEADER.size + ENTRY.size * len(files))
+
+    entries = []
+    blobs = bytearray()
+    for rel, full in files:
+        with open(full, 'rb') as f:
+            raw = f.read()
+        blob = raw
+        flags = 0
+        ext = os.path.splitext(rel)[1].lower()
+        if not args.no_gzip and ext not in NO_GZIP_EXT:
+            packed = gzip.compress(raw, compresslevel=9, mtime=0)
+            if len(packed) < len(raw):
+                blob = packed
+                flags |= FLAG_GZIP
+        offset = data_offset + len(blobs)
+        entries.append(ENTRY.pack(rel.encode(), offset, len(blob), len(raw),
+                                  zlib.crc32(blob), flags))
+        blobs += blob
+        blobs += b'\0' * (align4(len(blobs)) - len(blobs))
+        print('  %-40s %7d -> %7d%s' % (rel, len(raw), len(blob),
+                                          ' gz' if flags & FLAG_GZIP else ''))
+
+    index = b''.join(entries)
+    image_size = data_offset + len(blobs)
+    header = HEADER.pack(MAGIC, VERSION, ENTRY.size, len(files), data_offset,
+                         image_size, zlib.crc32(index))
+    image = header + index + b'\0' * (data_offset - HEADER.size - len(index)) + blobs
+
+    if args.size:
+        if len(image) > args.size:
+            sys.exit('error: image is %d bytes, partition is %d' % (len(image), args.size))
+        # Хвост как у стёртой flash
+        image += b'\xff' * (args.size - len(image))
+
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    print('%d assets, %d bytes -> %s' % (len(files), image_size, args.output))
+
+
+def verify(args):
+    with open(args.image, 'rb') as f:
+        image = f.read()
+
+    errors = []
+    if len(image) < HEADER.size:
+        sys.exit('error: image too small')
+    magic, version, entry_size, count, data_offset, image_size, index_crc = \
+        HEADER.unpack_from(image, 0)
+    if magic != MAGIC:
+        sys.exit('error: bad magic 0x%08x' % magic)
+    if version != VERSION or entry_size != ENTRY.size:
+        sys.exit('error: unsupported version %d / entry size %d' % (version, entry_size))
+    if image_size > len(image):
+        sys.exit('error: image truncated (%d < %d)' % (len(image), image_size))
+
+    index_end = HEADER.size + count * ENTRY.size
+    if index_end > data_offset:
+        errors.append('index overlaps data')
+    if zlib.crc32(image[HEADER.size:index_end]) != index_crc:
+        errors.append('index CRC mismatch')
+
+    prev = None
+    seen = {}
+    for i in range(count):
+        raw_path, offset, size, orig_size, crc, flags = \
+            ENTRY.unpack_from(image, HEADER.size + i * ENTRY.size)
+        if b'\0' not in raw_path:
+            errors.append('entry %d: path not terminated' % i)
+            continue
+        path = raw_path.split(b'\0', 1)[0]
+        name = path.decode(errors='replace')
+        if prev is not None and path <= prev:
+            errors.append('%s: index not sorted' % name)
+        prev = path
+        if offset < data_offset or offset + size > image_size:
+            errors.append('%s: blob out of range' % name)
+            continue
+        blob = image[offset:offset + size]
+        if zlib.crc32(blob) != crc:
+            errors.append('%s: CRC mismatch' % name)
+            continue
+        content = blob
+        if flags & FLAG_GZIP:
+            try:
+                content = gzip.decompress(blob)
+            except OSError as e:
+                errors.append('%s: bad gzip (%s)' % (name, e))
+                continue
+        if len(content) != orig_size:
+            errors.append('%s: size %d != %d' % (name, len(content), orig_size))
+        seen[name] = content
+        print('  %-40s %7d %7d%s' % (name, orig_size, size, ' gz' if flags & FLAG_GZIP else ''))
+
+    if args.dir:
+        expected = dict(collect(args.dir))
+        for name, full in expected.items():
+            with open(full, 'rb') as f:
+                if seen.get(name) != f.read():
+                    errors.append('%s: differs from source' % name)
+        for name in seen:
+            if name not in expected:
+                errors.append('%s: not in source dir' % name)
+
+    for e in errors:
+        print('error: ' + e, file=sys.stderr)
+    if errors:
+        sys.exit(1)
+    print('OK: %d assets, %d bytes' % (count, image_size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='UMNI asset image tool')
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('build', help='build image from directory')
+    p.add_argument('dir')
+    p.add_argument('-o', '--output', required=True)
+    p.add_argument('--size', type=lambda s: int(s, 0), default=0,
+                   help='partition size, pads image with 0xFF')
+    p.add_argument('--no-gzip', action='store_true')
+    p.set_defaults(func=build)
+
+    p = sub.add_parser('verify', help='check image index and blobs')
+    p.add_argument('image')
+    p.add_argument('--dir', help='compare contents with source directory')
+    p.set_defaults(func=verify)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
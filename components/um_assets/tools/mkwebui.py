@@ -0,0 +1,354 @@
+#!/usr/bin/env python3
+# Веб-интерфейс в прошивке: минификация, gzip и таблица с идеальным хэшем
+# (см. um_assets_bundle_t в um_assets.h)
+#
+#   mkwebui.py <dir> --bin webui.bin --src webui_bundle.c [--symbol um_webui_bundle]
+#                    [--no-minify] [--no-gzip]
+#
+# webui.bin встраивается в прошивку (target_add_binary_data), webui_bundle.c
+# ссылается на него через _binary_webui_bin_start.
+
+import argparse
+import gzip
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import zlib
+
+FLAG_GZIP = 1 << 0
+
+# Уже сжатые форматы не пережимаем
+NO_GZIP_EXT = {'.png', '.jpg', '.jpeg', '.gif', '.webp', '.gz', '.woff', '.woff2', '.zip'}
+
+# Как um_webserver_content_type() в um_webserver_static.c
+CONTENT_TYPES = {
+    '.html': 'text/html', '.htm': 'text/html',
+    '.js': 'application/javascript', '.mjs': 'application/javascript',
+    '.css': 'text/css',
+    '.json': 'application/json', '.map': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.png': 'image/png',
+    '.jpg': 'image/jpeg', '.jpeg': 'image/jpeg',
+    '.gif': 'image/gif',
+    '.webp': 'image/webp',
+    '.ico': 'image/x-icon',
+    '.woff2': 'font/woff2',
+    '.woff': 'font/woff',
+    '.txt': 'text/plain', '.log': 'text/plain',
+    '.csv': 'text/csv',
+    '.wasm': 'application/wasm',
+}
+
+# Попыток подобрать seed на каждый размер таблицы
+SEED_TRIES = 4096
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+def fnv1a(path, seed):
+    # Как path_hash() в um_assets.c
+    h = 0x811C9DC5 ^ seed
+    for b in path.encode():
+        h ^= b
+        h = (h * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def collect(src_dir):
+    files = []
+    for root, dirs, names in os.walk(src_dir):
+        dirs[:] = sorted(d for d in dirs if not d.startswith('.'))
+        for name in sorted(names):
+            if name.startswith('.'):
+                continue
+            full = os.path.join(root, name)
+            rel = '/' + os.path.relpath(full, src_dir).replace(os.sep, '/')
+            files.append((rel, full))
+    return files
+
+
+def strip_lines(text):
+    return '\n'.join(line.strip() for line in text.splitlines() if line.strip())
+
+
+# '/' после этих символов и слов начинает регулярное выражение, а не деление
+JS_REGEX_AFTER = set('(,=:[!&|?{};+-*%<>~^}')
+JS_REGEX_AFTER_WORDS = {'return', 'typeof', 'case', 'do', 'else', 'in', 'of', 'new', 'delete',
+                        'void', 'throw', 'instanceof', 'yield', 'await'}
+# Пробел рядом с этими знаками не нужен. '/', '+', '-', '.', '<', '>', '!' не входят:
+# склейка дала бы комментарий, ++/--, число с точкой или <!--
+JS_TIGHT = set('{}()[];,:=?&|*%^~')
+# Перевод строки после или перед ними не нужен для автоматической вставки ';'
+JS_NO_NEWLINE_AFTER = set(';,{([')
+JS_NO_NEWLINE_BEFORE = set('})],;')
+
+
+def js_ident(c):
+    return c.isalnum() or c in '_$' or ord(c) > 127
+
+
+class JsMinifier:
+    """Запасная минификация JS, если нет esbuild: комментарии и пробелы между токенами
+
+    Строки, шаблоны и регулярные выражения копируются как есть, переводы строк
+    там, где они могут значить конец оператора, сохраняются. Имена не сокращаются:
+    esbuild даёт меньший результат, но без него JS всё равно не уходит в прошивку
+    с комментариями и отступами.
+    """
+
+    def __init__(self, text):
+        self.src = text
+        self.pos = 0
+        self.out = []
+        self.pending = ''  # пробел перед следующим токеном: '', ' ' или '\n'
+        self.last = ''     # последний выведенный символ
+        self.word = ''     # последний токен, если это слово
+
+    def run(self):
+        self.code(False)
+        return ''.join(self.out)
+
+    def emit(self, text, word=''):
+        first = text[0]
+        if self.pending == '\n' and self.out and \
+                self.last not in JS_NO_NEWLINE_AFTER and first not in JS_NO_NEWLINE_BEFORE:
+            self.out.append('\n')
+        elif self.pending and self.out and self.last != '/' and first != '/' and \
+                self.last not in JS_TIGHT and first not in JS_TIGHT:
+            self.out.append(' ')
+        self.pending = ''
+        self.out.append(text)
+        self.last = text[-1]
+        self.word = word
+
+    def space(self, newline):
+        if newline:
+            self.pending = '\n'
+        elif not self.pending:
+            self.pending = ' '
+
+    def copy_until(self, start, end_chars):
+        """Строка или регулярное выражение от start до закрывающего символа включительно"""
+        s = self.src
+        i = start + 1
+        in_class = False
+        while i < len(s) and s[i] != '\n':
+            c = s[i]
+            if c == '\\':
+                i += 2
+                continue
+            if end_chars == '/':
+                if c == '[':
+                    in_class = True
+                elif c == ']':
+                    in_class = False
+                elif c == '/' and not in_class:
+                    break
+            elif c == end_chars:
+                break
+            i += 1
+        self.emit(s[start:i + 1])
+        self.pos = i + 1
+
+    def template(self):
+        s = self.src
+        start = self.pos
+        i = start + 1
+        while i < len(s):
+            c = s[i]
+            if c == '\\':
+                i += 2
+                continue
+            if c == '`':
+                break
+            if c == '$' and s.startswith('${', i):
+                self.emit(s[start:i + 2])
+                self.pos = i + 2
+                self.code(True)
+                start = self.pos
+                i = start
+                continue
+            i += 1
+        self.emit(s[start:i + 1])
+        self.pos = i + 1
+
+    def code(self, in_template):
+        s = self.src
+        depth = 0
+        while self.pos < len(s):
+            i = self.pos
+            c = s[i]
+            if c.isspace():
+                j = i
+                while j < len(s) and s[j].isspace():
+                    j += 1
+                self.space('\n' in s[i:j] or '\r' in s[i:j])
+                self.pos = j
+            elif s.startswith('//', i):
+                j = s.find('\n', i)
+                self.pos = len(s) if j < 0 else j
+            elif s.startswith('/*', i):
+                j = s.find('*/', i + 2)
+                j = len(s) if j < 0 else j + 2
+                self.space('\n' in s[i:j])
+                self.pos = j
+            elif c == '/' and (not self.last or (self.last in JS_REGEX_AFTER and not self.word) or
+                               self.word in JS_REGEX_AFTER_WORDS):
+                self.copy_until(i, '/')
+            elif c in '\'"':
+                self.copy_until(i, c)
+            elif c == '`':
+                self.template()
+            elif js_ident(c):
+                j = i
+                while j < len(s) and js_ident(s[j]):
+                    j += 1
+                self.emit(s[i:j], s[i:j])
+                self.pos = j
+            else:
+                if c == '{':
+                    depth += 1
+                elif c == '}':
+                    if in_template and depth == 0:
+                        # Конец ${...}: '}' выводит template()
+                        return
+                    depth -= 1
+                self.emit(c)
+                self.pos = i + 1
+
+
+def minify(ext, raw):
+    """Только безопасные преобразования; JS - внешним esbuild, без него - JsMinifier"""
+    try:
+        text = raw.decode('utf-8')
+    except UnicodeDecodeError:
+        return raw
+
+    if ext in ('.html', '.htm', '.svg'):
+        # Пробелы в <pre> и <textarea> значимы
+        if re.search(r'<(pre|textarea)\b', text, re.I):
+            return raw
+        text = re.sub(r'<!--(?!\[if).*?-->', '', text, flags=re.S)
+        return strip_lines(text).encode()
+    if ext == '.css':
+        text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+        return strip_lines(text).encode()
+    if ext in ('.json', '.map'):
+        return json.dumps(json.loads(text), separators=(',', ':'), ensure_ascii=False).encode()
+    if ext in ('.js', '.mjs'):
+        esbuild = shutil.which('esbuild')
+        if esbuild:
+            return subprocess.run([esbuild, '--minify', '--loader=js'], input=raw,
+                                  stdout=subprocess.PIPE, check=True).stdout
+        return JsMinifier(text).run().encode()
+    return raw
+
+
+def perfect_hash(paths):
+    """Наименьшая таблица и seed, при которых у всех путей разные ячейки"""
+    size = max(len(paths), 1)
+    while True:
+        for seed in range(SEED_TRIES):
+            slots = {fnv1a(p, seed) % size for p in paths}
+            if len(slots) == len(paths):
+                return size, seed
+        size += max(1, size // 8)
+
+
+def c_string(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='UMNI embedded web UI bundle')
+    parser.add_argument('dir')
+    parser.add_argument('--bin', required=True, help='blob file to embed')
+    parser.add_argument('--src', required=True, help='generated C table')
+    parser.add_argument('--symbol', default='um_webui_bundle')
+    parser.add_argument('--no-minify', action='store_true')
+    parser.add_argument('--no-gzip', action='store_true')
+    args = parser.parse_args()
+
+    files = collect(args.dir)
+    if not files:
+        sys.exit('error: %s is empty' % args.dir)
+
+    entries = []
+    blobs = bytearray()
+    total_raw = 0
+    for rel, full in files:
+        with open(full, 'rb') as f:
+            raw = f.read()
+        total_raw += len(raw)
+        ext = os.path.splitext(rel)[1].lower()
+
+        content = raw if args.no_minify else minify(ext, raw)
+        blob = content
+        flags = 0
+        if not args.no_gzip and ext not in NO_GZIP_EXT:
+            packed = gzip.compress(content, compresslevel=9, mtime=0)
+            if len(packed) < len(content):
+                blob = packed
+                flags |= FLAG_GZIP
+
+        entries.append({
+            'path': rel,
+            'offset': len(blobs),
+            'size': len(blob),
+            'orig_size': len(content),
+            'flags': flags,
+            'etag': '"%08x"' % zlib.crc32(blob),
+            'type': CONTENT_TYPES.get(ext, 'application/octet-stream'),
+        })
+        blobs += blob
+        blobs += b'\0' * (align4(len(blobs)) - len(blobs))
+        print('  %-40s %7d -> %7d%s' % (rel, len(raw), len(blob), ' gz' if flags & FLAG_GZIP else ''))
+
+    size, seed = perfect_hash([e['path'] for e in entries])
+    slots = [None] * size
+    for e in entries:
+        slots[fnv1a(e['path'], seed) % size] = e
+
+    lines = [
+        '// Сгенерировано mkwebui.py из %s, не редактировать' % os.path.basename(os.path.normpath(args.dir)),
+        '#include "um_assets.h"',
+        '',
+        'extern const uint8_t webui_bin_start[] asm("_binary_%s_start");' %
+        re.sub(r'[^A-Za-z0-9]', '_', os.path.basename(args.bin)),
+        '',
+        'static const um_assets_bundle_entry_t s_slots[%d] = {' % size,
+    ]
+    for i, e in enumerate(slots):
+        if e is None:
+            continue
+        lines.append('    [%d] = {%s, %d, %d, %d, 0x%x, %s, %s},' % (
+            i, c_string(e['path']), e['offset'], e['size'], e['orig_size'], e['flags'],
+            c_string(e['etag']), c_string(e['type'])))
+    lines += [
+        '};',
+        '',
+        'const um_assets_bundle_t %s = {' % args.symbol,
+        '    .data = webui_bin_start,',
+        '    .slots = s_slots,',
+        '    .slot_count = %d,' % size,
+        '    .count = %d,' % len(entries),
+        '    .seed = 0x%x,' % seed,
+        '};',
+        '',
+    ]
+
+    with open(args.bin, 'wb') as f:
+        f.write(blobs)
+    with open(args.src, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(lines))
+    print('%d files, %d -> %d bytes, %d slots (seed 0x%x) -> %s' % (
+        len(entries), total_raw, len(blobs), size, seed, args.bin))
+
+
+if __name__ == '__main__':
+    main()
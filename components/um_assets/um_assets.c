@@ -0,0 +1,284 @@
+/**
+ * @file um_assets.c
+ * @brief Read-only asset image mapped from the "assets" partition
+ * @version 1.0.0
+ */
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+#include "um_assets.h"
+
+static const char *TAG = "um_assets";
+
+#ifdef CONFIG_UM_CFG_ASSETS_PARTITION_LABEL
+#define ASSETS_PARTITION_LABEL CONFIG_UM_CFG_ASSETS_PARTITION_LABEL
+#else
+#define ASSETS_PARTITION_LABEL "assets"
+#endif
+
+_Static_assert(sizeof(um_assets_header_t) == 32, "um_assets_header_t must be 32 bytes");
+_Static_assert(sizeof(um_assets_entry_t) == 64, "um_assets_entry_t must be 64 bytes");
+
+static struct
+{
+    esp_partition_mmap_handle_t handle;
+    const uint8_t *base;
+    const um_assets_header_t *header;
+    const um_assets_entry_t *entries;
+    bool mounted;
+} s_assets = {0};
+
+static const um_assets_bundle_t *s_bundle = NULL;
+
+static void fill_asset(const um_assets_entry_t *e, um_asset_t *asset)
+{
+    asset->path = e->path;
+    asset->data = s_assets.base + e->offset;
+    asset->size = e->size;
+    asset->orig_size = e->orig_size;
+    asset->crc = e->crc;
+    asset->gzip = (e->flags & UM_ASSETS_FLAG_GZIP) != 0;
+    asset->etag = NULL;
+    asset->content_type = NULL;
+}
+
+/**
+ * @brief Проверка заголовка и таблицы записей
+ */
+static esp_err_t validate_image(size_t partition_size)
+{
+    const um_assets_header_t *h = s_assets.header;
+
+    if (partition_size < sizeof(um_assets_header_t) || h->magic != UM_ASSETS_MAGIC)
+    {
+        ESP_LOGW(TAG, "No asset image in partition");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (h->version != UM_ASSETS_VERSION || h->entry_size != sizeof(um_assets_entry_t))
+    {
+        ESP_LOGE(TAG, "Unsupported image version %u (entry %u)", h->version, h->entry_size);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // count ограничивается до умножения: на 32-битном size_t оно переполняется
+    if (h->image_size > partition_size || h->image_size < sizeof(um_assets_header_t) ||
+        h->data_offset > h->image_size ||
+        h->count > (h->image_size - sizeof(um_assets_header_t)) / sizeof(um_assets_entry_t) ||
+        sizeof(um_assets_header_t) + (size_t)h->count * sizeof(um_assets_entry_t) > h->data_offset)
+    {
+        ESP_LOGE(TAG, "Corrupted image header");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)s_assets.entries,
+                                    h->count * sizeof(um_assets_entry_t));
+    if (crc != h->index_crc)
+    {
+        ESP_LOGE(TAG, "Index CRC mismatch");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (uint32_t i = 0; i < h->count; i++)
+    {
+        const um_assets_entry_t *e = &s_assets.entries[i];
+        if (memchr(e->path, '\0', UM_ASSETS_PATH_MAX) == NULL ||
+            e->offset < h->data_offset || e->offset > h->image_size ||
+            e->size > h->image_size - e->offset ||
+            (i > 0 && strcmp(s_assets.entries[i - 1].path, e->path) >= 0))
+        {
+            ESP_LOGE(TAG, "Corrupted index entry %lu", (unsigned long)i);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t um_assets_init(void)
+{
+    if (s_assets.mounted)
+    {
+        return ESP_OK;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSETS_PARTITION_LABEL);
+    if (!part)
+    {
+        ESP_LOGW(TAG, "Partition '%s' not found", ASSETS_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *ptr = NULL;
+    esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA,
+                                       &ptr, &s_assets.handle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to map partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_assets.base = ptr;
+    s_assets.header = (const um_assets_header_t *)s_assets.base;
+    s_assets.entries = (const um_assets_entry_t *)(s_assets.base + sizeof(um_assets_header_t));
+
+    ret = validate_image(part->size);
+    if (ret != ESP_OK)
+    {
+        esp_partition_munmap(s_assets.handle);
+        memset(&s_assets, 0, sizeof(s_assets));
+        return ret;
+    }
+
+    s_assets.mounted = true;
+    ESP_LOGI(TAG, "Mapped %lu assets (%lu bytes) from '%s'",
+             (unsigned long)s_assets.header->count,
+             (unsigned long)s_assets.header->image_size, ASSETS_PARTITION_LABEL);
+    return ESP_OK;
+}
+
+void um_assets_deinit(void)
+{
+    if (!s_assets.mounted)
+    {
+        return;
+    }
+    esp_partition_munmap(s_assets.handle);
+    memset(&s_assets, 0, sizeof(s_assets));
+}
+
+bool um_assets_is_mounted(void)
+{
+    return s_assets.mounted;
+}
+
+void um_assets_register_bundle(const um_assets_bundle_t *bundle)
+{
+    s_bundle = bundle;
+    if (bundle)
+    {
+        ESP_LOGI(TAG, "Built-in bundle: %u assets", bundle->count);
+    }
+}
+
+// FNV-1a с начальным значением от seed, как в tools/mkwebui.py
+static uint32_t path_hash(const char *path, uint32_t seed)
+{
+    uint32_t h = 0x811C9DC5u ^ seed;
+    for (const uint8_t *p = (const uint8_t *)path; *p; p++)
+    {
+        h ^= *p;
+        h *= 0x01000193u;
+    }
+    return h;
+}
+
+static esp_err_t find_in_bundle(const char *path, um_asset_t *asset)
+{
+    const um_assets_bundle_entry_t *e =
+        &s_bundle->slots[path_hash(path, s_bundle->seed) % s_bundle->slot_count];
+    if (!e->path || strcmp(e->path, path) != 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    asset->path = e->path;
+    asset->data = s_bundle->data + e->offset;
+    asset->size = e->size;
+    asset->orig_size = e->orig_size;
+    asset->crc = 0;
+    asset->gzip = (e->flags & UM_ASSETS_FLAG_GZIP) != 0;
+    asset->etag = e->etag;
+    asset->content_type = e->content_type;
+    return ESP_OK;
+}
+
+static esp_err_t find_in_image(const char *path, um_asset_t *asset)
+{
+    // Записи отсортированы по path при сборке образа
+    size_t lo = 0;
+    size_t hi = s_assets.header->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(path, s_assets.entries[mid].path);
+        if (cmp == 0)
+        {
+            fill_asset(&s_assets.entries[mid], asset);
+            return ESP_OK;
+        }
+        if (cmp < 0)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t um_assets_find(const char *path, um_asset_t *asset)
+{
+    if (!path || !asset)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_assets.mounted && !s_bundle)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Прошитый образ перекрывает встроенный интерфейс
+    if (s_assets.mounted && find_in_image(path, asset) == ESP_OK)
+    {
+        return ESP_OK;
+    }
+    return s_bundle ? find_in_bundle(path, asset) : ESP_ERR_NOT_FOUND;
+}
+
+size_t um_assets_count(void)
+{
+    return s_assets.mounted ? s_assets.header->count : 0;
+}
+
+esp_err_t um_assets_get(size_t index, um_asset_t *asset)
+{
+    if (!asset)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_assets.mounted)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (index >= s_assets.header->count)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fill_asset(&s_assets.entries[index], asset);
+    return ESP_OK;
+}
+
+esp_err_t um_assets_verify(void)
+{
+    if (!s_assets.mounted)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (uint32_t i = 0; i < s_assets.header->count; i++)
+    {
+        const um_assets_entry_t *e = &s_assets.entries[i];
+        if (esp_rom_crc32_le(0, s_assets.base + e->offset, e->size) != e->crc)
+        {
+            ESP_LOGE(TAG, "CRC mismatch: %s", e->path);
+            return ESP_ERR_INVALID_CRC;
+        }
+    }
+    return ESP_OK;
+}
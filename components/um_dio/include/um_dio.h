@@ -66,6 +66,15 @@ esp_err_t um_dio_get_all_inputs(uint8_t *states);
  */
 esp_err_t um_dio_set_output(um_do_port_index_t output_idx, um_do_level_t level);
 
+/**
+ * @brief Set several outputs with one PCF8574 write
+ * 
+ * @param mask Outputs to change (bit 0 = DO_1 index of um_dio_set_output(), etc.)
+ * @param levels New levels for masked outputs (1 = DO_HIGH)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED if a masked output is disabled
+ */
+esp_err_t um_dio_set_outputs_masked(uint8_t mask, uint8_t levels);
+
 /**
  * @brief Get output pin state
  * 
@@ -6,6 +6,7 @@
 
 #include "um_dio.h"
 #include "um_nvs.h"
+#include "um_events.h"
 #include "pcf8574.h"
 #include "esp_log.h"
 #include "esp_err.h"
@@ -108,12 +109,26 @@ static void input_monitor_task(void *arg)
                     
                     /* Update stored state */
                     input_data = new_state;
+
+                    um_event_dio_t ev = {.states = new_state, .changed = changed};
+                    um_event_publish(UMNI_EVENT_INPUTS_CHANGED, &ev, sizeof(ev), 0);
                 }
             }
         }
     }
 }
 
+#if UM_FEATURE_ENABLED(OUTPUTS)
+/* Notify subscribers (web UI, MQTT) about new output states */
+static void publish_outputs(uint8_t old_data)
+{
+    if (old_data != output_data) {
+        um_event_dio_t ev = {.states = output_data, .changed = old_data ^ output_data};
+        um_event_publish(UMNI_EVENT_OUTPUTS_CHANGED, &ev, sizeof(ev), 0);
+    }
+}
+#endif
+
 /* Initialize output PCF8574 */
 static esp_err_t init_output_pcf8574(void)
 {
@@ -371,46 +386,57 @@ static uint8_t get_output_index(um_do_port_index_t output_idx)
     }
 }
 
-esp_err_t um_dio_set_output(um_do_port_index_t output_idx, um_do_level_t level)
-{
 #if UM_FEATURE_ENABLED(OUTPUTS)
-    if (output_idx < 0 || output_idx > 7) {
-        ESP_LOGE(TAG, "Invalid output index: %d", output_idx);
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    /* Check if specific output is enabled */
+/* Check if specific output is enabled */
+static bool output_enabled(uint8_t output_idx)
+{
     switch (output_idx) {
 #if UM_FEATURE_ENABLED(OUT1)
-        case 0: break;
+        case 0:
 #endif
 #if UM_FEATURE_ENABLED(OUT2)
-        case 1: break;
+        case 1:
 #endif
 #if UM_FEATURE_ENABLED(OUT3)
-        case 2: break;
+        case 2:
 #endif
 #if UM_FEATURE_ENABLED(OUT4)
-        case 3: break;
+        case 3:
 #endif
 #if UM_FEATURE_ENABLED(OUT5)
-        case 4: break;
+        case 4:
 #endif
 #if UM_FEATURE_ENABLED(OUT6)
-        case 5: break;
+        case 5:
 #endif
 #if UM_FEATURE_ENABLED(OUT7)
-        case 6: break;
+        case 6:
 #endif
 #if UM_FEATURE_ENABLED(OUT8)
-        case 7: break;
+        case 7:
 #endif
+            return true;
         default:
-            ESP_LOGE(TAG, "Output %d not enabled", output_idx);
-            return ESP_ERR_NOT_SUPPORTED;
+            return false;
+    }
+}
+#endif
+
+esp_err_t um_dio_set_output(um_do_port_index_t output_idx, um_do_level_t level)
+{
+#if UM_FEATURE_ENABLED(OUTPUTS)
+    if (output_idx < 0 || output_idx > 7) {
+        ESP_LOGE(TAG, "Invalid output index: %d", output_idx);
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!output_enabled(output_idx)) {
+        ESP_LOGE(TAG, "Output %d not enabled", output_idx);
+        return ESP_ERR_NOT_SUPPORTED;
     }
     
     //uint8_t bit_pos = get_output_bit_position(output_idx);
+    uint8_t old_data = output_data;
     
     if (level == DO_LOW)
     {
@@ -424,6 +450,7 @@ esp_err_t um_dio_set_output(um_do_port_index_t output_idx, um_do_level_t level)
     /* Write to PCF8574 */
     esp_err_t res = pcf8574_port_write(&pcf8574_output_dev, output_data);
     if (res == ESP_OK) {
+        publish_outputs(old_data);
         /* Save to NVS */
         res = um_nvs_set_outputs_data(output_data);
     }
@@ -435,6 +462,49 @@ esp_err_t um_dio_set_output(um_do_port_index_t output_idx, um_do_level_t level)
 #endif
 }
 
+esp_err_t um_dio_set_outputs_masked(uint8_t mask, uint8_t levels)
+{
+#if UM_FEATURE_ENABLED(OUTPUTS)
+    for (uint8_t i = 0; i < 8; i++) {
+        if ((mask & (1 << i)) && !output_enabled(i)) {
+            ESP_LOGE(TAG, "Output %d not enabled", i);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    
+    uint8_t old_data = output_data;
+    uint8_t new_data = output_data;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!(mask & (1 << i))) {
+            continue;
+        }
+        /* Same polarity as um_dio_set_output(): DO_HIGH clears the port bit */
+        if (levels & (1 << i)) {
+            new_data &= ~(1 << get_output_index(i));
+        } else {
+            new_data |= (1 << get_output_index(i));
+        }
+    }
+    
+    if (new_data == old_data) {
+        return ESP_OK;
+    }
+    
+    /* One I2C transaction and one NVS write for all changed outputs */
+    esp_err_t res = pcf8574_port_write(&pcf8574_output_dev, new_data);
+    if (res == ESP_OK) {
+        output_data = new_data;
+        publish_outputs(old_data);
+        res = um_nvs_set_outputs_data(output_data);
+    }
+    
+    return res;
+#else
+    ESP_LOGE(TAG, "Outputs feature not enabled");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 esp_err_t um_dio_get_output(uint8_t output_idx, bool *state)
 {
 #if UM_FEATURE_ENABLED(OUTPUTS)
@@ -456,11 +526,13 @@ esp_err_t um_dio_get_output(uint8_t output_idx, bool *state)
 esp_err_t um_dio_set_all_outputs(uint8_t states)
 {
 #if UM_FEATURE_ENABLED(OUTPUTS)
+    uint8_t old_data = output_data;
     output_data = states;
     
     /* Write to PCF8574 */
     esp_err_t res = pcf8574_port_write(&pcf8574_output_dev, output_data);
     if (res == ESP_OK) {
+        publish_outputs(old_data);
         /* Save to NVS */
         res = um_nvs_set_outputs_data(output_data);
     }
@@ -31,10 +31,24 @@ typedef enum {
     UMNI_EVENT_SDCARD_PUSH_OUT,
     UMNI_EVENT_OPENTHERM_CH_ON,
     UMNI_EVENT_OPENTHERM_CH_OFF,
-    UMNI_EVENT_OPENTHERM_SET_DATA
+    UMNI_EVENT_OPENTHERM_SET_DATA,
+    UMNI_EVENT_INPUTS_CHANGED,       /**< um_event_dio_t */
+    UMNI_EVENT_OUTPUTS_CHANGED,      /**< um_event_dio_t */
+    UMNI_EVENT_ONEWIRE_TEMPERATURES, /**< No data, values in um_onewire_get_readings() */
+    UMNI_EVENT_CONFIG_SAVED,         /**< Config file or credentials rewritten, no data */
 
 } umn_event_id_t;
 
+/**
+ * @brief Data of UMNI_EVENT_INPUTS_CHANGED / UMNI_EVENT_OUTPUTS_CHANGED
+ *
+ * Raw PCF8574 port bytes, same as um_dio_get_all_inputs()/um_dio_get_all_outputs().
+ */
+typedef struct {
+    uint8_t states;  /**< Port state after the change */
+    uint8_t changed; /**< Bits that changed */
+} um_event_dio_t;
+
 /**
  * @brief Event handler function type
  * 
@@ -4,10 +4,15 @@
  */
 
 #include "um_events.h"
+#include "um_metrics.h"
 #include "esp_log.h"
 
 static const char* TAG = "um_events";
 
+static um_metric_t m_published = UM_METRIC_COUNTER("um_events_published_total", "Events posted to the bus");
+static um_metric_t m_failed = UM_METRIC_COUNTER("um_events_publish_errors_total",
+                                                "Events lost: loop queue full or not initialized");
+
 /**
  * @brief Define the event base for UMN events
  */
@@ -23,6 +28,9 @@ ESP_EVENT_DEFINE_BASE(UMNI_EVENT_BASE);
 esp_err_t um_events_init(void) {
     esp_err_t ret = esp_event_loop_create_default();
     
+    um_metrics_register(&m_published);
+    um_metrics_register(&m_failed);
+
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Event bus initialized successfully");
     } else if (ret == ESP_ERR_INVALID_STATE) {
@@ -61,8 +69,11 @@ esp_err_t um_event_publish(int32_t event_id,
                                    ticks_to_wait);
     
     if (ret != ESP_OK) {
+        um_metric_inc(&m_failed);
         ESP_LOGE(TAG, "Failed to publish event %ld: %s", 
                 (long)event_id, esp_err_to_name(ret));
+    } else {
+        um_metric_inc(&m_published);
     }
     
     return ret;
@@ -0,0 +1,15 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_metrics_families(void);
+void test_um_metrics_histogram(void);
+void test_um_metrics_labels(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_metrics_families);
+    RUN_TEST(test_um_metrics_histogram);
+    RUN_TEST(test_um_metrics_labels);
+    exit(UNITY_END());
+}
@@ -0,0 +1,178 @@
+/*
+ * Текст Prometheus из um_metrics_write(): семейства с разными метками
+ * выводятся вместе, бакеты гистограммы накопительные, значения меток
+ * экранируются. Вывод собирается из кусков не больше буфера (256 байт).
+ *
+ * Реестр общий для всех тестов, поэтому у каждого теста свои имена метрик.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "um_metrics.h"
+
+// UM_METRICS_OUT_BUF в um_metrics.c
+#define OUT_BUF 256
+
+static struct
+{
+    char text[32768];
+    size_t len;
+    int chunks;
+} s_scrape;
+
+static esp_err_t collect(void *ctx, const char *data, size_t len)
+{
+    TEST_ASSERT_LESS_THAN(OUT_BUF, len);
+    TEST_ASSERT_LESS_THAN(sizeof(s_scrape.text) - s_scrape.len, len);
+    memcpy(s_scrape.text + s_scrape.len, data, len);
+    s_scrape.len += len;
+    s_scrape.text[s_scrape.len] = '\0';
+    s_scrape.chunks++;
+    return ESP_OK;
+}
+
+static const char *scrape(void)
+{
+    memset(&s_scrape, 0, sizeof(s_scrape));
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_write(collect, NULL));
+    // Каждая строка закончена: кусок не рвёт вывод посередине записи
+    TEST_ASSERT_EQUAL('\n', s_scrape.text[s_scrape.len - 1]);
+    return s_scrape.text;
+}
+
+static int count(const char *text, const char *needle)
+{
+    int n = 0;
+    for (const char *p = strstr(text, needle); p; p = strstr(p + 1, needle))
+    {
+        n++;
+    }
+    return n;
+}
+
+// Значение строки-образца "name{labels} value"
+static double value_of(const char *text, const char *sample)
+{
+    char key[128];
+    snprintf(key, sizeof(key), "\n%s ", sample);
+    const char *p = strstr(text, key);
+    TEST_ASSERT_NOT_NULL_MESSAGE(p, sample);
+    return strtod(p + strlen(key), NULL);
+}
+
+/* --- Тесты --- */
+
+void test_um_metrics_families(void)
+{
+    static um_metric_t a1 = UM_METRIC_COUNTER_L("test_a_total", "A help", "bus=\"1\"");
+    static um_metric_t b = UM_METRIC_GAUGE("test_b", "B help");
+    static um_metric_t a2 = UM_METRIC_COUNTER_L("test_a_total", "Ignored help", "bus=\"2\"");
+    static um_metric_t big = UM_METRIC_COUNTER("test_big_total", NULL);
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register(&a1));
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register(&b));
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register(&a2));
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register(&big));
+    // Повторная регистрация не дублирует метрику
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register(&a1));
+
+    um_metric_add(&a1, 3);
+    um_metric_add(&a2, 5);
+    um_metric_set(&b, -7);
+    um_metric_add(&big, 4294967295u);
+    const char *text = scrape();
+
+    // Метрики с одним именем - одно семейство, HELP от первой, порядок регистрации
+    TEST_ASSERT_NOT_NULL(strstr(text, "# HELP test_a_total A help\n"
+                                      "# TYPE test_a_total counter\n"
+                                      "test_a_total{bus=\"1\"} 3\n"
+                                      "test_a_total{bus=\"2\"} 5\n"
+                                      "# HELP test_b B help\n"
+                                      "# TYPE test_b gauge\n"
+                                      "test_b -7\n"));
+    TEST_ASSERT_EQUAL(1, count(text, "# TYPE test_a_total "));
+    TEST_ASSERT_EQUAL(0, count(text, "Ignored help"));
+
+    // Счётчик выводится всеми 10 цифрами: иначе rate() видит скачки
+    TEST_ASSERT_NOT_NULL(strstr(text, "# TYPE test_big_total counter\ntest_big_total 4294967295\n"));
+
+    // Системные метрики collector'а и вывод в несколько кусков
+    TEST_ASSERT_EQUAL(1, count(text, "# TYPE um_uptime_seconds gauge\n"));
+    TEST_ASSERT_EQUAL(1, count(text, "# TYPE um_heap_free_bytes gauge\n"));
+    TEST_ASSERT_GREATER_THAN(1, s_scrape.chunks);
+
+    // Неполная метрика не регистрируется
+    static um_metric_t bad = {.name = "test_bad", .type = UM_METRIC_HISTOGRAM};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, um_metrics_register(&bad));
+}
+
+void test_um_metrics_histogram(void)
+{
+    // Границы в мс, вывод в секундах
+    static const uint32_t bounds[] = {10, 100};
+    static uint32_t buckets[3];
+    static uint32_t op_buckets[3];
+    static um_metric_t h = UM_METRIC_HISTOGRAM("test_h_seconds", "H help", bounds, buckets, 1e-3f);
+    static um_metric_t h_op = UM_METRIC_HISTOGRAM_L("test_h_seconds", NULL, "op=\"w\"", bounds, op_buckets, 1e-3f);
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register(&h));
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register(&h_op));
+
+    // Граница включается в свой бакет
+    um_metric_observe(&h, 5);
+    um_metric_observe(&h, 10);
+    um_metric_observe(&h, 50);
+    um_metric_observe(&h, 500);
+    um_metric_observe(&h_op, 1000);
+    const char *text = scrape();
+
+    TEST_ASSERT_NOT_NULL(strstr(text, "# HELP test_h_seconds H help\n"
+                                      "# TYPE test_h_seconds histogram\n"
+                                      "test_h_seconds_bucket{le=\"0.01\"} 2\n"
+                                      "test_h_seconds_bucket{le=\"0.1\"} 3\n"
+                                      "test_h_seconds_bucket{le=\"+Inf\"} 4\n"
+                                      "test_h_seconds_sum "));
+    TEST_ASSERT_NOT_NULL(strstr(text, "test_h_seconds_count 4\n"
+                                      "test_h_seconds_bucket{op=\"w\",le=\"0.01\"} 0\n"
+                                      "test_h_seconds_bucket{op=\"w\",le=\"0.1\"} 0\n"
+                                      "test_h_seconds_bucket{op=\"w\",le=\"+Inf\"} 1\n"
+                                      "test_h_seconds_sum{op=\"w\"} "));
+    TEST_ASSERT_NOT_NULL(strstr(text, "test_h_seconds_count{op=\"w\"} 1\n"));
+    TEST_ASSERT_EQUAL(1, count(text, "# TYPE test_h_seconds "));
+
+    // Сумма в секундах (scale - float, поэтому с допуском)
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 0.565, value_of(text, "test_h_seconds_sum"));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 1.0, value_of(text, "test_h_seconds_sum{op=\"w\"}"));
+}
+
+static void collect_names(um_metrics_out_t *out)
+{
+    static const char *const names[] = {"plain", "we\"ird\\", "two\nlines"};
+    um_metrics_family(out, "test_name_info", NULL, UM_METRIC_GAUGE);
+    for (int i = 0; i < 3; i++)
+    {
+        char value[32];
+        char labels[48];
+        um_metrics_label_value(value, sizeof(value), names[i]);
+        snprintf(labels, sizeof(labels), "name=\"%s\"", value);
+        um_metrics_sample(out, "test_name_info", labels, i);
+    }
+}
+
+void test_um_metrics_labels(void)
+{
+    char buf[16];
+    TEST_ASSERT_EQUAL_STRING("a\\\"b\\\\c\\n", um_metrics_label_value(buf, sizeof(buf), "a\"b\\c\n"));
+    TEST_ASSERT_EQUAL_STRING("plain", um_metrics_label_value(buf, sizeof(buf), "plain"));
+
+    // Не помещается - обрезается, но не посередине экранирования
+    TEST_ASSERT_EQUAL_STRING("ab\\\"", um_metrics_label_value(buf, 5, "ab\"cd"));
+    TEST_ASSERT_EQUAL_STRING("ab", um_metrics_label_value(buf, 4, "ab\"cd"));
+    TEST_ASSERT_EQUAL_STRING("", um_metrics_label_value(buf, 1, "\\"));
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_metrics_register_collector(collect_names));
+    const char *text = scrape();
+    TEST_ASSERT_NOT_NULL(strstr(text, "# TYPE test_name_info gauge\n"
+                                      "test_name_info{name=\"plain\"} 0\n"
+                                      "test_name_info{name=\"we\\\"ird\\\\\"} 1\n"
+                                      "test_name_info{name=\"two\\nlines\"} 2\n"));
+}
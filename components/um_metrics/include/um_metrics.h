@@ -0,0 +1,184 @@
+/**
+ * @file um_metrics.h
+ * @brief Metrics registry with Prometheus text exposition
+ * @version 1.0.0
+ *
+ * Metrics are static objects owned by the component that updates them.
+ * Counters and gauges are updated with a single relaxed atomic operation,
+ * histograms take a short critical section. Scraping walks the registry
+ * and calls collectors for values that are only known at scrape time.
+ */
+
+#ifndef UM_METRICS_H
+#define UM_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "base_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Max scrape-time collectors */
+#define UM_METRICS_MAX_COLLECTORS 8
+
+/** Max tasks in um_task_stack_free_bytes (static snapshot, no heap per scrape) */
+#define UM_METRICS_MAX_TASKS 32
+
+typedef enum {
+    UM_METRIC_COUNTER,
+    UM_METRIC_GAUGE,
+    UM_METRIC_HISTOGRAM,
+} um_metric_type_t;
+
+/**
+ * @brief Metric (define with UM_METRIC_* initializers, do not touch fields directly)
+ *
+ * Metrics with the same name and different labels form one family and are
+ * written together; HELP is taken from the first registered one.
+ */
+typedef struct um_metric {
+    const char *name;       /**< Prometheus name, e.g. "um_mqtt_published_total" */
+    const char *help;
+    const char *labels;     /**< Constant labels without braces: "bus=\"1\"", or NULL */
+    um_metric_type_t type;
+    uint32_t value;         /**< Counter (wraps at 2^32) or gauge (int32_t) */
+    const uint32_t *bounds; /**< Histogram: ascending upper bounds in raw units */
+    uint32_t *buckets;      /**< Histogram: bucket_count + 1 counters, last is +Inf */
+    uint8_t bucket_count;
+    float scale;            /**< Histogram: raw unit -> exposition unit (1e-6f: us -> s) */
+    uint64_t sum;           /**< Histogram: sum of observed raw values */
+    struct um_metric *next;
+    bool registered;
+} um_metric_t;
+
+#define UM_METRIC_COUNTER(n, h) UM_METRIC_COUNTER_L(n, h, NULL)
+#define UM_METRIC_COUNTER_L(n, h, l) \
+    { .name = (n), .help = (h), .labels = (l), .type = UM_METRIC_COUNTER }
+
+#define UM_METRIC_GAUGE(n, h) UM_METRIC_GAUGE_L(n, h, NULL)
+#define UM_METRIC_GAUGE_L(n, h, l) \
+    { .name = (n), .help = (h), .labels = (l), .type = UM_METRIC_GAUGE }
+
+/**
+ * @param b static const uint32_t array of bounds
+ * @param storage static uint32_t array of (number of bounds + 1) elements
+ * @param sc multiplier to the exposed unit
+ */
+#define UM_METRIC_HISTOGRAM(n, h, b, storage, sc) UM_METRIC_HISTOGRAM_L(n, h, NULL, b, storage, sc)
+#define UM_METRIC_HISTOGRAM_L(n, h, l, b, storage, sc)                                   \
+    { .name = (n), .help = (h), .labels = (l), .type = UM_METRIC_HISTOGRAM, .bounds = (b), \
+      .buckets = (storage), .bucket_count = sizeof(b) / sizeof((b)[0]), .scale = (sc) }
+
+/** Bounds for durations in microseconds, exposed in seconds */
+#define UM_METRICS_US_BUCKETS { 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000 }
+
+/**
+ * @brief Scrape-time output (opaque, passed to collectors)
+ */
+typedef struct um_metrics_out um_metrics_out_t;
+
+/**
+ * @brief Collector: writes values that are computed at scrape time
+ */
+typedef void (*um_metrics_collect_fn)(um_metrics_out_t *out);
+
+/**
+ * @brief Sink for the exposition text
+ */
+typedef esp_err_t (*um_metrics_write_fn)(void *ctx, const char *data, size_t len);
+
+#if UM_FEATURE_ENABLED(METRICS)
+
+static inline void um_metric_add(um_metric_t *m, uint32_t n)
+{
+    __atomic_fetch_add(&m->value, n, __ATOMIC_RELAXED);
+}
+
+static inline void um_metric_inc(um_metric_t *m)
+{
+    um_metric_add(m, 1);
+}
+
+static inline void um_metric_set(um_metric_t *m, int32_t value)
+{
+    __atomic_store_n(&m->value, (uint32_t)value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Add an observation to a histogram
+ *
+ * @param value raw value in the unit of the bounds
+ */
+void um_metric_observe(um_metric_t *m, uint32_t value);
+
+/**
+ * @brief Add a metric to the registry (repeated calls are ignored)
+ *
+ * @param m Metric with static storage duration
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for an incomplete metric
+ */
+esp_err_t um_metrics_register(um_metric_t *m);
+
+/**
+ * @brief Add a collector (up to UM_METRICS_MAX_COLLECTORS)
+ */
+esp_err_t um_metrics_register_collector(um_metrics_collect_fn fn);
+
+/**
+ * @brief Write HELP/TYPE of a family (from a collector)
+ */
+void um_metrics_family(um_metrics_out_t *out, const char *name, const char *help, um_metric_type_t type);
+
+/**
+ * @brief Write one sample (from a collector)
+ *
+ * @param labels Label set without braces, or NULL; runtime values go through um_metrics_label_value()
+ */
+void um_metrics_sample(um_metrics_out_t *out, const char *name, const char *labels, double value);
+
+/**
+ * @brief Escape a label value: backslash, double quote and newline
+ *
+ * @return dst; a value that does not fit is cut, never in the middle of an escape
+ */
+const char *um_metrics_label_value(char *dst, size_t size, const char *value);
+
+/**
+ * @brief Write all metrics in Prometheus text format 0.0.4
+ *
+ * @return ESP_OK or the first error returned by write
+ */
+esp_err_t um_metrics_write(um_metrics_write_fn write, void *ctx);
+
+#else
+
+static inline void um_metric_add(um_metric_t *m, uint32_t n) {}
+static inline void um_metric_inc(um_metric_t *m) {}
+static inline void um_metric_set(um_metric_t *m, int32_t value) {}
+static inline void um_metric_observe(um_metric_t *m, uint32_t value) {}
+static inline esp_err_t um_metrics_register(um_metric_t *m) { return ESP_OK; }
+static inline esp_err_t um_metrics_register_collector(um_metrics_collect_fn fn) { return ESP_OK; }
+static inline void um_metrics_family(um_metrics_out_t *out, const char *name, const char *help,
+                                     um_metric_type_t type) {}
+static inline void um_metrics_sample(um_metrics_out_t *out, const char *name, const char *labels,
+                                     double value) {}
+static inline const char *um_metrics_label_value(char *dst, size_t size, const char *value)
+{
+    if (size > 0) {
+        dst[0] = '\0';
+    }
+    return dst;
+}
+static inline esp_err_t um_metrics_write(um_metrics_write_fn write, void *ctx) { return ESP_ERR_NOT_SUPPORTED; }
+
+#endif // UM_FEATURE_ENABLED(METRICS)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UM_METRICS_H
@@ -0,0 +1,310 @@
+/**
+ * @file um_metrics.c
+ * @brief Metrics registry with Prometheus text exposition
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "um_metrics.h"
+
+#if UM_FEATURE_ENABLED(METRICS)
+
+static const char *TAG = "um_metrics";
+
+#define UM_METRICS_OUT_BUF 256
+
+struct um_metrics_out {
+    um_metrics_write_fn write;
+    void *ctx;
+    esp_err_t err;
+    size_t len;
+    char buf[UM_METRICS_OUT_BUF];
+};
+
+static void collect_system(um_metrics_out_t *out);
+
+// Список только растёт: при чтении next публикуется после заполнения метрики
+static um_metric_t *s_head = NULL;
+static um_metric_t *s_tail = NULL;
+static um_metrics_collect_fn s_collectors[UM_METRICS_MAX_COLLECTORS] = {collect_system};
+static uint8_t s_collector_count = 1;
+static portMUX_TYPE s_reg_mux = portMUX_INITIALIZER_UNLOCKED;
+// Гистограммы: бакеты и сумма меняются вместе
+static portMUX_TYPE s_hist_mux = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+// Снимок задач для collect_system: память выделена один раз, а не на каждый опрос
+static TaskStatus_t s_tasks[UM_METRICS_MAX_TASKS];
+static bool s_tasks_busy;
+#endif
+
+void um_metric_observe(um_metric_t *m, uint32_t value)
+{
+    uint8_t i = 0;
+    while (i < m->bucket_count && value > m->bounds[i]) {
+        i++;
+    }
+    portENTER_CRITICAL(&s_hist_mux);
+    m->buckets[i]++;
+    m->sum += value;
+    portEXIT_CRITICAL(&s_hist_mux);
+}
+
+esp_err_t um_metrics_register(um_metric_t *m)
+{
+    if (!m || !m->name || (m->type == UM_METRIC_HISTOGRAM && (!m->bounds || !m->buckets))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_reg_mux);
+    if (!m->registered) {
+        m->registered = true;
+        m->next = NULL;
+        if (s_tail) {
+            __atomic_store_n(&s_tail->next, m, __ATOMIC_RELEASE);
+        } else {
+            __atomic_store_n(&s_head, m, __ATOMIC_RELEASE);
+        }
+        s_tail = m;
+    }
+    portEXIT_CRITICAL(&s_reg_mux);
+    return ESP_OK;
+}
+
+esp_err_t um_metrics_register_collector(um_metrics_collect_fn fn)
+{
+    if (!fn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_reg_mux);
+    if (s_collector_count < UM_METRICS_MAX_COLLECTORS) {
+        s_collectors[s_collector_count++] = fn;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_reg_mux);
+    return ret;
+}
+
+static void out_flush(um_metrics_out_t *out)
+{
+    if (out->err == ESP_OK && out->len > 0) {
+        out->err = out->write(out->ctx, out->buf, out->len);
+    }
+    out->len = 0;
+}
+
+static void out_printf(um_metrics_out_t *out, const char *fmt, ...)
+{
+    if (out->err != ESP_OK) {
+        return;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t room = sizeof(out->buf) - out->len;
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(out->buf + out->len, room, fmt, args);
+        va_end(args);
+
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < room) {
+            out->len += n;
+            return;
+        }
+        if (out->len == 0) {
+            // Строка длиннее буфера: отдаём обрезанной, но с переводом строки
+            ESP_LOGW(TAG, "Line truncated: %.32s", out->buf);
+            out->buf[sizeof(out->buf) - 2] = '\n';
+            out->len = sizeof(out->buf) - 1;
+            return;
+        }
+        out_flush(out);
+    }
+}
+
+void um_metrics_family(um_metrics_out_t *out, const char *name, const char *help, um_metric_type_t type)
+{
+    static const char *const types[] = {"counter", "gauge", "histogram"};
+    if (help) {
+        out_printf(out, "# HELP %s %s\n", name, help);
+    }
+    out_printf(out, "# TYPE %s %s\n", name, types[type]);
+}
+
+void um_metrics_sample(um_metrics_out_t *out, const char *name, const char *labels, double value)
+{
+    char num[24];
+    if (isnan(value)) {
+        strcpy(num, "NaN");
+    } else {
+        snprintf(num, sizeof(num), "%.10g", value);
+    }
+
+    if (labels && labels[0]) {
+        out_printf(out, "%s{%s} %s\n", name, labels, num);
+    } else {
+        out_printf(out, "%s %s\n", name, num);
+    }
+}
+
+const char *um_metrics_label_value(char *dst, size_t size, const char *value)
+{
+    if (size == 0) {
+        return dst;
+    }
+
+    size_t n = 0;
+    for (; *value; value++) {
+        char c = *value;
+        bool esc = c == '\\' || c == '"' || c == '\n';
+        if (n + (esc ? 2 : 1) >= size) {
+            break;
+        }
+        if (esc) {
+            dst[n++] = '\\';
+            c = c == '\n' ? 'n' : c;
+        }
+        dst[n++] = c;
+    }
+    dst[n] = '\0';
+    return dst;
+}
+
+static void write_histogram(um_metrics_out_t *out, um_metric_t *m)
+{
+    uint32_t counts[m->bucket_count + 1];
+    uint64_t sum;
+    portENTER_CRITICAL(&s_hist_mux);
+    memcpy(counts, m->buckets, sizeof(counts));
+    sum = m->sum;
+    portEXIT_CRITICAL(&s_hist_mux);
+
+    float scale = m->scale != 0.0f ? m->scale : 1.0f;
+    const char *sep = m->labels ? "," : "";
+    const char *labels = m->labels ? m->labels : "";
+
+    uint64_t cumulative = 0;
+    for (uint8_t i = 0; i <= m->bucket_count; i++) {
+        cumulative += counts[i];
+        if (i < m->bucket_count) {
+            out_printf(out, "%s_bucket{%s%sle=\"%g\"} %llu\n", m->name, labels, sep,
+                       (double)m->bounds[i] * scale, (unsigned long long)cumulative);
+        } else {
+            out_printf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", m->name, labels, sep,
+                       (unsigned long long)cumulative);
+        }
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s_sum", m->name);
+    um_metrics_sample(out, name, m->labels, (double)sum * scale);
+    snprintf(name, sizeof(name), "%s_count", m->name);
+    um_metrics_sample(out, name, m->labels, (double)cumulative);
+}
+
+static void write_metric(um_metrics_out_t *out, um_metric_t *m)
+{
+    uint32_t value = __atomic_load_n(&m->value, __ATOMIC_RELAXED);
+    switch (m->type) {
+    case UM_METRIC_COUNTER:
+        um_metrics_sample(out, m->name, m->labels, (double)value);
+        break;
+    case UM_METRIC_GAUGE:
+        um_metrics_sample(out, m->name, m->labels, (double)(int32_t)value);
+        break;
+    case UM_METRIC_HISTOGRAM:
+        write_histogram(out, m);
+        break;
+    }
+}
+
+static um_metric_t *next_metric(um_metric_t *m)
+{
+    return __atomic_load_n(m ? &m->next : &s_head, __ATOMIC_ACQUIRE);
+}
+
+esp_err_t um_metrics_write(um_metrics_write_fn write, void *ctx)
+{
+    // ~300 байт на стеке вызывающего (задача httpd), без кучи
+    um_metrics_out_t out = {.write = write, .ctx = ctx, .err = ESP_OK, .len = 0};
+
+    for (um_metric_t *m = next_metric(NULL); m; m = next_metric(m)) {
+        // Семейство пишется целиком при первой встрече имени
+        bool seen = false;
+        for (um_metric_t *p = next_metric(NULL); p != m && !seen; p = next_metric(p)) {
+            seen = strcmp(p->name, m->name) == 0;
+        }
+        if (seen) {
+            continue;
+        }
+
+        um_metrics_family(&out, m->name, m->help, m->type);
+        for (um_metric_t *f = m; f; f = next_metric(f)) {
+            if (f == m || strcmp(f->name, m->name) == 0) {
+                write_metric(&out, f);
+            }
+        }
+    }
+
+    uint8_t count = s_collector_count;
+    for (uint8_t i = 0; i < count && out.err == ESP_OK; i++) {
+        s_collectors[i](&out);
+    }
+
+    out_flush(&out);
+    return out.err;
+}
+
+/**
+ * @brief Память, время работы и стеки задач
+ */
+static void collect_system(um_metrics_out_t *out)
+{
+    um_metrics_family(out, "um_uptime_seconds", "Time since boot", UM_METRIC_GAUGE);
+    um_metrics_sample(out, "um_uptime_seconds", NULL, esp_timer_get_time() / 1e6);
+
+    um_metrics_family(out, "um_heap_free_bytes", "Free heap", UM_METRIC_GAUGE);
+    um_metrics_sample(out, "um_heap_free_bytes", NULL, esp_get_free_heap_size());
+    um_metrics_family(out, "um_heap_min_free_bytes", "Lowest free heap since boot", UM_METRIC_GAUGE);
+    um_metrics_sample(out, "um_heap_min_free_bytes", NULL, esp_get_minimum_free_heap_size());
+    um_metrics_family(out, "um_heap_largest_free_block_bytes", "Largest allocatable block", UM_METRIC_GAUGE);
+    um_metrics_sample(out, "um_heap_largest_free_block_bytes", NULL,
+                      heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    // Снимок занят параллельным опросом: этот обходится без стеков задач
+    if (__atomic_test_and_set(&s_tasks_busy, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    // 0 - задач больше, чем помещается в снимок
+    UBaseType_t count = uxTaskGetSystemState(s_tasks, UM_METRICS_MAX_TASKS, NULL);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, stacks not reported", UM_METRICS_MAX_TASKS);
+    } else {
+        um_metrics_family(out, "um_task_stack_free_bytes", "Lowest free stack since task start", UM_METRIC_GAUGE);
+    }
+    for (UBaseType_t i = 0; i < count; i++) {
+        char name[2 * configMAX_TASK_NAME_LEN];
+        char labels[sizeof(name) + 8];
+        um_metrics_label_value(name, sizeof(name), s_tasks[i].pcTaskName);
+        snprintf(labels, sizeof(labels), "task=\"%s\"", name);
+        um_metrics_sample(out, "um_task_stack_free_bytes", labels, s_tasks[i].usStackHighWaterMark);
+    }
+    __atomic_clear(&s_tasks_busy, __ATOMIC_RELEASE);
+#endif
+}
+
+#endif // UM_FEATURE_ENABLED(METRICS)
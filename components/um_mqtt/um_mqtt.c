@@ -14,9 +14,19 @@
 
 #include "um_mqtt.h"
 #include "um_nvs.h"
+#include "um_metrics.h"
 
 static const char *TAG = "um_mqtt";
 
+static um_metric_t m_connected = UM_METRIC_GAUGE("um_mqtt_connected", "1 while connected to the broker");
+static um_metric_t m_connects = UM_METRIC_COUNTER("um_mqtt_connects_total", "Successful broker connections");
+static um_metric_t m_disconnects = UM_METRIC_COUNTER("um_mqtt_disconnects_total", "Broker disconnections");
+static um_metric_t m_errors = UM_METRIC_COUNTER("um_mqtt_errors_total", "MQTT_EVENT_ERROR events");
+static um_metric_t m_published = UM_METRIC_COUNTER("um_mqtt_published_total", "Messages queued for publishing");
+static um_metric_t m_publish_errors = UM_METRIC_COUNTER("um_mqtt_publish_errors_total",
+                                                        "Messages not published: offline or client error");
+static um_metric_t m_received = UM_METRIC_COUNTER("um_mqtt_received_total", "Messages received");
+
 // Структура состояния MQTT клиента
 typedef struct
 {
@@ -220,6 +230,8 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
     {
     case MQTT_EVENT_CONNECTED:
         mqtt_state.connected = true;
+        um_metric_set(&m_connected, 1);
+        um_metric_inc(&m_connects);
         ESP_LOGI(TAG, "Connected to MQTT broker: %s:%d",
                  mqtt_state.broker_url, mqtt_state.port);
 
@@ -244,6 +256,8 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
 
     case MQTT_EVENT_DISCONNECTED:
         mqtt_state.connected = false;
+        um_metric_set(&m_connected, 0);
+        um_metric_inc(&m_disconnects);
         ESP_LOGW(TAG, "Disconnected from MQTT broker");
 
         if (mqtt_state.register_task)
@@ -276,6 +290,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
 
         memcpy(topic, event->topic, topic_len);
         memcpy(data, event->data, data_len);
+        um_metric_inc(&m_received);
 
         ESP_LOGI(TAG, "Received data: topic=%s, data=%s", topic, data);
 
@@ -296,6 +311,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
     case MQTT_EVENT_ERROR:
     {
         ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
+        um_metric_inc(&m_errors);
 
         if (event->error_handle)
         {
@@ -388,6 +404,14 @@ void um_mqtt_init(const char *client_id)
         return;
     }
 
+    um_metrics_register(&m_connected);
+    um_metrics_register(&m_connects);
+    um_metrics_register(&m_disconnects);
+    um_metrics_register(&m_errors);
+    um_metrics_register(&m_published);
+    um_metrics_register(&m_publish_errors);
+    um_metrics_register(&m_received);
+
     // Загружаем конфигурацию из NVS
     load_config_from_nvs();
 
@@ -550,6 +574,7 @@ esp_err_t um_mqtt_publish(const char *topic, const char *data, int qos, int reta
 
     if (!mqtt_state.enabled || !mqtt_state.connected || !mqtt_state.client)
     {
+        um_metric_inc(&m_publish_errors);
         ESP_LOGW(TAG, "Cannot publish: enabled=%d, connected=%d, client=%p",
                  mqtt_state.enabled, mqtt_state.connected, mqtt_state.client);
         return ESP_FAIL;
@@ -565,9 +590,11 @@ esp_err_t um_mqtt_publish(const char *topic, const char *data, int qos, int reta
                                          data, 0, qos, retain);
     if (msg_id < 0)
     {
+        um_metric_inc(&m_publish_errors);
         ESP_LOGE(TAG, "Failed to publish to %s", full_topic);
         return ESP_FAIL;
     }
+    um_metric_inc(&m_published);
 
     ESP_LOGI(TAG, "Published to %s: %s", full_topic, data);
     log_free_heap(__FUNCTION__);
@@ -583,6 +610,7 @@ esp_err_t um_mqtt_publish_full(const char *full_topic, const char *data, int qos
 
     if (!mqtt_state.enabled || !mqtt_state.connected || !mqtt_state.client)
     {
+        um_metric_inc(&m_publish_errors);
         ESP_LOGW(TAG, "Cannot publish: enabled=%d, connected=%d, client=%p",
                  mqtt_state.enabled, mqtt_state.connected, mqtt_state.client);
         return ESP_FAIL;
@@ -592,9 +620,11 @@ esp_err_t um_mqtt_publish_full(const char *full_topic, const char *data, int qos
                                          data, 0, qos, retain);
     if (msg_id < 0)
     {
+        um_metric_inc(&m_publish_errors);
         ESP_LOGE(TAG, "Failed to publish to %s", full_topic);
         return ESP_FAIL;
     }
+    um_metric_inc(&m_published);
 
     ESP_LOGI(TAG, "Published to %s: %s", full_topic, data);
     return ESP_OK;
@@ -0,0 +1,39 @@
+#include <stdlib.h>
+#include "unity.h"
+#include "nvs_flash.h"
+#include "um_nvs.h"
+
+void test_um_nvs_concurrent_open(void);
+void test_um_nvs_task_namespace(void);
+void test_um_nvs_stress(void);
+void test_um_nvs_batch_owner(void);
+void test_um_nvs_config_migrates_legacy_keys(void);
+void test_um_nvs_config_long_legacy_string_not_dropped(void);
+void test_um_nvs_config_corrupted_blob_kept(void);
+void test_um_nvs_config_other_namespace(void);
+void test_um_nvs_config_load_time(void);
+
+void app_main(void)
+{
+    nvs_flash_erase();
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+
+    UNITY_BEGIN();
+    // До um_nvs_init(): мьютекс кэша создаётся лениво из нескольких задач
+    RUN_TEST(test_um_nvs_concurrent_open);
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_init());
+    RUN_TEST(test_um_nvs_task_namespace);
+    RUN_TEST(test_um_nvs_stress);
+    RUN_TEST(test_um_nvs_batch_owner);
+
+    RUN_TEST(test_um_nvs_config_migrates_legacy_keys);
+    RUN_TEST(test_um_nvs_config_long_legacy_string_not_dropped);
+    RUN_TEST(test_um_nvs_config_corrupted_blob_kept);
+    RUN_TEST(test_um_nvs_config_other_namespace);
+    RUN_TEST(test_um_nvs_config_load_time);
+    int failures = UNITY_END();
+
+    um_nvs_close();
+    exit(failures);
+}
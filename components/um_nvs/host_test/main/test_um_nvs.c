@@ -0,0 +1,268 @@
+/*
+ * Многопоточные тесты um_nvs: задачи одновременно читают и пишут namespace
+ * по умолчанию, пока другие задачи переключаются на свои namespace.
+ */
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "um_nvs.h"
+
+#define OPENERS 6
+#define READERS 3
+#define WRITERS 2
+#define SWITCHERS 2
+#define STRESS_MS 2000
+#define STRESS_KEY "stress"
+
+typedef struct
+{
+    SemaphoreHandle_t done;
+    volatile bool stop;
+    volatile uint32_t ops;
+    volatile uint32_t errors;
+    volatile uint32_t foreign; // значения из чужого namespace
+} stress_ctx_t;
+
+typedef struct
+{
+    stress_ctx_t *ctx;
+    const char *ns;
+    nvs_handle_t handle;
+    int id;
+} worker_t;
+
+static void opener_task(void *arg)
+{
+    worker_t *w = arg;
+    if (um_nvs_get_namespace_handle(w->ns, &w->handle) != ESP_OK)
+    {
+        w->handle = 0;
+    }
+    xSemaphoreGive(w->ctx->done);
+    vTaskDelete(NULL);
+}
+
+void test_um_nvs_concurrent_open(void)
+{
+    static const char *names[] = {"um_nvs", "t_other"};
+    stress_ctx_t ctx = {.done = xSemaphoreCreateCounting(OPENERS, 0)};
+    worker_t workers[OPENERS];
+
+    for (int i = 0; i < OPENERS; i++)
+    {
+        workers[i] = (worker_t){.ctx = &ctx, .ns = names[i % 2], .id = i};
+        xTaskCreate(opener_task, "opener", 4096, &workers[i], 5, NULL);
+    }
+    for (int i = 0; i < OPENERS; i++)
+    {
+        TEST_ASSERT_TRUE(xSemaphoreTake(ctx.done, pdMS_TO_TICKS(5000)));
+    }
+
+    // Один хэндл на namespace, сколько бы задач ни открывали его одновременно
+    for (int i = 0; i < OPENERS; i++)
+    {
+        TEST_ASSERT_NOT_EQUAL(0, workers[i].handle);
+        TEST_ASSERT_EQUAL(workers[i % 2].handle, workers[i].handle);
+    }
+    TEST_ASSERT_NOT_EQUAL(workers[0].handle, workers[1].handle);
+    vSemaphoreDelete(ctx.done);
+}
+
+void test_um_nvs_task_namespace(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_write_i64(STRESS_KEY, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_open("t_other"));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_write_i64(STRESS_KEY, -1));
+
+    int64_t value = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_read_i64(STRESS_KEY, &value));
+    TEST_ASSERT_EQUAL_INT64(-1, value);
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_open(UM_NVS_DEFAULT_NAMESPACE));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_read_i64(STRESS_KEY, &value));
+    TEST_ASSERT_EQUAL_INT64(1, value);
+}
+
+/*
+ * Читатели и писатели работают с namespace по умолчанию, где значения
+ * положительные; задачи-переключатели пишут отрицательные в свои namespace.
+ * Отрицательное значение у читателя значит, что чужой um_nvs_open() подменил
+ * его хэндл.
+ */
+static void reader_task(void *arg)
+{
+    worker_t *w = arg;
+    while (!w->ctx->stop)
+    {
+        int64_t value = 0;
+        esp_err_t err = um_nvs_read_i64(STRESS_KEY, &value);
+        if (err != ESP_OK)
+            w->ctx->errors++;
+        else if (value <= 0)
+            w->ctx->foreign++;
+        w->ctx->ops++;
+    }
+    xSemaphoreGive(w->ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void writer_task(void *arg)
+{
+    worker_t *w = arg;
+    for (int64_t i = 1; !w->ctx->stop; i++)
+    {
+        if (um_nvs_write_i64(STRESS_KEY, i) != ESP_OK)
+            w->ctx->errors++;
+        w->ctx->ops++;
+        vTaskDelay(1);
+    }
+    xSemaphoreGive(w->ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void switcher_task(void *arg)
+{
+    worker_t *w = arg;
+    int64_t own = -(w->id + 1);
+
+    while (!w->ctx->stop)
+    {
+        if (um_nvs_open(w->ns) != ESP_OK || um_nvs_write_i64(STRESS_KEY, own) != ESP_OK)
+        {
+            w->ctx->errors++;
+        }
+
+        int64_t value = 0;
+        if (um_nvs_read_i64(STRESS_KEY, &value) != ESP_OK)
+            w->ctx->errors++;
+        else if (value != own)
+            w->ctx->foreign++;
+
+        if (um_nvs_open(UM_NVS_DEFAULT_NAMESPACE) != ESP_OK)
+            w->ctx->errors++;
+        w->ctx->ops++;
+        vTaskDelay(1);
+    }
+    xSemaphoreGive(w->ctx->done);
+    vTaskDelete(NULL);
+}
+
+void test_um_nvs_stress(void)
+{
+    static const char *own_ns[SWITCHERS] = {"t_other", "t_sw1"};
+    stress_ctx_t ctx = {.done = xSemaphoreCreateCounting(READERS + WRITERS + SWITCHERS, 0)};
+    worker_t workers[READERS + WRITERS + SWITCHERS];
+    int n = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_write_i64(STRESS_KEY, 1));
+
+    for (int i = 0; i < READERS; i++, n++)
+    {
+        workers[n] = (worker_t){.ctx = &ctx, .id = n};
+        xTaskCreate(reader_task, "reader", 4096, &workers[n], 5, NULL);
+    }
+    for (int i = 0; i < WRITERS; i++, n++)
+    {
+        workers[n] = (worker_t){.ctx = &ctx, .id = n};
+        xTaskCreate(writer_task, "writer", 4096, &workers[n], 5, NULL);
+    }
+    for (int i = 0; i < SWITCHERS; i++, n++)
+    {
+        workers[n] = (worker_t){.ctx = &ctx, .ns = own_ns[i], .id = i};
+        xTaskCreate(switcher_task, "switcher", 4096, &workers[n], 5, NULL);
+    }
+
+    int64_t start = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(STRESS_MS));
+    ctx.stop = true;
+    for (int i = 0; i < n; i++)
+    {
+        TEST_ASSERT_TRUE(xSemaphoreTake(ctx.done, pdMS_TO_TICKS(5000)));
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start;
+
+    printf("%lu ops in %lld ms, %lu errors, %lu foreign values\n", (unsigned long)ctx.ops,
+           (long long)(elapsed_us / 1000), (unsigned long)ctx.errors, (unsigned long)ctx.foreign);
+    TEST_ASSERT_EQUAL(0, ctx.errors);
+    TEST_ASSERT_EQUAL(0, ctx.foreign);
+    TEST_ASSERT_GREATER_THAN(0, ctx.ops);
+
+    // Задачи вернулись к namespace по умолчанию и освободили свои записи
+    int64_t value = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_read_i64(STRESS_KEY, &value));
+    TEST_ASSERT_GREATER_THAN(0, value);
+    vSemaphoreDelete(ctx.done);
+}
+
+/*
+ * Пакет откладывает commit только своей задаче: nvs_commit подменён
+ * (-Wl,--wrap=nvs_commit, см. CMakeLists.txt) и считается.
+ */
+esp_err_t __real_nvs_commit(nvs_handle_t handle);
+
+static volatile uint32_t s_commits;
+
+esp_err_t __wrap_nvs_commit(nvs_handle_t handle)
+{
+    s_commits++;
+    return __real_nvs_commit(handle);
+}
+
+typedef struct
+{
+    SemaphoreHandle_t done;
+    bool batch_seen;
+    uint32_t commits;
+    esp_err_t write;
+    esp_err_t end;
+} other_ctx_t;
+
+static void other_writer_task(void *arg)
+{
+    other_ctx_t *o = arg;
+    o->batch_seen = um_nvs_batch_active();
+    uint32_t before = s_commits;
+    o->write = um_nvs_write_i64("batch_other", 2);
+    o->commits = s_commits - before;
+    // Закрыть чужой пакет нельзя
+    o->end = um_nvs_batch_end();
+    xSemaphoreGive(o->done);
+    vTaskDelete(NULL);
+}
+
+void test_um_nvs_batch_owner(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_batch_begin());
+    TEST_ASSERT_TRUE(um_nvs_batch_active());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_nvs_batch_begin());
+
+    uint32_t before = s_commits;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_write_i64("batch_a", 1));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_write_i64("batch_b", 1));
+    TEST_ASSERT_EQUAL(before, s_commits);
+
+    // Другая задача не ждёт пакета и коммитит свою запись сразу
+    other_ctx_t o = {.done = xSemaphoreCreateBinary()};
+    xTaskCreate(other_writer_task, "other", 4096, &o, 5, NULL);
+    TEST_ASSERT_TRUE(xSemaphoreTake(o.done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_FALSE(o.batch_seen);
+    TEST_ASSERT_EQUAL(ESP_OK, o.write);
+    TEST_ASSERT_EQUAL(1, o.commits);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, o.end);
+    TEST_ASSERT_TRUE(um_nvs_batch_active());
+
+    // Один commit на namespace в конце пакета
+    before = s_commits;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_batch_end());
+    TEST_ASSERT_EQUAL(before + 1, s_commits);
+    TEST_ASSERT_FALSE(um_nvs_batch_active());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_nvs_batch_end());
+
+    int64_t value = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_read_i64("batch_b", &value));
+    TEST_ASSERT_EQUAL_INT64(1, value);
+    vSemaphoreDelete(o.done);
+}
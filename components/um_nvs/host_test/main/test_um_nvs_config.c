@@ -0,0 +1,202 @@
+/*
+ * Перенос старых отдельных ключей в packed-конфиги и поведение при битом blob-е
+ */
+#include <string.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "esp_timer.h"
+#include "um_nvs.h"
+#include "um_nvs_config.h"
+
+static nvs_handle_t default_ns(void)
+{
+    nvs_handle_t handle = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_namespace_handle(UM_NVS_DEFAULT_NAMESPACE, &handle));
+    return handle;
+}
+
+static void write_legacy(nvs_handle_t h)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_erase_all(h));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_i8(h, UM_NVS_KEY_OT_CH, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_i8(h, UM_NVS_KEY_OT_CH_SETPOINT, 50));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_u16(h, UM_NVS_KEY_MQTT_PORT, 1884));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_str(h, UM_NVS_KEY_MQTT_HOST, "broker.local"));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_i8(h, UM_NVS_KEY_OUTPUTS_DATA, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_commit(h));
+}
+
+void test_um_nvs_config_migrates_legacy_keys(void)
+{
+    nvs_handle_t h = default_ns();
+    write_legacy(h);
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_init());
+
+    uint8_t setpoint = 0;
+    uint16_t port = 0;
+    bool dhw = false;
+    char *host = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_ot_ch_setpoint(&setpoint));
+    TEST_ASSERT_EQUAL(50, setpoint);
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, um_nvs_get_ot_dhw_enabled(&dhw));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_mqtt_port(&port));
+    TEST_ASSERT_EQUAL(1884, port);
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_mqtt_host(&host));
+    TEST_ASSERT_EQUAL_STRING("broker.local", host);
+    free(host);
+
+    // Перенесённые ключи удалены, чужие (outputs) не тронуты
+    int8_t i8 = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, nvs_get_i8(h, UM_NVS_KEY_OT_CH_SETPOINT, &i8));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_i8(h, UM_NVS_KEY_OUTPUTS_DATA, &i8));
+
+    // Повторная загрузка уже из blob-а
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_init());
+    um_nvs_ot_config_t ot;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_get(UM_NVS_CONFIG_OT, &ot, sizeof(ot)));
+    TEST_ASSERT_EQUAL(1, ot.ch);
+    TEST_ASSERT_EQUAL(50, ot.ch_setpoint);
+    TEST_ASSERT_EQUAL_HEX32(0x0A, ot.present);
+}
+
+void test_um_nvs_config_long_legacy_string_not_dropped(void)
+{
+    char long_host[80];
+    memset(long_host, 'h', sizeof(long_host) - 1);
+    long_host[sizeof(long_host) - 1] = '\0';
+
+    nvs_handle_t h = default_ns();
+    write_legacy(h);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_str(h, UM_NVS_KEY_MQTT_HOST, long_host));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_commit(h));
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, um_nvs_config_init());
+
+    // MQTT остался на отдельных ключах и читается целиком
+    char *host = NULL;
+    uint16_t port = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_mqtt_host(&host));
+    TEST_ASSERT_EQUAL_STRING(long_host, host);
+    free(host);
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_mqtt_port(&port));
+    TEST_ASSERT_EQUAL(1884, port);
+
+    // OpenTherm перенесён независимо
+    int8_t i8 = 0;
+    uint8_t setpoint = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, nvs_get_i8(h, UM_NVS_KEY_OT_CH_SETPOINT, &i8));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_ot_ch_setpoint(&setpoint));
+    TEST_ASSERT_EQUAL(50, setpoint);
+}
+
+void test_um_nvs_config_corrupted_blob_kept(void)
+{
+    nvs_handle_t h = default_ns();
+    write_legacy(h);
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_init());
+
+    // Один перевёрнутый бит в payload
+    uint8_t blob[512];
+    size_t len = sizeof(blob);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_blob(h, UM_NVS_KEY_CFG_OT, blob, &len));
+    blob[len - 1] ^= 0x04;
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_blob(h, UM_NVS_KEY_CFG_OT, blob, len));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_commit(h));
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, um_nvs_config_init());
+    TEST_ASSERT_TRUE(um_nvs_config_is_corrupted(UM_NVS_CONFIG_OT));
+    TEST_ASSERT_FALSE(um_nvs_config_is_corrupted(UM_NVS_CONFIG_MQTT));
+
+    // Значения по умолчанию только в RAM, blob во flash не перезаписан
+    uint8_t setpoint = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, um_nvs_get_ot_ch_setpoint(&setpoint));
+    uint8_t stored[512];
+    size_t stored_len = sizeof(stored);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_blob(h, UM_NVS_KEY_CFG_OT, stored, &stored_len));
+    TEST_ASSERT_EQUAL(len, stored_len);
+    TEST_ASSERT_EQUAL_MEMORY(blob, stored, len);
+
+    // Явная запись заменяет битый blob
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_set_ot_ch_setpoint(40));
+    TEST_ASSERT_FALSE(um_nvs_config_is_corrupted(UM_NVS_CONFIG_OT));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_init());
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_ot_ch_setpoint(&setpoint));
+    TEST_ASSERT_EQUAL(40, setpoint);
+}
+
+void test_um_nvs_config_other_namespace(void)
+{
+    nvs_handle_t h = default_ns();
+    write_legacy(h);
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_init());
+
+    // В другом namespace "ottbsp" - обычный ключ, а не поле cfg_ot
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_open("t_other"));
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_set_ot_ch_setpoint(77));
+    uint8_t setpoint = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_ot_ch_setpoint(&setpoint));
+    TEST_ASSERT_EQUAL(77, setpoint);
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_open(UM_NVS_DEFAULT_NAMESPACE));
+
+    nvs_handle_t other = 0;
+    int8_t raw = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_namespace_handle("t_other", &other));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_i8(other, UM_NVS_KEY_OT_CH_SETPOINT, &raw));
+    TEST_ASSERT_EQUAL(77, raw);
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_get_ot_ch_setpoint(&setpoint));
+    TEST_ASSERT_EQUAL(50, setpoint);
+}
+
+/*
+ * Время загрузки: все ключи OpenTherm и MQTT по одному против двух blob-ов
+ */
+void test_um_nvs_config_load_time(void)
+{
+    static const char *i8_keys[] = {
+        UM_NVS_KEY_OT_EN, UM_NVS_KEY_OT_CH, UM_NVS_KEY_OT_CH2, UM_NVS_KEY_OT_CH_SETPOINT,
+        UM_NVS_KEY_OT_DHW_SETPOINT, UM_NVS_KEY_OT_DHW, UM_NVS_KEY_OT_COOL, UM_NVS_KEY_OT_MOD,
+        UM_NVS_KEY_OT_OTC, UM_NVS_KEY_OT_HCR, UM_NVS_KEY_MQTT_ENABLED,
+    };
+    static const char *str_keys[] = {UM_NVS_KEY_MQTT_HOST, UM_NVS_KEY_MQTT_USER, UM_NVS_KEY_MQTT_PWD};
+    const int rounds = 50;
+
+    nvs_handle_t h = default_ns();
+    write_legacy(h);
+    for (int i = 0; i < sizeof(i8_keys) / sizeof(i8_keys[0]); i++)
+    {
+        nvs_set_i8(h, i8_keys[i], 1);
+    }
+    nvs_set_str(h, UM_NVS_KEY_MQTT_USER, "user");
+    nvs_set_str(h, UM_NVS_KEY_MQTT_PWD, "secret");
+    nvs_commit(h);
+
+    int64_t start = esp_timer_get_time();
+    for (int r = 0; r < rounds; r++)
+    {
+        int8_t i8;
+        uint16_t u16;
+        char str[UM_NVS_CFG_STR_MAX_LEN];
+        for (int i = 0; i < sizeof(i8_keys) / sizeof(i8_keys[0]); i++)
+        {
+            TEST_ASSERT_EQUAL(ESP_OK, nvs_get_i8(h, i8_keys[i], &i8));
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, nvs_get_u16(h, UM_NVS_KEY_MQTT_PORT, &u16));
+        for (int i = 0; i < sizeof(str_keys) / sizeof(str_keys[0]); i++)
+        {
+            size_t len = sizeof(str);
+            TEST_ASSERT_EQUAL(ESP_OK, nvs_get_str(h, str_keys[i], str, &len));
+        }
+    }
+    int64_t per_key_us = (esp_timer_get_time() - start) / rounds;
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_init()); // перенос
+    start = esp_timer_get_time();
+    for (int r = 0; r < rounds; r++)
+    {
+        TEST_ASSERT_EQUAL(ESP_OK, um_nvs_config_init());
+    }
+    int64_t packed_us = (esp_timer_get_time() - start) / rounds;
+
+    printf("Load OpenTherm + MQTT: 15 keys %lld us, 2 blobs %lld us\n",
+           (long long)per_key_us, (long long)packed_us);
+}
@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "nvs.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -63,6 +64,7 @@ extern "C"
 #define UM_NVS_KEY_WEBHOOKS_URL "whkurl"
 #define UM_NVS_KEY_OPENCOLLECTORS "ocols"
 #define UM_NVS_KEY_WEBSERVER_TOKEN "httptoken"
+#define UM_NVS_KEY_SD_FREQ "sdfreq"
 
 /* Default Values */
 #define UM_NVS_DEFAULT_NTP "0.ru.pool.ntp.org"
@@ -93,6 +95,19 @@ extern "C"
 #define UM_NVS_IP_TYPE_DHCP 1
 #define UM_NVS_IP_TYPE_STATIC 2
 
+// Namespace, открываемый um_nvs_init()
+#define UM_NVS_DEFAULT_NAMESPACE "um_nvs"
+
+// Максимальное количество одновременно открытых namespace
+#ifndef UM_NVS_MAX_NAMESPACES
+#define UM_NVS_MAX_NAMESPACES 4
+#endif
+
+// Сколько задач одновременно могут работать не с namespace по умолчанию
+#ifndef UM_NVS_MAX_TASK_NAMESPACES
+#define UM_NVS_MAX_TASK_NAMESPACES 8
+#endif
+
 // Маска для битового хранения
 #define OC1_STATE_MASK 0x01 // bit 0
 #define OC2_STATE_MASK 0x02 // bit 1
@@ -108,31 +123,73 @@ extern "C"
     esp_err_t um_nvs_init(void);
 
     /**
-     * @brief Open a namespace in NVS
+     * @brief Open a namespace in NVS for the calling task
      *
-     * Opens a specific namespace for read/write operations. Only one namespace
-     * can be open at a time.
+     * Makes the namespace the default one for the um_nvs_read_* / um_nvs_write_*
+     * calls of this task only; other tasks keep UM_NVS_DEFAULT_NAMESPACE.
+     * Opening UM_NVS_DEFAULT_NAMESPACE again releases the task's slot, do it
+     * before the task exits. Handles are cached per namespace and not closed.
      *
      * @param namespace Name of the namespace to open
-     * @return ESP_OK on success, error code on failure
-     * @note If a namespace is already open, it will be closed first
+     * @return ESP_OK on success, ESP_ERR_NO_MEM if UM_NVS_MAX_TASK_NAMESPACES
+     *         tasks already use their own namespace
      */
     esp_err_t um_nvs_open(const char *namespace);
 
     /**
-     * @brief Close the current namespace
+     * @brief Get cached handle for a namespace
+     *
+     * Opens the namespace on first use and keeps the handle until
+     * um_nvs_close(). The handle may be used from any task with the
+     * regular nvs_get_* / nvs_set_* API.
+     *
+     * @param namespace Name of the namespace
+     * @param[out] out_handle Cached handle
+     * @return ESP_OK on success, ESP_ERR_NO_MEM if UM_NVS_MAX_NAMESPACES reached
+     */
+    esp_err_t um_nvs_get_namespace_handle(const char *namespace, nvs_handle_t *out_handle);
+
+    /**
+     * @brief Close all cached namespaces
      *
-     * Closes the currently open namespace and frees associated resources.
+     * @warning Must not be called while other tasks still access NVS
      */
     void um_nvs_close(void);
 
     /**
-     * @brief Check if namespace is currently open
+     * @brief Check if the calling task has an open namespace
      *
      * @return true if a namespace is open, false otherwise
      */
     bool um_nvs_is_open(void);
 
+    /**
+     * @brief Start a write batch: commits are deferred until um_nvs_batch_end()
+     *
+     * Values are still written immediately, only nvs_commit() and packed
+     * config blobs are postponed, so several settings cost one commit per
+     * namespace. Only writes of the calling task are deferred: other tasks
+     * keep committing immediately and are not blocked. Batches from different
+     * tasks are serialized.
+     *
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE before um_nvs_init()
+     *         or if the calling task already has a batch open
+     */
+    esp_err_t um_nvs_batch_begin(void);
+
+    /**
+     * @brief Finish the batch: write packed configs and commit touched namespaces
+     *
+     * @return ESP_OK on success, first commit error otherwise,
+     *         ESP_ERR_INVALID_STATE if the calling task has no batch open
+     */
+    esp_err_t um_nvs_batch_end(void);
+
+    /**
+     * @brief Check if the calling task has a batch open (its commits are deferred)
+     */
+    bool um_nvs_batch_active(void);
+
     /**
      * @brief Check if system is installed
      *
@@ -275,6 +332,26 @@ extern "C"
      */
     esp_err_t um_nvs_write_str(const char *key, const char *value);
 
+    /**
+     * @brief Read binary blob from NVS
+     *
+     * @param key Key to read
+     * @param[out] out_value Destination buffer (NULL to query length)
+     * @param[in,out] length Buffer size in, blob size out
+     * @return ESP_OK on success, error code on failure
+     */
+    esp_err_t um_nvs_read_blob(const char *key, void *out_value, size_t *length);
+
+    /**
+     * @brief Write binary blob to NVS
+     *
+     * @param key Key to write
+     * @param value Data to write
+     * @param length Data size in bytes
+     * @return ESP_OK on success, error code on failure
+     */
+    esp_err_t um_nvs_write_blob(const char *key, const void *value, size_t length);
+
     /* Legacy getters (for backward compatibility - return default values on error) */
 
     /* System Getters */
@@ -289,7 +366,8 @@ extern "C"
     esp_err_t um_nvs_get_poweron_at(char **poweron_at);
     esp_err_t um_nvs_get_reset_at(char **reset_at);
 
-    /* System Setters */
+    /* System Setters (installed flag and credentials: publish UMNI_EVENT_CONFIG_SAVED
+       after writing, um_webserver keeps them in RAM until that event) */
     esp_err_t um_nvs_set_installed(bool installed);
     esp_err_t um_nvs_set_hostname(const char *hostname);
     esp_err_t um_nvs_set_macname(const char *macname);
@@ -0,0 +1,174 @@
+/**
+ * @file um_nvs_config.h
+ * @brief Packed, versioned NVS config blobs for hot settings
+ * @version 1.0.0
+ *
+ * Вместо десятка отдельных ключей (otch, otdhw, mqport, ...) каждая подсистема
+ * хранится одним blob-ом: заголовок (magic, версия схемы, длина, CRC32) и
+ * упакованная структура. При загрузке весь конфиг читается одним nvs_get_blob(),
+ * дальше геттеры работают из RAM.
+ *
+ * Схема только дополняется в конец структуры: старый blob читается как префикс,
+ * новые поля остаются незаданными (бит в present сброшен).
+ */
+
+#ifndef UM_NVS_CONFIG_H
+#define UM_NVS_CONFIG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Blob keys */
+#define UM_NVS_KEY_CFG_OT "cfg_ot"
+#define UM_NVS_KEY_CFG_MQTT "cfg_mqtt"
+
+/* Schema versions */
+#define UM_NVS_CFG_OT_VERSION 1
+#define UM_NVS_CFG_MQTT_VERSION 1
+
+/* String field sizes (including null terminator) */
+#define UM_NVS_CFG_MQTT_HOST_LEN 64
+#define UM_NVS_CFG_MQTT_USER_LEN 32
+#define UM_NVS_CFG_MQTT_PWD_LEN 64
+
+/* Longest string field of all packed configs */
+#define UM_NVS_CFG_STR_MAX_LEN 64
+
+    typedef enum
+    {
+        UM_NVS_CONFIG_OT = 0,
+        UM_NVS_CONFIG_MQTT,
+        UM_NVS_CONFIG_MAX
+    } um_nvs_config_id_t;
+
+    typedef enum
+    {
+        UM_NVS_FIELD_I8 = 0,
+        UM_NVS_FIELD_U16,
+        UM_NVS_FIELD_STR
+    } um_nvs_field_type_t;
+
+    /**
+     * @brief OpenTherm settings (bit N of present = N-th field is set)
+     */
+    typedef struct __attribute__((packed))
+    {
+        uint16_t present;
+        int8_t enabled;      // oten
+        int8_t ch;           // otch
+        int8_t ch2;          // otch2
+        int8_t ch_setpoint;  // ottbsp
+        int8_t dhw_setpoint; // otdhwsp
+        int8_t dhw;          // otdhw
+        int8_t cool;         // otcol
+        int8_t modulation;   // otmod
+        int8_t otc;          // ototc
+        int8_t hcr;          // othcr
+    } um_nvs_ot_config_t;
+
+    /**
+     * @brief MQTT settings (bit N of present = N-th field is set)
+     */
+    typedef struct __attribute__((packed))
+    {
+        uint16_t present;
+        int8_t enabled;                          // mqen
+        uint16_t port;                           // mqport
+        char host[UM_NVS_CFG_MQTT_HOST_LEN];     // mqhost
+        char username[UM_NVS_CFG_MQTT_USER_LEN]; // mquser
+        char password[UM_NVS_CFG_MQTT_PWD_LEN];  // mqpwd
+    } um_nvs_mqtt_config_t;
+
+    /**
+     * @brief Load all packed configs
+     *
+     * Читает каждый blob одним запросом. Если blob-а нет, переносит значения
+     * из старых отдельных ключей и удаляет их после проверки записанного blob-а.
+     * Если перенос не удался, подсистема остаётся на отдельных ключах.
+     * Битый blob не перезаписывается: в RAM значения по умолчанию (все поля
+     * не заданы) до первой записи настройки. Вызывается из um_nvs_init().
+     *
+     * @return ESP_OK on success, ESP_ERR_INVALID_CRC if a blob is corrupted,
+     *         ESP_ERR_INVALID_SIZE if a legacy string does not fit its field
+     */
+    esp_err_t um_nvs_config_init(void);
+
+    /**
+     * @brief Check if the config was loaded from a corrupted blob
+     *
+     * @return true until the config is written again
+     */
+    bool um_nvs_config_is_corrupted(um_nvs_config_id_t id);
+
+    /**
+     * @brief Copy whole subsystem config from RAM cache
+     *
+     * @param id Config ID
+     * @param[out] out Destination structure
+     * @param size Size of destination structure
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not loaded
+     */
+    esp_err_t um_nvs_config_get(um_nvs_config_id_t id, void *out, size_t size);
+
+    /**
+     * @brief Replace whole subsystem config and persist it as one blob
+     *
+     * @param id Config ID
+     * @param cfg Source structure (present mask is taken as is)
+     * @param size Size of source structure
+     * @return ESP_OK on success, error code on failure
+     */
+    esp_err_t um_nvs_config_set(um_nvs_config_id_t id, const void *cfg, size_t size);
+
+    /* Key-level access used by um_nvs_read_* / um_nvs_write_* */
+
+    /**
+     * @brief Read a legacy key from packed config
+     *
+     * @return ESP_ERR_NOT_SUPPORTED if the key is not packed,
+     *         ESP_ERR_NVS_NOT_FOUND if the field is not set
+     */
+    esp_err_t um_nvs_config_read_key(const char *key, um_nvs_field_type_t type,
+                                     void *out, size_t out_size);
+
+    /**
+     * @brief Write a legacy key into packed config
+     *
+     * Unchanged values are not written to flash.
+     *
+     * @return ESP_ERR_NOT_SUPPORTED if the key is not packed
+     */
+    esp_err_t um_nvs_config_write_key(const char *key, um_nvs_field_type_t type,
+                                      const void *value, size_t len);
+
+    /**
+     * @brief Mark a legacy key as unset in packed config
+     *
+     * @return ESP_ERR_NOT_SUPPORTED if the key is not packed
+     */
+    esp_err_t um_nvs_config_delete_key(const char *key);
+
+    /**
+     * @brief Write configs changed during a batch (called by um_nvs_batch_end)
+     *
+     * @return ESP_OK on success, first write error otherwise
+     */
+    esp_err_t um_nvs_config_flush(void);
+
+    /**
+     * @brief Drop cached values after namespace erase
+     */
+    void um_nvs_config_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UM_NVS_CONFIG_H */
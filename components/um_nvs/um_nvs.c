@@ -1,7 +1,7 @@
 /**
  * @file um_nvs.c
  * @brief Non-volatile storage management implementation
- * @version 2.0.0
+ * @version 2.2.0
  */
 
 #include <stdlib.h>
@@ -11,23 +11,168 @@
 #include "nvs.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "um_metrics.h"
+
+#ifdef CONFIG_UM_CFG_NVS_PACKED_CONFIG
+#include "um_nvs_config.h"
+
+/*
+ * Ключи из packed-конфигов обслуживаются из RAM-кэша um_nvs_config,
+ * но только в namespace по умолчанию: в других это обычные ключи.
+ */
+#define TRY_PACKED(handle, expr)                  \
+    do                                            \
+    {                                             \
+        if ((handle) == um_nvs_handle)            \
+        {                                         \
+            esp_err_t _packed = (expr);           \
+            if (_packed != ESP_ERR_NOT_SUPPORTED) \
+            {                                     \
+                return _packed;                   \
+            }                                     \
+        }                                         \
+    } while (0)
+#else
+#define TRY_PACKED(handle, expr) \
+    do                           \
+    {                            \
+    } while (0)
+#endif
 
 static const char *TAG = "nvs";
 
-static nvs_handle_t um_nvs_handle = 0;
-static char *current_namespace = NULL;
+/*
+ * Кэш хэндлов по namespace. Хэндл открывается один раз и живёт до
+ * um_nvs_close(), поэтому задачи могут работать с ним без блокировок:
+ * сам NVS потокобезопасен, мьютекс нужен только для изменения таблицы.
+ */
+typedef struct
+{
+    char name[NVS_KEY_NAME_MAX_SIZE];
+    nvs_handle_t handle;
+} um_nvs_ns_entry_t;
+
+static um_nvs_ns_entry_t ns_cache[UM_NVS_MAX_NAMESPACES];
+static SemaphoreHandle_t ns_lock = NULL;
+static StaticSemaphore_t ns_lock_buffer;
+static uint8_t ns_lock_state = 0; // 0 - нет, 1 - создаётся, 2 - готов
+
+/*
+ * Namespace для um_nvs_read_* / um_nvs_write_* выбирается для каждой задачи отдельно:
+ * задача, вызвавшая um_nvs_open(), получает запись в task_ns, остальные
+ * работают с UM_NVS_DEFAULT_NAMESPACE.
+ */
+typedef struct
+{
+    TaskHandle_t task;
+    nvs_handle_t handle;
+} um_nvs_task_ns_t;
+
+static um_nvs_task_ns_t task_ns[UM_NVS_MAX_TASK_NAMESPACES];
+static volatile uint8_t task_ns_count = 0;
+static portMUX_TYPE task_ns_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// Хэндл UM_NVS_DEFAULT_NAMESPACE, задаётся в um_nvs_init()
+static volatile nvs_handle_t um_nvs_handle = 0;
+
+/*
+ * Пакет записей: пока он открыт, commit_changes() задачи-владельца только
+ * запоминает хэндл, а um_nvs_batch_end() делает по одному commit на
+ * namespace. Записи других задач коммитятся сразу, как без пакета.
+ */
+static SemaphoreHandle_t batch_lock = NULL;
+static StaticSemaphore_t batch_lock_buffer;
+static TaskHandle_t batch_owner = NULL; // под batch_spinlock
+static nvs_handle_t batch_handles[UM_NVS_MAX_NAMESPACES];
+static portMUX_TYPE batch_spinlock = portMUX_INITIALIZER_UNLOCKED;
 
 /* Forward declarations */
-static esp_err_t commit_changes(void);
+static esp_err_t commit_changes(nvs_handle_t handle);
+
+static const uint32_t commit_bounds[] = UM_METRICS_US_BUCKETS;
+static uint32_t commit_buckets[sizeof(commit_bounds) / sizeof(commit_bounds[0]) + 1];
+static um_metric_t m_commits = UM_METRIC_COUNTER_L("um_nvs_commits_total", "NVS commits", "store=\"key\"");
+static um_metric_t m_commit_errors = UM_METRIC_COUNTER_L("um_nvs_commit_errors_total", "Failed NVS writes",
+                                                         "store=\"key\"");
+static um_metric_t m_commit_time = UM_METRIC_HISTOGRAM_L("um_nvs_commit_duration_seconds", "NVS commit time",
+                                                         "store=\"key\"", commit_bounds, commit_buckets, 1e-6f);
 
 /* String size limit for safety */
 #define NVS_MAX_STR_SIZE 1024
 
+/**
+ * @brief Snapshot of the calling task's handle
+ *
+ * Читаем один раз в начале операции, чтобы um_nvs_open() не подменил
+ * хэндл посередине. Пока ни одна задача не переключала namespace,
+ * таблица не просматривается.
+ */
+static nvs_handle_t default_handle(void)
+{
+    nvs_handle_t handle = um_nvs_handle;
+    if (task_ns_count == 0)
+    {
+        return handle;
+    }
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&task_ns_spinlock);
+    for (int i = 0; i < UM_NVS_MAX_TASK_NAMESPACES; i++)
+    {
+        if (task_ns[i].task == self)
+        {
+            handle = task_ns[i].handle;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&task_ns_spinlock);
+    return handle;
+}
+
+static SemaphoreHandle_t get_ns_lock(void)
+{
+    SemaphoreHandle_t lock = __atomic_load_n(&ns_lock, __ATOMIC_ACQUIRE);
+    if (lock != NULL)
+    {
+        return lock;
+    }
+
+    // Мьютекс создаёт первая задача, остальные ждут его появления
+    uint8_t expected = 0;
+    if (__atomic_compare_exchange_n(&ns_lock_state, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        lock = xSemaphoreCreateMutexStatic(&ns_lock_buffer);
+        __atomic_store_n(&ns_lock, lock, __ATOMIC_RELEASE);
+        __atomic_store_n(&ns_lock_state, 2, __ATOMIC_RELEASE);
+        return lock;
+    }
+    while ((lock = __atomic_load_n(&ns_lock, __ATOMIC_ACQUIRE)) == NULL)
+    {
+        vTaskDelay(1);
+    }
+    return lock;
+}
+
 /**
  * @brief Initialize NVS flash storage
  */
 esp_err_t um_nvs_init(void)
 {
+    get_ns_lock();
+    if (batch_lock == NULL)
+    {
+        batch_lock = xSemaphoreCreateMutexStatic(&batch_lock_buffer);
+    }
+
+    um_metrics_register(&m_commits);
+    um_metrics_register(&m_commit_errors);
+    um_metrics_register(&m_commit_time);
+
     esp_err_t err = nvs_flash_init();
 
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
@@ -43,83 +188,181 @@ esp_err_t um_nvs_init(void)
         return err;
     }
 
-    err = um_nvs_open("um_nvs");
+    nvs_handle_t handle = 0;
+    err = um_nvs_get_namespace_handle(UM_NVS_DEFAULT_NAMESPACE, &handle);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to open default namespace");
         return err;
     }
+    um_nvs_handle = handle;
+
+#ifdef CONFIG_UM_CFG_NVS_PACKED_CONFIG
+    err = um_nvs_config_init();
+    if (err != ESP_OK)
+    {
+        // Не фатально: подсистема работает на значениях по умолчанию или на отдельных ключах
+        ESP_LOGE(TAG, "Failed to load packed configs: %s", esp_err_to_name(err));
+    }
+#endif
 
     ESP_LOGI(TAG, "NVS initialized successfully");
     return ESP_OK;
 }
 
 /**
- * @brief Open NVS namespace
+ * @brief Get (or open) cached handle for namespace
  */
-esp_err_t um_nvs_open(const char *namespace)
+esp_err_t um_nvs_get_namespace_handle(const char *namespace, nvs_handle_t *out_handle)
 {
-    if (namespace == NULL)
+    if (namespace == NULL || out_handle == NULL)
     {
-        ESP_LOGE(TAG, "Namespace cannot be NULL");
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Закрыть предыдущий namespace если открыт
-    if (um_nvs_handle != 0)
+    if (strlen(namespace) >= NVS_KEY_NAME_MAX_SIZE)
+    {
+        ESP_LOGE(TAG, "Namespace name too long: %s", namespace);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    SemaphoreHandle_t lock = get_ns_lock();
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    um_nvs_ns_entry_t *free_slot = NULL;
+    for (int i = 0; i < UM_NVS_MAX_NAMESPACES; i++)
     {
-        ESP_LOGD(TAG, "Closing previous namespace: %s",
-                 current_namespace ? current_namespace : "NULL");
-        nvs_close(um_nvs_handle);
-        um_nvs_handle = 0;
+        if (ns_cache[i].handle != 0 && strcmp(ns_cache[i].name, namespace) == 0)
+        {
+            *out_handle = ns_cache[i].handle;
+            xSemaphoreGive(lock);
+            return ESP_OK;
+        }
+        if (ns_cache[i].handle == 0 && free_slot == NULL)
+        {
+            free_slot = &ns_cache[i];
+        }
     }
 
-    // Освободить предыдущее имя
-    if (current_namespace != NULL)
+    if (free_slot == NULL)
     {
-        free(current_namespace);
-        current_namespace = NULL;
+        xSemaphoreGive(lock);
+        ESP_LOGE(TAG, "Too many open namespaces (max %d)", UM_NVS_MAX_NAMESPACES);
+        return ESP_ERR_NO_MEM;
     }
 
-    esp_err_t err = nvs_open(namespace, NVS_READWRITE, &um_nvs_handle);
+    nvs_handle_t handle = 0;
+    esp_err_t err = nvs_open(namespace, NVS_READWRITE, &handle);
     if (err != ESP_OK)
     {
+        xSemaphoreGive(lock);
         ESP_LOGE(TAG, "Failed to open NVS namespace '%s': %s",
                  namespace, esp_err_to_name(err));
         return err;
     }
 
-    current_namespace = strdup(namespace);
-    if (current_namespace == NULL)
+    strncpy(free_slot->name, namespace, sizeof(free_slot->name) - 1);
+    free_slot->name[sizeof(free_slot->name) - 1] = '\0';
+    free_slot->handle = handle;
+    xSemaphoreGive(lock);
+
+    ESP_LOGI(TAG, "Opened NVS namespace: %s", namespace);
+    *out_handle = handle;
+    return ESP_OK;
+}
+
+/**
+ * @brief Open NVS namespace for the calling task
+ */
+esp_err_t um_nvs_open(const char *namespace)
+{
+    if (namespace == NULL)
+    {
+        ESP_LOGE(TAG, "Namespace cannot be NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle = 0;
+    esp_err_t err = um_nvs_get_namespace_handle(namespace, &handle);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to allocate memory for namespace");
-        nvs_close(um_nvs_handle);
-        um_nvs_handle = 0;
+        return err;
+    }
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    // Возврат к namespace по умолчанию освобождает запись задачи
+    bool is_default = (handle == um_nvs_handle);
+
+    portENTER_CRITICAL(&task_ns_spinlock);
+    um_nvs_task_ns_t *slot = NULL;
+    for (int i = 0; i < UM_NVS_MAX_TASK_NAMESPACES; i++)
+    {
+        if (task_ns[i].task == self)
+        {
+            slot = &task_ns[i];
+            break;
+        }
+        if (task_ns[i].task == NULL && slot == NULL)
+        {
+            slot = &task_ns[i];
+        }
+    }
+    if (slot != NULL)
+    {
+        if (slot->task == self && is_default)
+        {
+            slot->task = NULL;
+            slot->handle = 0;
+            task_ns_count--;
+        }
+        else if (!is_default)
+        {
+            if (slot->task == NULL)
+            {
+                slot->task = self;
+                task_ns_count++;
+            }
+            slot->handle = handle;
+        }
+    }
+    portEXIT_CRITICAL(&task_ns_spinlock);
+
+    if (slot == NULL && !is_default)
+    {
+        ESP_LOGE(TAG, "Too many tasks with own namespace (max %d)", UM_NVS_MAX_TASK_NAMESPACES);
         return ESP_ERR_NO_MEM;
     }
 
-    ESP_LOGI(TAG, "Opened NVS namespace: %s", namespace);
+    ESP_LOGD(TAG, "Task namespace: %s", namespace);
     return ESP_OK;
 }
 
 /**
- * @brief Close NVS namespace
+ * @brief Close all NVS namespaces
  */
 void um_nvs_close(void)
 {
-    if (um_nvs_handle != 0)
-    {
-        nvs_close(um_nvs_handle);
-        um_nvs_handle = 0;
-    }
+    SemaphoreHandle_t lock = get_ns_lock();
+    xSemaphoreTake(lock, portMAX_DELAY);
 
-    if (current_namespace != NULL)
+    portENTER_CRITICAL(&task_ns_spinlock);
+    memset(task_ns, 0, sizeof(task_ns));
+    task_ns_count = 0;
+    portEXIT_CRITICAL(&task_ns_spinlock);
+
+    um_nvs_handle = 0;
+    for (int i = 0; i < UM_NVS_MAX_NAMESPACES; i++)
     {
-        free(current_namespace);
-        current_namespace = NULL;
+        if (ns_cache[i].handle != 0)
+        {
+            nvs_close(ns_cache[i].handle);
+            ns_cache[i].handle = 0;
+            ns_cache[i].name[0] = '\0';
+        }
     }
 
-    ESP_LOGI(TAG, "NVS namespace closed");
+    xSemaphoreGive(lock);
+    ESP_LOGI(TAG, "NVS namespaces closed");
 }
 
 /**
@@ -127,7 +370,7 @@ void um_nvs_close(void)
  */
 bool um_nvs_is_open(void)
 {
-    return (um_nvs_handle != 0);
+    return (default_handle() != 0);
 }
 
 /**
@@ -158,26 +401,34 @@ bool um_nvs_is_installed(void)
  */
 esp_err_t um_nvs_erase(void)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         ESP_LOGE(TAG, "NVS not opened");
         return ESP_ERR_INVALID_STATE;
     }
 
-    esp_err_t err = nvs_erase_all(um_nvs_handle);
+    esp_err_t err = nvs_erase_all(handle);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to erase NVS: %s", esp_err_to_name(err));
         return err;
     }
 
-    err = commit_changes();
+    err = commit_changes(handle);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to commit erase: %s", esp_err_to_name(err));
         return err;
     }
 
+#ifdef CONFIG_UM_CFG_NVS_PACKED_CONFIG
+    if (handle == um_nvs_handle)
+    {
+        um_nvs_config_reset();
+    }
+#endif
+
     ESP_LOGI(TAG, "NVS erased successfully");
     return ESP_OK;
 }
@@ -187,7 +438,8 @@ esp_err_t um_nvs_erase(void)
  */
 esp_err_t um_nvs_delete_key(const char *key)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -197,35 +449,143 @@ esp_err_t um_nvs_delete_key(const char *key)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_erase_key(um_nvs_handle, key);
+    TRY_PACKED(handle, um_nvs_config_delete_key(key));
+
+    esp_err_t err = nvs_erase_key(handle, key);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to delete key '%s': %s", key, esp_err_to_name(err));
         return err;
     }
 
-    return commit_changes();
+    return commit_changes(handle);
+}
+
+// Вызывается под batch_spinlock
+static bool batch_owned(void)
+{
+    return batch_owner != NULL && batch_owner == xTaskGetCurrentTaskHandle();
+}
+
+/**
+ * @brief Remember handle to commit at the end of the batch
+ *
+ * @return false if the calling task has no batch open or the table is full (commit now)
+ */
+static bool batch_defer(nvs_handle_t handle)
+{
+    bool deferred = false;
+    portENTER_CRITICAL(&batch_spinlock);
+    if (batch_owned())
+    {
+        for (int i = 0; i < UM_NVS_MAX_NAMESPACES && !deferred; i++)
+        {
+            if (batch_handles[i] == handle || batch_handles[i] == 0)
+            {
+                batch_handles[i] = handle;
+                deferred = true;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&batch_spinlock);
+    return deferred;
 }
 
 /**
  * @brief Commit changes to NVS
  */
-static esp_err_t commit_changes(void)
+static esp_err_t commit_changes(nvs_handle_t handle)
 {
-    if (um_nvs_handle == 0)
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
 
-    esp_err_t err = nvs_commit(um_nvs_handle);
+    if (batch_defer(handle))
+    {
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = nvs_commit(handle);
+    um_metric_observe(&m_commit_time, (uint32_t)(esp_timer_get_time() - start_us));
+    um_metric_inc(&m_commits);
     if (err != ESP_OK)
     {
+        um_metric_inc(&m_commit_errors);
         ESP_LOGE(TAG, "Failed to commit changes: %s", esp_err_to_name(err));
     }
 
     return err;
 }
 
+esp_err_t um_nvs_batch_begin(void)
+{
+    if (batch_lock == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Вложенный пакет ждал бы сам себя
+    if (um_nvs_batch_active())
+    {
+        ESP_LOGE(TAG, "Nested batch");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(batch_lock, portMAX_DELAY);
+    portENTER_CRITICAL(&batch_spinlock);
+    memset(batch_handles, 0, sizeof(batch_handles));
+    batch_owner = xTaskGetCurrentTaskHandle();
+    portEXIT_CRITICAL(&batch_spinlock);
+    return ESP_OK;
+}
+
+esp_err_t um_nvs_batch_end(void)
+{
+    nvs_handle_t handles[UM_NVS_MAX_NAMESPACES];
+
+    portENTER_CRITICAL(&batch_spinlock);
+    bool owned = batch_owned();
+    if (owned)
+    {
+        batch_owner = NULL;
+        memcpy(handles, batch_handles, sizeof(handles));
+    }
+    portEXIT_CRITICAL(&batch_spinlock);
+
+    if (!owned)
+    {
+        ESP_LOGE(TAG, "Batch end without batch begin");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_OK;
+#ifdef CONFIG_UM_CFG_NVS_PACKED_CONFIG
+    ret = um_nvs_config_flush();
+#endif
+
+    for (int i = 0; i < UM_NVS_MAX_NAMESPACES && handles[i] != 0; i++)
+    {
+        esp_err_t err = commit_changes(handles[i]);
+        if (ret == ESP_OK)
+        {
+            ret = err;
+        }
+    }
+
+    xSemaphoreGive(batch_lock);
+    return ret;
+}
+
+bool um_nvs_batch_active(void)
+{
+    portENTER_CRITICAL(&batch_spinlock);
+    bool owned = batch_owned();
+    portEXIT_CRITICAL(&batch_spinlock);
+    return owned;
+}
+
 /**
  * @brief Initialize NVS with default values
  */
@@ -289,7 +649,8 @@ esp_err_t um_nvs_initialize_with_defaults(void)
 
 esp_err_t um_nvs_read_i8(const char *key, int8_t *out_value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -299,7 +660,9 @@ esp_err_t um_nvs_read_i8(const char *key, int8_t *out_value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_get_i8(um_nvs_handle, key, out_value);
+    TRY_PACKED(handle, um_nvs_config_read_key(key, UM_NVS_FIELD_I8, out_value, sizeof(*out_value)));
+
+    esp_err_t err = nvs_get_i8(handle, key, out_value);
     if (err != ESP_OK)
     {
         ESP_LOGD(TAG, "Key '%s' not found: %s", key, esp_err_to_name(err));
@@ -312,7 +675,8 @@ esp_err_t um_nvs_read_i8(const char *key, int8_t *out_value)
 
 esp_err_t um_nvs_read_i16(const char *key, int16_t *out_value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -322,7 +686,7 @@ esp_err_t um_nvs_read_i16(const char *key, int16_t *out_value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_get_i16(um_nvs_handle, key, out_value);
+    esp_err_t err = nvs_get_i16(handle, key, out_value);
     if (err != ESP_OK)
     {
         ESP_LOGD(TAG, "Key '%s' not found: %s", key, esp_err_to_name(err));
@@ -335,7 +699,8 @@ esp_err_t um_nvs_read_i16(const char *key, int16_t *out_value)
 
 esp_err_t um_nvs_read_i64(const char *key, int64_t *out_value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -345,7 +710,7 @@ esp_err_t um_nvs_read_i64(const char *key, int64_t *out_value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_get_i64(um_nvs_handle, key, out_value);
+    esp_err_t err = nvs_get_i64(handle, key, out_value);
     if (err != ESP_OK)
     {
         ESP_LOGD(TAG, "Key '%s' not found: %s", key, esp_err_to_name(err));
@@ -358,7 +723,8 @@ esp_err_t um_nvs_read_i64(const char *key, int64_t *out_value)
 
 esp_err_t um_nvs_read_u16(const char *key, uint16_t *out_value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -368,7 +734,9 @@ esp_err_t um_nvs_read_u16(const char *key, uint16_t *out_value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_get_u16(um_nvs_handle, key, out_value);
+    TRY_PACKED(handle, um_nvs_config_read_key(key, UM_NVS_FIELD_U16, out_value, sizeof(*out_value)));
+
+    esp_err_t err = nvs_get_u16(handle, key, out_value);
     if (err != ESP_OK)
     {
         ESP_LOGD(TAG, "Key '%s' not found: %s", key, esp_err_to_name(err));
@@ -386,7 +754,8 @@ esp_err_t um_nvs_read_str(const char *key, char **out_value)
 
 esp_err_t um_nvs_read_str_len(const char *key, char **out_value, size_t max_len)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -399,9 +768,31 @@ esp_err_t um_nvs_read_str_len(const char *key, char **out_value, size_t max_len)
     // Инициализируем выходной параметр
     *out_value = NULL;
 
+#ifdef CONFIG_UM_CFG_NVS_PACKED_CONFIG
+    char packed[UM_NVS_CFG_STR_MAX_LEN];
+    esp_err_t packed_err = ESP_ERR_NOT_SUPPORTED;
+    if (handle == um_nvs_handle)
+    {
+        packed_err = um_nvs_config_read_key(key, UM_NVS_FIELD_STR, packed, sizeof(packed));
+    }
+    if (packed_err != ESP_ERR_NOT_SUPPORTED)
+    {
+        if (packed_err != ESP_OK)
+        {
+            return packed_err;
+        }
+        if (strlen(packed) + 1 > max_len)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        *out_value = strdup(packed);
+        return (*out_value != NULL) ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+#endif
+
     // Получаем размер строки
     size_t required_size = 0;
-    esp_err_t err = nvs_get_str(um_nvs_handle, key, NULL, &required_size);
+    esp_err_t err = nvs_get_str(handle, key, NULL, &required_size);
     if (err != ESP_OK)
     {
         ESP_LOGD(TAG, "Key '%s' not found: %s", key, esp_err_to_name(err));
@@ -436,7 +827,7 @@ esp_err_t um_nvs_read_str_len(const char *key, char **out_value, size_t max_len)
     }
 
     // Читаем строку
-    err = nvs_get_str(um_nvs_handle, key, value, &required_size);
+    err = nvs_get_str(handle, key, value, &required_size);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to read string '%s': %s", key, esp_err_to_name(err));
@@ -453,7 +844,8 @@ esp_err_t um_nvs_read_str_len(const char *key, char **out_value, size_t max_len)
 
 esp_err_t um_nvs_write_i8(const char *key, int8_t value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -463,21 +855,24 @@ esp_err_t um_nvs_write_i8(const char *key, int8_t value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_set_i8(um_nvs_handle, key, value);
+    TRY_PACKED(handle, um_nvs_config_write_key(key, UM_NVS_FIELD_I8, &value, sizeof(value)));
+
+    esp_err_t err = nvs_set_i8(handle, key, value);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to write i8 '%s': %s", key, esp_err_to_name(err));
         return err;
     }
 
-    err = commit_changes();
+    err = commit_changes(handle);
     ESP_LOGD(TAG, "Write i8: %s = %d", key, value);
     return err;
 }
 
 esp_err_t um_nvs_write_i16(const char *key, int16_t value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -487,21 +882,22 @@ esp_err_t um_nvs_write_i16(const char *key, int16_t value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_set_i16(um_nvs_handle, key, value);
+    esp_err_t err = nvs_set_i16(handle, key, value);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to write i16 '%s': %s", key, esp_err_to_name(err));
         return err;
     }
 
-    err = commit_changes();
+    err = commit_changes(handle);
     ESP_LOGD(TAG, "Write i16: %s = %d", key, value);
     return err;
 }
 
 esp_err_t um_nvs_write_u16(const char *key, uint16_t value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -511,21 +907,24 @@ esp_err_t um_nvs_write_u16(const char *key, uint16_t value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_set_u16(um_nvs_handle, key, value);
+    TRY_PACKED(handle, um_nvs_config_write_key(key, UM_NVS_FIELD_U16, &value, sizeof(value)));
+
+    esp_err_t err = nvs_set_u16(handle, key, value);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to write u16 '%s': %s", key, esp_err_to_name(err));
         return err;
     }
 
-    err = commit_changes();
+    err = commit_changes(handle);
     ESP_LOGD(TAG, "Write u16: %s = %u", key, value);
     return err;
 }
 
 esp_err_t um_nvs_write_i64(const char *key, int64_t value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -535,21 +934,22 @@ esp_err_t um_nvs_write_i64(const char *key, int64_t value)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_set_i64(um_nvs_handle, key, value);
+    esp_err_t err = nvs_set_i64(handle, key, value);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to write i64 '%s': %s", key, esp_err_to_name(err));
         return err;
     }
 
-    err = commit_changes();
+    err = commit_changes(handle);
     ESP_LOGD(TAG, "Write i64: %s = %lld", key, value);
     return err;
 }
 
 esp_err_t um_nvs_write_str(const char *key, const char *value)
 {
-    if (um_nvs_handle == 0)
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
     {
         return ESP_ERR_INVALID_STATE;
     }
@@ -565,18 +965,69 @@ esp_err_t um_nvs_write_str(const char *key, const char *value)
         return um_nvs_delete_key(key);
     }
 
-    esp_err_t err = nvs_set_str(um_nvs_handle, key, value);
+    TRY_PACKED(handle, um_nvs_config_write_key(key, UM_NVS_FIELD_STR, value, strlen(value) + 1));
+
+    esp_err_t err = nvs_set_str(handle, key, value);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to write str '%s': %s", key, esp_err_to_name(err));
         return err;
     }
 
-    err = commit_changes();
+    err = commit_changes(handle);
     ESP_LOGD(TAG, "Write str: %s = %s", key, value);
     return err;
 }
 
+esp_err_t um_nvs_read_blob(const char *key, void *out_value, size_t *length)
+{
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (key == NULL || length == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_get_blob(handle, key, out_value, length);
+    if (err != ESP_OK)
+    {
+        ESP_LOGD(TAG, "Key '%s' not found: %s", key, esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGD(TAG, "Read blob: %s (%d bytes)", key, *length);
+    return ESP_OK;
+}
+
+esp_err_t um_nvs_write_blob(const char *key, const void *value, size_t length)
+{
+    nvs_handle_t handle = default_handle();
+    if (handle == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (key == NULL || value == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_set_blob(handle, key, value, length);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to write blob '%s': %s", key, esp_err_to_name(err));
+        return err;
+    }
+
+    err = commit_changes(handle);
+    ESP_LOGD(TAG, "Write blob: %s (%d bytes)", key, length);
+    return err;
+}
+
 /* Legacy getters implementation (backward compatibility) */
 
 bool um_nvs_get_installed(void)
@@ -0,0 +1,652 @@
+/**
+ * @file um_nvs_config.c
+ * @brief Packed, versioned NVS config blobs for hot settings
+ * @version 1.0.0
+ */
+
+#include <string.h>
+#include "um_nvs.h"
+#include "um_nvs_config.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "um_metrics.h"
+
+static const char *TAG = "nvs_cfg";
+
+static const uint32_t commit_bounds[] = UM_METRICS_US_BUCKETS;
+static uint32_t commit_buckets[sizeof(commit_bounds) / sizeof(commit_bounds[0]) + 1];
+static um_metric_t m_commits = UM_METRIC_COUNTER_L("um_nvs_commits_total", "NVS commits", "store=\"packed\"");
+static um_metric_t m_commit_errors = UM_METRIC_COUNTER_L("um_nvs_commit_errors_total", "Failed NVS writes",
+                                                         "store=\"packed\"");
+static um_metric_t m_commit_time = UM_METRIC_HISTOGRAM_L("um_nvs_commit_duration_seconds", "NVS commit time",
+                                                         "store=\"packed\"", commit_bounds, commit_buckets, 1e-6f);
+
+#define CFG_MAGIC 0x4355 // "UC"
+
+/* Заголовок blob-а, за ним идёт упакованная структура */
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t length; // длина payload
+    uint32_t crc;    // CRC32 payload
+} cfg_header_t;
+
+// Старые отдельные ключи ещё не удалены (перенос прервался перезагрузкой)
+#define CFG_FLAG_LEGACY 0x01
+
+/* С запасом под будущие версии схемы */
+#define CFG_BLOB_MAX_SIZE 512
+
+typedef struct
+{
+    const char *key; // старый отдельный ключ
+    um_nvs_field_type_t type;
+    uint16_t offset;
+    uint16_t size;
+} cfg_field_t;
+
+typedef struct
+{
+    const char *blob_key;
+    uint8_t version;
+    const cfg_field_t *fields;
+    uint8_t field_count;
+    uint8_t *cache;
+    uint16_t size;
+    bool loaded;
+    bool dirty;   // изменён внутри пакета, ещё не записан
+    bool corrupt; // blob не прошёл проверку, в RAM значения по умолчанию
+} cfg_desc_t;
+
+#define CFG_FIELD(k, t, s, m) {k, t, offsetof(s, m), sizeof(((s *)0)->m)}
+
+static const cfg_field_t ot_fields[] = {
+    CFG_FIELD(UM_NVS_KEY_OT_EN, UM_NVS_FIELD_I8, um_nvs_ot_config_t, enabled),
+    CFG_FIELD(UM_NVS_KEY_OT_CH, UM_NVS_FIELD_I8, um_nvs_ot_config_t, ch),
+    CFG_FIELD(UM_NVS_KEY_OT_CH2, UM_NVS_FIELD_I8, um_nvs_ot_config_t, ch2),
+    CFG_FIELD(UM_NVS_KEY_OT_CH_SETPOINT, UM_NVS_FIELD_I8, um_nvs_ot_config_t, ch_setpoint),
+    CFG_FIELD(UM_NVS_KEY_OT_DHW_SETPOINT, UM_NVS_FIELD_I8, um_nvs_ot_config_t, dhw_setpoint),
+    CFG_FIELD(UM_NVS_KEY_OT_DHW, UM_NVS_FIELD_I8, um_nvs_ot_config_t, dhw),
+    CFG_FIELD(UM_NVS_KEY_OT_COOL, UM_NVS_FIELD_I8, um_nvs_ot_config_t, cool),
+    CFG_FIELD(UM_NVS_KEY_OT_MOD, UM_NVS_FIELD_I8, um_nvs_ot_config_t, modulation),
+    CFG_FIELD(UM_NVS_KEY_OT_OTC, UM_NVS_FIELD_I8, um_nvs_ot_config_t, otc),
+    CFG_FIELD(UM_NVS_KEY_OT_HCR, UM_NVS_FIELD_I8, um_nvs_ot_config_t, hcr),
+};
+
+static const cfg_field_t mqtt_fields[] = {
+    CFG_FIELD(UM_NVS_KEY_MQTT_ENABLED, UM_NVS_FIELD_I8, um_nvs_mqtt_config_t, enabled),
+    CFG_FIELD(UM_NVS_KEY_MQTT_PORT, UM_NVS_FIELD_U16, um_nvs_mqtt_config_t, port),
+    CFG_FIELD(UM_NVS_KEY_MQTT_HOST, UM_NVS_FIELD_STR, um_nvs_mqtt_config_t, host),
+    CFG_FIELD(UM_NVS_KEY_MQTT_USER, UM_NVS_FIELD_STR, um_nvs_mqtt_config_t, username),
+    CFG_FIELD(UM_NVS_KEY_MQTT_PWD, UM_NVS_FIELD_STR, um_nvs_mqtt_config_t, password),
+};
+
+static um_nvs_ot_config_t ot_cache;
+static um_nvs_mqtt_config_t mqtt_cache;
+
+static cfg_desc_t configs[UM_NVS_CONFIG_MAX] = {
+    [UM_NVS_CONFIG_OT] = {
+        .blob_key = UM_NVS_KEY_CFG_OT,
+        .version = UM_NVS_CFG_OT_VERSION,
+        .fields = ot_fields,
+        .field_count = sizeof(ot_fields) / sizeof(ot_fields[0]),
+        .cache = (uint8_t *)&ot_cache,
+        .size = sizeof(ot_cache),
+    },
+    [UM_NVS_CONFIG_MQTT] = {
+        .blob_key = UM_NVS_KEY_CFG_MQTT,
+        .version = UM_NVS_CFG_MQTT_VERSION,
+        .fields = mqtt_fields,
+        .field_count = sizeof(mqtt_fields) / sizeof(mqtt_fields[0]),
+        .cache = (uint8_t *)&mqtt_cache,
+        .size = sizeof(mqtt_cache),
+    },
+};
+
+_Static_assert(sizeof(ot_fields) / sizeof(ot_fields[0]) <= 16, "present mask is 16 bit");
+_Static_assert(sizeof(mqtt_fields) / sizeof(mqtt_fields[0]) <= 16, "present mask is 16 bit");
+_Static_assert(sizeof(cfg_header_t) + sizeof(um_nvs_mqtt_config_t) <= CFG_BLOB_MAX_SIZE, "blob buffer");
+
+/*
+ * Кэш читается из любых задач под спинлоком (копирование пары байт),
+ * запись во flash сериализуется мьютексом, чтобы blob-ы не перемешались.
+ */
+static portMUX_TYPE cache_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t write_lock = NULL;
+static StaticSemaphore_t write_lock_buffer;
+
+static inline uint16_t get_present(const cfg_desc_t *d)
+{
+    uint16_t present;
+    memcpy(&present, d->cache, sizeof(present));
+    return present;
+}
+
+static inline void set_present(cfg_desc_t *d, uint16_t present)
+{
+    memcpy(d->cache, &present, sizeof(present));
+}
+
+static esp_err_t get_handle(nvs_handle_t *handle)
+{
+    return um_nvs_get_namespace_handle(UM_NVS_DEFAULT_NAMESPACE, handle);
+}
+
+static bool find_key(const char *key, cfg_desc_t **out_desc, uint8_t *out_index)
+{
+    for (int c = 0; c < UM_NVS_CONFIG_MAX; c++)
+    {
+        for (uint8_t i = 0; i < configs[c].field_count; i++)
+        {
+            if (strcmp(configs[c].fields[i].key, key) == 0)
+            {
+                *out_desc = &configs[c];
+                *out_index = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Write snapshot of cached config as one blob and commit
+ */
+static esp_err_t write_blob(cfg_desc_t *d, nvs_handle_t handle, uint8_t flags)
+{
+    uint8_t buf[CFG_BLOB_MAX_SIZE];
+    cfg_header_t *hdr = (cfg_header_t *)buf;
+
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+
+    portENTER_CRITICAL(&cache_spinlock);
+    memcpy(buf + sizeof(cfg_header_t), d->cache, d->size);
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    hdr->magic = CFG_MAGIC;
+    hdr->version = d->version;
+    hdr->flags = flags;
+    hdr->length = d->size;
+    hdr->crc = esp_rom_crc32_le(0, buf + sizeof(cfg_header_t), d->size);
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = nvs_set_blob(handle, d->blob_key, buf, sizeof(cfg_header_t) + d->size);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    um_metric_observe(&m_commit_time, (uint32_t)(esp_timer_get_time() - start_us));
+
+    xSemaphoreGive(write_lock);
+
+    um_metric_inc(&m_commits);
+    if (err != ESP_OK)
+    {
+        um_metric_inc(&m_commit_errors);
+        ESP_LOGE(TAG, "Failed to write '%s': %s", d->blob_key, esp_err_to_name(err));
+    }
+    return err;
+}
+
+static esp_err_t persist(cfg_desc_t *d)
+{
+    if (um_nvs_batch_active())
+    {
+        // Несколько полей пакета - один blob в um_nvs_config_flush()
+        portENTER_CRITICAL(&cache_spinlock);
+        d->dirty = true;
+        portEXIT_CRITICAL(&cache_spinlock);
+        return ESP_OK;
+    }
+
+    nvs_handle_t handle = 0;
+    esp_err_t err = get_handle(&handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    err = write_blob(d, handle, 0);
+    if (err == ESP_OK && d->corrupt)
+    {
+        // Битый blob заменён новым: дальше это обычный конфиг
+        ESP_LOGW(TAG, "Corrupted '%s' replaced", d->blob_key);
+        d->corrupt = false;
+    }
+    return err;
+}
+
+/**
+ * @brief Read and verify blob
+ *
+ * @param[out] payload Config struct (shorter blob of an older schema is
+ *                     zero-padded, unknown fields are dropped)
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND or ESP_ERR_INVALID_CRC if the blob is damaged
+ */
+static esp_err_t read_blob(const cfg_desc_t *d, nvs_handle_t handle, uint8_t *payload, cfg_header_t *out_hdr)
+{
+    uint8_t buf[CFG_BLOB_MAX_SIZE];
+    size_t len = sizeof(buf);
+
+    esp_err_t err = nvs_get_blob(handle, d->blob_key, buf, &len);
+    if (err == ESP_ERR_NVS_INVALID_LENGTH)
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    const cfg_header_t *hdr = (const cfg_header_t *)buf;
+    if (len < sizeof(cfg_header_t) || hdr->magic != CFG_MAGIC ||
+        hdr->length > len - sizeof(cfg_header_t) ||
+        hdr->length < sizeof(uint16_t) ||
+        hdr->crc != esp_rom_crc32_le(0, buf + sizeof(cfg_header_t), hdr->length))
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // Схема только дополняется: берём общий префикс, новые поля не заданы
+    uint16_t copy = hdr->length < d->size ? hdr->length : d->size;
+    memset(payload, 0, d->size);
+    memcpy(payload, buf + sizeof(cfg_header_t), copy);
+
+    uint16_t present;
+    memcpy(&present, payload, sizeof(present));
+    present &= (uint16_t)((1u << d->field_count) - 1);
+    for (uint8_t i = 0; i < d->field_count; i++)
+    {
+        const cfg_field_t *f = &d->fields[i];
+        if (f->offset + f->size > copy)
+        {
+            present &= ~(1u << i);
+        }
+        else if (f->type == UM_NVS_FIELD_STR)
+        {
+            payload[f->offset + f->size - 1] = '\0';
+        }
+    }
+    memcpy(payload, &present, sizeof(present));
+
+    *out_hdr = *hdr;
+    return ESP_OK;
+}
+
+static void erase_legacy(const cfg_desc_t *d, nvs_handle_t handle)
+{
+    for (uint8_t i = 0; i < d->field_count; i++)
+    {
+        nvs_erase_key(handle, d->fields[i].key);
+    }
+    nvs_commit(handle);
+}
+
+/**
+ * @brief Build config from legacy per-key layout
+ *
+ * Старые ключи удаляются только после того, как записанный blob прочитан
+ * обратно и совпал. Blob пишется с CFG_FLAG_LEGACY: если перезагрузка
+ * случится до удаления ключей, load() доделает перенос.
+ */
+static esp_err_t migrate_legacy(cfg_desc_t *d, nvs_handle_t handle)
+{
+    uint8_t tmp[CFG_BLOB_MAX_SIZE];
+    uint16_t present = 0;
+
+    memset(tmp, 0, d->size);
+
+    for (uint8_t i = 0; i < d->field_count; i++)
+    {
+        const cfg_field_t *f = &d->fields[i];
+        esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+
+        switch (f->type)
+        {
+        case UM_NVS_FIELD_I8:
+            err = nvs_get_i8(handle, f->key, (int8_t *)(tmp + f->offset));
+            break;
+        case UM_NVS_FIELD_U16:
+        {
+            uint16_t value = 0;
+            err = nvs_get_u16(handle, f->key, &value);
+            if (err == ESP_OK)
+            {
+                memcpy(tmp + f->offset, &value, sizeof(value));
+            }
+            break;
+        }
+        case UM_NVS_FIELD_STR:
+        {
+            size_t len = f->size;
+            err = nvs_get_str(handle, f->key, (char *)(tmp + f->offset), &len);
+            if (err == ESP_ERR_NVS_INVALID_LENGTH)
+            {
+                // Не теряем значение: остаёмся на отдельных ключах
+                ESP_LOGE(TAG, "Legacy '%s' longer than %d bytes, '%s' not migrated",
+                         f->key, f->size - 1, d->blob_key);
+                return ESP_ERR_INVALID_SIZE;
+            }
+            break;
+        }
+        }
+
+        if (err == ESP_OK)
+        {
+            present |= (1u << i);
+        }
+        else if (err == ESP_ERR_NVS_NOT_FOUND)
+        {
+            memset(tmp + f->offset, 0, f->size);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Failed to read legacy '%s': %s", f->key, esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    memcpy(tmp, &present, sizeof(present));
+
+    portENTER_CRITICAL(&cache_spinlock);
+    memcpy(d->cache, tmp, d->size);
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    if (present == 0)
+    {
+        // Переносить нечего: пустой blob, чтобы не искать старые ключи при каждой загрузке
+        return write_blob(d, handle, 0);
+    }
+
+    esp_err_t err = write_blob(d, handle, CFG_FLAG_LEGACY);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    uint8_t check[CFG_BLOB_MAX_SIZE];
+    cfg_header_t hdr;
+    err = read_blob(d, handle, check, &hdr);
+    if (err != ESP_OK || memcmp(check, tmp, d->size) != 0)
+    {
+        ESP_LOGE(TAG, "Blob '%s' verification failed, legacy keys kept", d->blob_key);
+        return err != ESP_OK ? err : ESP_ERR_INVALID_CRC;
+    }
+
+    erase_legacy(d, handle);
+    err = write_blob(d, handle, 0);
+
+    ESP_LOGI(TAG, "Migrated %d legacy keys into '%s'",
+             __builtin_popcount(present), d->blob_key);
+    return err;
+}
+
+static esp_err_t load(cfg_desc_t *d, nvs_handle_t handle)
+{
+    uint8_t tmp[CFG_BLOB_MAX_SIZE];
+    cfg_header_t hdr;
+
+    esp_err_t err = read_blob(d, handle, tmp, &hdr);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return migrate_legacy(d, handle);
+    }
+    if (err == ESP_ERR_INVALID_CRC)
+    {
+        /*
+         * Ничего не пишем: значения по умолчанию только в RAM, битый blob
+         * остаётся во flash до первой явной записи настройки.
+         */
+        ESP_LOGE(TAG, "Blob '%s' corrupted, using defaults", d->blob_key);
+        portENTER_CRITICAL(&cache_spinlock);
+        memset(d->cache, 0, d->size);
+        portEXIT_CRITICAL(&cache_spinlock);
+        d->corrupt = true;
+        return err;
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to read '%s': %s", d->blob_key, esp_err_to_name(err));
+        return err;
+    }
+
+    portENTER_CRITICAL(&cache_spinlock);
+    memcpy(d->cache, tmp, d->size);
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    if (hdr.flags & CFG_FLAG_LEGACY)
+    {
+        ESP_LOGI(TAG, "Finishing migration of '%s'", d->blob_key);
+        erase_legacy(d, handle);
+        return write_blob(d, handle, 0);
+    }
+
+    if (hdr.version < d->version)
+    {
+        ESP_LOGI(TAG, "Upgrading '%s' v%d -> v%d", d->blob_key, hdr.version, d->version);
+        return write_blob(d, handle, 0);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t um_nvs_config_init(void)
+{
+    if (write_lock == NULL)
+    {
+        write_lock = xSemaphoreCreateMutexStatic(&write_lock_buffer);
+    }
+
+    um_metrics_register(&m_commits);
+    um_metrics_register(&m_commit_errors);
+    um_metrics_register(&m_commit_time);
+
+    nvs_handle_t handle = 0;
+    esp_err_t err = get_handle(&handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t result = ESP_OK;
+
+    for (int c = 0; c < UM_NVS_CONFIG_MAX; c++)
+    {
+        err = load(&configs[c], handle);
+        if (err != ESP_OK)
+        {
+            result = err;
+        }
+        // Без blob-а (перенос не удался) ключи остаются отдельными в NVS
+        configs[c].loaded = (err == ESP_OK || configs[c].corrupt);
+    }
+
+    ESP_LOGI(TAG, "Packed configs loaded in %lld us", esp_timer_get_time() - start);
+    return result;
+}
+
+esp_err_t um_nvs_config_get(um_nvs_config_id_t id, void *out, size_t size)
+{
+    if (id >= UM_NVS_CONFIG_MAX || out == NULL || size != configs[id].size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cfg_desc_t *d = &configs[id];
+    if (!d->loaded)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&cache_spinlock);
+    memcpy(out, d->cache, d->size);
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    return ESP_OK;
+}
+
+esp_err_t um_nvs_config_set(um_nvs_config_id_t id, const void *cfg, size_t size)
+{
+    if (id >= UM_NVS_CONFIG_MAX || cfg == NULL || size != configs[id].size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cfg_desc_t *d = &configs[id];
+    if (!d->loaded)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&cache_spinlock);
+    memcpy(d->cache, cfg, d->size);
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    return persist(d);
+}
+
+esp_err_t um_nvs_config_read_key(const char *key, um_nvs_field_type_t type,
+                                 void *out, size_t out_size)
+{
+    cfg_desc_t *d = NULL;
+    uint8_t index = 0;
+
+    if (key == NULL || !find_key(key, &d, &index) || !d->loaded)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const cfg_field_t *f = &d->fields[index];
+    if (f->type != type || out == NULL || out_size < f->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+
+    portENTER_CRITICAL(&cache_spinlock);
+    if (get_present(d) & (1u << index))
+    {
+        memcpy(out, d->cache + f->offset, f->size);
+        err = ESP_OK;
+    }
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    return err;
+}
+
+esp_err_t um_nvs_config_write_key(const char *key, um_nvs_field_type_t type,
+                                  const void *value, size_t len)
+{
+    cfg_desc_t *d = NULL;
+    uint8_t index = 0;
+
+    if (key == NULL || !find_key(key, &d, &index) || !d->loaded)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const cfg_field_t *f = &d->fields[index];
+    if (f->type != type || value == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Для строк len включает завершающий ноль
+    if (len > f->size)
+    {
+        ESP_LOGE(TAG, "Value for '%s' too long: %d bytes (max %d)", key, len, f->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    bool changed;
+
+    portENTER_CRITICAL(&cache_spinlock);
+    uint16_t present = get_present(d);
+    changed = !(present & (1u << index)) ||
+              memcmp(d->cache + f->offset, value, len) != 0;
+    if (changed)
+    {
+        memset(d->cache + f->offset, 0, f->size);
+        memcpy(d->cache + f->offset, value, len);
+        set_present(d, present | (1u << index));
+    }
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    // Не тратим ресурс flash на запись того же значения
+    return changed ? persist(d) : ESP_OK;
+}
+
+esp_err_t um_nvs_config_delete_key(const char *key)
+{
+    cfg_desc_t *d = NULL;
+    uint8_t index = 0;
+
+    if (key == NULL || !find_key(key, &d, &index) || !d->loaded)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const cfg_field_t *f = &d->fields[index];
+    bool present;
+
+    portENTER_CRITICAL(&cache_spinlock);
+    uint16_t mask = get_present(d);
+    present = (mask & (1u << index)) != 0;
+    memset(d->cache + f->offset, 0, f->size);
+    set_present(d, mask & ~(1u << index));
+    portEXIT_CRITICAL(&cache_spinlock);
+
+    if (!present)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return persist(d);
+}
+
+esp_err_t um_nvs_config_flush(void)
+{
+    esp_err_t ret = ESP_OK;
+    for (int c = 0; c < UM_NVS_CONFIG_MAX; c++)
+    {
+        cfg_desc_t *d = &configs[c];
+
+        portENTER_CRITICAL(&cache_spinlock);
+        bool dirty = d->dirty;
+        d->dirty = false;
+        portEXIT_CRITICAL(&cache_spinlock);
+
+        if (dirty)
+        {
+            esp_err_t err = persist(d);
+            if (ret == ESP_OK)
+            {
+                ret = err;
+            }
+        }
+    }
+    return ret;
+}
+
+bool um_nvs_config_is_corrupted(um_nvs_config_id_t id)
+{
+    return id < UM_NVS_CONFIG_MAX && configs[id].corrupt;
+}
+
+void um_nvs_config_reset(void)
+{
+    portENTER_CRITICAL(&cache_spinlock);
+    for (int c = 0; c < UM_NVS_CONFIG_MAX; c++)
+    {
+        memset(configs[c].cache, 0, configs[c].size);
+        configs[c].corrupt = false;
+    }
+    portEXIT_CRITICAL(&cache_spinlock);
+}
@@ -0,0 +1,16 @@
+/*
+ * Драйвера GPIO на linux нет: подтяжка шины в симуляторе ничего не делает
+ */
+#pragma once
+
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum
+{
+    GPIO_PULLUP_ONLY,
+    GPIO_FLOATING,
+} gpio_pull_mode_t;
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull);
@@ -0,0 +1,19 @@
+/*
+ * Симулятор датчиков DS18x20 для хост-тестов: объявления как в esp-idf-lib/ds18x20,
+ * реализация - в test_um_onewire_bus.c
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "onewire.h"
+
+#define DS18X20_ANY ONEWIRE_NONE
+
+#define DS18X20_FAMILY_DS18S20 0x10
+#define DS18X20_FAMILY_DS1822 0x22
+#define DS18X20_FAMILY_DS18B20 0x28
+#define DS18X20_FAMILY_MAX31850 0x3B
+
+esp_err_t ds18x20_measure(gpio_num_t pin, onewire_addr_t addr, bool wait);
+esp_err_t ds18x20_read_temperature(gpio_num_t pin, onewire_addr_t addr, float *temperature);
@@ -0,0 +1,22 @@
+/*
+ * Симулятор шины 1-Wire для хост-тестов: объявления как в esp-idf-lib/onewire,
+ * реализация - в test_um_onewire_bus.c
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/gpio.h"
+
+typedef uint64_t onewire_addr_t;
+
+typedef struct
+{
+    int next; // номер следующего устройства на шине
+} onewire_search_t;
+
+#define ONEWIRE_NONE ((onewire_addr_t)(0xffffffffffffffffLL))
+
+void onewire_search_start(onewire_search_t *search);
+onewire_addr_t onewire_search_next(onewire_search_t *search, gpio_num_t pin);
+void onewire_depower(gpio_num_t pin);
@@ -0,0 +1,13 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_onewire_sched_bus_timing(void);
+void test_um_onewire_cached_values(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_onewire_sched_bus_timing);
+    RUN_TEST(test_um_onewire_cached_values);
+    exit(UNITY_END());
+}
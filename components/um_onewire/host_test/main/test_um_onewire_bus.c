@@ -0,0 +1,295 @@
+/*
+ * um_onewire с симулятором шины вместо драйверов esp-idf-lib (host_test/bus).
+ *
+ * Расписание опроса проверяется на виртуальных часах: тест играет задачу
+ * onewire_poll и добавляет задержки шины (Convert T, чтение scratchpad,
+ * зависшие датчики). Таблица значений - через настоящие шаги цикла
+ * um_onewire_poll_step() и um_onewire_get_readings()/um_onewire_get_cached() на часах хоста.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "um_onewire.h"
+
+// um_onewire_priv.h
+esp_err_t um_onewire_poll_step(um_onewire_step_t step);
+
+/* --- Симулятор шины --- */
+
+#define BUS_MAX 8
+
+static struct
+{
+    onewire_addr_t devices[BUS_MAX];
+    int count;
+    uint32_t failing;   // маска устройств, у которых scratchpad не читается (CRC)
+    int64_t measure_us; // последний Convert T
+    uint32_t measures;
+    uint32_t reads;
+    uint32_t early_reads; // scratchpad прочитан раньше конца преобразования
+} s_bus;
+
+// Семейство - младший байт адреса, номер устройства - старший
+static onewire_addr_t device(uint8_t n, uint8_t family)
+{
+    return ((onewire_addr_t)n << 56) | family;
+}
+
+// Значение после n-го Convert T: точно представимо во float
+static float sim_temperature(onewire_addr_t addr, uint32_t measure)
+{
+    return 20.0f + (float)(addr >> 56) + measure * 0.0625f;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    return ESP_OK;
+}
+
+void onewire_search_start(onewire_search_t *search)
+{
+    search->next = 0;
+}
+
+onewire_addr_t onewire_search_next(onewire_search_t *search, gpio_num_t pin)
+{
+    return search->next < s_bus.count ? s_bus.devices[search->next++] : ONEWIRE_NONE;
+}
+
+void onewire_depower(gpio_num_t pin)
+{
+}
+
+esp_err_t ds18x20_measure(gpio_num_t pin, onewire_addr_t addr, bool wait)
+{
+    // Фоновый опрос - одна команда всем (SKIP ROM), не дожидаясь окончания
+    TEST_ASSERT_TRUE(addr == DS18X20_ANY);
+    TEST_ASSERT_FALSE(wait);
+    s_bus.measure_us = esp_timer_get_time();
+    s_bus.measures++;
+    return ESP_OK;
+}
+
+esp_err_t ds18x20_read_temperature(gpio_num_t pin, onewire_addr_t addr, float *temperature)
+{
+    s_bus.reads++;
+    if (esp_timer_get_time() - s_bus.measure_us < UM_ONEWIRE_CONVERT_MS * 1000)
+    {
+        s_bus.early_reads++;
+    }
+    for (int i = 0; i < s_bus.count; i++)
+    {
+        if (s_bus.devices[i] == addr)
+        {
+            if (s_bus.failing & (1u << i))
+            {
+                return ESP_ERR_INVALID_CRC;
+            }
+            *temperature = sim_temperature(addr, s_bus.measures);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/* --- Расписание на виртуальных часах --- */
+
+#define PERIOD_MS 2000
+#define ACTIVE 7
+#define CONVERT_CMD_US 2000 // сама команда Convert T
+#define READ_US 12000       // scratchpad одного датчика
+#define SLOW_READ_US 400000 // датчики "зависают": цикл длиннее периода
+#define SLOW_FROM_US 14000000
+#define SLOW_TO_US 20000000
+#define RUN_US 30000000
+
+void test_um_onewire_sched_bus_timing(void)
+{
+    // Внеочередные запросы: между циклами, во время преобразования, снова между циклами
+    static const int64_t requests[] = {5300000, 5400000, 9100000};
+    // Плановые на сетке, запросы (5.3, 9.1) и опоздавшие после зависших чтений (17.55, 21.1)
+    static const int64_t expected[] = {0,        2000000,  4000000,  5300000,  8000000,
+                                       9100000,  10000000, 12000000, 14000000, 17550000,
+                                       21100000, 22000000, 24000000, 26000000, 28000000};
+    const int n_expected = sizeof(expected) / sizeof(expected[0]);
+
+    um_onewire_sched_t sched = {.period_ms = PERIOD_MS, .convert_ms = UM_ONEWIRE_CONVERT_MS, .next_cycle_us = 0};
+    int64_t now = 0;
+    int64_t converts[32];
+    int n_converts = 0;
+    int n_reads = 0;
+    int next_request = 0;
+    bool converting = false;
+
+    while (now < RUN_US)
+    {
+        uint32_t wait_ms;
+        switch (um_onewire_sched_next(&sched, now, &wait_ms))
+        {
+        case UM_ONEWIRE_STEP_CONVERT:
+            // Новый Convert T сорвал бы идущее преобразование
+            TEST_ASSERT_FALSE(converting);
+            TEST_ASSERT_LESS_THAN(32, n_converts);
+            converts[n_converts++] = now;
+            converting = true;
+            now += CONVERT_CMD_US;
+            break;
+
+        case UM_ONEWIRE_STEP_READ:
+            TEST_ASSERT_TRUE(converting);
+            // Не раньше конца преобразования и без лишнего сна после него
+            TEST_ASSERT_GREATER_OR_EQUAL(UM_ONEWIRE_CONVERT_MS * 1000, now - converts[n_converts - 1]);
+            TEST_ASSERT_LESS_OR_EQUAL(UM_ONEWIRE_CONVERT_MS * 1000 + 1000, now - converts[n_converts - 1]);
+            converting = false;
+            n_reads++;
+            now += ACTIVE * (now >= SLOW_FROM_US && now < SLOW_TO_US ? SLOW_READ_US : READ_US);
+            break;
+
+        case UM_ONEWIRE_STEP_WAIT:
+        {
+            // Задача спит, а не крутится
+            TEST_ASSERT_GREATER_THAN(0, wait_ms);
+            int64_t until = now + (int64_t)wait_ms * 1000;
+            if (next_request < 3 && requests[next_request] < until)
+            {
+                // um_onewire_request_read() будит задачу раньше
+                now = requests[next_request++];
+                sched.requested = true;
+            }
+            else
+            {
+                now = until;
+            }
+            break;
+        }
+        }
+    }
+
+    for (int i = 0; i < n_converts; i++)
+    {
+        printf("cycle %2d: convert at %6.3f s\n", i, converts[i] / 1e6);
+    }
+    TEST_ASSERT_EQUAL(n_expected, n_converts);
+    for (int i = 0; i < n_expected; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32((int32_t)expected[i], (int32_t)converts[i]);
+    }
+    TEST_ASSERT_EQUAL(n_converts, n_reads);
+}
+
+/* --- Таблица значений --- */
+
+// Цикл задачи onewire_poll: Convert T, ожидание преобразования, чтение
+static esp_err_t poll_cycle(void)
+{
+    esp_err_t res = um_onewire_poll_step(UM_ONEWIRE_STEP_CONVERT);
+    if (res != ESP_OK)
+    {
+        return res;
+    }
+    vTaskDelay(pdMS_TO_TICKS(UM_ONEWIRE_CONVERT_MS) + 1);
+    return um_onewire_poll_step(UM_ONEWIRE_STEP_READ);
+}
+
+static void expect_cached(onewire_addr_t addr, float temperature, uint32_t min_age_ms, uint32_t max_age_ms)
+{
+    float t = 0;
+    uint32_t age_ms = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_onewire_get_cached(addr, &t, &age_ms));
+    TEST_ASSERT_EQUAL_FLOAT(temperature, t);
+    TEST_ASSERT_GREATER_OR_EQUAL(min_age_ms, age_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(max_age_ms, age_ms);
+}
+
+void test_um_onewire_cached_values(void)
+{
+    const onewire_addr_t s1 = device(1, DS18X20_FAMILY_DS18B20);
+    const onewire_addr_t s2 = device(2, DS18X20_FAMILY_DS18B20);
+    const onewire_addr_t s3 = device(3, DS18X20_FAMILY_DS1822);
+    const onewire_addr_t s4 = device(4, DS18X20_FAMILY_DS18S20);
+    const onewire_addr_t other = device(5, 0x01); // DS2401, не датчик температуры
+
+    memset(&s_bus, 0, sizeof(s_bus));
+    s_bus.devices[0] = s1;
+    s_bus.devices[1] = s2;
+    s_bus.devices[2] = other;
+    s_bus.devices[3] = s3;
+    s_bus.devices[4] = s4;
+    s_bus.count = 5;
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_onewire_init());
+    TEST_ASSERT_EQUAL(4, um_onewire_get_sensor_count());
+
+    // Датчики в таблице сразу после сканирования, значений ещё нет
+    float t;
+    um_onewire_reading_t r[ONEWIRE_MAX_SENSORS];
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, um_onewire_get_cached(s1, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_onewire_get_cached(s1, &t, NULL));
+    TEST_ASSERT_EQUAL(4, um_onewire_get_readings(r, ONEWIRE_MAX_SENSORS));
+    TEST_ASSERT_EQUAL_HEX64(s3, r[2].address);
+    TEST_ASSERT_EQUAL(UM_ONEWIRE_TYPE_DS1822, r[2].type);
+    TEST_ASSERT_TRUE(r[2].active);
+    TEST_ASSERT_EQUAL_UINT32(UM_ONEWIRE_AGE_NONE, r[2].age_ms);
+    TEST_ASSERT_EQUAL(2, um_onewire_get_readings(r, 2));
+
+    // Неактивный датчик не читается и остаётся "ещё не измерялся"
+    TEST_ASSERT_EQUAL(ESP_OK, um_onewire_set_sensor_active(s4, false));
+    TEST_ASSERT_EQUAL(ESP_OK, poll_cycle());
+    TEST_ASSERT_EQUAL(3, s_bus.reads);
+    expect_cached(s1, sim_temperature(s1, 1), 0, 100);
+    expect_cached(s2, sim_temperature(s2, 1), 0, 100);
+    expect_cached(s3, sim_temperature(s3, 1), 0, 100);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_onewire_get_cached(s4, &t, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, um_onewire_get_cached(other, &t, NULL));
+
+    // Не прочитался один: остальные обновлены, у него прошлое значение старше цикла
+    s_bus.failing = 1u << 1;
+    TEST_ASSERT_EQUAL(ESP_OK, poll_cycle());
+    expect_cached(s1, sim_temperature(s1, 2), 0, 100);
+    expect_cached(s2, sim_temperature(s2, 1), UM_ONEWIRE_CONVERT_MS, 10000);
+
+    // Калибровка и активность видны читателям сразу, без цикла опроса
+    TEST_ASSERT_EQUAL(ESP_OK, um_onewire_set_sensor_calibration(s1, -0.5f));
+    TEST_ASSERT_EQUAL(4, um_onewire_get_readings(r, ONEWIRE_MAX_SENSORS));
+    TEST_ASSERT_EQUAL_HEX64(s1, r[0].address);
+    TEST_ASSERT_EQUAL_FLOAT(sim_temperature(s1, 2) - 0.5f, r[0].temperature);
+    TEST_ASSERT_EQUAL_FLOAT(-0.5f, r[0].calibration);
+    TEST_ASSERT_LESS_THAN(100, r[0].age_ms);
+    TEST_ASSERT_EQUAL_FLOAT(sim_temperature(s2, 1), r[1].temperature);
+    TEST_ASSERT_GREATER_OR_EQUAL(UM_ONEWIRE_CONVERT_MS, r[1].age_ms);
+    TEST_ASSERT_FALSE(r[3].active);
+    TEST_ASSERT_EQUAL_UINT32(UM_ONEWIRE_AGE_NONE, r[3].age_ms);
+    expect_cached(s1, sim_temperature(s1, 2), 0, 100); // без калибровки
+
+    // Не прочитался ни один активный - ошибка цикла, значения прежние
+    s_bus.failing = (1u << 0) | (1u << 1) | (1u << 3);
+    TEST_ASSERT_EQUAL(ESP_FAIL, poll_cycle());
+    expect_cached(s1, sim_temperature(s1, 2), UM_ONEWIRE_CONVERT_MS, 10000);
+
+    // s1 снят с шины: индексы сдвинулись, значения остаются у своих датчиков
+    s_bus.devices[0] = s2;
+    s_bus.devices[1] = other;
+    s_bus.devices[2] = s3;
+    s_bus.devices[3] = s4;
+    s_bus.count = 4;
+    s_bus.failing = 1u << 2;
+    TEST_ASSERT_EQUAL(3, um_onewire_scan());
+    TEST_ASSERT_EQUAL(ESP_OK, poll_cycle());
+    expect_cached(s2, sim_temperature(s2, 4), 0, 100);
+    expect_cached(s3, sim_temperature(s3, 2), 2 * UM_ONEWIRE_CONVERT_MS, 10000);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, um_onewire_get_cached(s1, &t, NULL));
+    TEST_ASSERT_EQUAL(3, um_onewire_get_readings(r, ONEWIRE_MAX_SENSORS));
+    TEST_ASSERT_EQUAL_HEX64(s2, r[0].address);
+    TEST_ASSERT_EQUAL_HEX64(s3, r[1].address);
+    TEST_ASSERT_EQUAL_FLOAT(sim_temperature(s3, 2), r[1].temperature);
+    TEST_ASSERT_EQUAL_FLOAT(sim_temperature(s4, 4), r[2].temperature);
+
+    TEST_ASSERT_EQUAL(4, s_bus.measures);
+    TEST_ASSERT_EQUAL(0, s_bus.early_reads);
+    um_onewire_deinit();
+    TEST_ASSERT_EQUAL(0, um_onewire_get_readings(r, ONEWIRE_MAX_SENSORS));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_onewire_poll_step(UM_ONEWIRE_STEP_CONVERT));
+}
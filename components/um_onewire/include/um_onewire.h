@@ -37,24 +37,18 @@ extern "C"
         UM_ONEWIRE_TYPE_MAX31850 = DS18X20_FAMILY_MAX31850
     } um_onewire_sensor_type_t;
 
-    // Структура датчика
+    // Датчик в таблице последних значений (копия, см. um_onewire_get_readings)
     typedef struct
     {
         uint64_t address;              // Адрес датчика
         um_onewire_sensor_type_t type; // Тип датчика
-        float temperature;             // Последнее измеренное значение температуры
-        bool active;                   // Активен ли датчик
+        float temperature;             // Последнее значение с калибровкой
         float calibration;             // Калибровка
-        char serial[17];               // Серийный номер в виде строки
-    } um_onewire_sensor_t;
+        bool active;                   // Активен ли датчик
+        uint32_t age_ms;               // Сколько мс назад измерен, UM_ONEWIRE_AGE_NONE - ещё не измерялся
+    } um_onewire_reading_t;
 
-    // Структура состояния шины
-    typedef struct
-    {
-        um_onewire_sensor_t sensors[ONEWIRE_MAX_SENSORS];
-        uint8_t sensor_count;
-        bool initialized;
-    } um_onewire_state_t;
+#define UM_ONEWIRE_AGE_NONE UINT32_MAX
 
     /**
      * @brief Инициализирует шину 1-Wire
@@ -75,13 +69,6 @@ extern "C"
      */
     uint8_t um_onewire_scan(void);
 
-    /**
-     * @brief Возвращает состояние шины
-     *
-     * @return const um_onewire_state_t* Указатель на состояние шины
-     */
-    const um_onewire_state_t *um_onewire_get_state(void);
-
     /**
      * @brief Устанавливает активность датчика
      *
@@ -126,28 +113,16 @@ extern "C"
     uint8_t um_onewire_get_sensor_count(void);
 
     /**
-     * @brief Возвращает информацию о конкретном датчике
-     *
-     * @param index Индекс датчика (0..sensor_count-1)
-     * @return const um_onewire_sensor_t* Указатель на датчик или NULL
-     */
-    const um_onewire_sensor_t *um_onewire_get_sensor(uint8_t index);
-
-    /**
-     * @brief Читает температуру со всех датчиков
+     * @brief Копия таблицы последних значений без обращения к шине и без блокировок
      *
-     * @return esp_err_t Результат операции
-     */
-    esp_err_t um_onewire_read_all_temperatures(void);
-
-    /**
-     * @brief Читает температуру с конкретного датчика
+     * Датчики в порядке сканирования. Таблица публикуется целиком после цикла опроса,
+     * сканирования и изменения активности или калибровки.
      *
-     * @param address Адрес датчика
-     * @param temperature Указатель для сохранения температуры
-     * @return esp_err_t Результат операции
+     * @param readings Буфер на max датчиков
+     * @param max Размер буфера (ONEWIRE_MAX_SENSORS - все датчики)
+     * @return uint8_t Сколько датчиков скопировано
      */
-    esp_err_t um_onewire_read_temperature(uint64_t address, float *temperature);
+    uint8_t um_onewire_get_readings(um_onewire_reading_t *readings, uint8_t max);
 
     /**
      * @brief Преобразует адрес датчика в строку
@@ -174,13 +149,71 @@ extern "C"
      */
     const char *um_onewire_sensor_type_to_string(um_onewire_sensor_type_t type);
 
+// Время преобразования при 12 битах (DS18B20, DS18S20)
+#define UM_ONEWIRE_CONVERT_MS 750
+
+    /**
+     * @brief Запускает фоновый опрос датчиков
+     *
+     * Задача раз в period_ms отправляет Convert T всем датчикам (SKIP ROM), на время
+     * преобразования отдаёт процессор, затем читает scratchpad каждого активного датчика,
+     * обновляет таблицу последних значений и публикует UMNI_EVENT_ONEWIRE_TEMPERATURES.
+     *
+     * @param period_ms Период опроса (не меньше UM_ONEWIRE_CONVERT_MS)
+     * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE (уже запущен), ESP_ERR_NO_MEM
+     */
+    esp_err_t um_onewire_start_polling(uint32_t period_ms);
+
+    /**
+     * @brief Внеочередной цикл опроса (не ждёт его окончания)
+     */
+    void um_onewire_request_read(void);
+
+    /**
+     * @brief Последнее измеренное значение без обращения к шине и без блокировок
+     *
+     * @param address Адрес датчика
+     * @param temperature Температура без калибровки
+     * @param age_ms Сколько миллисекунд назад измерена (может быть NULL)
+     * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND, ESP_ERR_INVALID_STATE (ещё не измерялась)
+     */
+    esp_err_t um_onewire_get_cached(uint64_t address, float *temperature, uint32_t *age_ms);
+
+    /**
+     * @brief Шаг фонового опроса
+     */
+    typedef enum
+    {
+        UM_ONEWIRE_STEP_WAIT = 0, /**< Ждать wait_ms или внеочередного запроса */
+        UM_ONEWIRE_STEP_CONVERT,  /**< Отправить Convert T всем датчикам */
+        UM_ONEWIRE_STEP_READ,     /**< Преобразование закончено - читать scratchpad */
+    } um_onewire_step_t;
+
     /**
-     * @brief Возвращает калиброванное значение температуры
+     * @brief Расписание опроса
+     */
+    typedef struct
+    {
+        uint32_t period_ms;
+        uint32_t convert_ms;
+        int64_t next_cycle_us; /**< Начало следующего планового цикла */
+        int64_t read_at_us;    /**< Конец текущего преобразования */
+        bool converting;       /**< Convert T отправлен, ждём read_at_us */
+        bool requested;        /**< Запрошен внеочередной цикл */
+    } um_onewire_sched_t;
+
+    /**
+     * @brief Следующий шаг опроса (без обращения к железу)
+     * @param sched Расписание, обновляется
+     * @param now_us Текущее время
+     * @param wait_ms Для UM_ONEWIRE_STEP_WAIT - сколько ждать
+     * @return Действие, которое должна выполнить задача опроса
      *
-     * @param sensor Указатель на датчик
-     * @return float Калиброванная температура
+     * Плановые циклы идут по сетке period_ms от первого; пропущенные из-за долгого
+     * чтения не догоняются. Цикл не начинается, пока не закончено предыдущее
+     * преобразование. Если Convert T не удался, вызывающий сбрасывает converting.
      */
-    float um_onewire_get_calibrated_temperature(const um_onewire_sensor_t *sensor);
+    um_onewire_step_t um_onewire_sched_next(um_onewire_sched_t *sched, int64_t now_us, uint32_t *wait_ms);
 
 #ifdef __cplusplus
 }
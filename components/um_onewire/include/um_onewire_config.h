@@ -17,8 +17,12 @@ extern "C"
         char location[32]; // Местоположение
         bool active;       // Активен ли датчик
         float calibration; // Калибровочное смещение
+        uint8_t slot;      // Номер ряда в истории температур, постоянный для датчика
     } um_onewire_sensor_config_t;
 
+// Слот ещё не назначен
+#define UM_ONEWIRE_SLOT_NONE 0xFF
+
     /**
      * @brief Загружает конфигурацию датчиков из файла
      *
@@ -35,6 +39,8 @@ extern "C"
 
     /**
      * @brief Применяет загруженную конфигурацию к найденным датчикам
+     *
+     * Для новых датчиков создаёт конфигурацию со свободным слотом и сохраняет файл.
      */
     void um_onewire_config_apply(void);
 
@@ -45,6 +51,13 @@ extern "C"
      */
     char *um_onewire_config_read(void);
 
+    /**
+     * @brief Возвращает путь к файлу конфигурации (для потокового чтения)
+     *
+     * @return const char* Путь к файлу
+     */
+    const char *um_onewire_config_path(void);
+
     /**
      * @brief Обновляет конфигурацию конкретного датчика
      *
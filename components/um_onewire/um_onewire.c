@@ -1,18 +1,80 @@
 #include "um_onewire.h"
+#include "um_onewire_priv.h"
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <driver/gpio.h>
+#include <esp_timer.h>
+#include "um_events.h"
+#include "um_metrics.h"
 
 #if defined(CONFIG_UM_FEATURE_ONEWIRE)
 
 static const char *TAG = "onewire";
 
+// Датчик на шине
+typedef struct
+{
+    uint64_t address;              // Адрес датчика
+    um_onewire_sensor_type_t type; // Тип датчика
+    float temperature;             // Последнее измеренное значение, без калибровки
+    int64_t updated_us;            // 0 - ещё не измерялся
+    bool active;                   // Активен ли датчик
+    float calibration;             // Калибровка
+    char serial[17];               // Серийный номер в виде строки
+} um_onewire_sensor_t;
+
+// Состояние шины: меняется только под state_mutex и сразу публикуется в temp_tables
+typedef struct
+{
+    um_onewire_sensor_t sensors[ONEWIRE_MAX_SENSORS];
+    uint8_t sensor_count;
+    bool initialized;
+} um_onewire_state_t;
+
 // Глобальное состояние шины
 static um_onewire_state_t onewire_state = {0};
 
+// Шина: фоновый опрос и сканирование не должны пересекаться.
+// Захватывается на всё преобразование, поэтому состояние защищено отдельно
+static SemaphoreHandle_t bus_mutex = NULL;
+static SemaphoreHandle_t state_mutex = NULL;
+
+static TaskHandle_t poll_task = NULL;
+static um_onewire_sched_t poll_sched;
+static int64_t cycle_start_us;
+
+/**
+ * @brief Опубликованная копия состояния
+ */
+typedef struct
+{
+    um_onewire_sensor_t sensors[ONEWIRE_MAX_SENSORS];
+    uint8_t count;
+} temp_table_t;
+
+// Писатель (под state_mutex) заполняет неактивную копию и увеличивает table_gen,
+// активная копия - table_gen & 1. Читатели не блокируются и не ждут писателя;
+// сразу после публикации писатель пишет в копию, которую читатель мог ещё не дочитать,
+// поэтому любое изменение table_gen во время чтения - повтор
+static temp_table_t temp_tables[2];
+static uint32_t table_gen = 0;
+
+static const uint32_t read_bounds[] = UM_METRICS_US_BUCKETS;
+static uint32_t read_buckets[sizeof(read_bounds) / sizeof(read_bounds[0]) + 1];
+static um_metric_t m_sensors = UM_METRIC_GAUGE("um_onewire_sensors", "Sensors found by the last scan");
+static um_metric_t m_reads = UM_METRIC_COUNTER("um_onewire_reads_total", "Bus read cycles (all sensors)");
+static um_metric_t m_read_errors = UM_METRIC_COUNTER("um_onewire_read_errors_total", "Failed read cycles");
+static um_metric_t m_sensor_errors = UM_METRIC_COUNTER("um_onewire_sensor_errors_total",
+                                                       "Failed scratchpad reads (value kept)");
+static um_metric_t m_read_time = UM_METRIC_HISTOGRAM("um_onewire_read_duration_seconds",
+                                                     "Convert and read time of one cycle",
+                                                     read_bounds, read_buckets, 1e-6f);
+
 /**
  * @brief Вспомогательная функция для получения типа датчика по family ID
  */
@@ -33,27 +95,47 @@ static um_onewire_sensor_type_t get_sensor_type(uint8_t family_id)
     }
 }
 
+/**
+ * @brief Опубликовать текущее состояние новой копией таблицы (под state_mutex)
+ */
+static void publish_state(void)
+{
+    uint32_t gen = table_gen;
+    temp_table_t *next = &temp_tables[(gen + 1) & 1];
+
+    // Публикация прошлого раза видна раньше, чем правка копии, которую по ней читают
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    memcpy(next->sensors, onewire_state.sensors, sizeof(next->sensors));
+    next->count = onewire_state.sensor_count;
+    __atomic_store_n(&table_gen, gen + 1, __ATOMIC_RELEASE);
+}
+
 esp_err_t um_onewire_init(void)
 {
     ESP_LOGI(TAG, "Initializing 1-Wire bus on GPIO %d", ONE_WIRE_PIN);
 
-    // Инициализируем состояние
-    memset(&onewire_state, 0, sizeof(um_onewire_state_t));
+    if (bus_mutex == NULL)
+    {
+        bus_mutex = xSemaphoreCreateMutex();
+        state_mutex = xSemaphoreCreateMutex();
+        if (bus_mutex == NULL || state_mutex == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
 
-    // Явно инициализируем все поля структуры
-    onewire_state.sensor_count = 0;
+    // Инициализируем состояние; датчики заполнит сканирование
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    memset(&onewire_state, 0, sizeof(um_onewire_state_t));
     onewire_state.initialized = true;
+    publish_state();
+    xSemaphoreGive(state_mutex);
 
-    // Инициализируем все датчики в массиве (даже неиспользуемые)
-    for (int i = 0; i < ONEWIRE_MAX_SENSORS; i++)
-    {
-        onewire_state.sensors[i].address = 0;
-        onewire_state.sensors[i].type = UM_ONEWIRE_TYPE_UNKNOWN;
-        onewire_state.sensors[i].temperature = 0.0f;
-        onewire_state.sensors[i].active = true;      // По умолчанию все активны
-        onewire_state.sensors[i].calibration = 0.0f; // Без калибровки по умолчанию
-        memset(onewire_state.sensors[i].serial, 0, sizeof(onewire_state.sensors[i].serial));
-    }
+    um_metrics_register(&m_sensors);
+    um_metrics_register(&m_reads);
+    um_metrics_register(&m_read_errors);
+    um_metrics_register(&m_sensor_errors);
+    um_metrics_register(&m_read_time);
 
     // Настраиваем подтягивающий резистор
     gpio_set_pull_mode(ONE_WIRE_PIN, GPIO_PULLUP_ONLY);
@@ -68,8 +150,15 @@ esp_err_t um_onewire_init(void)
 void um_onewire_deinit(void)
 {
     ESP_LOGI(TAG, "Deinitializing 1-Wire bus");
+    if (state_mutex == NULL)
+    {
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
     memset(&onewire_state, 0, sizeof(um_onewire_state_t));
     onewire_state.initialized = false;
+    publish_state();
+    xSemaphoreGive(state_mutex);
 }
 
 uint8_t um_onewire_scan(void)
@@ -82,15 +171,15 @@ uint8_t um_onewire_scan(void)
 
     onewire_search_t search;
     onewire_addr_t addr;
+    onewire_addr_t found_addr[ONEWIRE_MAX_SENSORS];
+    um_onewire_sensor_type_t found_type[ONEWIRE_MAX_SENSORS];
     uint8_t found = 0;
 
+    xSemaphoreTake(bus_mutex, portMAX_DELAY);
+
     // Начинаем поиск
     onewire_search_start(&search);
 
-    // Очищаем предыдущие данные
-    memset(onewire_state.sensors, 0, sizeof(onewire_state.sensors));
-    onewire_state.sensor_count = 0;
-
     // Ищем все устройства на шине
     while ((addr = onewire_search_next(&search, ONE_WIRE_PIN)) != ONEWIRE_NONE)
     {
@@ -102,18 +191,8 @@ uint8_t um_onewire_scan(void)
             // Сохраняем только поддерживаемые датчики температуры
             if (type != UM_ONEWIRE_TYPE_UNKNOWN)
             {
-                onewire_state.sensors[found].address = addr;
-                onewire_state.sensors[found].type = type;
-                onewire_state.sensors[found].active = true;
-                onewire_state.sensors[found].temperature = 0.0;
-
-                // Преобразуем адрес в строку
-                um_onewire_address_to_string(addr, onewire_state.sensors[found].serial);
-
-                ESP_LOGI(TAG, "Found sensor: %s (type: %s)",
-                         onewire_state.sensors[found].serial,
-                         um_onewire_sensor_type_to_string(type));
-
+                found_addr[found] = addr;
+                found_type[found] = type;
                 found++;
             }
             else
@@ -128,7 +207,41 @@ uint8_t um_onewire_scan(void)
         }
     }
 
+    // Новый список; последнее значение остаётся только у того же датчика
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    um_onewire_sensor_t prev[ONEWIRE_MAX_SENSORS];
+    uint8_t prev_count = onewire_state.sensor_count;
+    memcpy(prev, onewire_state.sensors, sizeof(prev));
+    memset(onewire_state.sensors, 0, sizeof(onewire_state.sensors));
+
+    for (uint8_t i = 0; i < found; i++)
+    {
+        um_onewire_sensor_t *sensor = &onewire_state.sensors[i];
+        sensor->address = found_addr[i];
+        sensor->type = found_type[i];
+        sensor->active = true;
+        for (uint8_t j = 0; j < prev_count; j++)
+        {
+            if (prev[j].address == sensor->address)
+            {
+                sensor->temperature = prev[j].temperature;
+                sensor->updated_us = prev[j].updated_us;
+                break;
+            }
+        }
+
+        // Преобразуем адрес в строку
+        um_onewire_address_to_string(sensor->address, sensor->serial);
+
+        ESP_LOGI(TAG, "Found sensor: %s (type: %s)",
+                 sensor->serial, um_onewire_sensor_type_to_string(sensor->type));
+    }
+
     onewire_state.sensor_count = found;
+    publish_state();
+    xSemaphoreGive(state_mutex);
+    xSemaphoreGive(bus_mutex);
+    um_metric_set(&m_sensors, found);
 
     if (found == 0)
     {
@@ -138,106 +251,359 @@ uint8_t um_onewire_scan(void)
     return found;
 }
 
-const um_onewire_state_t *um_onewire_get_state(void)
-{
-    return &onewire_state;
-}
-
 uint8_t um_onewire_get_sensor_count(void)
 {
     return onewire_state.sensor_count;
 }
 
-const um_onewire_sensor_t *um_onewire_get_sensor(uint8_t index)
+/**
+ * @brief Convert T всем датчикам одной командой (SKIP ROM), не дожидаясь окончания
+ *
+ * Вызывается под bus_mutex; шина остаётся захваченной до read_and_publish():
+ * любой обмен во время преобразования сорвал бы его у датчиков с паразитным питанием.
+ */
+static esp_err_t start_conversion(void)
 {
-    if (index < onewire_state.sensor_count)
-    {
-        return &onewire_state.sensors[index];
-    }
-    return NULL;
+    return ds18x20_measure(ONE_WIRE_PIN, DS18X20_ANY, false);
 }
 
-esp_err_t um_onewire_read_all_temperatures(void)
+/**
+ * @brief Прочитать scratchpad активных датчиков и опубликовать новую копию таблицы (под bus_mutex)
+ *
+ * @return ESP_FAIL - не прочитался ни один датчик
+ */
+static esp_err_t read_and_publish(void)
 {
-    if (!onewire_state.initialized || onewire_state.sensor_count == 0)
+    onewire_depower(ONE_WIRE_PIN);
+
+    // Список датчиков не меняется: сканирование тоже под bus_mutex. Активность - снимок
+    bool active[ONEWIRE_MAX_SENSORS];
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    uint8_t count = onewire_state.sensor_count;
+    for (uint8_t i = 0; i < count; i++)
     {
-        return ESP_ERR_INVALID_STATE;
+        active[i] = onewire_state.sensors[i].active;
     }
+    xSemaphoreGive(state_mutex);
 
-    // Создаем массив адресов для чтения
-    onewire_addr_t addresses[ONEWIRE_MAX_SENSORS];
-    float temperatures[ONEWIRE_MAX_SENSORS];
+    float values[ONEWIRE_MAX_SENSORS];
+    int64_t read_us[ONEWIRE_MAX_SENSORS];
+    uint8_t reading = 0;
+    uint8_t failed = 0;
 
-    for (uint8_t i = 0; i < onewire_state.sensor_count; i++)
+    for (uint8_t i = 0; i < count; i++)
     {
-        addresses[i] = onewire_state.sensors[i].address;
-    }
+        read_us[i] = 0;
+        if (!active[i])
+        {
+            continue;
+        }
+        reading++;
 
-    // Читаем температуру со всех датчиков
-    esp_err_t res = ds18x20_measure_and_read_multi(ONE_WIRE_PIN, addresses,
-                                                   onewire_state.sensor_count, temperatures);
+        const um_onewire_sensor_t *sensor = &onewire_state.sensors[i];
+        esp_err_t res = ds18x20_read_temperature(ONE_WIRE_PIN, sensor->address, &values[i]);
+        if (res != ESP_OK)
+        {
+            // Остаётся прошлое значение, его возраст виден в um_onewire_get_readings()
+            failed++;
+            um_metric_inc(&m_sensor_errors);
+            ESP_LOGW(TAG, "Sensor %s: %s", sensor->serial, esp_err_to_name(res));
+            continue;
+        }
+        read_us[i] = esp_timer_get_time();
+        ESP_LOGD(TAG, "Sensor %s: %.2f°C", sensor->serial, values[i]);
+    }
 
-    if (res == ESP_OK)
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < count; i++)
     {
-        for (uint8_t i = 0; i < onewire_state.sensor_count; i++)
+        if (read_us[i])
         {
-            onewire_state.sensors[i].temperature = temperatures[i];
-            ESP_LOGI(TAG, "Sensor %s: %.2f°C",
-                     onewire_state.sensors[i].serial,
-                     temperatures[i]);
+            onewire_state.sensors[i].temperature = values[i];
+            onewire_state.sensors[i].updated_us = read_us[i];
         }
     }
+    publish_state();
+    xSemaphoreGive(state_mutex);
+
+    return reading > 0 && failed == reading ? ESP_FAIL : ESP_OK;
+}
+
+/**
+ * @brief Метрики и событие по окончании цикла
+ */
+static void finish_cycle(esp_err_t res, int64_t start_us)
+{
+    um_metric_observe(&m_read_time, (uint32_t)(esp_timer_get_time() - start_us));
+    um_metric_inc(&m_reads);
+
+    if (res == ESP_OK)
+    {
+        um_event_publish(UMNI_EVENT_ONEWIRE_TEMPERATURES, NULL, 0, 0);
+    }
     else
     {
+        um_metric_inc(&m_read_errors);
         ESP_LOGE(TAG, "Failed to read temperatures: %s", esp_err_to_name(res));
     }
+}
+
+esp_err_t um_onewire_poll_step(um_onewire_step_t step)
+{
+    esp_err_t res;
 
-    return res;
+    switch (step)
+    {
+    case UM_ONEWIRE_STEP_CONVERT:
+        if (!onewire_state.initialized || onewire_state.sensor_count == 0)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        xSemaphoreTake(bus_mutex, portMAX_DELAY);
+        cycle_start_us = esp_timer_get_time();
+        res = start_conversion();
+        if (res != ESP_OK)
+        {
+            xSemaphoreGive(bus_mutex);
+            finish_cycle(res, cycle_start_us);
+        }
+        return res;
+
+    case UM_ONEWIRE_STEP_READ:
+        res = read_and_publish();
+        xSemaphoreGive(bus_mutex);
+        finish_cycle(res, cycle_start_us);
+        return res;
+
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+/**
+ * @brief Значение датчика из таблицы для читателя
+ */
+static um_onewire_reading_t to_reading(const um_onewire_sensor_t *sensor, int64_t now_us)
+{
+    return (um_onewire_reading_t){
+        .address = sensor->address,
+        .type = sensor->type,
+        .temperature = sensor->updated_us ? sensor->temperature + sensor->calibration : 0.0f,
+        .calibration = sensor->calibration,
+        .active = sensor->active,
+        .age_ms = sensor->updated_us ? (uint32_t)((now_us - sensor->updated_us) / 1000) : UM_ONEWIRE_AGE_NONE,
+    };
 }
 
-esp_err_t um_onewire_read_temperature(uint64_t address, float *temperature)
+uint8_t um_onewire_get_readings(um_onewire_reading_t *readings, uint8_t max)
 {
-    if (!onewire_state.initialized || temperature == NULL)
+    if (readings == NULL)
+    {
+        return 0;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    while (true)
+    {
+        uint32_t gen = __atomic_load_n(&table_gen, __ATOMIC_ACQUIRE);
+        const temp_table_t *table = &temp_tables[gen & 1];
+        uint8_t count = 0;
+
+        for (; count < table->count && count < max && count < ONEWIRE_MAX_SENSORS; count++)
+        {
+            readings[count] = to_reading(&table->sensors[count], now_us);
+        }
+
+        // После публикации следующий писатель пишет в эту копию: любая смена поколения - повтор
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&table_gen, __ATOMIC_RELAXED) == gen)
+        {
+            return count;
+        }
+    }
+}
+
+esp_err_t um_onewire_get_cached(uint64_t address, float *temperature, uint32_t *age_ms)
+{
+    if (temperature == NULL)
     {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Ищем датчик с таким адресом
-    for (uint8_t i = 0; i < onewire_state.sensor_count; i++)
+    while (true)
     {
-        if (onewire_state.sensors[i].address == address)
+        uint32_t gen = __atomic_load_n(&table_gen, __ATOMIC_ACQUIRE);
+        const temp_table_t *table = &temp_tables[gen & 1];
+        esp_err_t res = ESP_ERR_NOT_FOUND;
+        float value = 0.0f;
+        int64_t updated_us = 0;
+
+        for (uint8_t i = 0; i < table->count && i < ONEWIRE_MAX_SENSORS; i++)
         {
-            esp_err_t res = ds18x20_measure_and_read(ONE_WIRE_PIN, address, temperature);
-            if (res == ESP_OK)
+            if (table->sensors[i].address == address)
             {
-                onewire_state.sensors[i].temperature = *temperature;
+                value = table->sensors[i].temperature;
+                updated_us = table->sensors[i].updated_us;
+                res = updated_us ? ESP_OK : ESP_ERR_INVALID_STATE;
+                break;
             }
-            return res;
         }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&table_gen, __ATOMIC_RELAXED) != gen)
+        {
+            continue;
+        }
+
+        if (res == ESP_OK)
+        {
+            *temperature = value;
+            if (age_ms)
+            {
+                *age_ms = (uint32_t)((esp_timer_get_time() - updated_us) / 1000);
+            }
+        }
+        return res;
+    }
+}
+
+um_onewire_step_t um_onewire_sched_next(um_onewire_sched_t *sched, int64_t now_us, uint32_t *wait_ms)
+{
+    *wait_ms = 0;
+
+    if (sched->converting)
+    {
+        if (now_us >= sched->read_at_us)
+        {
+            // Запрос, пришедший во время преобразования, выполнен этим циклом
+            sched->converting = false;
+            sched->requested = false;
+            return UM_ONEWIRE_STEP_READ;
+        }
+        *wait_ms = (uint32_t)((sched->read_at_us - now_us + 999) / 1000);
+        return UM_ONEWIRE_STEP_WAIT;
     }
 
-    return ESP_ERR_NOT_FOUND;
+    if (sched->requested || now_us >= sched->next_cycle_us)
+    {
+        int64_t period_us = (int64_t)sched->period_ms * 1000;
+        sched->converting = true;
+        sched->requested = false;
+        sched->read_at_us = now_us + (int64_t)sched->convert_ms * 1000;
+
+        // Следующий плановый цикл - на сетке и не раньше конца этого преобразования
+        if (sched->next_cycle_us < sched->read_at_us)
+        {
+            int64_t behind = sched->read_at_us - sched->next_cycle_us;
+            sched->next_cycle_us += (behind + period_us - 1) / period_us * period_us;
+        }
+        return UM_ONEWIRE_STEP_CONVERT;
+    }
+
+    *wait_ms = (uint32_t)((sched->next_cycle_us - now_us + 999) / 1000);
+    return UM_ONEWIRE_STEP_WAIT;
 }
 
-esp_err_t um_onewire_set_sensor_active(uint64_t address, bool active)
+static void poll_task_handler(void *arg)
 {
-    if (!onewire_state.initialized)
+    while (true)
+    {
+        uint32_t wait_ms;
+        switch (um_onewire_sched_next(&poll_sched, esp_timer_get_time(), &wait_ms))
+        {
+        case UM_ONEWIRE_STEP_CONVERT:
+            if (um_onewire_poll_step(UM_ONEWIRE_STEP_CONVERT) != ESP_OK)
+            {
+                // Преобразование не идёт, шина свободна
+                poll_sched.converting = false;
+            }
+            break;
+
+        case UM_ONEWIRE_STEP_READ:
+            um_onewire_poll_step(UM_ONEWIRE_STEP_READ);
+            break;
+
+        case UM_ONEWIRE_STEP_WAIT:
+            // Во время преобразования процессор свободен; уведомление - внеочередной цикл
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms)) > 0)
+            {
+                poll_sched.requested = true;
+            }
+            break;
+        }
+    }
+}
+
+esp_err_t um_onewire_start_polling(uint32_t period_ms)
+{
+    if (!onewire_state.initialized || period_ms < UM_ONEWIRE_CONVERT_MS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (poll_task != NULL)
     {
         return ESP_ERR_INVALID_STATE;
     }
 
+    poll_sched = (um_onewire_sched_t){
+        .period_ms = period_ms,
+        .convert_ms = UM_ONEWIRE_CONVERT_MS,
+        .next_cycle_us = esp_timer_get_time(),
+    };
+    if (xTaskCreate(poll_task_handler, "onewire_poll", configMINIMAL_STACK_SIZE * 4, NULL, 2, &poll_task) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Polling %d sensors every %lu ms", onewire_state.sensor_count, (unsigned long)period_ms);
+    return ESP_OK;
+}
+
+void um_onewire_request_read(void)
+{
+    if (poll_task != NULL)
+    {
+        xTaskNotifyGive(poll_task);
+    }
+}
+
+/**
+ * @brief Датчик по адресу (под state_mutex), NULL - не найден
+ */
+static um_onewire_sensor_t *find_sensor(uint64_t address)
+{
     for (int i = 0; i < onewire_state.sensor_count; i++)
     {
         if (onewire_state.sensors[i].address == address)
         {
-            onewire_state.sensors[i].active = active;
-            ESP_LOGI(TAG, "Sensor %016" PRIX64 " active: %s",
-                     address, active ? "true" : "false");
-            return ESP_OK;
+            return &onewire_state.sensors[i];
         }
     }
+    return NULL;
+}
+
+esp_err_t um_onewire_set_sensor_active(uint64_t address, bool active)
+{
+    if (!onewire_state.initialized)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    return ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    um_onewire_sensor_t *sensor = find_sensor(address);
+    if (sensor)
+    {
+        sensor->active = active;
+        publish_state();
+    }
+    xSemaphoreGive(state_mutex);
+
+    if (sensor == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "Sensor %016" PRIX64 " active: %s", address, active ? "true" : "false");
+    return ESP_OK;
 }
 
 esp_err_t um_onewire_set_sensor_calibration(uint64_t address, float calibration)
@@ -254,18 +620,21 @@ esp_err_t um_onewire_set_sensor_calibration(uint64_t address, float calibration)
         // Но не запрещаем, возможно спецслучай
     }
 
-    for (int i = 0; i < onewire_state.sensor_count; i++)
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    um_onewire_sensor_t *sensor = find_sensor(address);
+    if (sensor)
     {
-        if (onewire_state.sensors[i].address == address)
-        {
-            onewire_state.sensors[i].calibration = calibration;
-            ESP_LOGI(TAG, "Sensor %016" PRIX64 " calibration: %+.2f°C",
-                     address, calibration);
-            return ESP_OK;
-        }
+        sensor->calibration = calibration;
+        publish_state();
     }
+    xSemaphoreGive(state_mutex);
 
-    return ESP_ERR_NOT_FOUND;
+    if (sensor == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "Sensor %016" PRIX64 " calibration: %+.2f°C", address, calibration);
+    return ESP_OK;
 }
 
 esp_err_t um_onewire_get_sensor_calibration(uint64_t address, float *calibration)
@@ -275,16 +644,15 @@ esp_err_t um_onewire_get_sensor_calibration(uint64_t address, float *calibration
         return ESP_ERR_INVALID_ARG;
     }
 
-    for (int i = 0; i < onewire_state.sensor_count; i++)
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    const um_onewire_sensor_t *sensor = find_sensor(address);
+    if (sensor)
     {
-        if (onewire_state.sensors[i].address == address)
-        {
-            *calibration = onewire_state.sensors[i].calibration;
-            return ESP_OK;
-        }
+        *calibration = sensor->calibration;
     }
+    xSemaphoreGive(state_mutex);
 
-    return ESP_ERR_NOT_FOUND;
+    return sensor ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
 esp_err_t um_onewire_get_sensor_active(uint64_t address, bool *active)
@@ -294,26 +662,15 @@ esp_err_t um_onewire_get_sensor_active(uint64_t address, bool *active)
         return ESP_ERR_INVALID_ARG;
     }
 
-    for (int i = 0; i < onewire_state.sensor_count; i++)
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    const um_onewire_sensor_t *sensor = find_sensor(address);
+    if (sensor)
     {
-        if (onewire_state.sensors[i].address == address)
-        {
-            *active = onewire_state.sensors[i].active;
-            return ESP_OK;
-        }
+        *active = sensor->active;
     }
+    xSemaphoreGive(state_mutex);
 
-    return ESP_ERR_NOT_FOUND;
-}
-
-// Также обновляем функцию для получения калиброванной температуры:
-float um_onewire_get_calibrated_temperature(const um_onewire_sensor_t *sensor)
-{
-    if (!sensor || !sensor->active)
-    {
-        return 0.0f;
-    }
-    return sensor->temperature + sensor->calibration;
+    return sensor ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
 void um_onewire_address_to_string(uint64_t address, char *buffer)
@@ -1,5 +1,8 @@
 #include "um_onewire_config.h"
 #include "um_storage.h"
+#include "um_json_stream.h"
+#include "um_events.h"
+#include <stdlib.h>
 #include <string.h>
 #include <esp_log.h>
 
@@ -23,82 +26,250 @@ static um_onewire_sensor_config_t *find_config(const char *serial)
     return NULL;
 }
 
-esp_err_t um_onewire_config_load()
+/**
+ * @brief Слот для нового датчика: следующий за наибольшим занятым
+ *
+ * Слоты удалённых из конфигурации датчиков не переходят к новым, пока есть номера выше.
+ */
+static uint8_t new_slot(void)
 {
+    int max = -1;
+    for (int i = 0; i < config_count; i++)
+    {
+        if (sensor_configs[i].slot != UM_ONEWIRE_SLOT_NONE && sensor_configs[i].slot > max)
+        {
+            max = sensor_configs[i].slot;
+        }
+    }
+    if (max + 1 < UM_ONEWIRE_SLOT_NONE)
+    {
+        return max + 1;
+    }
 
-    // Проверяем существование файла
-    if (!um_storage_file_exists(ow_config_path))
+    // Номера кончились - наименьший свободный
+    for (int slot = 0; slot < UM_ONEWIRE_SLOT_NONE; slot++)
     {
-        ESP_LOGW(TAG, "Config file %s not found, creating default", ow_config_path);
-        return um_onewire_config_create_default(ow_config_path);
+        bool used = false;
+        for (int i = 0; i < config_count && !used; i++)
+        {
+            used = sensor_configs[i].slot == slot;
+        }
+        if (!used)
+        {
+            return slot;
+        }
     }
+    return UM_ONEWIRE_SLOT_NONE;
+}
 
-    // Способ 2: Более безопасный
-    char *config = um_storage_read_json_string(ow_config_path);
-    if (config != NULL)
+static bool slot_used(uint8_t slot)
+{
+    for (int i = 0; i < config_count; i++)
     {
-        // Парсим JSON
-        cJSON *root = cJSON_Parse(config);
-        if (root == NULL)
+        if (sensor_configs[i].slot == slot)
         {
-            ESP_LOGE(TAG, "Failed to parse JSON config");
-            return ESP_ERR_INVALID_RESPONSE;
+            return true;
         }
+    }
+    return false;
+}
 
-        // Очищаем старые конфигурации
-        config_count = 0;
-        memset(sensor_configs, 0, sizeof(sensor_configs));
+// Состояние потокового разбора onewire.json
+typedef struct
+{
+    char key[16];      // последний прочитанный ключ
+    bool in_sensors;   // внутри массива "sensors"
+    bool in_sensor;    // внутри объекта датчика
+    bool has_sn;
+    bool has_label;
+    um_onewire_sensor_config_t current;
+} ow_parse_ctx_t;
+
+/*
+ * Уровни вложенности: 1 - ключи корня, 2 - объекты массива "sensors",
+ * 3 - поля датчика. Более глубокие значения игнорируются.
+ */
+static esp_err_t ow_config_token(void *arg, um_json_token_t token, const char *value, int depth)
+{
+    ow_parse_ctx_t *ctx = (ow_parse_ctx_t *)arg;
+    um_onewire_sensor_config_t *cur = &ctx->current;
+
+    switch (token)
+    {
+    case UM_JSON_KEY:
+        strncpy(ctx->key, value, sizeof(ctx->key) - 1);
+        ctx->key[sizeof(ctx->key) - 1] = '\0';
+        break;
 
-        // Читаем массив датчиков
-        cJSON *sensor_array = cJSON_GetObjectItem(root, "sensors");
-        if (cJSON_IsArray(sensor_array))
+    case UM_JSON_ARRAY_START:
+        if (depth == 1 && strcmp(ctx->key, "sensors") == 0)
         {
-            cJSON *sensor_item = NULL;
-            cJSON_ArrayForEach(sensor_item, sensor_array)
+            ctx->in_sensors = true;
+        }
+        break;
+
+    case UM_JSON_ARRAY_END:
+        if (depth == 1)
+        {
+            ctx->in_sensors = false;
+        }
+        break;
+
+    case UM_JSON_OBJECT_START:
+        if (ctx->in_sensors && depth == 2)
+        {
+            memset(cur, 0, sizeof(*cur));
+            cur->active = true;
+            cur->slot = UM_ONEWIRE_SLOT_NONE;
+            ctx->in_sensor = true;
+            ctx->has_sn = false;
+            ctx->has_label = false;
+        }
+        break;
+
+    case UM_JSON_OBJECT_END:
+        if (ctx->in_sensor && depth == 2)
+        {
+            ctx->in_sensor = false;
+            if (!ctx->has_sn || !ctx->has_label)
+            {
+                break;
+            }
+            if (config_count >= ONEWIRE_MAX_SENSORS)
+            {
+                ESP_LOGW(TAG, "Too many sensors in config, max is %d", ONEWIRE_MAX_SENSORS);
+                break;
+            }
+            if (cur->slot != UM_ONEWIRE_SLOT_NONE && slot_used(cur->slot))
             {
-                if (config_count >= ONEWIRE_MAX_SENSORS)
-                {
-                    ESP_LOGW(TAG, "Too many sensors in config, max is %d", ONEWIRE_MAX_SENSORS);
-                    break;
-                }
+                ESP_LOGW(TAG, "Duplicate slot %u for %s, reassigning", cur->slot, cur->serial);
+                cur->slot = UM_ONEWIRE_SLOT_NONE;
+            }
+
+            sensor_configs[config_count++] = *cur;
+            ESP_LOGI(TAG, "Loaded config for %s: '%s' (active: %s)",
+                     cur->serial, cur->label, cur->active ? "yes" : "no");
+        }
+        break;
+
+    case UM_JSON_STRING:
+        if (!ctx->in_sensor || depth != 3)
+        {
+            break;
+        }
+        if (strcmp(ctx->key, "sn") == 0)
+        {
+            strncpy(cur->serial, value, sizeof(cur->serial) - 1);
+            ctx->has_sn = true;
+        }
+        else if (strcmp(ctx->key, "label") == 0)
+        {
+            strncpy(cur->label, value, sizeof(cur->label) - 1);
+            ctx->has_label = true;
+        }
+        else if (strcmp(ctx->key, "location") == 0)
+        {
+            strncpy(cur->location, value, sizeof(cur->location) - 1);
+        }
+        break;
+
+    case UM_JSON_TRUE:
+    case UM_JSON_FALSE:
+        if (ctx->in_sensor && depth == 3 && strcmp(ctx->key, "active") == 0)
+        {
+            cur->active = (token == UM_JSON_TRUE);
+        }
+        break;
 
-                um_onewire_sensor_config_t *config = &sensor_configs[config_count];
+    case UM_JSON_NUMBER:
+        if (!ctx->in_sensor || depth != 3)
+        {
+            break;
+        }
+        if (strcmp(ctx->key, "calibration") == 0)
+        {
+            cur->calibration = strtof(value, NULL);
+        }
+        else if (strcmp(ctx->key, "slot") == 0)
+        {
+            long slot = strtol(value, NULL, 10);
+            cur->slot = slot >= 0 && slot < UM_ONEWIRE_SLOT_NONE ? (uint8_t)slot : UM_ONEWIRE_SLOT_NONE;
+        }
+        break;
 
-                // Читаем обязательные поля
-                cJSON *sn = cJSON_GetObjectItem(sensor_item, "sn");
-                cJSON *label = cJSON_GetObjectItem(sensor_item, "label");
+    default:
+        break;
+    }
 
-                if (cJSON_IsString(sn) && cJSON_IsString(label))
-                {
-                    strncpy(config->serial, sn->valuestring, sizeof(config->serial) - 1);
-                    strncpy(config->label, label->valuestring, sizeof(config->label) - 1);
+    return ESP_OK;
+}
 
-                    // Читаем опциональные поля
-                    cJSON *location = cJSON_GetObjectItem(sensor_item, "location");
-                    if (cJSON_IsString(location))
-                    {
-                        strncpy(config->location, location->valuestring, sizeof(config->location) - 1);
-                    }
+esp_err_t um_onewire_config_load()
+{
 
-                    cJSON *active = cJSON_GetObjectItem(sensor_item, "active");
-                    config->active = (active && cJSON_IsBool(active)) ? cJSON_IsTrue(active) : true;
+    // Проверяем существование файла
+    if (!um_storage_file_exists(ow_config_path))
+    {
+        ESP_LOGW(TAG, "Config file %s not found, creating default", ow_config_path);
+        return um_onewire_config_create_default(ow_config_path);
+    }
 
-                    cJSON *calibration = cJSON_GetObjectItem(sensor_item, "calibration");
-                    config->calibration = (calibration && cJSON_IsNumber(calibration)) ? (float)calibration->valuedouble : 0.0f;
+    // Слоты прежней конфигурации: файл без "slot" (старый или от клиента) не перенумерует историю
+    struct
+    {
+        char serial[17];
+        uint8_t slot;
+    } prev[ONEWIRE_MAX_SENSORS];
+    uint8_t prev_count = config_count;
+    for (int i = 0; i < prev_count; i++)
+    {
+        memcpy(prev[i].serial, sensor_configs[i].serial, sizeof(prev[i].serial));
+        prev[i].slot = sensor_configs[i].slot;
+    }
+
+    // Очищаем старые конфигурации
+    config_count = 0;
+    memset(sensor_configs, 0, sizeof(sensor_configs));
 
-                    ESP_LOGI(TAG, "Loaded config for %s: '%s' (active: %s)",
-                             config->serial, config->label, config->active ? "yes" : "no");
+    // Разбираем файл кусками, без загрузки целиком и без дерева cJSON
+    ow_parse_ctx_t ctx = {0};
+    esp_err_t ret = um_json_stream_parse_file(ow_config_path, ow_config_token, &ctx);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to parse JSON config: %s", esp_err_to_name(ret));
+        config_count = 0;
+        memset(sensor_configs, 0, sizeof(sensor_configs));
+        return ESP_ERR_INVALID_RESPONSE;
+    }
 
-                    config_count++;
-                }
+    // Датчикам без слота - прежний, если он свободен, иначе новый; слоты сохраняются в файл,
+    // иначе после перезагрузки (без прежних) их раздали бы заново по порядку в файле
+    bool assigned = false;
+    for (int i = 0; i < config_count; i++)
+    {
+        um_onewire_sensor_config_t *config = &sensor_configs[i];
+        if (config->slot != UM_ONEWIRE_SLOT_NONE)
+        {
+            continue;
+        }
+        for (int j = 0; j < prev_count; j++)
+        {
+            if (strcmp(prev[j].serial, config->serial) == 0 && prev[j].slot != UM_ONEWIRE_SLOT_NONE &&
+                !slot_used(prev[j].slot))
+            {
+                config->slot = prev[j].slot;
+                break;
             }
         }
-        free(config); // Освобождаем
-        cJSON_Delete(root);
-        ESP_LOGI(TAG, "Loaded %d sensor configurations", config_count);
-        return ESP_OK;
+        if (config->slot == UM_ONEWIRE_SLOT_NONE)
+        {
+            config->slot = new_slot();
+        }
+        assigned = true;
     }
-    return ESP_FAIL;
+
+    ESP_LOGI(TAG, "Loaded %d sensor configurations", config_count);
+    return assigned ? um_onewire_config_save() : ESP_OK;
 }
 
 esp_err_t um_onewire_config_save()
@@ -128,6 +299,11 @@ esp_err_t um_onewire_config_save()
             cJSON_AddNumberToObject(sensor, "calibration", config->calibration);
         }
 
+        if (config->slot != UM_ONEWIRE_SLOT_NONE)
+        {
+            cJSON_AddNumberToObject(sensor, "slot", config->slot);
+        }
+
         cJSON_AddItemToArray(sensors_array, sensor);
     }
 
@@ -150,19 +326,29 @@ esp_err_t um_onewire_config_save()
     if (ret == ESP_OK)
     {
         ESP_LOGI(TAG, "Saved %d sensor configurations to %s", config_count, ow_config_path);
+        um_event_publish(UMNI_EVENT_CONFIG_SAVED, NULL, 0, portMAX_DELAY);
     }
 
     return ret;
 }
 
-void um_onewire_config_apply(void)
+/**
+ * @brief Применить конфигурацию к найденным датчикам
+ *
+ * @return true - для новых датчиков созданы конфигурации
+ */
+static bool apply_configs(void)
 {
-    const um_onewire_state_t *state = um_onewire_get_state();
+    um_onewire_reading_t readings[ONEWIRE_MAX_SENSORS];
+    uint8_t count = um_onewire_get_readings(readings, ONEWIRE_MAX_SENSORS);
+    bool added = false;
 
-    for (int i = 0; i < state->sensor_count; i++)
+    for (int i = 0; i < count; i++)
     {
-        const um_onewire_sensor_t *sensor = &state->sensors[i];
-        um_onewire_sensor_config_t *config = find_config(sensor->serial);
+        const um_onewire_reading_t *sensor = &readings[i];
+        char serial[17];
+        um_onewire_address_to_string(sensor->address, serial);
+        um_onewire_sensor_config_t *config = find_config(serial);
 
         if (config)
         {
@@ -170,18 +356,11 @@ void um_onewire_config_apply(void)
             um_onewire_set_sensor_active(sensor->address, config->active);
             um_onewire_set_sensor_calibration(sensor->address, config->calibration);
 
-            // Можно добавить логирование изменений
-            bool current_active;
-            float current_calib;
-
-            um_onewire_get_sensor_active(sensor->address, &current_active);
-            um_onewire_get_sensor_calibration(sensor->address, &current_calib);
-
             ESP_LOGI(TAG, "Config applied to %s: active=%s->%s, calib=%.2f->%.2f",
-                     sensor->serial,
-                     current_active ? "on" : "off",
+                     serial,
+                     sensor->active ? "on" : "off",
                      config->active ? "on" : "off",
-                     current_calib,
+                     sensor->calibration,
                      config->calibration);
         }
         else
@@ -192,22 +371,35 @@ void um_onewire_config_apply(void)
             {
                 um_onewire_sensor_config_t new_config = {
                     .active = true,
-                    .calibration = 0.0f};
-                strncpy(new_config.serial, sensor->serial, sizeof(new_config.serial) - 1);
-                snprintf(new_config.label, sizeof(new_config.label), "Sensor %s", sensor->serial);
+                    .calibration = 0.0f,
+                    .slot = new_slot()};
+                strncpy(new_config.serial, serial, sizeof(new_config.serial) - 1);
+                snprintf(new_config.label, sizeof(new_config.label), "Sensor %s", serial);
 
                 // Сохраняем в массив конфигов
                 sensor_configs[config_count] = new_config;
                 config_count++;
+                added = true;
 
                 // Применяем к состоянию
                 um_onewire_set_sensor_active(sensor->address, true);
                 um_onewire_set_sensor_calibration(sensor->address, 0.0f);
 
-                ESP_LOGI(TAG, "Created default config for new sensor %s", sensor->serial);
+                ESP_LOGI(TAG, "Created default config for new sensor %s (slot %u)", serial, new_config.slot);
             }
         }
     }
+
+    return added;
+}
+
+void um_onewire_config_apply(void)
+{
+    // Слот нового датчика должен пережить перезагрузку
+    if (apply_configs())
+    {
+        um_onewire_config_save();
+    }
 }
 
 char *um_onewire_config_read(void)
@@ -215,6 +407,11 @@ char *um_onewire_config_read(void)
     return um_storage_read_json_string(ow_config_path);
 }
 
+const char *um_onewire_config_path(void)
+{
+    return ow_config_path;
+}
+
 esp_err_t um_onewire_config_update(const char *serial, const um_onewire_sensor_config_t *config)
 {
     if (serial == NULL || config == NULL)
@@ -225,8 +422,10 @@ esp_err_t um_onewire_config_update(const char *serial, const um_onewire_sensor_c
     um_onewire_sensor_config_t *existing_config = find_config(serial);
     if (existing_config)
     {
-        // Обновляем существующую конфигурацию
+        // Обновляем существующую конфигурацию; слот истории остаётся за датчиком
+        uint8_t slot = existing_config->slot;
         *existing_config = *config;
+        existing_config->slot = slot;
         strncpy(existing_config->serial, serial, sizeof(existing_config->serial) - 1);
         ESP_LOGI(TAG, "Updated config for %s", serial);
     }
@@ -238,7 +437,9 @@ esp_err_t um_onewire_config_update(const char *serial, const um_onewire_sensor_c
             return ESP_ERR_NO_MEM;
         }
 
+        uint8_t slot = new_slot();
         sensor_configs[config_count] = *config;
+        sensor_configs[config_count].slot = slot;
         strncpy(sensor_configs[config_count].serial, serial, sizeof(sensor_configs[config_count].serial) - 1);
         config_count++;
         ESP_LOGI(TAG, "Added new config for %s", serial);
@@ -255,6 +456,6 @@ const um_onewire_sensor_config_t *um_onewire_config_get(const char *serial)
 esp_err_t um_onewire_config_create_default()
 {
     // Создаем конфигурацию на основе найденных датчиков
-    um_onewire_config_apply();
+    apply_configs();
     return um_onewire_config_save(ow_config_path);
 }
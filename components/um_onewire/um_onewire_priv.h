@@ -0,0 +1,31 @@
+#pragma once
+
+// Внутренние объявления компонента um_onewire (не для внешних модулей)
+
+#include "um_onewire.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(CONFIG_UM_FEATURE_ONEWIRE)
+
+    /**
+     * @brief Выполнить шаг цикла опроса, выбранный um_onewire_sched_next()
+     *
+     * UM_ONEWIRE_STEP_CONVERT захватывает шину и отправляет Convert T; при ESP_OK шина
+     * остаётся захваченной до UM_ONEWIRE_STEP_READ, который читает scratchpad, публикует
+     * таблицу и освобождает шину. Между шагами вызывающий ждёт UM_ONEWIRE_CONVERT_MS
+     * (задача onewire_poll, в хост-тестах - тест).
+     *
+     * @return esp_err_t ESP_OK; ESP_ERR_INVALID_STATE - нет датчиков; ESP_FAIL - не прочитался
+     *         ни один активный датчик; ошибка Convert T (шина освобождена, цикл завершён)
+     */
+    esp_err_t um_onewire_poll_step(um_onewire_step_t step);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -66,6 +66,10 @@ void um_ot_set_dhw_setpoint(float temp);
 
 void um_ot_update_state(bool otch, int otdhw, int ottbsp);
 
+// Целевые температуры без обмена по шине: отправит задача OpenTherm в следующем цикле.
+// Отрицательное значение - не менять.
+void um_ot_set_targets(int ch_setpoint, int dhw_setpoint);
+
 void um_ot_set_central_heating_active(bool state);
 
 void um_ot_set_hot_water_active(bool state);
@@ -537,6 +537,22 @@ void um_ot_set_heat_curve_ratio(int ratio)
     ot_data.othcr = ratio;
 }
 
+void um_ot_set_targets(int ch_setpoint, int dhw_setpoint)
+{
+    if (ch_setpoint >= 0)
+    {
+        targetCHTemp = ch_setpoint;
+        ot_data.ottbsp = ch_setpoint;
+        um_nvs_set_ot_ch_setpoint(ch_setpoint);
+    }
+    if (dhw_setpoint >= 0)
+    {
+        targetDHWTemp = dhw_setpoint;
+        ot_data.otdhwsp = dhw_setpoint;
+        um_nvs_set_ot_dhw_setpoint(dhw_setpoint);
+    }
+}
+
 void um_ot_update_state(bool otch, int otdhwsp, int ottbsp)
 {
     um_ot_set_central_heating_active(otch);
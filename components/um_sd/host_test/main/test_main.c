@@ -0,0 +1,23 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_sd_cd_insert_eject(void);
+void test_um_sd_cd_mount_retries(void);
+void test_um_sd_cd_eject_while_busy(void);
+void test_um_sd_cd_invariants(void);
+void test_um_sd_cd_task_debounce(void);
+void test_um_sd_cd_task_unmount_postponed(void);
+void test_um_sd_cd_task_open_file(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_sd_cd_insert_eject);
+    RUN_TEST(test_um_sd_cd_mount_retries);
+    RUN_TEST(test_um_sd_cd_eject_while_busy);
+    RUN_TEST(test_um_sd_cd_invariants);
+    RUN_TEST(test_um_sd_cd_task_debounce);
+    RUN_TEST(test_um_sd_cd_task_unmount_postponed);
+    RUN_TEST(test_um_sd_cd_task_open_file);
+    exit(UNITY_END());
+}
@@ -0,0 +1,171 @@
+/*
+ * Автомат детектора SD карты: сценарии вставки/извлечения в модели
+ * задачи sd_cd_task. Результаты монтирования и размонтирования задаёт тест.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "unity.h"
+#include "um_sd_cd.h"
+
+typedef struct
+{
+    um_sd_state_t state;
+    uint8_t retries;
+    bool mounted_fs;   // файловая система смонтирована
+    int mounts;
+    int unmounts;
+    int push_out;
+} model_t;
+
+// Один проход задачи детектора (как в um_sd_cd_task)
+static um_sd_cd_action_t step(model_t *m, bool detected, bool mount_ok, bool card_busy)
+{
+    um_sd_cd_action_t action = um_sd_cd_next(m->state, detected, m->retries);
+    switch (action)
+    {
+    case UM_SD_CD_MOUNT:
+        m->retries = 0;
+        // fallthrough
+    case UM_SD_CD_RETRY:
+        m->mounts++;
+        if (mount_ok)
+        {
+            m->state = UM_SD_STATE_MOUNTED;
+            m->mounted_fs = true;
+            m->retries = 0;
+        }
+        else
+        {
+            m->state = UM_SD_STATE_MOUNT_FAILED;
+            m->retries++;
+        }
+        break;
+    case UM_SD_CD_UNMOUNT:
+        if (m->state == UM_SD_STATE_MOUNTED)
+        {
+            m->push_out++;
+        }
+        // um_sd_unmount(): пока карта занята, ФС не трогается
+        m->state = UM_SD_STATE_UNMOUNTING;
+        if (!card_busy)
+        {
+            m->unmounts++;
+            m->mounted_fs = false;
+            m->state = UM_SD_STATE_NO_CARD;
+        }
+        break;
+    case UM_SD_CD_FORGET:
+        m->push_out++;
+        m->state = UM_SD_STATE_NO_CARD;
+        m->retries = 0;
+        break;
+    case UM_SD_CD_NONE:
+        break;
+    }
+    return action;
+}
+
+void test_um_sd_cd_insert_eject(void)
+{
+    model_t m = {0};
+
+    TEST_ASSERT_EQUAL(UM_SD_CD_NONE, step(&m, false, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_CD_MOUNT, step(&m, true, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_MOUNTED, m.state);
+
+    // Повторный фронт без смены уровня (дребезг) ничего не делает
+    TEST_ASSERT_EQUAL(UM_SD_CD_NONE, step(&m, true, true, false));
+    TEST_ASSERT_EQUAL(1, m.mounts);
+
+    TEST_ASSERT_EQUAL(UM_SD_CD_UNMOUNT, step(&m, false, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_NO_CARD, m.state);
+    TEST_ASSERT_FALSE(m.mounted_fs);
+    TEST_ASSERT_EQUAL(1, m.push_out);
+    TEST_ASSERT_EQUAL(UM_SD_CD_NONE, step(&m, false, true, false));
+}
+
+void test_um_sd_cd_mount_retries(void)
+{
+    model_t m = {0};
+
+    TEST_ASSERT_EQUAL(UM_SD_CD_MOUNT, step(&m, true, false, false));
+    for (int i = 1; i < UM_SD_MOUNT_RETRY_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(UM_SD_CD_RETRY, step(&m, true, false, false));
+    }
+    TEST_ASSERT_EQUAL(UM_SD_MOUNT_RETRY_COUNT, m.mounts);
+
+    // Попытки исчерпаны - ждём извлечения
+    TEST_ASSERT_EQUAL(UM_SD_CD_NONE, step(&m, true, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_CD_FORGET, step(&m, false, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_NO_CARD, m.state);
+    TEST_ASSERT_EQUAL(0, m.retries);
+
+    // Новая карта - снова полный набор попыток
+    TEST_ASSERT_EQUAL(UM_SD_CD_MOUNT, step(&m, true, false, false));
+    TEST_ASSERT_EQUAL(UM_SD_CD_RETRY, step(&m, true, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_MOUNTED, m.state);
+}
+
+void test_um_sd_cd_eject_while_busy(void)
+{
+    model_t m = {0};
+    step(&m, true, true, false);
+
+    // Модуль держит карту дольше таймаута: ФС остаётся смонтированной
+    TEST_ASSERT_EQUAL(UM_SD_CD_UNMOUNT, step(&m, false, true, true));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_UNMOUNTING, m.state);
+    TEST_ASSERT_TRUE(m.mounted_fs);
+    TEST_ASSERT_EQUAL(0, m.unmounts);
+
+    // Повторы по таймеру; карту вставили обратно - всё равно сначала размонтирование
+    TEST_ASSERT_EQUAL(UM_SD_CD_UNMOUNT, step(&m, false, true, true));
+    TEST_ASSERT_EQUAL(UM_SD_CD_UNMOUNT, step(&m, true, true, true));
+    TEST_ASSERT_EQUAL(UM_SD_CD_UNMOUNT, step(&m, true, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_NO_CARD, m.state);
+    TEST_ASSERT_FALSE(m.mounted_fs);
+    TEST_ASSERT_EQUAL(1, m.unmounts);
+    TEST_ASSERT_EQUAL(1, m.push_out);
+
+    // Затем вставленная карта монтируется заново
+    TEST_ASSERT_EQUAL(UM_SD_CD_MOUNT, step(&m, true, true, false));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_MOUNTED, m.state);
+    TEST_ASSERT_EQUAL(2, m.mounts);
+}
+
+void test_um_sd_cd_invariants(void)
+{
+    static const um_sd_state_t states[] = {
+        UM_SD_STATE_NO_CARD, UM_SD_STATE_MOUNTED, UM_SD_STATE_MOUNT_FAILED, UM_SD_STATE_UNMOUNTING,
+    };
+
+    for (size_t i = 0; i < sizeof(states) / sizeof(states[0]); i++)
+    {
+        for (int detected = 0; detected <= 1; detected++)
+        {
+            for (uint8_t retries = 0; retries <= UM_SD_MOUNT_RETRY_COUNT + 1; retries++)
+            {
+                um_sd_cd_action_t a = um_sd_cd_next(states[i], detected, retries);
+                // Монтировать можно только пустой слот, размонтировать - только смонтированную ФС
+                if (a == UM_SD_CD_MOUNT || a == UM_SD_CD_RETRY)
+                {
+                    TEST_ASSERT_TRUE(detected);
+                    TEST_ASSERT_TRUE(states[i] == UM_SD_STATE_NO_CARD || states[i] == UM_SD_STATE_MOUNT_FAILED);
+                }
+                if (a == UM_SD_CD_UNMOUNT)
+                {
+                    TEST_ASSERT_TRUE(states[i] == UM_SD_STATE_MOUNTED || states[i] == UM_SD_STATE_UNMOUNTING);
+                }
+                if (a == UM_SD_CD_RETRY)
+                {
+                    TEST_ASSERT_LESS_THAN(UM_SD_MOUNT_RETRY_COUNT, retries);
+                }
+                // Начатое размонтирование не бросается
+                if (states[i] == UM_SD_STATE_UNMOUNTING)
+                {
+                    TEST_ASSERT_EQUAL(UM_SD_CD_UNMOUNT, a);
+                }
+            }
+        }
+    }
+}
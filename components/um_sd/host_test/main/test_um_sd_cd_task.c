@@ -0,0 +1,195 @@
+/*
+ * Настоящая задача детектора sd_cd_task (um_sd_cd_task.c): дребезг CD,
+ * отложенное размонтирование, пока карта захвачена или на ней открыт файл.
+ *
+ * Железо (um_sd_priv.h) и um_sd_mount() подменены тестом, события
+ * перехватываются -Wl,--wrap=um_event_publish. Задача работает со своими
+ * настоящими задержками, поэтому тесты идут несколько секунд.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "um_sd.h"
+#include "um_events.h"
+
+// um_sd_priv.h
+extern TaskHandle_t um_sd_cd_task_handle;
+esp_err_t um_sd_cd_init(void);
+esp_err_t um_sd_cd_start(void);
+void um_sd_set_state(um_sd_state_t state);
+
+/* --- Железо --- */
+
+#define MAX_LEVELS 8
+
+// Уровни CD по очереди выборок, дальше - последний
+static struct
+{
+    int levels[MAX_LEVELS];
+    int count;
+    volatile int reads;
+} s_cd;
+
+static volatile bool s_fs_mounted;
+static volatile int s_mounts;
+static volatile int s_fs_unmounts;
+static volatile int s_events[UMNI_EVENT_CONFIG_SAVED + 1];
+
+int um_sd_cd_level(void)
+{
+    int i = s_cd.reads++;
+    return s_cd.levels[i < s_cd.count ? i : s_cd.count - 1];
+}
+
+bool um_sd_fs_mounted(void)
+{
+    return s_fs_mounted;
+}
+
+esp_err_t um_sd_fs_unmount(void)
+{
+    s_fs_unmounts++;
+    s_fs_mounted = false;
+    return ESP_OK;
+}
+
+// Как um_sd.c: состояние MOUNTED до события
+esp_err_t um_sd_mount(void)
+{
+    s_mounts++;
+    s_fs_mounted = true;
+    um_sd_set_state(UM_SD_STATE_MOUNTED);
+    return ESP_OK;
+}
+
+esp_err_t __wrap_um_event_publish(int32_t event_id, void *event_data, size_t event_data_size,
+                                  TickType_t ticks_to_wait)
+{
+    s_events[event_id]++;
+    return ESP_OK;
+}
+
+/* --- Помощники --- */
+
+static void start_detector(void)
+{
+    if (!um_sd_cd_task_handle)
+    {
+        TEST_ASSERT_EQUAL(ESP_OK, um_sd_cd_init());
+        TEST_ASSERT_EQUAL(ESP_OK, um_sd_cd_start());
+    }
+}
+
+// Фронт на CD: новые выборки уровня и пробуждение задачи, как из ISR
+static void cd_edge(const int *levels, int count)
+{
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_LEVELS, count);
+    for (int i = 0; i < count; i++)
+    {
+        s_cd.levels[i] = levels[i];
+    }
+    s_cd.count = count;
+    s_cd.reads = 0;
+    xTaskNotifyGive(um_sd_cd_task_handle);
+}
+
+static bool wait_state(um_sd_state_t state, int timeout_ms)
+{
+    for (int t = 0; t < timeout_ms; t += 10)
+    {
+        if (um_sd_get_state() == state)
+        {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return um_sd_get_state() == state;
+}
+
+/* --- Тесты --- */
+
+void test_um_sd_cd_task_debounce(void)
+{
+    start_detector();
+
+    // Вставка с дребезгом: уровень меняется три раза, потом держится
+    static const int insert[] = {1, 0, 1, 0, 0};
+    cd_edge(insert, 5);
+    TEST_ASSERT_TRUE(wait_state(UM_SD_STATE_MOUNTED, 2000));
+    TEST_ASSERT_EQUAL(5, s_cd.reads);
+    TEST_ASSERT_EQUAL(1, s_mounts);
+    TEST_ASSERT_EQUAL(1, s_events[UMNI_EVENT_SDCARD_PUSH_IN]);
+
+    // Короткий выброс: к концу выборок уровень тот же - ничего не делаем
+    static const int glitch[] = {1, 0, 0};
+    cd_edge(glitch, 3);
+    vTaskDelay(pdMS_TO_TICKS(500));
+    TEST_ASSERT_EQUAL(3, s_cd.reads);
+    TEST_ASSERT_EQUAL(UM_SD_STATE_MOUNTED, um_sd_get_state());
+    TEST_ASSERT_EQUAL(0, s_events[UMNI_EVENT_SDCARD_PUSH_OUT]);
+    TEST_ASSERT_EQUAL(0, s_fs_unmounts);
+    TEST_ASSERT_EQUAL(1, s_mounts);
+}
+
+void test_um_sd_cd_task_unmount_postponed(void)
+{
+    start_detector();
+    TEST_ASSERT_EQUAL(UM_SD_STATE_MOUNTED, um_sd_get_state());
+    int unmounts = s_fs_unmounts;
+
+    // Модуль держит карту дольше таймаута размонтирования (2 с)
+    TEST_ASSERT_EQUAL(ESP_OK, um_sd_lock(0));
+    static const int eject[] = {1};
+    cd_edge(eject, 1);
+    TEST_ASSERT_TRUE(wait_state(UM_SD_STATE_UNMOUNTING, 1000));
+    TEST_ASSERT_EQUAL(1, s_events[UMNI_EVENT_SDCARD_PUSH_OUT]);
+
+    // Новые захваты уже отклоняются, ФС остаётся смонтированной
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_sd_lock(0));
+    vTaskDelay(pdMS_TO_TICKS(2500));
+    TEST_ASSERT_EQUAL(UM_SD_STATE_UNMOUNTING, um_sd_get_state());
+    TEST_ASSERT_EQUAL(unmounts, s_fs_unmounts);
+    TEST_ASSERT_EQUAL(0, s_events[UMNI_EVENT_SDCARD_UNMOUNTED]);
+
+    // Отпустили - повтор задачи детектора доводит размонтирование
+    um_sd_unlock();
+    TEST_ASSERT_TRUE(wait_state(UM_SD_STATE_NO_CARD, 5000));
+    TEST_ASSERT_EQUAL(unmounts + 1, s_fs_unmounts);
+    TEST_ASSERT_EQUAL(1, s_events[UMNI_EVENT_SDCARD_UNMOUNTED]);
+    TEST_ASSERT_FALSE(s_fs_mounted);
+}
+
+void test_um_sd_cd_task_open_file(void)
+{
+    start_detector();
+    TEST_ASSERT_EQUAL(UM_SD_STATE_NO_CARD, um_sd_get_state());
+    static const int insert[] = {0};
+    cd_edge(insert, 1);
+    TEST_ASSERT_TRUE(wait_state(UM_SD_STATE_MOUNTED, 2000));
+    int mounts = s_mounts;
+    int unmounts = s_fs_unmounts;
+
+    // Файл открыт под захватом и остаётся открытым после um_sd_unlock()
+    TEST_ASSERT_EQUAL(ESP_OK, um_sd_lock(0));
+    um_sd_file_opened();
+    um_sd_unlock();
+
+    static const int eject[] = {1};
+    cd_edge(eject, 1);
+    TEST_ASSERT_TRUE(wait_state(UM_SD_STATE_UNMOUNTING, 1000));
+    vTaskDelay(pdMS_TO_TICKS(500));
+    TEST_ASSERT_EQUAL(unmounts, s_fs_unmounts);
+    TEST_ASSERT_TRUE(s_fs_mounted);
+    // Владелец получает отказ и закрывает файл
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, um_sd_lock(0));
+
+    // Тем временем карту вставили обратно: после размонтирования её
+    // монтируют заново без нового фронта
+    s_cd.levels[0] = 0;
+    um_sd_file_closed();
+    TEST_ASSERT_TRUE(wait_state(UM_SD_STATE_MOUNTED, 5000));
+    TEST_ASSERT_EQUAL(unmounts + 1, s_fs_unmounts);
+    TEST_ASSERT_EQUAL(mounts + 1, s_mounts);
+}
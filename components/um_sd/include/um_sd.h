@@ -6,10 +6,14 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#if !CONFIG_IDF_TARGET_LINUX
+// Драйверов SD на linux нет: хост-тестам нужны только объявления (um_sd_lock и т.п.)
 #include "esp_vfs_fat.h"
 #include "driver/gpio.h"
 #include "sdmmc_cmd.h"
 #include "driver/sdspi_host.h"
+#endif
+#include "um_sd_cd.h"
 
 #ifndef CONFIG_UMNI_SD_MOUNT_POINT
 #define CONFIG_UMNI_SD_MOUNT_POINT "/sdcard"
@@ -23,8 +27,9 @@ extern "C"
     /**
      * @brief Инициализация детектора SD карты с подавлением дребезга
      *
-     * Настраивает GPIO и прерывания для детектирования наличия SD карты
-     * с программным подавлением дребезга контактов
+     * Настраивает GPIO и прерывания для детектирования наличия SD карты.
+     * ISR только будит постоянную задачу детектора; она подавляет дребезг,
+     * монтирует/размонтирует карту и публикует UMNI_EVENT_SDCARD_*
      */
     void um_init_sd_cd(void);
 
@@ -48,15 +53,24 @@ extern "C"
      * @brief Монтирует SD карту в файловую систему
      * @return ESP_OK при успехе, код ошибки при неудаче
      *
-     * Инициализирует SD карту и монтирует её в указанную точку монтирования
+     * Инициализирует SD карту и монтирует её в указанную точку монтирования.
+     * С CONFIG_UM_CFG_SDCARD_AUTO_FREQ частота берётся из NVS и проверяется
+     * самопроверкой (запись/чтение с CRC32); если её нет или она не прошла,
+     * перебираются частоты от CONFIG_UM_CFG_SDCARD_MAX_FREQ_KHZ вниз, лучшая
+     * сохраняется в NVS.
      */
     esp_err_t um_sd_mount(void);
 
     /**
      * @brief Размонтирует SD карту
-     * @return ESP_OK при успехе, код ошибки при неудаче
+     * @return ESP_OK при успехе, ESP_ERR_TIMEOUT если карта занята,
+     *         код ошибки при неудаче
      *
-     * Размонтирует файловую систему и освобождает ресурсы SD карты
+     * Переводит карту в UM_SD_STATE_UNMOUNTING (новые um_sd_lock() получают
+     * отказ) и ждёт освобождения до 2 секунд. Если карта всё ещё занята или
+     * остались файлы, отмеченные um_sd_file_opened(), файловая система
+     * остаётся смонтированной, а задача детектора повторяет попытку каждые
+     * 2 секунды.
      */
     esp_err_t um_sd_unmount(void);
 
@@ -68,6 +82,82 @@ extern "C"
      */
     void *um_sd_get_card_info(void);
 
+    /**
+     * @brief Текущее состояние SD карты
+     */
+    um_sd_state_t um_sd_get_state(void);
+
+    /**
+     * @brief Смонтирована ли SD карта
+     */
+    bool um_sd_is_mounted(void);
+
+    /**
+     * @brief Захватить карту на время работы с файлами
+     * @param timeout Время ожидания
+     * @return ESP_OK, ESP_ERR_INVALID_STATE если карта не смонтирована,
+     *         ESP_ERR_TIMEOUT
+     *
+     * Пока карта захвачена, детектор не размонтирует её (ждёт до 2 с).
+     * Файл, открытый между захватами, регистрируется um_sd_file_opened():
+     * иначе карту размонтируют под открытым дескриптором.
+     */
+    esp_err_t um_sd_lock(TickType_t timeout);
+
+    /**
+     * @brief Освободить карту после um_sd_lock()
+     */
+    void um_sd_unlock(void);
+
+    /**
+     * @brief Отметить файл (или каталог), который остаётся открытым после um_sd_unlock()
+     *
+     * Вызывается под um_sd_lock() сразу после открытия. Пока есть открытые
+     * файлы, um_sd_unmount() откладывается (ESP_ERR_TIMEOUT), а детектор
+     * повторяет попытку каждые 2 с. Получив отказ um_sd_lock() (карта в
+     * UM_SD_STATE_UNMOUNTING), владелец должен закрыть файл.
+     */
+    void um_sd_file_opened(void);
+
+    /**
+     * @brief Файл, отмеченный um_sd_file_opened(), закрыт (блокировка не нужна)
+     */
+    void um_sd_file_closed(void);
+
+    /**
+     * @brief Результат теста скорости SD карты
+     */
+    typedef struct
+    {
+        uint32_t size_kb;    /**< Фактический объём теста (кратен 16 KB) */
+        uint32_t freq_khz;   /**< Частота шины */
+        uint32_t write_kbps; /**< Последовательная запись, KB/s */
+        uint32_t read_kbps;  /**< Последовательное чтение, KB/s */
+        bool crc_ok;         /**< Прочитанные данные совпали с записанными */
+    } um_sd_bench_result_t;
+
+    /** Максимальный объём теста скорости */
+#define UM_SD_BENCH_MAX_KB 8192
+
+    /**
+     * @brief Текущая частота шины SD, кГц (0 - карта не смонтирована)
+     */
+    uint32_t um_sd_get_freq_khz(void);
+
+    /**
+     * @brief Тест последовательной записи/чтения
+     * @param size_kb Объём файла (16 .. UM_SD_BENCH_MAX_KB)
+     * @param[out] result Результат
+     * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE (нет карты),
+     *         ESP_ERR_NO_MEM, ESP_FAIL (ошибка ввода-вывода)
+     *
+     * Пишет и читает временный файл кусками по 16 KB, захватывая
+     * um_sd_lock() на каждый кусок, затем удаляет его. size_kb округляется
+     * вниз до кратного 16, скорость считается по фактическому объёму
+     * (result->size_kb). Блокирует вызывающую задачу на время теста.
+     */
+    esp_err_t um_sd_benchmark(uint32_t size_kb, um_sd_bench_result_t *result);
+
 #ifdef __cplusplus
 }
 #endif
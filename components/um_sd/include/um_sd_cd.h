@@ -0,0 +1,51 @@
+#ifndef UM_SD_CD_H
+#define UM_SD_CD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Повторные попытки монтирования, если карта вставлена, но не читается */
+#define UM_SD_MOUNT_RETRY_COUNT 3
+
+    /**
+     * @brief Состояние SD карты
+     */
+    typedef enum
+    {
+        UM_SD_STATE_NO_CARD = 0,  /**< Карты нет (или извлечена) */
+        UM_SD_STATE_MOUNTED,      /**< Карта смонтирована */
+        UM_SD_STATE_MOUNT_FAILED, /**< Карта вставлена, но не монтируется */
+        UM_SD_STATE_UNMOUNTING,   /**< Ждём, пока модули отпустят карту */
+    } um_sd_state_t;
+
+    /**
+     * @brief Действие детектора по стабильному уровню CD
+     */
+    typedef enum
+    {
+        UM_SD_CD_NONE = 0, /**< Ничего не делать (дребезг, повтор фронта) */
+        UM_SD_CD_MOUNT,    /**< Карта вставлена - монтировать */
+        UM_SD_CD_RETRY,    /**< Повторить неудачное монтирование */
+        UM_SD_CD_UNMOUNT,  /**< Карта извлечена - размонтировать */
+        UM_SD_CD_FORGET,   /**< Извлечена карта, которая не смонтировалась */
+    } um_sd_cd_action_t;
+
+    /**
+     * @brief Переход автомата детектора карты (без обращения к железу)
+     * @param state Текущее состояние
+     * @param detected Стабильный уровень CD: карта вставлена
+     * @param retries Число уже сделанных попыток монтирования
+     * @return Действие, которое должна выполнить задача детектора
+     */
+    um_sd_cd_action_t um_sd_cd_next(um_sd_state_t state, bool detected, uint8_t retries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UM_SD_CD_H
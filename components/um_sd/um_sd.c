@@ -1,57 +1,52 @@
 #include "um_sd.h"
+#include "um_sd_priv.h"
 #include "base_config.h"
 #include "um_events.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "um_nvs.h"
+#include "um_storage.h"
 
-// Время подавления дребезга контактов в миллисекундах
-#define DEBOUNCE_DELAY_MS 50
+// Безопасная частота (прежнее фиксированное значение)
+#define UM_SD_SAFE_FREQ_KHZ 12000
+// Кластер FAT (allocation_unit_size) за одну DMA-передачу
+#define UM_SD_MAX_TRANSFER_SZ (16 * 1024)
+
+// Самопроверка частоты: 4 x 4 KB поверх одного и того же файла. Файл
+// остаётся на карте: перезапись на месте не меняет таблицу FAT
+#define UM_SD_TEST_FILE CONFIG_UMNI_SD_MOUNT_POINT "/SDTEST.BIN"
+#define UM_SD_TEST_CHUNK 4096
+#define UM_SD_TEST_CHUNKS 4
+
+// Тест скорости: файл пишется и читается кусками по кластеру
+#define UM_SD_BENCH_FILE CONFIG_UMNI_SD_MOUNT_POINT "/SDBENCH.BIN"
+#define UM_SD_BENCH_CHUNK (16 * 1024)
+#define UM_SD_BENCH_LOCK_MS 1000
 
 #if UM_FEATURE_ENABLED(SDCARD)
 
 static const char *TAG = "sdcard";
-static TickType_t last_interrupt_time = 0;
 static sdmmc_card_t *sd_card = NULL;
 
-/**
- * @brief Задача обработки прерывания детектора SD карты
- */
-static void um_sd_cd_interrupt_task(void *arg)
-{
-    int level = gpio_get_level(CONFIG_UM_CFG_SDCARD_DETECT_GPIO);
-    printf("Level %d ", level);
-    if (level == 0)
-    {
-        esp_event_post(UMNI_EVENT_BASE, UMNI_EVENT_SDCARD_PUSH_IN, NULL, sizeof(NULL), portMAX_DELAY);
-        ESP_LOGI(TAG, "SD card was inserted %d", level);
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-        um_sd_mount();
-    }
-    else
-    {
-        esp_event_post(UMNI_EVENT_BASE, UMNI_EVENT_SDCARD_PUSH_OUT, NULL, sizeof(NULL), portMAX_DELAY);
-        ESP_LOGW(TAG, "SD card was ejected %d", level);
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-        um_sd_unmount();
-    }
-
-    esp_restart();
-
-    vTaskDelete(NULL);
-}
+static uint32_t s_freq_khz = 0;
 
 /**
  * @brief Обработчик прерывания GPIO в режиме IRAM
  */
 static void IRAM_ATTR um_catch_sd_cd_interrupts(void *args)
 {
-    TickType_t current_time = xTaskGetTickCountFromISR();
-
-    // Подавление дребезга - проверяем время с последнего прерывания
-    if ((current_time - last_interrupt_time) * portTICK_PERIOD_MS >= DEBOUNCE_DELAY_MS)
+    BaseType_t woken = pdFALSE;
+    if (um_sd_cd_task_handle)
     {
-        xTaskCreate(um_sd_cd_interrupt_task, "sd_cd_interrupt_task", 4096, NULL, 2, NULL);
+        vTaskNotifyGiveFromISR(um_sd_cd_task_handle, &woken);
     }
-
-    last_interrupt_time = current_time;
+    portYIELD_FROM_ISR(woken);
 }
 
 /**
@@ -59,6 +54,10 @@ static void IRAM_ATTR um_catch_sd_cd_interrupts(void *args)
  */
 void um_init_sd_cd(void)
 {
+    if (um_sd_cd_start() != ESP_OK)
+    {
+        return;
+    }
 
     // Убедитесь, что служба прерываний GPIO установлена
     esp_err_t res = gpio_install_isr_service(0);
@@ -79,13 +78,9 @@ void um_init_sd_cd(void)
     ESP_LOGI(TAG, "SD CD interrupt handler initialized with debouncing (level %d)", level);
 }
 
-/**
- * @brief Проверяет текущее состояние детектора SD карты
- */
-bool um_sd_card_detected(void)
+int um_sd_cd_level(void)
 {
-    int level = gpio_get_level(CONFIG_UM_CFG_SDCARD_DETECT_GPIO);
-    return (level == 0);
+    return gpio_get_level(CONFIG_UM_CFG_SDCARD_DETECT_GPIO);
 }
 
 /**
@@ -93,27 +88,63 @@ bool um_sd_card_detected(void)
  */
 esp_err_t um_sd_init()
 {
+    if (um_sd_cd_init() != ESP_OK)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Начальное монтирование - до запуска задачи детектора
+    esp_err_t ret = ESP_FAIL;
+    if (um_sd_card_detected())
+    {
+        um_sd_try_mount();
+        ret = um_sd_is_mounted() ? ESP_OK : ESP_FAIL;
+    }
+
     // Инициализация детектора
     um_init_sd_cd();
 
-    // Проверка наличия карты
-    if (um_sd_card_detected())
+    // Повторные попытки, если карта вставлена, но не смонтировалась
+    if (um_sd_get_state() == UM_SD_STATE_MOUNT_FAILED && um_sd_cd_task_handle)
     {
-        // Монтирование карты
-        return um_sd_mount();
+        xTaskNotifyGive(um_sd_cd_task_handle);
     }
-    return ESP_FAIL;
+
+    return ret;
 }
 /**
- * @brief Монтирует SD карту в файловую систему
+ * @brief Инициализирует шину SPI (один раз, остаётся между переподключениями)
  */
-esp_err_t um_sd_mount(void)
+static esp_err_t um_sd_init_bus(void)
 {
-    esp_err_t ret;
+    spi_bus_config_t bus_cfg = {
+        .mosi_io_num = CONFIG_UM_CFG_SDCARD_MOSI_GPIO,
+        .miso_io_num = CONFIG_UM_CFG_SDCARD_MISO_GPIO,
+        .sclk_io_num = CONFIG_UM_CFG_SDCARD_SCLK_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        // Многосекторные DMA-передачи: целый кластер FAT за раз
+        .max_transfer_sz = UM_SD_MAX_TRANSFER_SZ,
+    };
+
+    esp_err_t ret = spi_bus_initialize(CONFIG_UM_CFG_SDCARD_SPI_HOST, &bus_cfg, SDSPI_DEFAULT_DMA);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to initialize bus.");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
 
+/**
+ * @brief Монтирует FAT на заданной частоте, без событий
+ */
+static esp_err_t um_sd_mount_at(uint32_t freq_khz)
+{
     // Конфигурация монтирования FAT
+    // Не форматируем при ошибке: при горячей вставке контакт может быть
+    // нестабильным, и форматирование уничтожило бы данные на карте
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
-        .format_if_mount_failed = true,
+        .format_if_mount_failed = false,
         .max_files = 5,
         .allocation_unit_size = 16 * 1024};
 
@@ -124,29 +155,212 @@ esp_err_t um_sd_mount(void)
 
     // Настройка хоста SD SPI
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
-    host.max_freq_khz = 12 * 1000; // Пониженная частота для стабильности
+    host.slot = CONFIG_UM_CFG_SDCARD_SPI_HOST;
+    host.max_freq_khz = freq_khz;
 
-    spi_bus_config_t bus_cfg = {
-        .mosi_io_num = CONFIG_UM_CFG_SDCARD_MOSI_GPIO,
-        .miso_io_num = CONFIG_UM_CFG_SDCARD_MISO_GPIO,
-        .sclk_io_num = CONFIG_UM_CFG_SDCARD_SCLK_GPIO,
-        .quadwp_io_num = -1,
-        .quadhd_io_num = -1,
-        .max_transfer_sz = 4000,
-    };
+    esp_err_t ret = esp_vfs_fat_sdspi_mount(CONFIG_UMNI_SD_MOUNT_POINT, &host, &slot_config, &mount_config, &sd_card);
+    if (ret != ESP_OK)
+    {
+        sd_card = NULL;
+    }
+    return ret;
+}
 
-    ret = spi_bus_initialize(host.slot, &bus_cfg, SDSPI_DEFAULT_DMA);
-    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
-        ESP_LOGE(TAG, "Failed to initialize bus.");
-        return ESP_FAIL;
+static void um_sd_unmount_card(void)
+{
+    if (sd_card)
+    {
+        esp_vfs_fat_sdcard_unmount(CONFIG_UMNI_SD_MOUNT_POINT, sd_card);
+        sd_card = NULL;
+    }
+}
+
+static void um_sd_fill_pattern(uint8_t *buf, size_t len, uint32_t seed)
+{
+    // xorshift32: разные данные на каждой частоте, чтобы не прочитать старые
+    uint32_t x = seed ? seed : 0x9E3779B9;
+    for (size_t i = 0; i + 4 <= len; i += 4)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        memcpy(buf + i, &x, 4);
+    }
+}
+
+#if CONFIG_UM_CFG_SDCARD_AUTO_FREQ
+/**
+ * @brief Самопроверка на текущей частоте: запись и чтение с проверкой CRC32
+ *
+ * Пишет поверх уже выделенного файла, поэтому таблица FAT не меняется.
+ * В режиме SPI карта сама отвергает блоки с ошибкой CRC при записи.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_CRC при искажении/ошибке ввода-вывода,
+ *         ESP_ERR_NOT_SUPPORTED если файл создать нельзя (карта заполнена/защищена)
+ */
+static esp_err_t um_sd_self_test(uint32_t seed)
+{
+    uint8_t *buf = heap_caps_malloc(UM_SD_TEST_CHUNK, MALLOC_CAP_DMA);
+    if (!buf)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    uint32_t crc_written = 0;
+    uint32_t crc_read = 0;
+
+    int fd = open(UM_SD_TEST_FILE, O_RDWR | O_CREAT, 0664);
+    if (fd < 0)
+    {
+        free(buf);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    for (int i = 0; i < UM_SD_TEST_CHUNKS && ret == ESP_OK; i++)
+    {
+        um_sd_fill_pattern(buf, UM_SD_TEST_CHUNK, seed + i);
+        crc_written = esp_rom_crc32_le(crc_written, buf, UM_SD_TEST_CHUNK);
+        if (write(fd, buf, UM_SD_TEST_CHUNK) != UM_SD_TEST_CHUNK)
+        {
+            ret = (errno == ENOSPC) ? ESP_ERR_NOT_SUPPORTED : ESP_ERR_INVALID_CRC;
+        }
+    }
+    if (ret == ESP_OK && fsync(fd) != 0)
+    {
+        ret = ESP_ERR_INVALID_CRC;
+    }
+
+    if (ret == ESP_OK && lseek(fd, 0, SEEK_SET) == 0)
+    {
+        for (int i = 0; i < UM_SD_TEST_CHUNKS && ret == ESP_OK; i++)
+        {
+            if (read(fd, buf, UM_SD_TEST_CHUNK) != UM_SD_TEST_CHUNK)
+            {
+                ret = ESP_ERR_INVALID_CRC;
+                break;
+            }
+            crc_read = esp_rom_crc32_le(crc_read, buf, UM_SD_TEST_CHUNK);
+        }
+        if (ret == ESP_OK && crc_read != crc_written)
+        {
+            ret = ESP_ERR_INVALID_CRC;
+        }
+    }
+
+    close(fd);
+    free(buf);
+    return ret;
+}
+
+/**
+ * @brief Подбор частоты: от большей к меньшей, до первой прошедшей самопроверку
+ *
+ * @return ESP_OK - карта смонтирована (на подобранной или безопасной частоте)
+ */
+static esp_err_t um_sd_negotiate(void)
+{
+    static const uint32_t freqs_khz[] = {40000, 26000, 20000, 16000, 12000, 8000, 4000};
+    esp_err_t ret = ESP_FAIL;
+
+    for (size_t i = 0; i < sizeof(freqs_khz) / sizeof(freqs_khz[0]); i++)
+    {
+        uint32_t freq = freqs_khz[i];
+        if (freq > CONFIG_UM_CFG_SDCARD_MAX_FREQ_KHZ)
+        {
+            continue;
+        }
+
+        ret = um_sd_mount_at(freq);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Mount at %lu kHz failed: %s", (unsigned long)freq, esp_err_to_name(ret));
+            continue;
+        }
+
+        esp_err_t test = um_sd_self_test(freq);
+        if (test == ESP_OK)
+        {
+            ESP_LOGI(TAG, "SD card self-test passed at %lu kHz", (unsigned long)freq);
+            s_freq_khz = freq;
+            um_nvs_write_u16(UM_NVS_KEY_SD_FREQ, (uint16_t)freq);
+            return ESP_OK;
+        }
+
+        if (test == ESP_ERR_NOT_SUPPORTED || test == ESP_ERR_NO_MEM)
+        {
+            // Проверить нечем - остаёмся на безопасной частоте, не запоминая её
+            ESP_LOGW(TAG, "SD card self-test not possible, using %d kHz", UM_SD_SAFE_FREQ_KHZ);
+            um_sd_unmount_card();
+            break;
+        }
+
+        ESP_LOGW(TAG, "SD card self-test failed at %lu kHz", (unsigned long)freq);
+        um_sd_unmount_card();
+        ret = ESP_FAIL;
     }
 
-    // Монтирование SD карты
-    ret = esp_vfs_fat_sdspi_mount(CONFIG_UMNI_SD_MOUNT_POINT, &host, &slot_config, &mount_config, &sd_card);
+    ret = um_sd_mount_at(UM_SD_SAFE_FREQ_KHZ);
+    if (ret == ESP_OK)
+    {
+        s_freq_khz = UM_SD_SAFE_FREQ_KHZ;
+    }
+    return ret;
+}
+#endif // CONFIG_UM_CFG_SDCARD_AUTO_FREQ
+
+/**
+ * @brief Монтирует SD карту в файловую систему
+ */
+esp_err_t um_sd_mount(void)
+{
+    esp_err_t ret;
+
+    if (sd_card)
+    {
+        return ESP_OK;
+    }
+
+    ret = um_sd_init_bus();
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+#if CONFIG_UM_CFG_SDCARD_AUTO_FREQ
+    // Сохранённая частота проверяется самопроверкой: карта могла смениться
+    uint16_t saved = 0;
+    ret = ESP_FAIL;
+    if (um_nvs_read_u16(UM_NVS_KEY_SD_FREQ, &saved) == ESP_OK && saved > 0 &&
+        saved <= CONFIG_UM_CFG_SDCARD_MAX_FREQ_KHZ)
+    {
+        ret = um_sd_mount_at(saved);
+        if (ret == ESP_OK && um_sd_self_test(esp_random()) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Saved SD frequency %u kHz is unreliable", saved);
+            um_sd_unmount_card();
+            ret = ESP_FAIL;
+        }
+        if (ret == ESP_OK)
+        {
+            s_freq_khz = saved;
+        }
+    }
+    if (ret != ESP_OK)
+    {
+        ret = um_sd_negotiate();
+    }
+#else
+    ret = um_sd_mount_at(UM_SD_SAFE_FREQ_KHZ);
+    if (ret == ESP_OK)
+    {
+        s_freq_khz = UM_SD_SAFE_FREQ_KHZ;
+    }
+#endif
 
     if (ret == ESP_OK)
     {
-        ESP_LOGI(TAG, "SD card mounted successfully");
+        ESP_LOGI(TAG, "SD card mounted successfully at %lu kHz", (unsigned long)s_freq_khz);
         // Вывод информации о карте
         //sdmmc_card_print_info(stdout, sd_card);
         char *type;
@@ -167,34 +381,41 @@ esp_err_t um_sd_mount(void)
         }
         uint64_t size = ((uint64_t) sd_card->csd.capacity) * sd_card->csd.sector_size / (1024 * 1024);
         ESP_LOGI(TAG, "✅ SD Card name: %s, type: %s, capacity: %llu MB",sd_card->cid.name, type, size);
-        esp_event_post(UMNI_EVENT_BASE, UMNI_EVENT_SDCARD_MOUNTED, NULL, sizeof(NULL), portMAX_DELAY);
+        // Карта ещё никому не выдана: доводим до конца атомарные записи,
+        // прерванные извлечением или сбросом (загрузки /api/files и т.п.)
+        um_storage_recover_dir(CONFIG_UMNI_SD_MOUNT_POINT);
+        um_sd_set_state(UM_SD_STATE_MOUNTED);
+        um_event_publish(UMNI_EVENT_SDCARD_MOUNTED, NULL, 0, portMAX_DELAY);
     }
     else
     {
         ESP_LOGE(TAG, "❌ Failed to mount SD card: %s", esp_err_to_name(ret));
-        esp_event_post(UMNI_EVENT_BASE, UMNI_EVENT_SDCARD_UNMOUNTED, NULL, sizeof(NULL), portMAX_DELAY);
+        s_freq_khz = 0;
+        um_event_publish(UMNI_EVENT_SDCARD_UNMOUNTED, NULL, 0, portMAX_DELAY);
     }
 
     return ret;
 }
 
-/**
- * @brief Размонтирует SD карту
- */
-esp_err_t um_sd_unmount(void)
+bool um_sd_fs_mounted(void)
+{
+    return sd_card != NULL;
+}
+
+esp_err_t um_sd_fs_unmount(void)
 {
     esp_err_t ret = esp_vfs_fat_sdcard_unmount(CONFIG_UMNI_SD_MOUNT_POINT, sd_card);
 
     if (ret == ESP_OK)
     {
         ESP_LOGI(TAG, "SD card unmounted successfully");
-        sd_card = NULL;
     }
     else
     {
         ESP_LOGE(TAG, "Failed to unmount SD card: %s", esp_err_to_name(ret));
     }
-
+    sd_card = NULL;
+    s_freq_khz = 0;
     return ret;
 }
 
@@ -206,4 +427,141 @@ void *um_sd_get_card_info(void)
     return sd_card;
 }
 
-#endif
\ No newline at end of file
+uint32_t um_sd_get_freq_khz(void)
+{
+    return s_freq_khz;
+}
+
+esp_err_t um_sd_benchmark(uint32_t size_kb, um_sd_bench_result_t *result)
+{
+    if (!result || size_kb < UM_SD_BENCH_CHUNK / 1024 || size_kb > UM_SD_BENCH_MAX_KB)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(result, 0, sizeof(*result));
+
+    uint8_t *buf = heap_caps_malloc(UM_SD_BENCH_CHUNK, MALLOC_CAP_DMA);
+    if (!buf)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Размер округляется вниз до целого числа кусков
+    size_t chunks = (size_t)size_kb * 1024 / UM_SD_BENCH_CHUNK;
+    uint64_t bytes = (uint64_t)chunks * UM_SD_BENCH_CHUNK;
+    uint32_t crc_written = 0;
+    uint32_t crc_read = 0;
+
+    // Карта захватывается на каждый кусок, чтобы лог и веб-сервер не ждали
+    // весь тест; ожидание захвата во время не входит
+    esp_err_t ret = um_sd_lock(pdMS_TO_TICKS(UM_SD_BENCH_LOCK_MS));
+    if (ret != ESP_OK)
+    {
+        free(buf);
+        return ret;
+    }
+    int fd = open(UM_SD_BENCH_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    um_sd_unlock();
+    if (fd < 0)
+    {
+        free(buf);
+        return ESP_FAIL;
+    }
+
+    // Последовательная запись (генерация данных не входит во время)
+    int64_t elapsed = 0;
+    for (size_t i = 0; i < chunks && ret == ESP_OK; i++)
+    {
+        um_sd_fill_pattern(buf, UM_SD_BENCH_CHUNK, i + 1);
+        crc_written = esp_rom_crc32_le(crc_written, buf, UM_SD_BENCH_CHUNK);
+        ret = um_sd_lock(pdMS_TO_TICKS(UM_SD_BENCH_LOCK_MS));
+        if (ret != ESP_OK)
+        {
+            break;
+        }
+        int64_t start = esp_timer_get_time();
+        if (write(fd, buf, UM_SD_BENCH_CHUNK) != UM_SD_BENCH_CHUNK)
+        {
+            ret = ESP_FAIL;
+        }
+        elapsed += esp_timer_get_time() - start;
+        um_sd_unlock();
+    }
+    if (ret == ESP_OK)
+    {
+        ret = um_sd_lock(pdMS_TO_TICKS(UM_SD_BENCH_LOCK_MS));
+        if (ret == ESP_OK)
+        {
+            int64_t start = esp_timer_get_time();
+            if (fsync(fd) != 0)
+            {
+                ret = ESP_FAIL;
+            }
+            elapsed += esp_timer_get_time() - start;
+            um_sd_unlock();
+        }
+    }
+    close(fd);
+    if (ret == ESP_OK && elapsed > 0)
+    {
+        result->write_kbps = (uint32_t)(bytes * 1000000 / 1024 / elapsed);
+    }
+
+    // Последовательное чтение с проверкой CRC
+    if (ret == ESP_OK)
+    {
+        elapsed = 0;
+        fd = open(UM_SD_BENCH_FILE, O_RDONLY);
+        if (fd < 0)
+        {
+            ret = ESP_FAIL;
+        }
+        for (size_t i = 0; i < chunks && ret == ESP_OK; i++)
+        {
+            ret = um_sd_lock(pdMS_TO_TICKS(UM_SD_BENCH_LOCK_MS));
+            if (ret != ESP_OK)
+            {
+                break;
+            }
+            int64_t start = esp_timer_get_time();
+            if (read(fd, buf, UM_SD_BENCH_CHUNK) != UM_SD_BENCH_CHUNK)
+            {
+                ret = ESP_FAIL;
+            }
+            elapsed += esp_timer_get_time() - start;
+            um_sd_unlock();
+            crc_read = esp_rom_crc32_le(crc_read, buf, UM_SD_BENCH_CHUNK);
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (ret == ESP_OK && elapsed > 0)
+        {
+            result->read_kbps = (uint32_t)(bytes * 1000000 / 1024 / elapsed);
+        }
+        result->crc_ok = (ret == ESP_OK && crc_read == crc_written);
+    }
+
+    // Карту могли извлечь посреди теста - тогда удалять нечего
+    if (um_sd_lock(pdMS_TO_TICKS(UM_SD_BENCH_LOCK_MS)) == ESP_OK)
+    {
+        unlink(UM_SD_BENCH_FILE);
+        um_sd_unlock();
+    }
+    free(buf);
+
+    result->size_kb = (uint32_t)(bytes / 1024);
+    result->freq_khz = s_freq_khz;
+
+    if (ret == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Benchmark %lu KB @ %lu kHz: write %lu KB/s, read %lu KB/s, CRC %s",
+                 (unsigned long)result->size_kb, (unsigned long)s_freq_khz,
+                 (unsigned long)result->write_kbps, (unsigned long)result->read_kbps,
+                 result->crc_ok ? "ok" : "MISMATCH");
+    }
+    return ret;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "um_sd_cd.h"
+
+/**
+ * @brief Переход автомата детектора по стабильному уровню CD
+ *
+ * Чистая функция: всё, что зависит от железа, делает вызывающий.
+ * Отдельный файл, чтобы автомат собирался и тестировался на хосте.
+ */
+um_sd_cd_action_t um_sd_cd_next(um_sd_state_t state, bool detected, uint8_t retries)
+{
+    switch (state)
+    {
+    case UM_SD_STATE_NO_CARD:
+        return detected ? UM_SD_CD_MOUNT : UM_SD_CD_NONE;
+    case UM_SD_STATE_MOUNTED:
+        return detected ? UM_SD_CD_NONE : UM_SD_CD_UNMOUNT;
+    case UM_SD_STATE_MOUNT_FAILED:
+        if (!detected)
+            return UM_SD_CD_FORGET;
+        return retries < UM_SD_MOUNT_RETRY_COUNT ? UM_SD_CD_RETRY : UM_SD_CD_NONE;
+    case UM_SD_STATE_UNMOUNTING:
+        // Размонтирование доводится до конца, даже если карту уже вставили
+        // обратно: это может быть другая карта
+        return UM_SD_CD_UNMOUNT;
+    }
+    return UM_SD_CD_NONE;
+}
@@ -0,0 +1,301 @@
+#include "um_sd.h"
+#include "um_sd_priv.h"
+#include "base_config.h"
+#include "um_events.h"
+#include "freertos/semphr.h"
+
+// Задача детектора, состояние карты и её блокировка. Обращения к железу -
+// через um_sd_priv.h, поэтому файл собирается и тестируется на хосте
+
+// Время подавления дребезга контактов в миллисекундах
+#define DEBOUNCE_DELAY_MS 50
+// Максимум повторных выборок, пока уровень не стабилизируется
+#define DEBOUNCE_MAX_SAMPLES 20
+// Пауза после вставки карты перед монтированием (контакты садятся не сразу)
+#define INSERT_SETTLE_MS 500
+// Повторные попытки монтирования, если карта вставлена, но не читается
+#define MOUNT_RETRY_COUNT UM_SD_MOUNT_RETRY_COUNT
+#define MOUNT_RETRY_DELAY_MS 2000
+// Сколько ждать, пока модули отпустят карту перед размонтированием
+#define UNMOUNT_LOCK_TIMEOUT_MS 2000
+
+#define SD_CD_TASK_STACK 4096
+#define SD_CD_TASK_PRIORITY 2
+
+#if UM_FEATURE_ENABLED(SDCARD)
+
+static const char *TAG = "sdcard";
+
+TaskHandle_t um_sd_cd_task_handle = NULL;
+
+static SemaphoreHandle_t s_sd_lock = NULL;
+static volatile um_sd_state_t s_state = UM_SD_STATE_NO_CARD;
+static uint8_t s_mount_retries = 0;
+
+// Файлы и каталоги, открытые между захватами (um_sd_file_opened)
+static portMUX_TYPE s_files_mux = portMUX_INITIALIZER_UNLOCKED;
+static int s_open_files = 0;
+
+/**
+ * @brief Ждёт, пока уровень CD не перестанет меняться
+ */
+static bool um_sd_cd_read_debounced(void)
+{
+    int level = um_sd_cd_level();
+
+    for (int i = 0; i < DEBOUNCE_MAX_SAMPLES; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(DEBOUNCE_DELAY_MS));
+        int now = um_sd_cd_level();
+        if (now == level)
+        {
+            break;
+        }
+        level = now;
+    }
+
+    // Фронты, пойманные за время ожидания, уже учтены
+    ulTaskNotifyTake(pdTRUE, 0);
+    return level == 0;
+}
+
+void um_sd_try_mount(void)
+{
+    if (um_sd_mount() == ESP_OK)
+    {
+        s_state = UM_SD_STATE_MOUNTED;
+        s_mount_retries = 0;
+    }
+    else
+    {
+        s_state = UM_SD_STATE_MOUNT_FAILED;
+        s_mount_retries++;
+    }
+}
+
+/**
+ * @brief Задача детектора SD карты
+ *
+ * Живёт всё время работы: ISR только будит её, монтирование и
+ * размонтирование выполняются здесь, без перезагрузки контроллера.
+ */
+static void um_sd_cd_task(void *arg)
+{
+    while (1)
+    {
+        TickType_t wait = portMAX_DELAY;
+        if ((s_state == UM_SD_STATE_MOUNT_FAILED && s_mount_retries < MOUNT_RETRY_COUNT) ||
+            s_state == UM_SD_STATE_UNMOUNTING)
+        {
+            wait = pdMS_TO_TICKS(MOUNT_RETRY_DELAY_MS);
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        bool detected = um_sd_cd_read_debounced();
+
+        switch (um_sd_cd_next(s_state, detected, s_mount_retries))
+        {
+        case UM_SD_CD_MOUNT:
+            ESP_LOGI(TAG, "SD card was inserted");
+            um_event_publish(UMNI_EVENT_SDCARD_PUSH_IN, NULL, 0, portMAX_DELAY);
+            vTaskDelay(pdMS_TO_TICKS(INSERT_SETTLE_MS));
+            s_mount_retries = 0;
+            um_sd_try_mount();
+            break;
+
+        case UM_SD_CD_RETRY:
+            ESP_LOGW(TAG, "Retrying SD card mount (%d/%d)", s_mount_retries + 1, MOUNT_RETRY_COUNT);
+            um_sd_try_mount();
+            break;
+
+        case UM_SD_CD_UNMOUNT:
+            if (s_state == UM_SD_STATE_MOUNTED)
+            {
+                ESP_LOGW(TAG, "SD card was ejected");
+                um_event_publish(UMNI_EVENT_SDCARD_PUSH_OUT, NULL, 0, portMAX_DELAY);
+            }
+            // Карта занята - повтор через MOUNT_RETRY_DELAY_MS
+            if (um_sd_unmount() == ESP_OK && detected)
+            {
+                // Вставленную тем временем карту монтируем без нового фронта
+                xTaskNotifyGive(um_sd_cd_task_handle);
+            }
+            break;
+
+        case UM_SD_CD_FORGET:
+            ESP_LOGW(TAG, "Unreadable SD card was ejected");
+            um_event_publish(UMNI_EVENT_SDCARD_PUSH_OUT, NULL, 0, portMAX_DELAY);
+            s_state = UM_SD_STATE_NO_CARD;
+            s_mount_retries = 0;
+            break;
+
+        case UM_SD_CD_NONE:
+            break;
+        }
+    }
+}
+
+esp_err_t um_sd_cd_init(void)
+{
+    if (!s_sd_lock)
+    {
+        s_sd_lock = xSemaphoreCreateRecursiveMutex();
+        if (!s_sd_lock)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t um_sd_cd_start(void)
+{
+    if (!um_sd_cd_task_handle &&
+        xTaskCreate(um_sd_cd_task, "sd_cd_task", SD_CD_TASK_STACK, NULL,
+                    SD_CD_TASK_PRIORITY, &um_sd_cd_task_handle) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create SD CD task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void um_sd_set_state(um_sd_state_t state)
+{
+    s_state = state;
+}
+
+/**
+ * @brief Проверяет текущее состояние детектора SD карты
+ */
+bool um_sd_card_detected(void)
+{
+    return um_sd_cd_level() == 0;
+}
+
+static int um_sd_open_files(void)
+{
+    portENTER_CRITICAL(&s_files_mux);
+    int n = s_open_files;
+    portEXIT_CRITICAL(&s_files_mux);
+    return n;
+}
+
+/**
+ * @brief Отложить размонтирование: повтор делает задача детектора
+ */
+static void um_sd_unmount_postpone(void)
+{
+    // Кто бы ни начал размонтирование, задача детектора повторит его
+    if (um_sd_cd_task_handle && xTaskGetCurrentTaskHandle() != um_sd_cd_task_handle)
+    {
+        xTaskNotifyGive(um_sd_cd_task_handle);
+    }
+}
+
+/**
+ * @brief Размонтирует SD карту
+ */
+esp_err_t um_sd_unmount(void)
+{
+    if (!um_sd_fs_mounted())
+    {
+        s_state = UM_SD_STATE_NO_CARD;
+        return ESP_OK;
+    }
+
+    // Новые um_sd_lock() с этого момента получают ESP_ERR_INVALID_STATE
+    s_state = UM_SD_STATE_UNMOUNTING;
+
+    // Дожидаемся, пока модули закончат текущие операции с файлами.
+    // Размонтировать под открытым файлом нельзя: FATFS освободит объекты,
+    // которыми ещё пользуется владелец блокировки
+    bool locked = s_sd_lock &&
+                  xSemaphoreTakeRecursive(s_sd_lock, pdMS_TO_TICKS(UNMOUNT_LOCK_TIMEOUT_MS)) == pdTRUE;
+    if (s_sd_lock && !locked)
+    {
+        ESP_LOGW(TAG, "SD card is still in use, unmount postponed");
+        um_sd_unmount_postpone();
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // То же для файлов, открытых под прошлыми захватами: новых не будет,
+    // владельцы закрывают их, получив отказ um_sd_lock()
+    int open_files = um_sd_open_files();
+    if (open_files > 0)
+    {
+        if (locked)
+        {
+            xSemaphoreGiveRecursive(s_sd_lock);
+        }
+        ESP_LOGW(TAG, "%d file(s) still open on SD card, unmount postponed", open_files);
+        um_sd_unmount_postpone();
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = um_sd_fs_unmount();
+    s_state = UM_SD_STATE_NO_CARD;
+
+    if (locked)
+    {
+        xSemaphoreGiveRecursive(s_sd_lock);
+    }
+
+    um_event_publish(UMNI_EVENT_SDCARD_UNMOUNTED, NULL, 0, portMAX_DELAY);
+    return ret;
+}
+
+um_sd_state_t um_sd_get_state(void)
+{
+    return s_state;
+}
+
+bool um_sd_is_mounted(void)
+{
+    return s_state == UM_SD_STATE_MOUNTED;
+}
+
+esp_err_t um_sd_lock(TickType_t timeout)
+{
+    if (!s_sd_lock)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xSemaphoreTakeRecursive(s_sd_lock, timeout) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (s_state != UM_SD_STATE_MOUNTED)
+    {
+        xSemaphoreGiveRecursive(s_sd_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+void um_sd_unlock(void)
+{
+    if (s_sd_lock)
+    {
+        xSemaphoreGiveRecursive(s_sd_lock);
+    }
+}
+
+void um_sd_file_opened(void)
+{
+    portENTER_CRITICAL(&s_files_mux);
+    s_open_files++;
+    portEXIT_CRITICAL(&s_files_mux);
+}
+
+void um_sd_file_closed(void)
+{
+    portENTER_CRITICAL(&s_files_mux);
+    if (s_open_files > 0)
+    {
+        s_open_files--;
+    }
+    portEXIT_CRITICAL(&s_files_mux);
+}
+
+#endif // UM_FEATURE_ENABLED(SDCARD)
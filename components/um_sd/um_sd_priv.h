@@ -0,0 +1,59 @@
+#pragma once
+
+// Внутренние объявления компонента um_sd (не для внешних модулей)
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "um_sd_cd.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** Задача детектора (NULL, пока не запущена); её будит ISR */
+    extern TaskHandle_t um_sd_cd_task_handle;
+
+    /**
+     * @brief Создать блокировку карты (один раз, до первого монтирования)
+     */
+    esp_err_t um_sd_cd_init(void);
+
+    /**
+     * @brief Запустить задачу детектора (повторный вызов ничего не делает)
+     */
+    esp_err_t um_sd_cd_start(void);
+
+    /**
+     * @brief Смонтировать карту и обновить состояние и счётчик попыток
+     */
+    void um_sd_try_mount(void);
+
+    /**
+     * @brief Установить состояние карты (um_sd_mount - перед UMNI_EVENT_SDCARD_MOUNTED)
+     */
+    void um_sd_set_state(um_sd_state_t state);
+
+    /* Железо: реализует um_sd.c, в хост-тестах - тест */
+
+    /**
+     * @brief Уровень вывода CD (0 - карта вставлена)
+     */
+    int um_sd_cd_level(void);
+
+    /**
+     * @brief Смонтирована ли файловая система
+     */
+    bool um_sd_fs_mounted(void);
+
+    /**
+     * @brief Размонтировать FATFS и освободить карту
+     *
+     * Вызывается под блокировкой карты, когда открытых файлов нет.
+     */
+    esp_err_t um_sd_fs_unmount(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,13 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_sdlog_rotate_on_sntp(void);
+void test_um_sdlog_benchmark(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_sdlog_rotate_on_sntp);
+    RUN_TEST(test_um_sdlog_benchmark);
+    exit(UNITY_END());
+}
@@ -0,0 +1,246 @@
+/*
+ * um_sdlog: смена файла при первой синхронизации часов и в полночь,
+ * бенчмарк записей в секунду против fopen/fprintf/fclose на запись.
+ * write() перехватывается (-Wl,--wrap): ни один не пересекает границу
+ * кластера, т.е. FAT не читает и не переписывает частичный кластер.
+ *
+ * Каталог бенчмарка - UM_SDLOG_BENCH_DIR (например, смонтированный образ
+ * FAT с кластером 16 KB), иначе временный каталог хоста.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "unity.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "um_sdlog.h"
+
+// 2024-05-01 12:00:00 UTC
+#define T_SYNCED 1714564800
+#define T_NEXT_DAY (T_SYNCED + 12 * 3600 + 1)
+
+#define BENCH_RECORDS 100000
+#define BASELINE_RECORDS 10000
+#define WAIT_MS 5000
+
+time_t __real_time(time_t *t);
+ssize_t __real_write(int fd, const void *buf, size_t len);
+
+static time_t s_now = -1;
+
+// -1: настоящие часы
+time_t __wrap_time(time_t *t)
+{
+    time_t now = s_now >= 0 ? s_now : __real_time(NULL);
+    if (t)
+    {
+        *t = now;
+    }
+    return now;
+}
+
+static uint32_t s_cluster;
+static uint32_t s_crossing;
+
+// write() файла лога не должен пересекать границу кластера
+ssize_t __wrap_write(int fd, const void *buf, size_t len)
+{
+    off_t off = fd > STDERR_FILENO ? lseek(fd, 0, SEEK_END) : -1;
+    if (s_cluster && off >= 0 && off % s_cluster + len > s_cluster)
+    {
+        s_crossing++;
+    }
+    return __real_write(fd, buf, len);
+}
+
+static char s_dir[64];
+
+static void new_dir(void)
+{
+    strcpy(s_dir, "/tmp/um_sdlog_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(s_dir));
+}
+
+static long file_size(const char *name)
+{
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", s_dir, name);
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+// Сдать буфер задаче записи и дождаться, пока он окажется в файле
+static void flush_and_wait(void)
+{
+    um_sdlog_stats_t st;
+    TEST_ASSERT_EQUAL(ESP_OK, um_sdlog_flush());
+    for (int ms = 0; ms < WAIT_MS; ms += 10)
+    {
+        um_sdlog_get_stats(&st);
+        if (st.written + st.lost_bytes == st.bytes)
+        {
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    TEST_FAIL_MESSAGE("writer task did not drain the buffers");
+}
+
+void test_um_sdlog_rotate_on_sntp(void)
+{
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    new_dir();
+
+    um_sdlog_config_t cfg = UM_SDLOG_DEFAULT_CONFIG();
+    cfg.dir = s_dir;
+    cfg.buffer_size = 512;
+    cfg.buffer_count = 4;
+
+    // До SNTP: файл без даты
+    s_now = 1000;
+    TEST_ASSERT_EQUAL(ESP_OK, um_sdlog_init(&cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, um_sdlog_printf("early\n"));
+    flush_and_wait();
+    TEST_ASSERT_EQUAL(6, file_size("00000000.LOG"));
+
+    // Первая синхронизация: файл дня, а не дописывание в 000000NN.LOG
+    s_now = T_SYNCED;
+    TEST_ASSERT_EQUAL(ESP_OK, um_sdlog_printf("synced\n"));
+    flush_and_wait();
+    TEST_ASSERT_EQUAL(6, file_size("00000000.LOG"));
+    TEST_ASSERT_EQUAL(7, file_size("24050100.LOG"));
+
+    // Полночь
+    s_now = T_NEXT_DAY;
+    TEST_ASSERT_EQUAL(ESP_OK, um_sdlog_printf("next\n"));
+    flush_and_wait();
+    TEST_ASSERT_EQUAL(7, file_size("24050100.LOG"));
+    TEST_ASSERT_EQUAL(5, file_size("24050200.LOG"));
+
+    um_sdlog_stats_t st;
+    um_sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL(3, st.files);
+    TEST_ASSERT_EQUAL(0, st.lost_bytes);
+    um_sdlog_deinit();
+    s_now = -1;
+}
+
+typedef struct
+{
+    long syscw;
+    long wchar;
+    int64_t us;
+} io_sample_t;
+
+// Вызовы write() и записанные байты процесса (Linux)
+static io_sample_t io_sample(void)
+{
+    io_sample_t s = {.us = esp_timer_get_time()};
+    FILE *f = fopen("/proc/self/io", "r");
+    TEST_ASSERT_NOT_NULL(f);
+    char line[64];
+    while (fgets(line, sizeof(line), f))
+    {
+        sscanf(line, "syscw: %ld", &s.syscw);
+        sscanf(line, "wchar: %ld", &s.wchar);
+    }
+    fclose(f);
+    return s;
+}
+
+static void report(const char *name, uint32_t records, io_sample_t a, io_sample_t b)
+{
+    long calls = b.syscw - a.syscw;
+    long bytes = b.wchar - a.wchar;
+    printf("%-22s %9.0f rec/s %8ld write() %8ld B/write\n", name,
+           records * 1e6 / (double)(b.us - a.us), calls, calls ? bytes / calls : 0);
+}
+
+void test_um_sdlog_benchmark(void)
+{
+    const char *bench_dir = getenv("UM_SDLOG_BENCH_DIR");
+    if (bench_dir)
+    {
+        snprintf(s_dir, sizeof(s_dir), "%s/log", bench_dir);
+    }
+    else
+    {
+        new_dir();
+    }
+    printf("um_sdlog benchmark in %s\n", s_dir);
+
+    // Как без um_sdlog: открыть, дописать строку, закрыть - на каждую запись
+    mkdir(s_dir, 0775);
+    char text_path[96];
+    snprintf(text_path, sizeof(text_path), "%s/BASELINE.TXT", s_dir);
+    io_sample_t a = io_sample();
+    for (uint32_t i = 0; i < BASELINE_RECORDS; i++)
+    {
+        FILE *f = fopen(text_path, "a");
+        TEST_ASSERT_NOT_NULL(f);
+        fprintf(f, "%lu;ot;1;1;0;%.1f;%.1f;%.1f;%.1f;%.2f;0\n", (unsigned long)(T_SYNCED + i),
+                (i % 100) * 1.0f, 55.5f, 41.25f, 48.0f, 1.72f);
+        fclose(f);
+    }
+    io_sample_t b = io_sample();
+    report("fopen/fprintf/fclose", BASELINE_RECORDS, a, b);
+    unlink(text_path);
+
+    // Настройки по умолчанию: 2 буфера по кластеру
+    um_sdlog_config_t cfg = UM_SDLOG_DEFAULT_CONFIG();
+    cfg.dir = s_dir;
+    TEST_ASSERT_EQUAL(ESP_OK, um_sdlog_init(&cfg));
+    s_cluster = cfg.buffer_size;
+    s_crossing = 0;
+
+    uint32_t retries = 0;
+    a = io_sample();
+    for (uint32_t i = 0; i < BENCH_RECORDS; i++)
+    {
+        // Буферы заняты - ждём задачу записи, как ждал бы опрос OpenTherm
+        while (um_sdlog_printf("%lu;ot;1;1;0;%.1f;%.1f;%.1f;%.1f;%.2f;0\n", (unsigned long)(T_SYNCED + i),
+                               (i % 100) * 1.0f, 55.5f, 41.25f, 48.0f, 1.72f) == ESP_ERR_NO_MEM)
+        {
+            retries++;
+            vTaskDelay(1);
+        }
+    }
+    flush_and_wait();
+    b = io_sample();
+    report("um_sdlog", BENCH_RECORDS, a, b);
+
+    um_sdlog_stats_t st;
+    um_sdlog_get_stats(&st);
+    printf("um_sdlog: %llu B in %lu write(), %lu files, max write %lu us, %lu waits for a buffer\n",
+           (unsigned long long)st.written, (unsigned long)st.writes, (unsigned long)st.files,
+           (unsigned long)st.max_write_us, (unsigned long)retries);
+    TEST_ASSERT_EQUAL(BENCH_RECORDS, st.records);
+    TEST_ASSERT_EQUAL(st.bytes, st.written);
+    TEST_ASSERT_EQUAL(0, st.write_errors);
+    // Целые буферы; неполные - последний буфер файла и сброс по таймеру
+    TEST_ASSERT_LESS_OR_EQUAL(st.written / cfg.buffer_size + 2 * st.files, st.writes);
+    TEST_ASSERT_EQUAL(0, s_crossing);
+    um_sdlog_deinit();
+    s_cluster = 0;
+
+    // Следующий запуск на том же образе начинает с пустого каталога
+    DIR *dir = opendir(s_dir);
+    TEST_ASSERT_NOT_NULL(dir);
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL)
+    {
+        if (strstr(e->d_name, ".LOG"))
+        {
+            char path[96 + 16];
+            snprintf(path, sizeof(path), "%s/%s", s_dir, e->d_name);
+            unlink(path);
+        }
+    }
+    closedir(dir);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file um_sdlog.h
+ * @brief Buffered SD card data logger with a dedicated writer task
+ * @version 1.0.0
+ *
+ * Записи копируются в один из N буферов размером с кластер FAT
+ * (allocation_unit_size = 16 KB). Заполненный буфер уходит задаче записи,
+ * которая пишет его одним write(), поэтому карта получает крупные
+ * выровненные блоки, а вызывающий код не ждёт SPI.
+ */
+
+#ifndef UM_SDLOG_H
+#define UM_SDLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default buffer size: one FAT cluster as configured in um_sd_mount() */
+#define UM_SDLOG_CLUSTER_SIZE (16 * 1024)
+
+/** Longest line produced by um_sdlog_printf() */
+#define UM_SDLOG_LINE_MAX 256
+
+/**
+ * @brief Logger configuration
+ */
+typedef struct {
+    const char* dir;            /**< Log directory, e.g. "/sdcard/log" */
+    uint8_t buffer_count;       /**< Number of buffers (>= 2) */
+    uint32_t buffer_size;       /**< Buffer size, multiple of 512 */
+    uint32_t max_file_size;     /**< Start a new file after this many bytes */
+    bool rotate_daily;          /**< Start a new file at local midnight */
+    uint32_t flush_interval_ms; /**< Write partially filled buffer at least this often */
+} um_sdlog_config_t;
+
+#define UM_SDLOG_DEFAULT_CONFIG() {          \
+    .dir = "/sdcard/log",                    \
+    .buffer_count = 2,                       \
+    .buffer_size = UM_SDLOG_CLUSTER_SIZE,    \
+    .max_file_size = 4 * 1024 * 1024,        \
+    .rotate_daily = true,                    \
+    .flush_interval_ms = 5000,               \
+}
+
+/**
+ * @brief Logger statistics
+ */
+typedef struct {
+    uint32_t records;        /**< Records accepted */
+    uint32_t dropped;        /**< Records dropped: no free buffer (backpressure) */
+    uint64_t bytes;          /**< Bytes accepted */
+    uint64_t dropped_bytes;  /**< Bytes of dropped records */
+    uint64_t lost_bytes;     /**< Buffered bytes discarded: card out or write error */
+    uint64_t written;        /**< Bytes written to the card */
+    uint32_t writes;         /**< write() calls */
+    uint32_t write_errors;   /**< Failed write()/open() */
+    uint32_t files;          /**< Files opened */
+    uint32_t max_write_us;   /**< Slowest write() */
+    uint8_t buffers_free;    /**< Free buffers right now */
+    bool paused;             /**< Card removed, logging paused */
+} um_sdlog_stats_t;
+
+/**
+ * @brief Allocate buffers and start the writer task
+ *
+ * @param config Configuration (NULL for defaults)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM
+ */
+esp_err_t um_sdlog_init(const um_sdlog_config_t* config);
+
+/**
+ * @brief Write buffered data, close the file and free buffers
+ */
+void um_sdlog_deinit(void);
+
+/**
+ * @brief Append raw bytes
+ *
+ * Never touches the card. If no buffer is free the whole record is dropped.
+ *
+ * @param data Record
+ * @param len Record length (<= buffer_size)
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM if dropped, ESP_ERR_INVALID_STATE
+ */
+esp_err_t um_sdlog_write(const void* data, size_t len);
+
+/**
+ * @brief Append formatted text (caller adds '\n')
+ *
+ * @return esp_err_t See um_sdlog_write()
+ */
+esp_err_t um_sdlog_printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief Hand the partially filled buffer to the writer now
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE
+ */
+esp_err_t um_sdlog_flush(void);
+
+/**
+ * @brief Get statistics
+ *
+ * @param[out] stats Statistics
+ */
+void um_sdlog_get_stats(um_sdlog_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UM_SDLOG_H
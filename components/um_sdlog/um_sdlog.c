@@ -0,0 +1,681 @@
+/**
+ * @file um_sdlog.c
+ * @brief Buffered SD card data logger with a dedicated writer task
+ * @version 1.0.0
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "base_config.h"
+#include "um_sdlog.h"
+
+#if UM_FEATURE_ENABLED(SDCARD)
+#include "um_sd.h"
+#include "um_events.h"
+#endif
+
+static const char *TAG = "sdlog";
+
+#define SDLOG_PATH_MAX 48
+#define SDLOG_SECTOR_SIZE 512
+#define SDLOG_MAX_SEQ 99
+#define SDLOG_CARD_LOCK_MS 1000
+// Время до 2020 года считаем не синхронизированным
+#define SDLOG_TIME_VALID 1577836800
+
+#define SDLOG_TASK_STACK 3072
+#define SDLOG_TASK_PRIORITY 3
+
+// Служебные блоки в очереди записи
+#define BLOCK_CLOSE -1
+#define BLOCK_STOP -2
+
+typedef struct
+{
+    int16_t index; // номер буфера или BLOCK_*
+    bool rotate;   // начать новый файл перед записью
+    uint32_t len;
+} block_t;
+
+static struct
+{
+    um_sdlog_config_t cfg;
+    char dir[32];
+    uint8_t **buffers;
+    QueueHandle_t free_q; // uint8_t - номера свободных буферов
+    QueueHandle_t full_q; // block_t - буферы к записи
+    SemaphoreHandle_t lock;    // сторона записи в буферы
+    SemaphoreHandle_t io_lock; // файловый дескриптор
+    SemaphoreHandle_t stopped;
+    TaskHandle_t task;
+    bool running;
+
+    // Заполняемый буфер (под lock)
+    int16_t fill;
+    uint32_t used;
+    uint32_t capacity;  // меньше buffer_size, если надо выровнять смещение в файле
+    bool whole_records; // последний буфер файла: записи не разрываются
+    uint32_t file_pos;  // байт, отданных в текущий файл
+    bool rotate_next;
+    time_t day_end;
+
+    // Задача записи (под io_lock)
+    int fd;
+    char file_date[8];
+    uint8_t file_seq;
+    volatile bool file_undated; // открыт 000000NN.LOG, часы ещё не установлены
+    volatile bool paused;
+
+    um_sdlog_stats_t stats;
+} s = {.fd = -1, .fill = -1};
+
+/* ---------- Сторона записи в буферы (под s.lock) ---------- */
+
+static void start_buffer(void)
+{
+    // Выравниваем следующий write() на границу буфера в файле
+    s.used = 0;
+    s.capacity = s.cfg.buffer_size - (s.file_pos % s.cfg.buffer_size);
+    s.whole_records = s.file_pos + s.capacity >= s.cfg.max_file_size;
+}
+
+static bool take_buffer(void)
+{
+    uint8_t idx;
+    if (xQueueReceive(s.free_q, &idx, 0) != pdTRUE)
+    {
+        return false;
+    }
+    s.fill = idx;
+    start_buffer();
+    return true;
+}
+
+static void hand_off(void)
+{
+    if (s.fill < 0 || s.used == 0)
+    {
+        return;
+    }
+
+    block_t b = {.index = s.fill, .rotate = s.rotate_next, .len = s.used};
+    s.rotate_next = false;
+    s.file_pos += s.used;
+    if (s.file_pos >= s.cfg.max_file_size)
+    {
+        s.rotate_next = true;
+        s.file_pos = 0;
+    }
+    s.fill = -1;
+
+    // Места в очереди хватает всегда: буферов меньше, чем её длина
+    xQueueSend(s.full_q, &b, 0);
+}
+
+static void end_file(void)
+{
+    hand_off();
+    s.rotate_next = true;
+    s.file_pos = 0;
+    if (s.fill >= 0)
+    {
+        start_buffer();
+    }
+}
+
+static void check_day(void)
+{
+    if (!s.cfg.rotate_daily)
+    {
+        return;
+    }
+
+    time_t now = time(NULL);
+    if (now < SDLOG_TIME_VALID || now < s.day_end)
+    {
+        return;
+    }
+
+    // Полночь или первая синхронизация SNTP при открытом 000000NN.LOG
+    if (s.day_end != 0 || s.file_undated)
+    {
+        end_file();
+    }
+
+    struct tm tm;
+    localtime_r(&now, &tm);
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_mday++;
+    s.day_end = mktime(&tm);
+}
+
+/**
+ * @brief Поместится ли запись целиком в текущий и свободные буферы
+ */
+static bool has_room(size_t len)
+{
+    UBaseType_t free_bufs = uxQueueMessagesWaiting(s.free_q);
+    size_t room;
+
+    if (s.fill >= 0)
+    {
+        room = s.capacity - s.used;
+        if (s.whole_records && len > room)
+        {
+            // Запись уйдёт целиком в новый файл
+            room = (s.used == 0) ? s.cfg.buffer_size : 0;
+        }
+    }
+    else
+    {
+        if (free_bufs == 0)
+        {
+            return false;
+        }
+        free_bufs--;
+        room = s.cfg.buffer_size - (s.file_pos % s.cfg.buffer_size);
+        if (s.file_pos + room >= s.cfg.max_file_size && len > room)
+        {
+            room = s.cfg.buffer_size;
+        }
+    }
+
+    return room + (size_t)free_bufs * s.cfg.buffer_size >= len;
+}
+
+/* ---------- Задача записи ---------- */
+
+static bool card_lock(void)
+{
+#if UM_FEATURE_ENABLED(SDCARD)
+    return um_sd_lock(pdMS_TO_TICKS(SDLOG_CARD_LOCK_MS)) == ESP_OK;
+#else
+    return true;
+#endif
+}
+
+static void card_unlock(void)
+{
+#if UM_FEATURE_ENABLED(SDCARD)
+    um_sd_unlock();
+#endif
+}
+
+static bool card_mounted(void)
+{
+#if UM_FEATURE_ENABLED(SDCARD)
+    return um_sd_is_mounted();
+#else
+    return true;
+#endif
+}
+
+static void close_file(void)
+{
+    if (s.fd >= 0)
+    {
+        close(s.fd);
+        s.fd = -1;
+#if UM_FEATURE_ENABLED(SDCARD)
+        um_sd_file_closed();
+#endif
+    }
+}
+
+/**
+ * @brief Закрыть файл вне записи (запись в процессе держит io_lock)
+ */
+static void close_file_locked(void)
+{
+    xSemaphoreTake(s.io_lock, portMAX_DELAY);
+    close_file();
+    xSemaphoreGive(s.io_lock);
+}
+
+static void open_file(void)
+{
+    char date[8];
+    time_t now = time(NULL);
+    if (now >= SDLOG_TIME_VALID)
+    {
+        struct tm tm;
+        localtime_r(&now, &tm);
+        strftime(date, sizeof(date), "%y%m%d", &tm);
+    }
+    else
+    {
+        strcpy(date, "000000");
+    }
+
+    mkdir(s.dir, 0775);
+
+    // Длинные имена включены (CONFIG_FATFS_LFN_HEAP), но имя 8.3 YYMMDDNN.LOG
+    // занимает одну запись каталога и читается любой реализацией FAT.
+    // После NN = 99 дописываем в последний файл дня
+    uint8_t seq = 0;
+    if (strcmp(date, s.file_date) == 0)
+    {
+        seq = s.file_seq < SDLOG_MAX_SEQ ? s.file_seq + 1 : SDLOG_MAX_SEQ;
+    }
+    char path[SDLOG_PATH_MAX];
+    struct stat st;
+    for (;; seq++)
+    {
+        snprintf(path, sizeof(path), "%s/%s%02u.LOG", s.dir, date, seq);
+        if (seq >= SDLOG_MAX_SEQ || stat(path, &st) != 0)
+        {
+            break;
+        }
+    }
+
+    s.fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0664);
+    if (s.fd < 0)
+    {
+        ESP_LOGE(TAG, "Failed to open %s: %d", path, errno);
+        s.stats.write_errors++;
+        return;
+    }
+#if UM_FEATURE_ENABLED(SDCARD)
+    // Файл открыт между захватами карты: um_sd_unmount() дождётся close_file()
+    um_sd_file_opened();
+#endif
+
+    strcpy(s.file_date, date);
+    s.file_seq = seq;
+    s.file_undated = (now < SDLOG_TIME_VALID);
+    s.stats.files++;
+    ESP_LOGI(TAG, "Logging to %s", path);
+}
+
+static void write_block(const block_t *b)
+{
+    if (s.paused || !card_lock())
+    {
+        s.stats.lost_bytes += b->len;
+        // Карту размонтируют: держать файл открытым нельзя
+        close_file_locked();
+        return;
+    }
+
+    xSemaphoreTake(s.io_lock, portMAX_DELAY);
+
+    if (b->rotate)
+    {
+        close_file();
+    }
+    if (s.fd < 0)
+    {
+        open_file();
+    }
+
+    if (s.fd >= 0)
+    {
+        int64_t start = esp_timer_get_time();
+        ssize_t n = write(s.fd, s.buffers[b->index], b->len);
+        uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+        if (n == (ssize_t)b->len)
+        {
+            s.stats.written += b->len;
+            s.stats.writes++;
+            if (elapsed > s.stats.max_write_us)
+            {
+                s.stats.max_write_us = elapsed;
+            }
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Write failed: %d", errno);
+            s.stats.write_errors++;
+            s.stats.lost_bytes += b->len;
+            close_file();
+        }
+    }
+    else
+    {
+        s.stats.lost_bytes += b->len;
+    }
+
+    xSemaphoreGive(s.io_lock);
+    card_unlock();
+}
+
+static void sync_file(void)
+{
+    if (s.paused || !card_lock())
+    {
+        return;
+    }
+    xSemaphoreTake(s.io_lock, portMAX_DELAY);
+    if (s.fd >= 0)
+    {
+        fsync(s.fd);
+    }
+    xSemaphoreGive(s.io_lock);
+    card_unlock();
+}
+
+static void um_sdlog_task(void *arg)
+{
+    block_t b;
+
+    while (1)
+    {
+        if (xQueueReceive(s.full_q, &b, pdMS_TO_TICKS(s.cfg.flush_interval_ms)) != pdTRUE)
+        {
+            // Давно не было полных буферов - сбрасываем частично заполненный
+            um_sdlog_flush();
+            // Без записей файл закрывается здесь, иначе размонтирование ждёт его
+            if (!card_mounted())
+            {
+                close_file_locked();
+            }
+            continue;
+        }
+
+        if (b.index == BLOCK_STOP)
+        {
+            break;
+        }
+        if (b.index == BLOCK_CLOSE)
+        {
+            close_file_locked();
+            continue;
+        }
+
+        write_block(&b);
+        uint8_t idx = b.index;
+        xQueueSend(s.free_q, &idx, 0);
+
+        // Очередь пуста - фиксируем размер файла в FAT
+        if (uxQueueMessagesWaiting(s.full_q) == 0)
+        {
+            sync_file();
+        }
+    }
+
+    close_file_locked();
+
+    xSemaphoreGive(s.stopped);
+    vTaskDelete(NULL);
+}
+
+#if UM_FEATURE_ENABLED(SDCARD)
+/**
+ * @brief Пауза при извлечении карты, продолжение после монтирования
+ */
+static void um_sdlog_sd_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id == UMNI_EVENT_SDCARD_MOUNTED)
+    {
+        ESP_LOGI(TAG, "SD card mounted, logging resumed");
+        s.paused = false;
+        return;
+    }
+
+    if (!s.paused)
+    {
+        ESP_LOGW(TAG, "SD card removed, logging paused");
+        s.paused = true;
+    }
+
+    // Закрываем файл до размонтирования
+    close_file_locked();
+}
+#endif
+
+/* ---------- API ---------- */
+
+esp_err_t um_sdlog_init(const um_sdlog_config_t *config)
+{
+    if (s.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    um_sdlog_config_t cfg = UM_SDLOG_DEFAULT_CONFIG();
+    if (config)
+    {
+        cfg = *config;
+    }
+
+    if (!cfg.dir || strlen(cfg.dir) >= sizeof(s.dir) || cfg.buffer_count < 2 ||
+        cfg.buffer_size == 0 || cfg.buffer_size % SDLOG_SECTOR_SIZE != 0 ||
+        cfg.flush_interval_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Граница файла всегда совпадает с границей буфера
+    if (cfg.max_file_size < cfg.buffer_size)
+    {
+        cfg.max_file_size = cfg.buffer_size;
+    }
+    cfg.max_file_size -= cfg.max_file_size % cfg.buffer_size;
+
+    memset(&s, 0, sizeof(s));
+    s.fd = -1;
+    s.fill = -1;
+    s.cfg = cfg;
+    strcpy(s.dir, cfg.dir);
+    s.cfg.dir = s.dir;
+
+    s.buffers = calloc(cfg.buffer_count, sizeof(uint8_t *));
+    s.free_q = xQueueCreate(cfg.buffer_count, sizeof(uint8_t));
+    s.full_q = xQueueCreate(cfg.buffer_count + 2, sizeof(block_t));
+    s.lock = xSemaphoreCreateMutex();
+    s.io_lock = xSemaphoreCreateMutex();
+    s.stopped = xSemaphoreCreateBinary();
+    if (!s.buffers || !s.free_q || !s.full_q || !s.lock || !s.io_lock || !s.stopped)
+    {
+        goto no_mem;
+    }
+
+    for (uint8_t i = 0; i < cfg.buffer_count; i++)
+    {
+        // DMA-память: SDSPI пишет из неё без промежуточного копирования
+        s.buffers[i] = heap_caps_malloc(cfg.buffer_size, MALLOC_CAP_DMA);
+        if (!s.buffers[i])
+        {
+            goto no_mem;
+        }
+        xQueueSend(s.free_q, &i, 0);
+    }
+
+    s.running = true;
+    if (xTaskCreate(um_sdlog_task, "sdlog", SDLOG_TASK_STACK, NULL, SDLOG_TASK_PRIORITY, &s.task) != pdPASS)
+    {
+        s.running = false;
+        goto no_mem;
+    }
+
+#if UM_FEATURE_ENABLED(SDCARD)
+    s.paused = !um_sd_is_mounted();
+    um_event_subscribe(UMNI_EVENT_SDCARD_PUSH_OUT, um_sdlog_sd_event_handler, NULL);
+    um_event_subscribe(UMNI_EVENT_SDCARD_UNMOUNTED, um_sdlog_sd_event_handler, NULL);
+    um_event_subscribe(UMNI_EVENT_SDCARD_MOUNTED, um_sdlog_sd_event_handler, NULL);
+#endif
+
+    ESP_LOGI(TAG, "Initialized: %s, %u x %lu bytes", s.dir, cfg.buffer_count,
+             (unsigned long)cfg.buffer_size);
+    return ESP_OK;
+
+no_mem:
+    ESP_LOGE(TAG, "Not enough memory for %u x %lu bytes", cfg.buffer_count,
+             (unsigned long)cfg.buffer_size);
+    um_sdlog_deinit();
+    return ESP_ERR_NO_MEM;
+}
+
+void um_sdlog_deinit(void)
+{
+    if (s.running)
+    {
+#if UM_FEATURE_ENABLED(SDCARD)
+        um_event_unsubscribe(UMNI_EVENT_SDCARD_PUSH_OUT, um_sdlog_sd_event_handler);
+        um_event_unsubscribe(UMNI_EVENT_SDCARD_UNMOUNTED, um_sdlog_sd_event_handler);
+        um_event_unsubscribe(UMNI_EVENT_SDCARD_MOUNTED, um_sdlog_sd_event_handler);
+#endif
+        xSemaphoreTake(s.lock, portMAX_DELAY);
+        hand_off();
+        s.running = false;
+        xSemaphoreGive(s.lock);
+
+        block_t stop = {.index = BLOCK_STOP};
+        xQueueSend(s.full_q, &stop, portMAX_DELAY);
+        xSemaphoreTake(s.stopped, portMAX_DELAY);
+    }
+
+    if (s.buffers)
+    {
+        for (uint8_t i = 0; i < s.cfg.buffer_count; i++)
+        {
+            heap_caps_free(s.buffers[i]);
+        }
+        free(s.buffers);
+    }
+    if (s.free_q)
+        vQueueDelete(s.free_q);
+    if (s.full_q)
+        vQueueDelete(s.full_q);
+    if (s.lock)
+        vSemaphoreDelete(s.lock);
+    if (s.io_lock)
+        vSemaphoreDelete(s.io_lock);
+    if (s.stopped)
+        vSemaphoreDelete(s.stopped);
+
+    memset(&s, 0, sizeof(s));
+    s.fd = -1;
+    s.fill = -1;
+}
+
+esp_err_t um_sdlog_write(const void *data, size_t len)
+{
+    if (!data || len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > s.cfg.buffer_size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint8_t *src = data;
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+
+    check_day();
+
+    if (!has_room(len))
+    {
+        s.stats.dropped++;
+        s.stats.dropped_bytes += len;
+        xSemaphoreGive(s.lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    s.stats.records++;
+    s.stats.bytes += len;
+
+    while (len > 0)
+    {
+        if (s.fill < 0 && !take_buffer())
+        {
+            // has_room() это исключает
+            break;
+        }
+
+        size_t room = s.capacity - s.used;
+        if (s.whole_records && len > room)
+        {
+            end_file();
+            continue;
+        }
+
+        size_t n = len < room ? len : room;
+        memcpy(s.buffers[s.fill] + s.used, src, n);
+        s.used += n;
+        src += n;
+        len -= n;
+
+        if (s.used == s.capacity)
+        {
+            hand_off();
+        }
+    }
+
+    xSemaphoreGive(s.lock);
+    return ESP_OK;
+}
+
+esp_err_t um_sdlog_printf(const char *fmt, ...)
+{
+    char line[UM_SDLOG_LINE_MAX];
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (len < 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len >= (int)sizeof(line))
+    {
+        len = sizeof(line) - 1;
+    }
+    return um_sdlog_write(line, len);
+}
+
+esp_err_t um_sdlog_flush(void)
+{
+    if (!s.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+    check_day();
+    hand_off();
+    xSemaphoreGive(s.lock);
+    return ESP_OK;
+}
+
+void um_sdlog_get_stats(um_sdlog_stats_t *stats)
+{
+    if (!stats)
+    {
+        return;
+    }
+    if (!s.running)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+    xSemaphoreTake(s.io_lock, portMAX_DELAY);
+    *stats = s.stats;
+    stats->buffers_free = uxQueueMessagesWaiting(s.free_q);
+    stats->paused = s.paused;
+    xSemaphoreGive(s.io_lock);
+    xSemaphoreGive(s.lock);
+}
@@ -0,0 +1,25 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_storage_truncated_tmp_not_promoted(void);
+void test_um_storage_commit_marker_promoted(void);
+void test_um_storage_path_too_long(void);
+void test_um_storage_user_side_files_kept(void);
+void test_um_storage_cut_at_offset(void);
+void test_um_storage_kill_at_random_time(void);
+void test_um_json_stream_grammar(void);
+void test_um_json_stream_heap(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_storage_truncated_tmp_not_promoted);
+    RUN_TEST(test_um_storage_commit_marker_promoted);
+    RUN_TEST(test_um_storage_path_too_long);
+    RUN_TEST(test_um_storage_user_side_files_kept);
+    RUN_TEST(test_um_storage_cut_at_offset);
+    RUN_TEST(test_um_storage_kill_at_random_time);
+    RUN_TEST(test_um_json_stream_grammar);
+    RUN_TEST(test_um_json_stream_heap);
+    exit(UNITY_END());
+}
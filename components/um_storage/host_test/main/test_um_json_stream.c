@@ -0,0 +1,180 @@
+/*
+ * um_json_stream: грамматика (на всех размерах кусков) и пиковая куча
+ * по сравнению с um_storage_read_json_string() + cJSON_Parse().
+ *
+ * Куча считается обёртками malloc/free (-Wl,--wrap, см. CMakeLists.txt):
+ * учитываются выделения кода приложения, внутренние выделения libc
+ * (буфер FILE) - нет.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "unity.h"
+#include "cJSON.h"
+#include "um_storage.h"
+#include "um_json_stream.h"
+
+#define HEAP_SENSORS 16
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static long s_heap_live;
+static long s_heap_peak;
+
+static void heap_track(long delta)
+{
+    long live = __atomic_add_fetch(&s_heap_live, delta, __ATOMIC_RELAXED);
+    long peak = __atomic_load_n(&s_heap_peak, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&s_heap_peak, &peak, live, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void* __wrap_malloc(size_t size)
+{
+    void* p = __real_malloc(size);
+    if (p) heap_track(malloc_usable_size(p));
+    return p;
+}
+
+void* __wrap_calloc(size_t n, size_t size)
+{
+    void* p = __real_calloc(n, size);
+    if (p) heap_track(malloc_usable_size(p));
+    return p;
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    long old = ptr ? (long)malloc_usable_size(ptr) : 0;
+    void* p = __real_realloc(ptr, size);
+    if (p) heap_track((long)malloc_usable_size(p) - old);
+    return p;
+}
+
+void __wrap_free(void* ptr)
+{
+    if (ptr) heap_track(-(long)malloc_usable_size(ptr));
+    __real_free(ptr);
+}
+
+static void heap_peak_reset(void)
+{
+    __atomic_store_n(&s_heap_peak, __atomic_load_n(&s_heap_live, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+static long heap_peak_since(long base)
+{
+    return __atomic_load_n(&s_heap_peak, __ATOMIC_RELAXED) - base;
+}
+
+static esp_err_t count_token(void* ctx, um_json_token_t token, const char* value, int depth)
+{
+    (*(int*)ctx)++;
+    return ESP_OK;
+}
+
+// Разбор документа кусками chunk; ESP_OK только для корректного JSON
+static esp_err_t parse_chunked(const char* json, size_t chunk)
+{
+    int tokens = 0;
+    um_json_stream_t parser;
+    um_json_stream_init(&parser, count_token, &tokens);
+
+    size_t len = strlen(json);
+    for (size_t off = 0; off < len; off += chunk) {
+        size_t n = len - off < chunk ? len - off : chunk;
+        esp_err_t err = um_json_stream_feed(&parser, json + off, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return um_json_stream_finish(&parser);
+}
+
+static void check_all_chunks(const char* json, bool valid)
+{
+    size_t len = strlen(json);
+    for (size_t chunk = 1; chunk <= len; chunk++) {
+        esp_err_t err = parse_chunked(json, chunk);
+        if ((err == ESP_OK) != valid) {
+            printf("'%s' chunk %u: %s\n", json, (unsigned)chunk, esp_err_to_name(err));
+            TEST_FAIL_MESSAGE(valid ? "valid JSON rejected" : "invalid JSON accepted");
+        }
+    }
+}
+
+void test_um_json_stream_grammar(void)
+{
+    static const char* const valid[] = {
+        "{}", "[]", " { } ", "\"s\"", "0", "-0.5e+3", "1E5", "true", "null",
+        "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"x\"}}",
+        "[1,[2,[]],{},\"\\u0416\"]",
+        "\n{ \"a\" : -12.25 ,\t\"b\" : [ 1 , 2 ] }\n",
+    };
+    static const char* const invalid[] = {
+        "", "{", "[1", "{\"a\" 1}", "{\"a\":1 \"b\":2}", "[1 2]", "{,}", "[,1]",
+        "[1,]", "{\"a\":1,}", "{\"a\"}", "{\"a\":}", "{1:2}", "{\"a\"::1}",
+        "[1,,2]", "[1]]", "{} {}", "\"a\" \"b\"", "1 2", ":", ",", "[:]",
+        "01", "-", "1.", "1.e5", "1e", "1e+", "--1", "1-2", "+1", ".5",
+        "tru", "truex", "[true1]", "{\"a\":1}}", "[\"a\":1]",
+    };
+
+    for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+        check_all_chunks(valid[i], true);
+    }
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        check_all_chunks(invalid[i], false);
+    }
+}
+
+void test_um_json_stream_heap(void)
+{
+    // onewire.json на 16 датчиков, как его пишет um_onewire_config_save()
+    char json[2048];
+    int n = snprintf(json, sizeof(json), "{\"sensors\":[");
+    for (int i = 0; i < HEAP_SENSORS; i++) {
+        n += snprintf(json + n, sizeof(json) - n,
+                      "%s{\"sn\":\"28FF%012X\",\"label\":\"Sensor %d\",\"location\":\"Room %d\","
+                      "\"active\":true,\"calibration\":-0.25}",
+                      i ? "," : "", 0x641E8C00 + i, i + 1, i + 1);
+    }
+    n += snprintf(json + n, sizeof(json) - n, "]}");
+    TEST_ASSERT_LESS_THAN(sizeof(json), n);
+
+    char path[] = "/tmp/um_json_stream_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(path, json));
+
+    // Потоковый разбор
+    int tokens = 0;
+    long base = __atomic_load_n(&s_heap_live, __ATOMIC_RELAXED);
+    heap_peak_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, um_json_stream_parse_file(path, count_token, &tokens));
+    long stream_peak = heap_peak_since(base);
+
+    // Как было: файл целиком + дерево cJSON
+    base = __atomic_load_n(&s_heap_live, __ATOMIC_RELAXED);
+    heap_peak_reset();
+    char* text = um_storage_read_json_string(path);
+    TEST_ASSERT_NOT_NULL(text);
+    cJSON* root = cJSON_Parse(text);
+    TEST_ASSERT_NOT_NULL(root);
+    free(text);
+    cJSON_Delete(root);
+    long tree_peak = heap_peak_since(base);
+
+    printf("onewire.json %d bytes, %d tokens: stream peak heap %ld B, "
+           "read_json_string + cJSON_Parse peak heap %ld B\n",
+           n, tokens, stream_peak, tree_peak);
+    TEST_ASSERT_EQUAL(0, stream_peak);
+    TEST_ASSERT_GREATER_THAN(n, tree_peak);
+
+    unlink(path);
+}
@@ -0,0 +1,272 @@
+/*
+ * Имитация сброса во время атомарной записи.
+ *
+ * Дочерний процесс пишет файл и убивается SIGKILL - на случайном смещении
+ * данных или в случайный момент. Затем родитель "перезагружается"
+ * (um_storage_recover_dir) и проверяет, что файл содержит целиком старое
+ * или целиком новое содержимое. Состояния между шагами подмены
+ * (.um~tmp, .um~new, без оригинала) дополнительно собираются вручную.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "um_storage.h"
+
+#define CUT_RUNS 200
+#define KILL_RUNS 200
+#define CONTENT_A_LEN 3000
+#define CONTENT_B_LEN 5000
+#define CHUNK 97
+
+static char s_dir[32];
+static char s_path[UM_STORAGE_PATH_MAX];
+static char* s_content_a;
+static char* s_content_b;
+
+static char* make_content(char fill, size_t len)
+{
+    char* json = malloc(len + 1);
+    TEST_ASSERT_NOT_NULL(json);
+    int n = snprintf(json, len + 1, "{\"gen\":\"%c\",\"pad\":\"", fill);
+    memset(json + n, fill, len - n - 2);
+    strcpy(json + len - 2, "\"}");
+    return json;
+}
+
+static void setup_dir(void)
+{
+    if (s_dir[0] == '\0') {
+        strcpy(s_dir, "/tmp/um_storage_XXXXXX");
+        TEST_ASSERT_NOT_NULL(mkdtemp(s_dir));
+        snprintf(s_path, sizeof(s_path), "%s/cfg.json", s_dir);
+        s_content_a = make_content('A', CONTENT_A_LEN);
+        s_content_b = make_content('B', CONTENT_B_LEN);
+    }
+    char side[UM_STORAGE_PATH_MAX + 8];
+    unlink(s_path);
+    snprintf(side, sizeof(side), "%s" UM_STORAGE_TMP_SUFFIX, s_path);
+    unlink(side);
+    snprintf(side, sizeof(side), "%s" UM_STORAGE_NEW_SUFFIX, s_path);
+    unlink(side);
+}
+
+static bool side_exists(const char* suffix)
+{
+    char side[UM_STORAGE_PATH_MAX + 8];
+    snprintf(side, sizeof(side), "%s%s", s_path, suffix);
+    struct stat st;
+    return stat(side, &st) == 0;
+}
+
+static void write_raw(const char* suffix, const char* data, size_t len)
+{
+    char side[UM_STORAGE_PATH_MAX + 8];
+    snprintf(side, sizeof(side), "%s%s", s_path, suffix);
+    FILE* f = fopen(side, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, f));
+    fclose(f);
+}
+
+// Содержимое после "перезагрузки": 'A', 'B', 0 - файла нет, '?' - мусор
+static char boot_and_read(void)
+{
+    um_storage_recover_dir(s_dir);
+    TEST_ASSERT_FALSE(side_exists(UM_STORAGE_TMP_SUFFIX));
+    TEST_ASSERT_FALSE(side_exists(UM_STORAGE_NEW_SUFFIX));
+
+    if (!um_storage_file_exists(s_path)) {
+        return 0;
+    }
+    char* json = um_storage_read_json_string(s_path);
+    char gen = '?';
+    if (json != NULL && strcmp(json, s_content_a) == 0) {
+        gen = 'A';
+    } else if (json != NULL && strcmp(json, s_content_b) == 0) {
+        gen = 'B';
+    }
+    free(json);
+    return gen;
+}
+
+// Запись из кода прошивки: .um~tmp с трейлером CRC
+static void write_tmp_like_writer(const char* content, size_t cut)
+{
+    um_storage_writer_t writer;
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_writer_open(s_path, UM_STORAGE_FLAG_CRC, &writer));
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_writer_write(&writer, content, cut));
+    fclose(writer.file);   // "сброс": ни commit, ни abort
+}
+
+void test_um_storage_truncated_tmp_not_promoted(void)
+{
+    setup_dir();
+
+    // Сброс во время самой первой записи: оригинала нет, .um~tmp обрезан
+    write_tmp_like_writer(s_content_a, CONTENT_A_LEN / 2);
+    TEST_ASSERT_FALSE(um_storage_file_exists(s_path));
+    TEST_ASSERT_NULL(um_storage_read_json_string(s_path));
+    TEST_ASSERT_TRUE(side_exists(UM_STORAGE_TMP_SUFFIX));
+    TEST_ASSERT_EQUAL(0, boot_and_read());
+
+    // То же при существующем оригинале
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(s_path, s_content_a));
+    write_tmp_like_writer(s_content_b, CONTENT_B_LEN - 1);
+    TEST_ASSERT_EQUAL('A', boot_and_read());
+}
+
+void test_um_storage_commit_marker_promoted(void)
+{
+    setup_dir();
+
+    // Сброс между unlink() оригинала и последним rename(): только .um~new
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(s_path, s_content_b));
+    char side[UM_STORAGE_PATH_MAX + 8];
+    snprintf(side, sizeof(side), "%s" UM_STORAGE_NEW_SUFFIX, s_path);
+    TEST_ASSERT_EQUAL(0, rename(s_path, side));
+    TEST_ASSERT_TRUE(um_storage_file_exists(s_path));   // чтение доводит подмену
+    TEST_ASSERT_EQUAL('B', boot_and_read());
+
+    // Сброс между rename() в .um~new и unlink() оригинала: .um~new новее
+    char old_path[UM_STORAGE_PATH_MAX];
+    snprintf(old_path, sizeof(old_path), "%s/old.json", s_dir);
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(old_path, s_content_a));
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(s_path, s_content_b));
+    TEST_ASSERT_EQUAL(0, rename(s_path, side));
+    TEST_ASSERT_EQUAL(0, rename(old_path, s_path));
+    TEST_ASSERT_EQUAL('B', boot_and_read());
+
+    // Удалённый файл не воскресает из .um~new
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(s_path, s_content_a));
+    write_raw(UM_STORAGE_NEW_SUFFIX, "{}", 2);
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_delete_file(s_path));
+    TEST_ASSERT_FALSE(um_storage_file_exists(s_path));
+}
+
+void test_um_storage_path_too_long(void)
+{
+    setup_dir();
+
+    // Путь влезает в UM_STORAGE_PATH_MAX, но не вместе с суффиксом
+    char path[UM_STORAGE_PATH_MAX];
+    int n = snprintf(path, sizeof(path), "%s/", s_dir);
+    memset(path + n, 'x', sizeof(path) - n - 2);
+    path[sizeof(path) - 2] = '\0';
+
+    um_storage_writer_t writer;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, um_storage_writer_open(path, 0, &writer));
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_storage_write_json(path, s_content_a));
+    TEST_ASSERT_FALSE(um_storage_file_exists(path));
+
+    // Усечённое до UM_STORAGE_PATH_MAX имя не должно стать файлом
+    char truncated[UM_STORAGE_PATH_MAX + 8];
+    snprintf(truncated, sizeof(truncated), "%s" UM_STORAGE_NEW_SUFFIX, path);
+    truncated[UM_STORAGE_PATH_MAX - 1] = '\0';
+    FILE* f = fopen(truncated, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fclose(f);
+    TEST_ASSERT_FALSE(um_storage_file_exists(path));
+    unlink(truncated);
+}
+
+void test_um_storage_user_side_files_kept(void)
+{
+    setup_dir();
+
+    // Чужие *.tmp и *.new (например, загруженные через /api/files) - обычные файлы
+    char user_tmp[UM_STORAGE_PATH_MAX];
+    char user_new[UM_STORAGE_PATH_MAX];
+    snprintf(user_tmp, sizeof(user_tmp), "%s/upload.tmp", s_dir);
+    snprintf(user_new, sizeof(user_new), "%s/cfg.json.new", s_dir);
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(user_tmp, s_content_a));
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(user_new, s_content_b));
+
+    TEST_ASSERT_EQUAL(0, boot_and_read());
+    TEST_ASSERT_TRUE(um_storage_file_exists(user_tmp));
+    TEST_ASSERT_TRUE(um_storage_file_exists(user_new));
+    TEST_ASSERT_FALSE(um_storage_file_exists(s_path));
+
+    unlink(user_tmp);
+    unlink(user_new);
+}
+
+static void child_quiet(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+}
+
+void test_um_storage_cut_at_offset(void)
+{
+    setup_dir();
+    srand(28);
+
+    int seen[2] = {0};
+    for (int run = 0; run < CUT_RUNS; run++) {
+        TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(s_path, s_content_a));
+        size_t cut = rand() % (CONTENT_B_LEN + 1);
+
+        pid_t pid = fork();
+        TEST_ASSERT_TRUE(pid >= 0);
+        if (pid == 0) {
+            child_quiet();
+            um_storage_writer_t writer;
+            um_storage_writer_open(s_path, UM_STORAGE_FLAG_CRC, &writer);
+            for (size_t off = 0; off < CONTENT_B_LEN; off += CHUNK) {
+                if (off >= cut) {
+                    fflush(writer.file);   // данные до смещения дошли до ФС
+                    raise(SIGKILL);
+                }
+                size_t len = CONTENT_B_LEN - off < CHUNK ? CONTENT_B_LEN - off : CHUNK;
+                um_storage_writer_write(&writer, s_content_b + off, len);
+            }
+            um_storage_writer_commit(&writer);
+            _exit(0);
+        }
+
+        int status;
+        TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+        char gen = boot_and_read();
+        TEST_ASSERT_TRUE_MESSAGE(gen == 'A' || gen == 'B', "file lost or damaged");
+        // Пока commit не начался, оригинал не тронут
+        if (WIFSIGNALED(status)) {
+            TEST_ASSERT_EQUAL('A', gen);
+        }
+        seen[gen == 'B']++;
+    }
+    printf("cut at offset: %d runs, old %d, new %d\n", CUT_RUNS, seen[0], seen[1]);
+}
+
+void test_um_storage_kill_at_random_time(void)
+{
+    setup_dir();
+    srand(280);
+
+    int seen[2] = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, um_storage_write_json(s_path, s_content_a));
+    for (int run = 0; run < KILL_RUNS; run++) {
+        pid_t pid = fork();
+        TEST_ASSERT_TRUE(pid >= 0);
+        if (pid == 0) {
+            child_quiet();
+            for (int i = 0;; i++) {
+                um_storage_write_json(s_path, (i & 1) ? s_content_a : s_content_b);
+            }
+        }
+
+        usleep(rand() % 3000);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+
+        char gen = boot_and_read();
+        TEST_ASSERT_TRUE_MESSAGE(gen == 'A' || gen == 'B', "file lost or damaged");
+        seen[gen == 'B']++;
+    }
+    printf("kill at random time: %d runs, A %d, B %d\n", KILL_RUNS, seen[0], seen[1]);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file um_json_stream.h
+ * @brief Streaming (push) JSON tokenizer with fixed-size buffer
+ * @version 1.0.0
+ */
+
+#ifndef UM_JSON_STREAM_H
+#define UM_JSON_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longest key/string/number kept; longer strings are truncated */
+#ifndef UM_JSON_STREAM_TOKEN_MAX
+#define UM_JSON_STREAM_TOKEN_MAX 64
+#endif
+
+/** Max nesting depth of objects/arrays */
+#define UM_JSON_STREAM_MAX_DEPTH 32
+
+typedef enum {
+    UM_JSON_OBJECT_START = 0,
+    UM_JSON_OBJECT_END,
+    UM_JSON_ARRAY_START,
+    UM_JSON_ARRAY_END,
+    UM_JSON_KEY,
+    UM_JSON_STRING,
+    UM_JSON_NUMBER,
+    UM_JSON_TRUE,
+    UM_JSON_FALSE,
+    UM_JSON_NULL
+} um_json_token_t;
+
+/**
+ * @brief Token callback
+ *
+ * depth - уровень вложенности места токена: корневой объект имеет depth 0,
+ * его ключи и значения - 1, и т.д. Для *_END depth совпадает с *_START.
+ *
+ * @param ctx User context
+ * @param token Token type
+ * @param value Null-terminated text for KEY/STRING/NUMBER, NULL otherwise
+ * @param depth Nesting level
+ * @return ESP_OK to continue, anything else aborts parsing
+ */
+typedef esp_err_t (*um_json_stream_cb_t)(void* ctx, um_json_token_t token, const char* value, int depth);
+
+typedef struct {
+    um_json_stream_cb_t cb;
+    void* ctx;
+    uint8_t state;
+    uint8_t expect;        // что допустимо дальше по грамматике
+    uint8_t number;        // разбор числа: где мы внутри -1.5e+3
+    uint8_t unicode_len;
+    uint16_t unicode;
+    int depth;
+    uint32_t containers;   // бит N = 1: уровень N - объект, 0 - массив
+    size_t len;
+    char buf[UM_JSON_STREAM_TOKEN_MAX];
+} um_json_stream_t;
+
+/**
+ * @brief Initialize tokenizer
+ *
+ * @param parser Parser state (caller-owned)
+ * @param cb Token callback
+ * @param ctx User context passed to callback
+ */
+void um_json_stream_init(um_json_stream_t* parser, um_json_stream_cb_t cb, void* ctx);
+
+/**
+ * @brief Feed next chunk of input
+ *
+ * @param parser Parser state
+ * @param data Input chunk
+ * @param len Chunk length
+ * The full JSON grammar is checked (commas, colons, keys, number format):
+ * tokens already emitted before a syntax error must be discarded.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on syntax error,
+ *         or error returned by callback
+ */
+esp_err_t um_json_stream_feed(um_json_stream_t* parser, const char* data, size_t len);
+
+/**
+ * @brief Finish parsing and check that the document is complete
+ *
+ * @param parser Parser state
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if truncated
+ */
+esp_err_t um_json_stream_finish(um_json_stream_t* parser);
+
+/**
+ * @brief Parse JSON file chunk by chunk
+ *
+ * @param file_path Full file path
+ * @param cb Token callback
+ * @param ctx User context
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND, ESP_ERR_INVALID_CRC,
+ *         ESP_ERR_INVALID_ARG on syntax error, or callback error
+ */
+esp_err_t um_json_stream_parse_file(const char* file_path, um_json_stream_cb_t cb, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UM_JSON_STREAM_H
@@ -1,7 +1,7 @@
 /**
  * @file um_storage.h
- * @brief Simple SPIFFS storage component for ESP-IDF
- * @version 1.0.0
+ * @brief Simple SPIFFS/LittleFS storage component for ESP-IDF
+ * @version 1.2.0
  */
 
 #ifndef UM_STORAGE_H
@@ -9,14 +9,67 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Append CRC32 trailer on write, verified and stripped on read */
+#define UM_STORAGE_FLAG_CRC (1 << 0)
+
+/** Partition label used when NULL is passed (see partitions.csv) */
+#define UM_STORAGE_DEFAULT_LABEL "storage"
+
+/** Max files copied by SPIFFS -> LittleFS migration */
+#define UM_STORAGE_MIGRATE_MAX_FILES 32
+
+/** Max fill level for um_storage_benchmark(), percent */
+#define UM_STORAGE_BENCH_MAX_FILL 95
+
+/** Max path length incl. temporary suffix (SD card paths from /api/files included) */
+#define UM_STORAGE_PATH_MAX 160
+
 /**
- * @brief Initialize SPIFFS storage
+ * Side files of an atomic write: "<file>" UM_STORAGE_TMP_SUFFIX (data being
+ * written) and "<file>" UM_STORAGE_NEW_SUFFIX (complete, not yet renamed).
+ * Only names with these suffixes are touched by um_storage_recover_dir().
+ */
+#define UM_STORAGE_TMP_SUFFIX ".um~tmp"
+#define UM_STORAGE_NEW_SUFFIX ".um~new"   // same length as UM_STORAGE_TMP_SUFFIX
+
+/**
+ * @brief Chunked file reader (allocate on stack, no heap used)
+ */
+typedef struct {
+    FILE* file;
+    size_t remaining;      // content bytes left (without CRC trailer)
+    bool has_crc;
+    uint32_t crc;          // running CRC32
+    uint32_t expected_crc;
+} um_storage_stream_t;
+
+/**
+ * @brief Chunked atomic writer (allocate on stack, no heap used)
+ *
+ * Data goes to <file>.um~tmp; on commit it is synced, renamed to
+ * <file>.um~new (complete-data marker) and only then replaces the original.
+ */
+typedef struct {
+    FILE* file;
+    uint32_t flags;
+    uint32_t crc;          // running CRC32 (UM_STORAGE_FLAG_CRC)
+    size_t written;
+    bool failed;
+    char path[UM_STORAGE_PATH_MAX];
+} um_storage_writer_t;
+
+/**
+ * @brief Initialize storage (SPIFFS or LittleFS, see Kconfig)
+ * 
+ * With LittleFS backend an existing SPIFFS partition is migrated once.
  * 
  * @param base_path Mount point (e.g., "/spiffs")
  * @param partition_label Partition label (NULL for default)
@@ -28,13 +81,26 @@ esp_err_t um_storage_init(const char* base_path, const char* partition_label,
                           int max_files, bool format_if_mount_failed);
 
 /**
- * @brief Deinitialize SPIFFS storage
+ * @brief Deinitialize storage
  * 
  * @param partition_label Partition label (NULL for default)
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t um_storage_deinit(const char* partition_label);
 
+/**
+ * @brief Finish or clean up interrupted atomic writes (recursive)
+ * 
+ * "<file>.um~new" replaces "<file>", "<file>.um~tmp" is deleted; other
+ * files (including user *.tmp and *.new) are left alone. Called by
+ * um_storage_init(); call it for other mounts (SD card) before they are
+ * used by writers.
+ * 
+ * @param dir_path Directory path
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if directory is missing
+ */
+esp_err_t um_storage_recover_dir(const char* dir_path);
+
 /**
  * @brief Check if file exists
  * 
@@ -47,22 +113,77 @@ bool um_storage_file_exists(const char* file_path);
 /**
  * @brief Read file content
  * 
+ * CRC trailer (if present and the file fits into the buffer) is verified
+ * and stripped.
+ * 
  * @param file_path Full file path
  * @param buffer Buffer to store data
  * @param buffer_size Buffer size
- * @return esp_err_t ESP_OK on success, ESP_FAIL on error
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_CRC if damaged, ESP_FAIL on error
  */
 esp_err_t um_storage_read_file(const char* file_path, char* buffer, size_t buffer_size);
 
 /**
  * @brief Write data to file
  * 
+ * Atomic: data goes to "<file>.um~tmp" and replaces the file only after
+ * fsync, so a reset leaves either the old or the new content. An unfinished
+ * "<file>.um~tmp" is never promoted.
+ * 
  * @param file_path Full file path
  * @param data Data to write
  * @return esp_err_t ESP_OK on success, ESP_FAIL on error
  */
 esp_err_t um_storage_write_file(const char* file_path, const char* data);
 
+/**
+ * @brief Atomically write binary data to file
+ * 
+ * @param file_path Full file path
+ * @param data Data to write
+ * @param len Data length
+ * @param flags UM_STORAGE_FLAG_* (0 for plain file)
+ * @return esp_err_t ESP_OK on success, ESP_FAIL on error
+ */
+esp_err_t um_storage_write_file_atomic(const char* file_path, const void* data, size_t len, uint32_t flags);
+
+/**
+ * @brief Open temporary file for chunked atomic write
+ * 
+ * @param file_path Full file path
+ * @param flags UM_STORAGE_FLAG_* (0 for plain file)
+ * @param writer Writer state (caller-owned)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if path is too long, ESP_FAIL on error
+ */
+esp_err_t um_storage_writer_open(const char* file_path, uint32_t flags, um_storage_writer_t* writer);
+
+/**
+ * @brief Write next chunk
+ * 
+ * @param writer Opened writer
+ * @param data Data to write
+ * @param len Data length
+ * @return esp_err_t ESP_OK on success, ESP_FAIL on error (commit will fail too)
+ */
+esp_err_t um_storage_writer_write(um_storage_writer_t* writer, const void* data, size_t len);
+
+/**
+ * @brief Sync temporary file and replace the original
+ * 
+ * The writer is closed in any case; on error the original is untouched.
+ * 
+ * @param writer Opened writer
+ * @return esp_err_t ESP_OK on success, ESP_FAIL on error
+ */
+esp_err_t um_storage_writer_commit(um_storage_writer_t* writer);
+
+/**
+ * @brief Close writer and delete temporary file, original is untouched
+ * 
+ * @param writer Writer (may be already closed)
+ */
+void um_storage_writer_abort(um_storage_writer_t* writer);
+
 /**
  * @brief Append data to file
  * 
@@ -109,19 +230,77 @@ esp_err_t um_storage_list_files(const char* path);
 /**
  * @brief Read JSON file with automatic buffer allocation
  * @param file_path Full file path
- * @return char on success or NULL
+ * @return char on success or NULL (missing file or CRC mismatch)
  */
 char* um_storage_read_json_string(const char* file_path);
 
 /**
  * @brief Write JSON file (for your configs)
  * 
+ * Atomic write with CRC trailer.
+ * 
  * @param file_path Full file path
  * @param json_data JSON data to write
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t um_storage_write_json(const char* file_path, const char* json_data);
 
+/**
+ * @brief Open file for chunked reading
+ * 
+ * CRC trailer (if present) is excluded from the data and verified
+ * when the end of content is reached.
+ * 
+ * @param file_path Full file path
+ * @param stream Stream state (caller-owned)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if file is missing
+ */
+esp_err_t um_storage_open_stream(const char* file_path, um_storage_stream_t* stream);
+
+/**
+ * @brief Read next chunk
+ * 
+ * @param stream Opened stream
+ * @param buffer Destination buffer
+ * @param buffer_size Buffer size
+ * @param out_len Bytes read, 0 at end of content
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_CRC at end of damaged file
+ */
+esp_err_t um_storage_read_chunk(um_storage_stream_t* stream, void* buffer, size_t buffer_size, size_t* out_len);
+
+/**
+ * @brief Close stream
+ * 
+ * @param stream Stream to close
+ */
+void um_storage_close_stream(um_storage_stream_t* stream);
+
+/**
+ * @brief Result of um_storage_benchmark(), mean latency per operation
+ */
+typedef struct {
+    uint8_t fill_percent;  // fill level actually reached
+    uint32_t files;        // entries seen by one directory listing
+    uint32_t open_us;      // fopen() + fclose() of an existing file
+    uint32_t read_us;      // read of a 1 KB file
+    uint32_t write_us;     // atomic write of a 1 KB file with CRC
+    uint32_t list_us;      // opendir() + readdir() of the mount point
+} um_storage_bench_result_t;
+
+/**
+ * @brief Measure open/read/write/list latency at given fill level
+ *
+ * Fills the partition with temporary files up to fill_percent, measures
+ * and deletes them. Blocks the caller for seconds at high fill levels.
+ *
+ * @param partition_label Partition label (NULL for default)
+ * @param fill_percent Target fill level (0 .. UM_STORAGE_BENCH_MAX_FILL)
+ * @param result Measured latencies (output)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM, ESP_FAIL
+ */
+esp_err_t um_storage_benchmark(const char* partition_label, uint8_t fill_percent,
+                               um_storage_bench_result_t* result);
+
 /**
  * @brief Format storage
  * 
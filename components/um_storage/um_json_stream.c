@@ -0,0 +1,439 @@
+/**
+ * @file um_json_stream.c
+ * @brief Streaming (push) JSON tokenizer with fixed-size buffer
+ * @version 1.0.0
+ */
+
+#include <string.h>
+#include "esp_log.h"
+#include "um_json_stream.h"
+#include "um_storage.h"
+
+static const char *TAG_JSON = "json_stream";
+
+/* Размер куска, читаемого из файла за раз (на стеке) */
+#define JSON_STREAM_CHUNK_SIZE 128
+
+enum {
+    ST_VALUE = 0,
+    ST_STRING,
+    ST_ESCAPE,
+    ST_UNICODE,
+    ST_NUMBER,
+    ST_LITERAL
+};
+
+/* Что допустимо в ST_VALUE, кроме пробелов */
+enum {
+    EXPECT_VALUE = 0,      // корень, после ':' или ',' в массиве
+    EXPECT_VALUE_OR_END,   // после '['
+    EXPECT_KEY,            // после ',' в объекте
+    EXPECT_KEY_OR_END,     // после '{'
+    EXPECT_COLON,          // после ключа
+    EXPECT_COMMA_OR_END,   // после значения внутри объекта/массива
+    EXPECT_NOTHING         // документ закончен
+};
+
+/* Разбор числа: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+enum {
+    NUM_SIGN = 0,          // после '-'
+    NUM_ZERO,              // ведущий 0
+    NUM_INT,
+    NUM_DOT,
+    NUM_FRAC,
+    NUM_EXP,               // после 'e'
+    NUM_EXP_SIGN,
+    NUM_EXP_DIGITS
+};
+
+static void append(um_json_stream_t* p, char c)
+{
+    // Длинные строки обрезаются, разбор продолжается
+    if (p->len < sizeof(p->buf) - 1) {
+        p->buf[p->len++] = c;
+    }
+}
+
+static void append_utf8(um_json_stream_t* p, uint16_t cp)
+{
+    if (cp < 0x80) {
+        append(p, (char)cp);
+    } else if (cp < 0x800) {
+        if (p->len + 2 < sizeof(p->buf)) {
+            append(p, (char)(0xC0 | (cp >> 6)));
+            append(p, (char)(0x80 | (cp & 0x3F)));
+        }
+    } else {
+        if (p->len + 3 < sizeof(p->buf)) {
+            append(p, (char)(0xE0 | (cp >> 12)));
+            append(p, (char)(0x80 | ((cp >> 6) & 0x3F)));
+            append(p, (char)(0x80 | (cp & 0x3F)));
+        }
+    }
+}
+
+static inline bool in_object(const um_json_stream_t* p)
+{
+    return p->depth > 0 && (p->containers & (1u << (p->depth - 1)));
+}
+
+static esp_err_t emit(um_json_stream_t* p, um_json_token_t token, bool with_value)
+{
+    const char* value = NULL;
+    if (with_value) {
+        p->buf[p->len] = '\0';
+        value = p->buf;
+    }
+    return p->cb(p->ctx, token, value, p->depth);
+}
+
+static void after_value(um_json_stream_t* p)
+{
+    p->expect = p->depth == 0 ? EXPECT_NOTHING : EXPECT_COMMA_OR_END;
+}
+
+static esp_err_t finish_literal(um_json_stream_t* p)
+{
+    p->buf[p->len] = '\0';
+    p->state = ST_VALUE;
+
+    um_json_token_t token;
+    if (strcmp(p->buf, "true") == 0) {
+        token = UM_JSON_TRUE;
+    } else if (strcmp(p->buf, "false") == 0) {
+        token = UM_JSON_FALSE;
+    } else if (strcmp(p->buf, "null") == 0) {
+        token = UM_JSON_NULL;
+    } else {
+        ESP_LOGE(TAG_JSON, "Unknown literal '%s'", p->buf);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = emit(p, token, false);
+    after_value(p);
+    return err;
+}
+
+// Следующий символ числа; false - символ числу не принадлежит
+static bool number_char(um_json_stream_t* p, char c)
+{
+    bool digit = c >= '0' && c <= '9';
+
+    switch (p->number) {
+    case NUM_SIGN:
+        if (!digit) return false;
+        p->number = c == '0' ? NUM_ZERO : NUM_INT;
+        return true;
+    case NUM_ZERO:
+    case NUM_INT:
+        if (digit && p->number == NUM_INT) {
+            return true;
+        }
+        if (c == '.') {
+            p->number = NUM_DOT;
+        } else if (c == 'e' || c == 'E') {
+            p->number = NUM_EXP;
+        } else {
+            return false;
+        }
+        return true;
+    case NUM_DOT:
+    case NUM_FRAC:
+        if (digit) {
+            p->number = NUM_FRAC;
+        } else if (p->number == NUM_FRAC && (c == 'e' || c == 'E')) {
+            p->number = NUM_EXP;
+        } else {
+            return false;
+        }
+        return true;
+    case NUM_EXP:
+        if (c == '+' || c == '-') {
+            p->number = NUM_EXP_SIGN;
+            return true;
+        }
+        // fall through
+    case NUM_EXP_SIGN:
+    case NUM_EXP_DIGITS:
+        if (!digit) return false;
+        p->number = NUM_EXP_DIGITS;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static esp_err_t finish_number(um_json_stream_t* p)
+{
+    p->state = ST_VALUE;
+    // "-", "1.", "1e+" - число оборвано
+    if (p->number == NUM_SIGN || p->number == NUM_DOT ||
+        p->number == NUM_EXP || p->number == NUM_EXP_SIGN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = emit(p, UM_JSON_NUMBER, true);
+    after_value(p);
+    return err;
+}
+
+static bool expects_value(const um_json_stream_t* p)
+{
+    return p->expect == EXPECT_VALUE || p->expect == EXPECT_VALUE_OR_END;
+}
+
+static esp_err_t open_container(um_json_stream_t* p, bool object)
+{
+    if (!expects_value(p) || p->depth >= UM_JSON_STREAM_MAX_DEPTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = emit(p, object ? UM_JSON_OBJECT_START : UM_JSON_ARRAY_START, false);
+    if (object) {
+        p->containers |= (1u << p->depth);
+    } else {
+        p->containers &= ~(1u << p->depth);
+    }
+    p->depth++;
+    p->expect = object ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+    return err;
+}
+
+static esp_err_t close_container(um_json_stream_t* p, bool object)
+{
+    // Пустой контейнер или после значения; "[1,]" и "{"a":}" - ошибка
+    bool can_close = p->expect == EXPECT_COMMA_OR_END ||
+                     p->expect == (object ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END);
+    if (p->depth == 0 || in_object(p) != object || !can_close) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    p->depth--;
+    esp_err_t err = emit(p, object ? UM_JSON_OBJECT_END : UM_JSON_ARRAY_END, false);
+    after_value(p);
+    return err;
+}
+
+static esp_err_t value_char(um_json_stream_t* p, char c)
+{
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+        return ESP_OK;
+    case '{':
+        return open_container(p, true);
+    case '[':
+        return open_container(p, false);
+    case '}':
+        return close_container(p, true);
+    case ']':
+        return close_container(p, false);
+    case ',':
+        if (p->expect != EXPECT_COMMA_OR_END) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        p->expect = in_object(p) ? EXPECT_KEY : EXPECT_VALUE;
+        return ESP_OK;
+    case ':':
+        if (p->expect != EXPECT_COLON) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        p->expect = EXPECT_VALUE;
+        return ESP_OK;
+    default:
+        break;
+    }
+
+    p->len = 0;
+    if (c == '"') {
+        // Строка - либо ключ, либо значение
+        if (!expects_value(p) && p->expect != EXPECT_KEY && p->expect != EXPECT_KEY_OR_END) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        p->state = ST_STRING;
+        return ESP_OK;
+    }
+
+    if (!expects_value(p)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        append(p, c);
+        p->number = c == '-' ? NUM_SIGN : (c == '0' ? NUM_ZERO : NUM_INT);
+        p->state = ST_NUMBER;
+    } else if (c == 't' || c == 'f' || c == 'n') {
+        append(p, c);
+        p->state = ST_LITERAL;
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void um_json_stream_init(um_json_stream_t* parser, um_json_stream_cb_t cb, void* ctx)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->cb = cb;
+    parser->ctx = ctx;
+    parser->state = ST_VALUE;
+}
+
+esp_err_t um_json_stream_feed(um_json_stream_t* parser, const char* data, size_t len)
+{
+    um_json_stream_t* p = parser;
+    esp_err_t err = ESP_OK;
+
+    for (size_t i = 0; i < len && err == ESP_OK; i++) {
+        char c = data[i];
+
+        switch (p->state) {
+        case ST_VALUE:
+            err = value_char(p, c);
+            break;
+
+        case ST_STRING:
+            if (c == '"') {
+                p->state = ST_VALUE;
+                if (!expects_value(p)) {
+                    p->expect = EXPECT_COLON;
+                    err = emit(p, UM_JSON_KEY, true);
+                } else {
+                    err = emit(p, UM_JSON_STRING, true);
+                    after_value(p);
+                }
+            } else if (c == '\\') {
+                p->state = ST_ESCAPE;
+            } else if ((unsigned char)c < 0x20) {
+                err = ESP_ERR_INVALID_ARG;
+            } else {
+                append(p, c);
+            }
+            break;
+
+        case ST_ESCAPE:
+            p->state = ST_STRING;
+            switch (c) {
+            case 'n': append(p, '\n'); break;
+            case 't': append(p, '\t'); break;
+            case 'r': append(p, '\r'); break;
+            case 'b': append(p, '\b'); break;
+            case 'f': append(p, '\f'); break;
+            case '"':
+            case '\\':
+            case '/':
+                append(p, c);
+                break;
+            case 'u':
+                p->state = ST_UNICODE;
+                p->unicode = 0;
+                p->unicode_len = 0;
+                break;
+            default:
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            break;
+
+        case ST_UNICODE: {
+            int h = hex_value(c);
+            if (h < 0) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            p->unicode = (p->unicode << 4) | h;
+            if (++p->unicode_len == 4) {
+                // Суррогатные пары не собираем
+                bool surrogate = p->unicode >= 0xD800 && p->unicode <= 0xDFFF;
+                append_utf8(p, surrogate ? '?' : p->unicode);
+                p->state = ST_STRING;
+            }
+            break;
+        }
+
+        case ST_NUMBER:
+            if (number_char(p, c)) {
+                append(p, c);
+            } else if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                err = ESP_ERR_INVALID_ARG;   // "01", "1.e5", "1-2"
+            } else {
+                err = finish_number(p);
+                if (err == ESP_OK) {
+                    err = value_char(p, c);
+                }
+            }
+            break;
+
+        case ST_LITERAL:
+            if (c >= 'a' && c <= 'z') {
+                append(p, c);
+            } else {
+                err = finish_literal(p);
+                if (err == ESP_OK) {
+                    err = value_char(p, c);
+                }
+            }
+            break;
+        }
+    }
+
+    if (err == ESP_ERR_INVALID_ARG) {
+        ESP_LOGE(TAG_JSON, "Syntax error");
+    }
+    return err;
+}
+
+esp_err_t um_json_stream_finish(um_json_stream_t* parser)
+{
+    esp_err_t err = ESP_OK;
+
+    // Документ из одного числа/литерала заканчивается вместе с входом
+    if (parser->state == ST_NUMBER) {
+        err = finish_number(parser);
+    } else if (parser->state == ST_LITERAL) {
+        err = finish_literal(parser);
+    }
+
+    if (err == ESP_OK && (parser->expect != EXPECT_NOTHING || parser->state != ST_VALUE)) {
+        ESP_LOGE(TAG_JSON, "Unexpected end of JSON");
+        err = ESP_ERR_INVALID_ARG;
+    }
+    return err;
+}
+
+esp_err_t um_json_stream_parse_file(const char* file_path, um_json_stream_cb_t cb, void* ctx)
+{
+    um_storage_stream_t stream;
+    esp_err_t err = um_storage_open_stream(file_path, &stream);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    um_json_stream_t parser;
+    um_json_stream_init(&parser, cb, ctx);
+
+    char chunk[JSON_STREAM_CHUNK_SIZE];
+    size_t n = 0;
+
+    do {
+        err = um_storage_read_chunk(&stream, chunk, sizeof(chunk), &n);
+        if (err == ESP_OK && n > 0) {
+            err = um_json_stream_feed(&parser, chunk, n);
+        }
+    } while (err == ESP_OK && n > 0);
+
+    um_storage_close_stream(&stream);
+
+    if (err == ESP_OK) {
+        err = um_json_stream_finish(&parser);
+    }
+    return err;
+}
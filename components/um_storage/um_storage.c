@@ -1,10 +1,11 @@
 /**
  * @file um_storage.c
- * @brief Simple SPIFFS storage component implementation
- * @version 1.0.0
+ * @brief Simple SPIFFS/LittleFS storage component implementation
+ * @version 1.2.0
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
@@ -12,24 +13,431 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_spiffs.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
 #include "um_storage.h"
 
+#if CONFIG_UM_CFG_STORAGE_LITTLEFS
+#include "esp_littlefs.h"
+#endif
+#if CONFIG_UM_CFG_STORAGE_MIGRATE_SPIFFS
+#include "nvs.h"
+#endif
+
 static const char *TAG_STORAGE = "storage";
 
 static char s_base_path[32] = "/spiffs"; // same as in partitions.csv
 
+/*
+ * Трейлер CRC в конце файла: 4 байта magic + CRC32 содержимого (LE).
+ * Magic начинается с 0x00, поэтому не совпадёт с концом текстового файла.
+ */
+static const uint8_t CRC_TRAILER_MAGIC[4] = {0x00, 'U', 'M', 0xC5};
+#define CRC_TRAILER_SIZE 8
+
+/*
+ * Атомарная запись: данные пишутся в <file>.um~tmp, после fsync он
+ * переименовывается в <file>.um~new (отметка "данные полные") и только потом
+ * подменяет оригинал. Оборванный .um~tmp никогда не становится файлом.
+ * Суффиксы свои, чтобы восстановление не трогало пользовательские *.tmp/*.new.
+ */
+#define TMP_SUFFIX UM_STORAGE_TMP_SUFFIX
+#define NEW_SUFFIX UM_STORAGE_NEW_SUFFIX
+
+/**
+ * @brief Build "<file><suffix>"
+ *
+ * @return false if the result does not fit (nothing is truncated silently)
+ */
+static bool make_side_path(const char* file_path, const char* suffix, char* out, size_t out_size)
+{
+    int n = snprintf(out, out_size, "%s%s", file_path, suffix);
+    return n > 0 && (size_t)n < out_size;
+}
+
+/**
+ * @brief Finish interrupted commit
+ *
+ * Если сброс произошёл между unlink() оригинала и последним rename(),
+ * остаётся только .um~new - он записан полностью и занимает место файла.
+ * Одинокий .um~tmp - оборванная запись, её не трогаем (удаляется при
+ * um_storage_recover_dir() или следующей записи).
+ */
+static void recover_commit(const char* file_path)
+{
+    struct stat st;
+    if (stat(file_path, &st) == 0) {
+        return;
+    }
+
+    char new_path[UM_STORAGE_PATH_MAX];
+    if (!make_side_path(file_path, NEW_SUFFIX, new_path, sizeof(new_path)) || stat(new_path, &st) != 0) {
+        return;
+    }
+
+    if (rename(new_path, file_path) == 0) {
+        ESP_LOGW(TAG_STORAGE, "Recovered %s from interrupted write", file_path);
+    }
+}
+
+static bool has_suffix(const char* name, const char* suffix)
+{
+    size_t len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return len > suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+/**
+ * @brief Verify and strip CRC trailer
+ *
+ * @return ESP_OK if trailer is valid or absent (old files),
+ *         ESP_ERR_INVALID_CRC if content is damaged
+ */
+static esp_err_t check_crc_trailer(const char* file_path, const uint8_t* data, size_t* len)
+{
+    if (*len < CRC_TRAILER_SIZE ||
+        memcmp(data + *len - CRC_TRAILER_SIZE, CRC_TRAILER_MAGIC, sizeof(CRC_TRAILER_MAGIC)) != 0) {
+        return ESP_OK;
+    }
+
+    size_t content_len = *len - CRC_TRAILER_SIZE;
+    const uint8_t* t = data + content_len + sizeof(CRC_TRAILER_MAGIC);
+    uint32_t stored = (uint32_t)t[0] | ((uint32_t)t[1] << 8) | ((uint32_t)t[2] << 16) | ((uint32_t)t[3] << 24);
+
+    if (esp_rom_crc32_le(0, data, content_len) != stored) {
+        ESP_LOGE(TAG_STORAGE, "CRC mismatch in %s", file_path);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    *len = content_len;
+    return ESP_OK;
+}
+
+#if CONFIG_UM_CFG_STORAGE_LITTLEFS
+
+// Миграция не удалась: раздел остался SPIFFS и смонтирован как SPIFFS
+static bool s_spiffs_fallback = false;
+
+// LittleFS требует явную метку раздела
+static const char* littlefs_label(const char* partition_label)
+{
+    return partition_label != NULL ? partition_label : UM_STORAGE_DEFAULT_LABEL;
+}
+
+static esp_err_t mount_littlefs(const char* partition_label, bool format_if_mount_failed)
+{
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = s_base_path,
+        .partition_label = littlefs_label(partition_label),
+        .format_if_mount_failed = format_if_mount_failed,
+        .dont_mount = false,
+    };
+    return esp_vfs_littlefs_register(&conf);
+}
+
+#if CONFIG_UM_CFG_STORAGE_MIGRATE_SPIFFS
+
+/*
+ * Копия файлов SPIFFS на время форматирования лежит в NVS (пространство
+ * MIGRATE_NAMESPACE): путь в "p<i>", содержимое в "f<i>". Ключ "n"
+ * (число файлов) пишется последним - это отметка "копия полная".
+ * Пока её нет, SPIFFS не тронут; после неё источником служит только NVS,
+ * и сброс на любом шаге доводит перенос до конца при следующем запуске.
+ */
+#define MIGRATE_NAMESPACE "um_migrate"
+#define MIGRATE_COUNT_KEY "n"
+
+// Создаёт промежуточные каталоги ("www/css/app.css" из плоского SPIFFS)
+static void make_parent_dirs(const char* file_path)
+{
+    char dir[UM_STORAGE_PATH_MAX];
+    strncpy(dir, file_path, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+
+    for (char* p = dir + strlen(s_base_path) + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(dir, 0775);
+            *p = '/';
+        }
+    }
+}
+
+static void migrate_key(char* key, size_t size, char prefix, int index)
+{
+    snprintf(key, size, "%c%d", prefix, index);
+}
+
+// Сначала отметка: сброс посреди очистки не оставит "полную" копию из обрывков
+static void migrate_clear(nvs_handle_t nvs)
+{
+    nvs_erase_key(nvs, MIGRATE_COUNT_KEY);
+    nvs_commit(nvs);
+    nvs_erase_all(nvs);
+    nvs_commit(nvs);
+}
+
+/**
+ * @brief Copy one SPIFFS file into NVS
+ *
+ * @return ESP_ERR_INVALID_SIZE if it does not fit the limits,
+ *         ESP_ERR_NO_MEM, ESP_FAIL on read error or NVS error code
+ */
+static esp_err_t stage_file(nvs_handle_t nvs, int index, const char* name, size_t* total)
+{
+    char path[UM_STORAGE_PATH_MAX];
+    int n = snprintf(path, sizeof(path), "%s/%s", s_base_path, name);
+    if (n < 0 || (size_t)n >= sizeof(path) || index >= UM_STORAGE_MIGRATE_MAX_FILES) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t size = um_storage_get_file_size(path);
+    if (*total + size > CONFIG_UM_CFG_STORAGE_MIGRATE_MAX_KB * 1024) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t* data = malloc(size > 0 ? size : 1);
+    if (data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    FILE* f = fopen(path, "rb");
+    if (f == NULL || fread(data, 1, size, f) != size) {
+        ret = ESP_FAIL;
+    }
+    if (f) fclose(f);
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    if (ret == ESP_OK) {
+        migrate_key(key, sizeof(key), 'p', index);
+        ret = nvs_set_str(nvs, key, name);
+    }
+    // Пустой файл - только путь, без блоба
+    if (ret == ESP_OK && size > 0) {
+        migrate_key(key, sizeof(key), 'f', index);
+        ret = nvs_set_blob(nvs, key, data, size);
+    }
+    free(data);
+
+    *total += size;
+    return ret;
+}
+
+/**
+ * @brief Copy all SPIFFS files into NVS, SPIFFS is left untouched
+ *
+ * Всё или ничего: если хоть один файл не помещается в лимиты, в память
+ * или в NVS, копия удаляется и раздел не форматируется.
+ */
+static esp_err_t stage_spiffs(nvs_handle_t nvs, int* count)
+{
+    // Остатки копирования, прерванного до отметки
+    migrate_clear(nvs);
+
+    DIR* dir = opendir(s_base_path);
+    if (dir == NULL) {
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t total = 0;
+    *count = 0;
+    struct dirent* entry;
+    while (ret == ESP_OK && (entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG) {
+            continue;
+        }
+        ret = stage_file(nvs, *count, entry->d_name, &total);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG_STORAGE, "Cannot keep %s for migration (%s)", entry->d_name, esp_err_to_name(ret));
+            break;
+        }
+        (*count)++;
+    }
+    closedir(dir);
+
+    if (ret == ESP_OK) {
+        ret = nvs_set_u16(nvs, MIGRATE_COUNT_KEY, *count);
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    if (ret != ESP_OK) {
+        migrate_clear(nvs);
+        return ret;
+    }
+
+    ESP_LOGI(TAG_STORAGE, "Staged %d files (%d bytes) in NVS", *count, total);
+    return ESP_OK;
+}
+
+/**
+ * @brief Reformat the partition as LittleFS
+ *
+ * Если копия в NVS уже полная (сброс после отметки), SPIFFS не читается:
+ * раздел мог быть частично стёрт. Иначе файлы сначала копируются в NVS.
+ * Если копию сделать нельзя, SPIFFS остаётся смонтированным как есть.
+ *
+ * @return ESP_OK if LittleFS or the SPIFFS fallback is mounted,
+ *         ESP_ERR_NOT_FOUND if there is neither SPIFFS nor a staged copy
+ */
+static esp_err_t migrate_from_spiffs(const char* partition_label, int max_files)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(MIGRATE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_STORAGE, "NVS unavailable (%s)", esp_err_to_name(ret));
+    }
+
+    uint16_t staged = 0;
+    if (ret == ESP_OK && nvs_get_u16(nvs, MIGRATE_COUNT_KEY, &staged) == ESP_OK) {
+        ESP_LOGW(TAG_STORAGE, "Resuming migration of %d staged files", staged);
+        nvs_close(nvs);
+    } else {
+        esp_vfs_spiffs_conf_t conf = {
+            .base_path = s_base_path,
+            .partition_label = partition_label,
+            .max_files = max_files,
+            .format_if_mount_failed = false
+        };
+        if (esp_vfs_spiffs_register(&conf) != ESP_OK) {
+            if (ret == ESP_OK) {
+                nvs_close(nvs);
+            }
+            return ESP_ERR_NOT_FOUND;
+        }
+
+        ESP_LOGW(TAG_STORAGE, "SPIFFS found, migrating to LittleFS");
+        if (ret == ESP_OK) {
+            int count = 0;
+            ret = stage_spiffs(nvs, &count);
+            nvs_close(nvs);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG_STORAGE, "Migration aborted, partition stays SPIFFS");
+            s_spiffs_fallback = true;
+            return ESP_OK;
+        }
+        esp_vfs_spiffs_unregister(partition_label);
+    }
+
+    ret = esp_littlefs_format(littlefs_label(partition_label));
+    if (ret == ESP_OK) {
+        ret = mount_littlefs(partition_label, false);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_STORAGE, "Migration failed (%s), staged copy kept", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+/**
+ * @brief Write staged files back to mounted LittleFS and drop the copy
+ *
+ * Вызывается при каждом запуске: после сброса посреди записи файлы
+ * пишутся заново (атомарно, поверх уже перенесённых).
+ */
+static void migrate_restore(void)
+{
+    nvs_handle_t nvs;
+    uint16_t count = 0;
+    if (nvs_open(MIGRATE_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_u16(nvs, MIGRATE_COUNT_KEY, &count) != ESP_OK) {
+        // Копии нет или остались обрывки прерванной очистки
+        nvs_erase_all(nvs);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+        return;
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t total = 0;
+    for (int i = 0; i < count && ret == ESP_OK; i++) {
+        char key[NVS_KEY_NAME_MAX_SIZE];
+        char name[UM_STORAGE_PATH_MAX];
+        size_t name_len = sizeof(name);
+        migrate_key(key, sizeof(key), 'p', i);
+        ret = nvs_get_str(nvs, key, name, &name_len);
+
+        size_t size = 0;
+        migrate_key(key, sizeof(key), 'f', i);
+        if (ret == ESP_OK && nvs_get_blob(nvs, key, NULL, &size) != ESP_OK) {
+            size = 0;   // пустой файл
+        }
+
+        uint8_t* data = ret == ESP_OK ? malloc(size > 0 ? size : 1) : NULL;
+        if (ret == ESP_OK && data == NULL) {
+            ret = ESP_ERR_NO_MEM;
+        }
+        if (ret == ESP_OK && size > 0) {
+            ret = nvs_get_blob(nvs, key, data, &size);
+        }
+
+        char path[UM_STORAGE_PATH_MAX];
+        if (ret == ESP_OK) {
+            snprintf(path, sizeof(path), "%s/%s", s_base_path, name);
+            make_parent_dirs(path);
+            // Байты как есть: CRC-трейлеры сохраняются
+            ret = um_storage_write_file_atomic(path, data, size, 0);
+        }
+        free(data);
+        total += size;
+    }
+
+    if (ret != ESP_OK) {
+        // Копия остаётся в NVS, следующий запуск повторит перенос
+        ESP_LOGE(TAG_STORAGE, "Failed to restore staged files (%s)", esp_err_to_name(ret));
+        nvs_close(nvs);
+        return;
+    }
+
+    migrate_clear(nvs);
+    nvs_close(nvs);
+    ESP_LOGI(TAG_STORAGE, "Migrated %d files (%d bytes)", count, total);
+}
+#endif // CONFIG_UM_CFG_STORAGE_MIGRATE_SPIFFS
+
+#endif // CONFIG_UM_CFG_STORAGE_LITTLEFS
+
 esp_err_t um_storage_init(
     const char* base_path, 
     const char* partition_label,
     int max_files, 
     bool format_if_mount_failed)
 {
-    ESP_LOGI(TAG_STORAGE, "Initializing SPIFFS");
-    
     if (base_path != NULL) {
         strncpy(s_base_path, base_path, sizeof(s_base_path) - 1);
         s_base_path[sizeof(s_base_path) - 1] = '\0';
     }
+
+#if CONFIG_UM_CFG_STORAGE_LITTLEFS
+    ESP_LOGI(TAG_STORAGE, "Initializing LittleFS");
+
+    esp_err_t ret = mount_littlefs(partition_label, false);
+#if CONFIG_UM_CFG_STORAGE_MIGRATE_SPIFFS
+    if (ret != ESP_OK) {
+        ret = migrate_from_spiffs(partition_label, max_files);
+    }
+#endif
+    if (ret != ESP_OK && format_if_mount_failed) {
+        ret = mount_littlefs(partition_label, true);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_STORAGE, "Failed to mount LittleFS (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+#if CONFIG_UM_CFG_STORAGE_MIGRATE_SPIFFS
+    if (!s_spiffs_fallback) {
+        migrate_restore();
+    }
+#endif
+#else
+    ESP_LOGI(TAG_STORAGE, "Initializing SPIFFS");
     
     esp_vfs_spiffs_conf_t conf = {
         .base_path = s_base_path,
@@ -50,13 +458,15 @@ esp_err_t um_storage_init(
         }
         return ret;
     }
+#endif
     
+    // Других задач ещё нет: можно довести до конца прерванные записи
+    um_storage_recover_dir(s_base_path);
+
     // Get storage info
     size_t total = 0, used = 0;
-    ret = esp_spiffs_info(conf.partition_label, &total, &used);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG_STORAGE, "Failed to get SPIFFS partition information");
-    } else {
+    ret = um_storage_get_info(partition_label, &total, &used);
+    if (ret == ESP_OK) {
         ESP_LOGI(TAG_STORAGE, "Partition size: total: %d, used: %d", total, used);
     }
     
@@ -65,16 +475,65 @@ esp_err_t um_storage_init(
 
 esp_err_t um_storage_deinit(const char* partition_label)
 {
+#if CONFIG_UM_CFG_STORAGE_LITTLEFS
+    ESP_LOGI(TAG_STORAGE, "Unmounting %s", s_spiffs_fallback ? "SPIFFS" : "LittleFS");
+    esp_err_t ret = s_spiffs_fallback ? esp_vfs_spiffs_unregister(partition_label)
+                                      : esp_vfs_littlefs_unregister(littlefs_label(partition_label));
+    s_spiffs_fallback = false;
+#else
     ESP_LOGI(TAG_STORAGE, "Unmounting SPIFFS");
     esp_err_t ret = esp_vfs_spiffs_unregister(partition_label);
+#endif
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG_STORAGE, "Failed to unmount SPIFFS (%s)", esp_err_to_name(ret));
+        ESP_LOGE(TAG_STORAGE, "Failed to unmount storage (%s)", esp_err_to_name(ret));
     }
     return ret;
 }
 
+esp_err_t um_storage_recover_dir(const char* dir_path)
+{
+    DIR* dir = opendir(dir_path);
+    if (dir == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char path[UM_STORAGE_PATH_MAX];
+    char file_path[UM_STORAGE_PATH_MAX];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        int n = snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        if (n < 0 || (size_t)n >= sizeof(path)) {
+            continue;
+        }
+
+        if (entry->d_type == DT_DIR) {
+            um_storage_recover_dir(path);
+        } else if (has_suffix(path, TMP_SUFFIX)) {
+            // Запись оборвалась до fsync - данные неполные
+            unlink(path);
+            ESP_LOGW(TAG_STORAGE, "Removed incomplete %s", path);
+        } else if (has_suffix(path, NEW_SUFFIX)) {
+            // Данные полные, подмена оригинала не завершилась
+            memcpy(file_path, path, n - (sizeof(NEW_SUFFIX) - 1));
+            file_path[n - (sizeof(NEW_SUFFIX) - 1)] = '\0';
+            unlink(file_path);
+            if (rename(path, file_path) == 0) {
+                ESP_LOGW(TAG_STORAGE, "Recovered %s from interrupted write", file_path);
+            }
+        }
+    }
+
+    closedir(dir);
+    return ESP_OK;
+}
+
 bool um_storage_file_exists(const char* file_path)
 {
+    recover_commit(file_path);
+
     struct stat st;
     return (stat(file_path, &st) == 0);
 }
@@ -86,6 +545,8 @@ esp_err_t um_storage_read_file(const char* file_path, char* buffer, size_t buffe
         return ESP_FAIL;
     }
     
+    recover_commit(file_path);
+
     FILE* f = fopen(file_path, "r");
     if (f == NULL) {
         ESP_LOGE(TAG_STORAGE, "Failed to open file for reading: %s", file_path);
@@ -93,34 +554,172 @@ esp_err_t um_storage_read_file(const char* file_path, char* buffer, size_t buffe
     }
     
     size_t bytes_read = fread(buffer, 1, buffer_size - 1, f);
-    buffer[bytes_read] = '\0'; // Null-terminate
-    
+    bool complete = feof(f) || fgetc(f) == EOF;
     fclose(f);
+
+    // Трейлер проверяем, только если файл прочитан целиком
+    if (complete && check_crc_trailer(file_path, (uint8_t*)buffer, &bytes_read) != ESP_OK) {
+        buffer[0] = '\0';
+        return ESP_ERR_INVALID_CRC;
+    }
+    buffer[bytes_read] = '\0'; // Null-terminate
     
     ESP_LOGD(TAG_STORAGE, "Read %d bytes from %s", bytes_read, file_path);
     return ESP_OK;
 }
 
-esp_err_t um_storage_write_file(const char* file_path, const char* data)
+esp_err_t um_storage_writer_open(const char* file_path, uint32_t flags, um_storage_writer_t* writer)
 {
-    if (data == NULL) {
-        ESP_LOGE(TAG_STORAGE, "Invalid data");
+    if (file_path == NULL || writer == NULL) {
         return ESP_FAIL;
     }
-    
-    FILE* f = fopen(file_path, "w");
-    if (f == NULL) {
-        ESP_LOGE(TAG_STORAGE, "Failed to open file for writing: %s", file_path);
+    memset(writer, 0, sizeof(*writer));
+
+    // Место под суффикс нужно и в path, и во временном имени
+    if (strlen(file_path) + sizeof(TMP_SUFFIX) > sizeof(writer->path)) {
+        ESP_LOGE(TAG_STORAGE, "Path too long: %s", file_path);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    strcpy(writer->path, file_path);
+    writer->flags = flags;
+
+    char tmp_path[UM_STORAGE_PATH_MAX];
+    char new_path[UM_STORAGE_PATH_MAX];
+    make_side_path(file_path, TMP_SUFFIX, tmp_path, sizeof(tmp_path));
+    make_side_path(file_path, NEW_SUFFIX, new_path, sizeof(new_path));
+
+    // .um~new от прерванной подмены всё равно будет перезаписан этим файлом
+    recover_commit(file_path);
+    unlink(new_path);
+
+    writer->file = fopen(tmp_path, "w");
+    if (writer->file == NULL) {
+        ESP_LOGE(TAG_STORAGE, "Failed to open file for writing: %s", tmp_path);
         return ESP_FAIL;
     }
-    
-    size_t bytes_written = fprintf(f, "%s", data);
-    fclose(f);
-    
-    ESP_LOGD(TAG_STORAGE, "Wrote %d bytes to %s", bytes_written, file_path);
     return ESP_OK;
 }
 
+esp_err_t um_storage_writer_write(um_storage_writer_t* writer, const void* data, size_t len)
+{
+    if (writer->file == NULL || writer->failed) {
+        return ESP_FAIL;
+    }
+    if (len == 0) {
+        return ESP_OK;
+    }
+
+    if (fwrite(data, 1, len, writer->file) != len) {
+        // Дальше писать бессмысленно: commit удалит временный файл
+        writer->failed = true;
+        return ESP_FAIL;
+    }
+    if (writer->flags & UM_STORAGE_FLAG_CRC) {
+        writer->crc = esp_rom_crc32_le(writer->crc, data, len);
+    }
+    writer->written += len;
+    return ESP_OK;
+}
+
+void um_storage_writer_abort(um_storage_writer_t* writer)
+{
+    if (writer->file == NULL) {
+        return;
+    }
+    fclose(writer->file);
+    writer->file = NULL;
+
+    char tmp_path[UM_STORAGE_PATH_MAX];
+    make_side_path(writer->path, TMP_SUFFIX, tmp_path, sizeof(tmp_path));
+    unlink(tmp_path);
+}
+
+esp_err_t um_storage_writer_commit(um_storage_writer_t* writer)
+{
+    if (writer->file == NULL) {
+        return ESP_FAIL;
+    }
+
+    // Длина проверена в um_storage_writer_open()
+    char tmp_path[UM_STORAGE_PATH_MAX];
+    char new_path[UM_STORAGE_PATH_MAX];
+    make_side_path(writer->path, TMP_SUFFIX, tmp_path, sizeof(tmp_path));
+    make_side_path(writer->path, NEW_SUFFIX, new_path, sizeof(new_path));
+    FILE* f = writer->file;
+    writer->file = NULL;
+
+    bool ok = !writer->failed;
+
+    if (ok && (writer->flags & UM_STORAGE_FLAG_CRC)) {
+        uint32_t crc = writer->crc;
+        uint8_t trailer[CRC_TRAILER_SIZE];
+        memcpy(trailer, CRC_TRAILER_MAGIC, sizeof(CRC_TRAILER_MAGIC));
+        trailer[4] = crc & 0xFF;
+        trailer[5] = (crc >> 8) & 0xFF;
+        trailer[6] = (crc >> 16) & 0xFF;
+        trailer[7] = (crc >> 24) & 0xFF;
+        ok = fwrite(trailer, 1, sizeof(trailer), f) == sizeof(trailer);
+    }
+
+    // Данные должны оказаться во flash до подмены оригинала
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok) {
+        ESP_LOGE(TAG_STORAGE, "Failed to write %s", tmp_path);
+        unlink(tmp_path);
+        return ESP_FAIL;
+    }
+
+    // Отметка о полной записи: с этого момента сброс не теряет новые данные
+    if (rename(tmp_path, new_path) != 0) {
+        ESP_LOGE(TAG_STORAGE, "Failed to rename %s -> %s", tmp_path, new_path);
+        unlink(tmp_path);
+        return ESP_FAIL;
+    }
+
+    if (rename(new_path, writer->path) != 0) {
+        // SPIFFS и FAT не перезаписывают существующий файл при rename
+        unlink(writer->path);
+        struct stat st;
+        // .um~new мог уже подхватить recover_commit() из читающей задачи
+        if (rename(new_path, writer->path) != 0 && stat(new_path, &st) == 0) {
+            ESP_LOGE(TAG_STORAGE, "Failed to rename %s -> %s", new_path, writer->path);
+            return ESP_FAIL;
+        }
+    }
+
+    ESP_LOGD(TAG_STORAGE, "Wrote %d bytes to %s", writer->written, writer->path);
+    return ESP_OK;
+}
+
+esp_err_t um_storage_write_file_atomic(const char* file_path, const void* data, size_t len, uint32_t flags)
+{
+    if (file_path == NULL || (data == NULL && len > 0)) {
+        ESP_LOGE(TAG_STORAGE, "Invalid data");
+        return ESP_FAIL;
+    }
+
+    um_storage_writer_t writer;
+    esp_err_t ret = um_storage_writer_open(file_path, flags, &writer);
+    if (ret != ESP_OK) {
+        return ret == ESP_ERR_INVALID_SIZE ? ESP_FAIL : ret;
+    }
+
+    um_storage_writer_write(&writer, data, len);
+    return um_storage_writer_commit(&writer);
+}
+
+esp_err_t um_storage_write_file(const char* file_path, const char* data)
+{
+    if (data == NULL) {
+        ESP_LOGE(TAG_STORAGE, "Invalid data");
+        return ESP_FAIL;
+    }
+
+    return um_storage_write_file_atomic(file_path, data, strlen(data), 0);
+}
+
 esp_err_t um_storage_append_file(const char* file_path, const char* data)
 {
     if (data == NULL) {
@@ -143,6 +742,12 @@ esp_err_t um_storage_append_file(const char* file_path, const char* data)
 
 esp_err_t um_storage_delete_file(const char* file_path)
 {
+    // Иначе recover_commit() вернёт файл из .um~new прерванной записи
+    char new_path[UM_STORAGE_PATH_MAX];
+    if (make_side_path(file_path, NEW_SUFFIX, new_path, sizeof(new_path))) {
+        unlink(new_path);
+    }
+
     if (unlink(file_path) != 0) {
         ESP_LOGE(TAG_STORAGE, "Failed to delete file: %s", file_path);
         return ESP_FAIL;
@@ -167,7 +772,12 @@ esp_err_t um_storage_get_info(const char* partition_label, size_t* total, size_t
         return ESP_ERR_INVALID_ARG;
     }
     
+#if CONFIG_UM_CFG_STORAGE_LITTLEFS
+    esp_err_t ret = s_spiffs_fallback ? esp_spiffs_info(partition_label, total, used)
+                                      : esp_littlefs_info(littlefs_label(partition_label), total, used);
+#else
     esp_err_t ret = esp_spiffs_info(partition_label, total, used);
+#endif
     if (ret != ESP_OK) {
         ESP_LOGE(TAG_STORAGE, "Failed to get storage info");
     }
@@ -200,6 +810,8 @@ esp_err_t um_storage_list_files(const char* path)
 
 char* um_storage_read_json_string(const char* file_path)
 {
+    recover_commit(file_path);
+
     size_t file_size = um_storage_get_file_size(file_path);
     if (file_size == 0) return NULL;
     
@@ -214,6 +826,11 @@ char* um_storage_read_json_string(const char* file_path)
     
     size_t read = fread(buffer, 1, file_size, f);
     fclose(f);
+
+    if (check_crc_trailer(file_path, (uint8_t*)buffer, &read) != ESP_OK) {
+        free(buffer);
+        return NULL;
+    }
     
     buffer[read] = '\0';
     return buffer;
@@ -221,19 +838,229 @@ char* um_storage_read_json_string(const char* file_path)
 
 esp_err_t um_storage_write_json(const char* file_path, const char* json_data)
 {
-    return um_storage_write_file(file_path, json_data);
+    if (json_data == NULL) {
+        ESP_LOGE(TAG_STORAGE, "Invalid data");
+        return ESP_FAIL;
+    }
+
+    return um_storage_write_file_atomic(file_path, json_data, strlen(json_data), UM_STORAGE_FLAG_CRC);
+}
+
+esp_err_t um_storage_open_stream(const char* file_path, um_storage_stream_t* stream)
+{
+    if (file_path == NULL || stream == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(stream, 0, sizeof(*stream));
+    recover_commit(file_path);
+
+    struct stat st;
+    if (stat(file_path, &st) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    FILE* f = fopen(file_path, "r");
+    if (f == NULL) {
+        ESP_LOGE(TAG_STORAGE, "Failed to open file for reading: %s", file_path);
+        return ESP_FAIL;
+    }
+
+    size_t size = st.st_size;
+    stream->file = f;
+    stream->remaining = size;
+
+    // Смотрим, есть ли в конце трейлер CRC
+    uint8_t trailer[CRC_TRAILER_SIZE];
+    if (size >= CRC_TRAILER_SIZE &&
+        fseek(f, (long)(size - CRC_TRAILER_SIZE), SEEK_SET) == 0 &&
+        fread(trailer, 1, sizeof(trailer), f) == sizeof(trailer) &&
+        memcmp(trailer, CRC_TRAILER_MAGIC, sizeof(CRC_TRAILER_MAGIC)) == 0) {
+        stream->has_crc = true;
+        stream->remaining = size - CRC_TRAILER_SIZE;
+        stream->expected_crc = (uint32_t)trailer[4] | ((uint32_t)trailer[5] << 8) |
+                               ((uint32_t)trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+    }
+
+    if (fseek(f, 0, SEEK_SET) != 0) {
+        um_storage_close_stream(stream);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t um_storage_read_chunk(um_storage_stream_t* stream, void* buffer, size_t buffer_size, size_t* out_len)
+{
+    if (stream == NULL || stream->file == NULL || buffer == NULL || out_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *out_len = 0;
+
+    if (stream->remaining == 0) {
+        if (stream->has_crc && stream->crc != stream->expected_crc) {
+            ESP_LOGE(TAG_STORAGE, "CRC mismatch in stream");
+            return ESP_ERR_INVALID_CRC;
+        }
+        return ESP_OK;
+    }
+
+    size_t to_read = buffer_size < stream->remaining ? buffer_size : stream->remaining;
+    size_t n = fread(buffer, 1, to_read, stream->file);
+    if (n == 0) {
+        ESP_LOGE(TAG_STORAGE, "Unexpected end of stream");
+        return ESP_FAIL;
+    }
+
+    stream->remaining -= n;
+    if (stream->has_crc) {
+        stream->crc = esp_rom_crc32_le(stream->crc, buffer, n);
+    }
+
+    *out_len = n;
+    return ESP_OK;
+}
+
+void um_storage_close_stream(um_storage_stream_t* stream)
+{
+    if (stream != NULL && stream->file != NULL) {
+        fclose(stream->file);
+        stream->file = NULL;
+    }
+}
+
+#define BENCH_PREFIX "bench_"
+#define BENCH_FILL_CHUNK 4096
+#define BENCH_FILL_FILE (32 * 1024)
+#define BENCH_PROBE_SIZE 1024
+#define BENCH_ROUNDS 20
+
+static void bench_fill_path(char* out, size_t size, int index)
+{
+    snprintf(out, size, "%s/" BENCH_PREFIX "%03d.bin", s_base_path, index);
+}
+
+// Заполнение файлами по BENCH_FILL_FILE до нужного уровня; false - место кончилось
+static bool bench_fill_file(const char* path, uint8_t* buf)
+{
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t off = 0; ok && off < BENCH_FILL_FILE; off += BENCH_FILL_CHUNK) {
+        ok = fwrite(buf, 1, BENCH_FILL_CHUNK, f) == BENCH_FILL_CHUNK;
+    }
+    ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+esp_err_t um_storage_benchmark(const char* partition_label, uint8_t fill_percent,
+                               um_storage_bench_result_t* result)
+{
+    if (result == NULL || fill_percent > UM_STORAGE_BENCH_MAX_FILL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(result, 0, sizeof(*result));
+
+    size_t total = 0, used = 0;
+    esp_err_t ret = um_storage_get_info(partition_label, &total, &used);
+    if (ret != ESP_OK || total == 0) {
+        return ESP_FAIL;
+    }
+
+    uint8_t* buf = malloc(BENCH_FILL_CHUNK);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < BENCH_FILL_CHUNK; i++) {
+        buf[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    char path[UM_STORAGE_PATH_MAX];
+    int fillers = 0;
+    while ((uint64_t)used * 100 < (uint64_t)total * fill_percent) {
+        bench_fill_path(path, sizeof(path), fillers);
+        bool ok = bench_fill_file(path, buf);
+        fillers++;
+        if (!ok || um_storage_get_info(partition_label, &total, &used) != ESP_OK) {
+            ESP_LOGW(TAG_STORAGE, "Fill stopped at %d%%", (int)((uint64_t)used * 100 / total));
+            break;
+        }
+    }
+    result->fill_percent = (uint8_t)((uint64_t)used * 100 / total);
+
+    char probe[UM_STORAGE_PATH_MAX];
+    snprintf(probe, sizeof(probe), "%s/" BENCH_PREFIX "probe.json", s_base_path);
+    int64_t write_us = 0, open_us = 0, read_us = 0, list_us = 0;
+    for (int round = 0; round < BENCH_ROUNDS && ret == ESP_OK; round++) {
+        int64_t start = esp_timer_get_time();
+        ret = um_storage_write_file_atomic(probe, buf, BENCH_PROBE_SIZE, UM_STORAGE_FLAG_CRC);
+        write_us += esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        FILE* f = fopen(probe, "rb");
+        if (f == NULL) {
+            ret = ESP_FAIL;
+            break;
+        }
+        fclose(f);
+        open_us += esp_timer_get_time() - start;
+
+        f = fopen(probe, "rb");
+        start = esp_timer_get_time();
+        if (f == NULL || fread(buf, 1, BENCH_PROBE_SIZE, f) != BENCH_PROBE_SIZE) {
+            ret = ESP_FAIL;
+        }
+        read_us += esp_timer_get_time() - start;
+        if (f) fclose(f);
+
+        start = esp_timer_get_time();
+        DIR* dir = opendir(s_base_path);
+        uint32_t files = 0;
+        while (dir != NULL && readdir(dir) != NULL) {
+            files++;
+        }
+        if (dir != NULL) {
+            closedir(dir);
+        }
+        list_us += esp_timer_get_time() - start;
+        result->files = files;
+    }
+
+    if (ret == ESP_OK) {
+        result->write_us = (uint32_t)(write_us / BENCH_ROUNDS);
+        result->open_us = (uint32_t)(open_us / BENCH_ROUNDS);
+        result->read_us = (uint32_t)(read_us / BENCH_ROUNDS);
+        result->list_us = (uint32_t)(list_us / BENCH_ROUNDS);
+    }
+
+    unlink(probe);
+    for (int i = 0; i < fillers; i++) {
+        bench_fill_path(path, sizeof(path), i);
+        unlink(path);
+    }
+    free(buf);
+    return ret;
 }
 
 esp_err_t um_storage_format(const char* partition_label)
 {
+#if CONFIG_UM_CFG_STORAGE_LITTLEFS
+    ESP_LOGW(TAG_STORAGE, "Formatting %s partition", s_spiffs_fallback ? "SPIFFS" : "LittleFS");
+    esp_err_t ret = s_spiffs_fallback ? esp_spiffs_format(partition_label)
+                                      : esp_littlefs_format(littlefs_label(partition_label));
+#else
     ESP_LOGW(TAG_STORAGE, "Formatting SPIFFS partition");
     esp_err_t ret = esp_spiffs_format(partition_label);
+#endif
     
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG_STORAGE, "Failed to format SPIFFS (%s)", esp_err_to_name(ret));
+        ESP_LOGE(TAG_STORAGE, "Failed to format storage (%s)", esp_err_to_name(ret));
     } else {
-        ESP_LOGI(TAG_STORAGE, "SPIFFS formatted successfully");
+        ESP_LOGI(TAG_STORAGE, "Storage formatted successfully");
     }
     
     return ret;
-}
\ No newline at end of file
+}
@@ -0,0 +1,17 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_tslog_preallocated_reopen(void);
+void test_um_tslog_torn_record(void);
+void test_um_tslog_flush_failure_counted(void);
+void test_um_tslog_benchmark(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_tslog_preallocated_reopen);
+    RUN_TEST(test_um_tslog_torn_record);
+    RUN_TEST(test_um_tslog_flush_failure_counted);
+    RUN_TEST(test_um_tslog_benchmark);
+    exit(UNITY_END());
+}
@@ -0,0 +1,294 @@
+/*
+ * um_tslog: заранее выделенные сегменты, восстановление после сброса,
+ * учёт потерь при ошибке flush и бенчмарк против текстового
+ * um_storage_append_file().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "unity.h"
+#include "esp_timer.h"
+#include "um_storage.h"
+#include "um_tslog.h"
+
+#define T0 1700000000u
+#define SEG_HEADER 16
+#define SEG_RECORDS 128
+
+#define BENCH_RECORDS 4096
+// 16 датчиков раз в 5 минут
+#define BENCH_PER_DAY (16 * 24 * 12)
+// SPIFFS: страница 256 байт, сектор 4 КБ
+#define FLASH_PAGE 256
+#define PAGES_PER_SECTOR 16
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t last_ts;
+    float last_value;
+    bool ordered;
+} query_ctx_t;
+
+static char s_dir[32];
+
+static void new_dir(void)
+{
+    strcpy(s_dir, "/tmp/um_tslog_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(s_dir));
+}
+
+static um_tslog_config_t small_config(void)
+{
+    um_tslog_config_t cfg = UM_TSLOG_DEFAULT_CONFIG();
+    cfg.base_path = s_dir;
+    cfg.name = "t";
+    cfg.segment_count = 3;
+    cfg.segment_records = SEG_RECORDS;
+    cfg.buffer_records = 64;
+    cfg.flush_threshold = 48;
+    cfg.flush_interval_ms = 60 * 1000;
+    return cfg;
+}
+
+static void segment_path(int slot, char *out, size_t out_size)
+{
+    snprintf(out, out_size, "%s/t_%d.tsl", s_dir, slot);
+}
+
+static long segment_size(int slot)
+{
+    char path[64];
+    segment_path(slot, path, sizeof(path));
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static void append_n(uint32_t first, uint32_t n)
+{
+    for (uint32_t i = first; i < first + n; i++)
+    {
+        um_tslog_record_t rec = {
+            .timestamp = T0 + i * 10,
+            .channel = i % 4,
+            .value = i * 0.5f,
+        };
+        TEST_ASSERT_EQUAL(ESP_OK, um_tslog_append_record(&rec));
+        // Буфер не должен переполняться, пока flush-задача занята
+        if ((i + 1) % 32 == 0)
+        {
+            TEST_ASSERT_EQUAL(ESP_OK, um_tslog_flush());
+        }
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_flush());
+}
+
+static bool collect(const um_tslog_record_t *rec, void *arg)
+{
+    query_ctx_t *ctx = arg;
+    if (ctx->count > 0 && rec->timestamp < ctx->last_ts)
+    {
+        ctx->ordered = false;
+    }
+    ctx->count++;
+    ctx->last_ts = rec->timestamp;
+    ctx->last_value = rec->value;
+    return true;
+}
+
+static query_ctx_t query_all(void)
+{
+    query_ctx_t ctx = {.ordered = true};
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_query(0, UINT32_MAX, collect, &ctx));
+    return ctx;
+}
+
+static uint32_t stored(void)
+{
+    um_tslog_stats_t stats;
+    um_tslog_get_stats(&stats);
+    return stats.stored;
+}
+
+void test_um_tslog_preallocated_reopen(void)
+{
+    new_dir();
+    um_tslog_config_t cfg = small_config();
+    const long full = SEG_HEADER + SEG_RECORDS * (long)sizeof(um_tslog_record_t);
+
+    // Сегмент сразу полного размера, а не растёт с каждым flush
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    TEST_ASSERT_EQUAL(full, segment_size(0));
+
+    append_n(0, 200);
+    TEST_ASSERT_EQUAL(200, stored());
+    TEST_ASSERT_EQUAL(full, segment_size(0));
+    TEST_ASSERT_EQUAL(full, segment_size(1));
+    um_tslog_deinit();
+
+    // Число записей восстанавливается по первой пустой записи, не по размеру
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    TEST_ASSERT_EQUAL(200, stored());
+    query_ctx_t q = query_all();
+    TEST_ASSERT_EQUAL(200, q.count);
+    TEST_ASSERT_TRUE(q.ordered);
+    TEST_ASSERT_EQUAL(T0 + 199 * 10, q.last_ts);
+
+    append_n(200, 1);
+    um_tslog_deinit();
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    TEST_ASSERT_EQUAL(201, stored());
+    um_tslog_deinit();
+}
+
+void test_um_tslog_torn_record(void)
+{
+    new_dir();
+    um_tslog_config_t cfg = small_config();
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    append_n(0, 70);
+    um_tslog_deinit();
+
+    // Сброс посреди записи 70: время и канал записаны, значение - нет
+    char path[64];
+    segment_path(0, path, sizeof(path));
+    FILE *f = fopen(path, "r+b");
+    TEST_ASSERT_NOT_NULL(f);
+    um_tslog_record_t torn = {.timestamp = T0 + 700, .channel = 2};
+    memset(&torn.value, 0xFF, sizeof(torn.value));
+    TEST_ASSERT_EQUAL(0, fseek(f, SEG_HEADER + 70 * sizeof(um_tslog_record_t), SEEK_SET));
+    TEST_ASSERT_EQUAL(sizeof(torn), fwrite(&torn, 1, sizeof(torn), f));
+    fclose(f);
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    TEST_ASSERT_EQUAL(70, stored());
+
+    // Следующая запись ложится на место недописанной
+    append_n(70, 1);
+    um_tslog_deinit();
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    query_ctx_t q = query_all();
+    TEST_ASSERT_EQUAL(71, q.count);
+    TEST_ASSERT_EQUAL_FLOAT(35.0f, q.last_value);
+    um_tslog_deinit();
+}
+
+void test_um_tslog_flush_failure_counted(void)
+{
+    new_dir();
+    um_tslog_config_t cfg = small_config();
+
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    append_n(0, SEG_RECORDS - 4);
+
+    // Следующий сегмент не создаётся: 4 записи влезут, 6 потеряются
+    char path[64];
+    segment_path(1, path, sizeof(path));
+    TEST_ASSERT_EQUAL(0, mkdir(path, 0775));
+
+    for (uint32_t i = SEG_RECORDS - 4; i < SEG_RECORDS + 6; i++)
+    {
+        um_tslog_record_t rec = {.timestamp = T0 + i * 10, .value = 1.0f};
+        TEST_ASSERT_EQUAL(ESP_OK, um_tslog_append_record(&rec));
+    }
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_tslog_flush());
+
+    um_tslog_stats_t stats;
+    um_tslog_get_stats(&stats);
+    TEST_ASSERT_EQUAL(1, stats.flush_errors);
+    TEST_ASSERT_EQUAL(6, stats.lost);
+    TEST_ASSERT_EQUAL(SEG_RECORDS, stats.stored);
+    TEST_ASSERT_EQUAL(SEG_RECORDS, stats.flushed);
+    TEST_ASSERT_EQUAL(stats.appended, stats.flushed + stats.lost);
+
+    // После устранения причины журнал пишется дальше
+    rmdir(path);
+    append_n(SEG_RECORDS + 6, 5);
+    TEST_ASSERT_EQUAL(SEG_RECORDS + 5, stored());
+    um_tslog_deinit();
+}
+
+typedef struct
+{
+    long syscw;
+    long wchar;
+    int64_t us;
+} io_sample_t;
+
+// Вызовы write() и записанные байты процесса (Linux)
+static io_sample_t io_sample(void)
+{
+    io_sample_t s = {.us = esp_timer_get_time()};
+    FILE *f = fopen("/proc/self/io", "r");
+    TEST_ASSERT_NOT_NULL(f);
+    char line[64];
+    while (fgets(line, sizeof(line), f))
+    {
+        sscanf(line, "syscw: %ld", &s.syscw);
+        sscanf(line, "wchar: %ld", &s.wchar);
+    }
+    fclose(f);
+    return s;
+}
+
+static void report(const char *name, io_sample_t a, io_sample_t b)
+{
+    long calls = b.syscw - a.syscw;
+    long bytes = b.wchar - a.wchar;
+    // Каждый write() программирует хотя бы одну страницу flash
+    long pages = bytes / FLASH_PAGE > calls ? bytes / FLASH_PAGE : calls;
+    double per_day = (double)BENCH_PER_DAY / BENCH_RECORDS;
+    printf("%-14s %8.0f rec/s %7ld write() %9ld B, >= %.0f sector erases/day\n",
+           name, BENCH_RECORDS * 1e6 / (double)(b.us - a.us), calls, bytes,
+           pages * per_day / PAGES_PER_SECTOR);
+}
+
+void test_um_tslog_benchmark(void)
+{
+    new_dir();
+    char text_path[64];
+    snprintf(text_path, sizeof(text_path), "%s/log.txt", s_dir);
+
+    // Как раньше: открыть, дописать строку, закрыть - на каждую запись
+    io_sample_t a = io_sample();
+    for (uint32_t i = 0; i < BENCH_RECORDS; i++)
+    {
+        char line[48];
+        snprintf(line, sizeof(line), "%lu;%u;%.2f\n",
+                 (unsigned long)(T0 + i * 10), (unsigned)(i % 16), i * 0.5f);
+        TEST_ASSERT_EQUAL(ESP_OK, um_storage_append_file(text_path, line));
+    }
+    io_sample_t b = io_sample();
+    report("text append", a, b);
+    long text_calls = b.syscw - a.syscw;
+
+    // Настройки по умолчанию, включая создание всех сегментов
+    um_tslog_config_t cfg = UM_TSLOG_DEFAULT_CONFIG();
+    cfg.base_path = s_dir;
+    cfg.name = "bench";
+    a = io_sample();
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_init(&cfg));
+    for (uint32_t i = 0; i < BENCH_RECORDS; i++)
+    {
+        um_tslog_record_t rec = {.timestamp = T0 + i * 10, .channel = i % 16, .value = i * 0.5f};
+        // Переполнение буфера тоже измеряется: flush-задача не успевает
+        while (um_tslog_append_record(&rec) == ESP_ERR_NO_MEM)
+        {
+            um_tslog_flush();
+        }
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, um_tslog_flush());
+    b = io_sample();
+    report("um_tslog", a, b);
+    long tslog_calls = b.syscw - a.syscw;
+
+    um_tslog_stats_t stats;
+    um_tslog_get_stats(&stats);
+    TEST_ASSERT_EQUAL(BENCH_RECORDS, stats.stored);
+    um_tslog_deinit();
+
+    TEST_ASSERT_LESS_THAN(text_calls / 10, tslog_calls);
+}
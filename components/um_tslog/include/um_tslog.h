@@ -0,0 +1,152 @@
+/**
+ * @file um_tslog.h
+ * @brief Append-only time-series log with fixed-size binary records
+ * @version 1.0.0
+ *
+ * Записи копятся в RAM и сбрасываются пачкой в сегментные файлы
+ * (кольцо из segment_count файлов по segment_records записей, каждый
+ * создаётся сразу полного размера).
+ * Для каждого сегмента в RAM хранится разреженный индекс по времени,
+ * поэтому выборка по диапазону читает только нужные блоки.
+ */
+
+#ifndef UM_TSLOG_H
+#define UM_TSLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Record timestamp was raised to keep the log ordered */
+#define UM_TSLOG_FLAG_CLAMPED (1 << 0)
+
+/** One index entry per this many records */
+#define UM_TSLOG_INDEX_STRIDE 64
+
+/**
+ * @brief Log record (12 bytes on flash)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp;    /**< Unix time, seconds */
+    uint16_t channel;      /**< Series ID */
+    uint16_t flags;        /**< UM_TSLOG_FLAG_* */
+    float value;
+} um_tslog_record_t;
+
+/**
+ * @brief Log configuration
+ */
+typedef struct {
+    const char* base_path;      /**< Directory, e.g. "/spiffs" */
+    const char* name;           /**< Segment file prefix, e.g. "temp" */
+    uint16_t segment_count;     /**< Segments in the ring */
+    uint16_t segment_records;   /**< Records per segment (multiple of UM_TSLOG_INDEX_STRIDE) */
+    uint16_t buffer_records;    /**< RAM buffer size */
+    uint16_t flush_threshold;   /**< Flush when this many records are buffered */
+    uint32_t flush_interval_ms; /**< Flush at least this often */
+} um_tslog_config_t;
+
+#define UM_TSLOG_DEFAULT_CONFIG() {     \
+    .base_path = "/spiffs",             \
+    .name = "tslog",                    \
+    .segment_count = 8,                 \
+    .segment_records = 1024,            \
+    .buffer_records = 128,              \
+    .flush_threshold = 96,              \
+    .flush_interval_ms = 5 * 60 * 1000, \
+}
+
+/**
+ * @brief Log statistics
+ */
+typedef struct {
+    uint32_t appended;   /**< Records accepted */
+    uint32_t dropped;    /**< Records lost on buffer overflow */
+    uint32_t flushed;    /**< Records written to flash */
+    uint32_t flushes;    /**< Flush operations */
+    uint32_t rotations;  /**< Segments overwritten */
+    uint32_t stored;     /**< Records currently on flash */
+    uint32_t flush_errors; /**< Flushes that failed (write or sync) */
+    uint32_t lost;       /**< Records lost because a flush failed */
+    uint32_t unsynced;   /**< um_tslog_append() calls before the clock was set */
+} um_tslog_stats_t;
+
+/**
+ * @brief Query callback
+ *
+ * @param record Matching record
+ * @param ctx User context
+ * @return true to continue, false to stop
+ */
+typedef bool (*um_tslog_query_cb_t)(const um_tslog_record_t* record, void* ctx);
+
+/**
+ * @brief Open log, rebuild index from existing segments and start flush task
+ *
+ * @param config Configuration (NULL for defaults)
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t um_tslog_init(const um_tslog_config_t* config);
+
+/**
+ * @brief Flush buffer and stop the log
+ */
+void um_tslog_deinit(void);
+
+/**
+ * @brief Append value with current time
+ *
+ * Never touches flash; safe to call from any task. Rejected until the
+ * clock is set (SNTP), otherwise records would be stamped 1970.
+ *
+ * @param channel Series ID
+ * @param value Value
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM if buffer is full,
+ *         ESP_ERR_INVALID_STATE if the log is closed or the clock is not set
+ */
+esp_err_t um_tslog_append(uint16_t channel, float value);
+
+/**
+ * @brief Append prepared record
+ *
+ * @param record Record (timestamp must not go backwards)
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM if buffer is full
+ */
+esp_err_t um_tslog_append_record(const um_tslog_record_t* record);
+
+/**
+ * @brief Write buffered records to flash now
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t um_tslog_flush(void);
+
+/**
+ * @brief Iterate records with from <= timestamp <= to (oldest first)
+ *
+ * Includes records not yet flushed.
+ *
+ * @param from Start time (inclusive)
+ * @param to End time (inclusive)
+ * @param cb Callback per record
+ * @param ctx User context
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t um_tslog_query(uint32_t from, uint32_t to, um_tslog_query_cb_t cb, void* ctx);
+
+/**
+ * @brief Get statistics
+ *
+ * @param[out] stats Statistics
+ */
+void um_tslog_get_stats(um_tslog_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UM_TSLOG_H
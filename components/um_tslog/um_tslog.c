@@ -0,0 +1,798 @@
+/**
+ * @file um_tslog.c
+ * @brief Append-only time-series log with fixed-size binary records
+ * @version 1.0.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "um_tslog.h"
+
+static const char *TAG = "tslog";
+
+#define TSLOG_MAGIC 0x474C5354 // "TSLG"
+#define TSLOG_VERSION 1
+#define TSLOG_PATH_MAX 64
+#define TSLOG_READ_BATCH 16
+
+#define TSLOG_TASK_STACK 3072
+#define TSLOG_TASK_PRIORITY 2
+
+// Сегменты создаются целиком, заполненными 0xFF: незаписанная запись
+#define TSLOG_EMPTY 0xFFFFFFFFu
+
+// Часы считаются установленными (SNTP) после 2020-01-01
+#define TSLOG_TIME_VALID 1577836800u
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t seq; // порядковый номер сегмента, 0 - пустой слот
+    uint32_t reserved;
+} segment_header_t;
+
+/* Состояние сегмента в RAM */
+typedef struct
+{
+    uint32_t seq;
+    uint32_t count;
+    uint32_t first_ts;
+    uint32_t last_ts;
+    uint32_t *index; // index[i] - время записи i * UM_TSLOG_INDEX_STRIDE
+} segment_t;
+
+static struct
+{
+    um_tslog_config_t cfg;
+    char base_path[32];
+    char name[16];
+
+    segment_t *segments;
+    uint16_t current;
+    FILE *current_file; // открыт всё время, чтобы не переоткрывать на каждый flush
+
+    um_tslog_record_t *buffer;
+    um_tslog_record_t *flush_buffer;
+    uint16_t buffered;
+    uint32_t last_ts;
+
+    SemaphoreHandle_t buf_lock; // короткий: только копирование записей
+    SemaphoreHandle_t io_lock;  // flush и запросы
+    SemaphoreHandle_t stopped;
+    TaskHandle_t task;
+    volatile bool running;
+
+    um_tslog_stats_t stats;
+} s_log;
+
+static void segment_path(uint16_t slot, char *out, size_t out_size)
+{
+    snprintf(out, out_size, "%s/%s_%u.tsl", s_log.base_path, s_log.name, slot);
+}
+
+static inline uint16_t index_size(void)
+{
+    return s_log.cfg.segment_records / UM_TSLOG_INDEX_STRIDE;
+}
+
+static inline long record_offset(uint32_t n)
+{
+    return (long)(sizeof(segment_header_t) + n * sizeof(um_tslog_record_t));
+}
+
+static bool read_record(FILE *f, uint32_t n, um_tslog_record_t *rec)
+{
+    return fseek(f, record_offset(n), SEEK_SET) == 0 && fread(rec, 1, sizeof(*rec), f) == sizeof(*rec);
+}
+
+/*
+ * Незаписанная запись (0xFF) или недописанная при сбросе: value пишется
+ * последним, а 0xFFFFFFFF не даёт ни один датчик (это не канонический NaN).
+ */
+static bool record_valid(const um_tslog_record_t *rec)
+{
+    uint32_t value_bits;
+    memcpy(&value_bits, &rec->value, sizeof(value_bits));
+    return rec->timestamp != TSLOG_EMPTY && value_bits != TSLOG_EMPTY;
+}
+
+/**
+ * @brief Rebuild segment state from its file
+ */
+static void scan_segment(uint16_t slot)
+{
+    segment_t *seg = &s_log.segments[slot];
+    char path[TSLOG_PATH_MAX];
+    segment_path(slot, path, sizeof(path));
+
+    seg->seq = 0;
+    seg->count = 0;
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return;
+    }
+
+    segment_header_t hdr;
+    struct stat st;
+    if (fread(&hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+        hdr.magic != TSLOG_MAGIC || hdr.version != TSLOG_VERSION ||
+        hdr.record_size != sizeof(um_tslog_record_t) ||
+        stat(path, &st) != 0)
+    {
+        ESP_LOGW(TAG, "Ignoring invalid segment %s", path);
+        fclose(f);
+        return;
+    }
+
+    // Сегменты старого формата не заполнены заранее: конец - по размеру
+    uint32_t limit = (st.st_size - sizeof(hdr)) / sizeof(um_tslog_record_t);
+    if (limit > s_log.cfg.segment_records)
+    {
+        limit = s_log.cfg.segment_records;
+    }
+
+    // Начала блоков заодно заполняют индекс
+    um_tslog_record_t rec;
+    uint32_t lo = 0;
+    uint32_t hi = limit;
+    for (uint32_t i = 0; i < limit; i += UM_TSLOG_INDEX_STRIDE)
+    {
+        if (!read_record(f, i, &rec) || !record_valid(&rec))
+        {
+            hi = i;
+            break;
+        }
+        seg->index[i / UM_TSLOG_INDEX_STRIDE] = rec.timestamp;
+        lo = i + 1;
+    }
+
+    // Записи идут подряд: первая незаписанная внутри последнего блока
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (read_record(f, mid, &rec) && record_valid(&rec))
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    uint32_t count = lo;
+
+    if (count > 0 && read_record(f, count - 1, &rec))
+    {
+        seg->first_ts = seg->index[0];
+        seg->last_ts = rec.timestamp;
+    }
+    else
+    {
+        count = 0;
+    }
+
+    fclose(f);
+    seg->seq = hdr.seq;
+    seg->count = count;
+}
+
+/**
+ * @brief Write header and fill the whole segment with empty records
+ *
+ * Файл сразу получает полный размер: flush дальше перезаписывает место
+ * внутри файла, а не наращивает его (без выделения блоков и обновления
+ * метаданных ФС на каждую пачку).
+ */
+static esp_err_t preallocate(FILE *f, uint32_t seq)
+{
+    segment_header_t hdr = {
+        .magic = TSLOG_MAGIC,
+        .version = TSLOG_VERSION,
+        .record_size = sizeof(um_tslog_record_t),
+        .seq = seq,
+    };
+    if (fwrite(&hdr, 1, sizeof(hdr), f) != sizeof(hdr))
+    {
+        return ESP_FAIL;
+    }
+
+    um_tslog_record_t empty[TSLOG_READ_BATCH];
+    memset(empty, 0xFF, sizeof(empty));
+    for (uint32_t n = 0; n < s_log.cfg.segment_records; n += TSLOG_READ_BATCH)
+    {
+        uint32_t k = s_log.cfg.segment_records - n;
+        if (k > TSLOG_READ_BATCH)
+        {
+            k = TSLOG_READ_BATCH;
+        }
+        if (fwrite(empty, sizeof(um_tslog_record_t), k, f) != k)
+        {
+            return ESP_FAIL;
+        }
+    }
+
+    return (fflush(f) == 0 && fsync(fileno(f)) == 0) ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Open current segment for writing (creates it if needed)
+ */
+static esp_err_t open_current(bool create)
+{
+    char path[TSLOG_PATH_MAX];
+    segment_path(s_log.current, path, sizeof(path));
+
+    if (s_log.current_file != NULL)
+    {
+        fclose(s_log.current_file);
+        s_log.current_file = NULL;
+    }
+
+    FILE *f = fopen(path, create ? "w+b" : "r+b");
+    if (f == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to open segment %s", path);
+        return ESP_FAIL;
+    }
+
+    if (create && preallocate(f, s_log.segments[s_log.current].seq) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to allocate segment %s", path);
+        fclose(f);
+        return ESP_FAIL;
+    }
+
+    s_log.current_file = f;
+    return ESP_OK;
+}
+
+/**
+ * @brief Move to the next slot, overwriting the oldest segment
+ */
+static esp_err_t rotate(void)
+{
+    uint32_t seq = s_log.segments[s_log.current].seq + 1;
+    s_log.current = (s_log.current + 1) % s_log.cfg.segment_count;
+
+    segment_t *seg = &s_log.segments[s_log.current];
+    if (seg->seq != 0)
+    {
+        s_log.stats.stored -= seg->count;
+        s_log.stats.rotations++;
+    }
+    seg->seq = seq;
+    seg->count = 0;
+
+    return open_current(true);
+}
+
+/**
+ * @brief Write records to flash (io_lock held)
+ *
+ * @param[out] written Records stored (also on error)
+ */
+static esp_err_t write_records(const um_tslog_record_t *recs, uint16_t n, uint16_t *written)
+{
+    *written = 0;
+    while (n > 0)
+    {
+        // Прошлая попытка создать сегмент не удалась
+        if (s_log.current_file == NULL && open_current(true) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
+
+        segment_t *seg = &s_log.segments[s_log.current];
+        if (seg->count >= s_log.cfg.segment_records)
+        {
+            esp_err_t err = rotate();
+            if (err != ESP_OK)
+            {
+                return err;
+            }
+            seg = &s_log.segments[s_log.current];
+        }
+
+        uint32_t k = s_log.cfg.segment_records - seg->count;
+        if (k > n)
+        {
+            k = n;
+        }
+
+        FILE *f = s_log.current_file;
+        if (fseek(f, record_offset(seg->count), SEEK_SET) != 0 ||
+            fwrite(recs, sizeof(um_tslog_record_t), k, f) != k)
+        {
+            ESP_LOGE(TAG, "Failed to write %lu records", (unsigned long)k);
+            return ESP_FAIL;
+        }
+
+        for (uint32_t i = 0; i < k; i++)
+        {
+            uint32_t pos = seg->count + i;
+            if (pos % UM_TSLOG_INDEX_STRIDE == 0)
+            {
+                seg->index[pos / UM_TSLOG_INDEX_STRIDE] = recs[i].timestamp;
+            }
+        }
+        if (seg->count == 0)
+        {
+            seg->first_ts = recs[0].timestamp;
+        }
+        seg->last_ts = recs[k - 1].timestamp;
+        seg->count += k;
+        s_log.stats.stored += k;
+        *written += k;
+
+        recs += k;
+        n -= k;
+    }
+
+    if (fflush(s_log.current_file) != 0 || fsync(fileno(s_log.current_file)) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to sync segment");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t flush_locked(void)
+{
+    xSemaphoreTake(s_log.buf_lock, portMAX_DELAY);
+    uint16_t n = s_log.buffered;
+    memcpy(s_log.flush_buffer, s_log.buffer, n * sizeof(um_tslog_record_t));
+    s_log.buffered = 0;
+    xSemaphoreGive(s_log.buf_lock);
+
+    if (n == 0)
+    {
+        return ESP_OK;
+    }
+
+    uint16_t written;
+    esp_err_t err = write_records(s_log.flush_buffer, n, &written);
+
+    xSemaphoreTake(s_log.buf_lock, portMAX_DELAY);
+    s_log.stats.flushed += written;
+    s_log.stats.flushes++;
+    if (err != ESP_OK)
+    {
+        // Записи уже вынуты из буфера: повторить их нельзя
+        s_log.stats.flush_errors++;
+        s_log.stats.lost += n - written;
+    }
+    xSemaphoreGive(s_log.buf_lock);
+
+    if (err == ESP_OK)
+    {
+        ESP_LOGD(TAG, "Flushed %u records", n);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Flush failed, %u of %u records lost", n - written, n);
+    }
+    return err;
+}
+
+esp_err_t um_tslog_flush(void)
+{
+    if (s_log.io_lock == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_log.io_lock, portMAX_DELAY);
+    esp_err_t err = flush_locked();
+    xSemaphoreGive(s_log.io_lock);
+    return err;
+}
+
+static void flush_task(void *arg)
+{
+    while (s_log.running)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(s_log.cfg.flush_interval_ms));
+        um_tslog_flush();
+    }
+
+    xSemaphoreGive(s_log.stopped);
+    vTaskDelete(NULL);
+}
+
+static void free_state(void)
+{
+    if (s_log.segments != NULL)
+    {
+        free(s_log.segments[0].index);
+    }
+    free(s_log.segments);
+    free(s_log.buffer);
+    free(s_log.flush_buffer);
+    if (s_log.buf_lock != NULL)
+    {
+        vSemaphoreDelete(s_log.buf_lock);
+    }
+    if (s_log.io_lock != NULL)
+    {
+        vSemaphoreDelete(s_log.io_lock);
+    }
+    if (s_log.stopped != NULL)
+    {
+        vSemaphoreDelete(s_log.stopped);
+    }
+    memset(&s_log, 0, sizeof(s_log));
+}
+
+esp_err_t um_tslog_init(const um_tslog_config_t *config)
+{
+    if (s_log.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    um_tslog_config_t defaults = UM_TSLOG_DEFAULT_CONFIG();
+    s_log.cfg = config ? *config : defaults;
+    um_tslog_config_t *cfg = &s_log.cfg;
+
+    if (cfg->base_path == NULL || cfg->name == NULL || cfg->segment_count < 2 ||
+        cfg->segment_records == 0 || cfg->segment_records % UM_TSLOG_INDEX_STRIDE != 0 ||
+        cfg->buffer_records == 0 || cfg->flush_threshold == 0 ||
+        cfg->flush_threshold > cfg->buffer_records)
+    {
+        ESP_LOGE(TAG, "Invalid configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    strncpy(s_log.base_path, cfg->base_path, sizeof(s_log.base_path) - 1);
+    strncpy(s_log.name, cfg->name, sizeof(s_log.name) - 1);
+    cfg->base_path = s_log.base_path;
+    cfg->name = s_log.name;
+
+    s_log.segments = calloc(cfg->segment_count, sizeof(segment_t));
+    uint32_t *index = calloc((size_t)cfg->segment_count * index_size(), sizeof(uint32_t));
+    s_log.buffer = malloc(cfg->buffer_records * sizeof(um_tslog_record_t));
+    s_log.flush_buffer = malloc(cfg->buffer_records * sizeof(um_tslog_record_t));
+    s_log.buf_lock = xSemaphoreCreateMutex();
+    s_log.io_lock = xSemaphoreCreateMutex();
+    s_log.stopped = xSemaphoreCreateBinary();
+
+    if (s_log.segments == NULL || index == NULL || s_log.buffer == NULL ||
+        s_log.flush_buffer == NULL || s_log.buf_lock == NULL ||
+        s_log.io_lock == NULL || s_log.stopped == NULL)
+    {
+        free(index);
+        free_state();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Восстанавливаем состояние и индексы по существующим сегментам
+    uint32_t max_seq = 0;
+    for (uint16_t i = 0; i < cfg->segment_count; i++)
+    {
+        s_log.segments[i].index = index + (size_t)i * index_size();
+        scan_segment(i);
+        s_log.stats.stored += s_log.segments[i].count;
+        if (s_log.segments[i].seq > max_seq)
+        {
+            max_seq = s_log.segments[i].seq;
+            s_log.current = i;
+        }
+    }
+
+    esp_err_t err;
+    if (max_seq == 0)
+    {
+        s_log.current = 0;
+        s_log.segments[0].seq = 1;
+        err = open_current(true);
+    }
+    else
+    {
+        s_log.last_ts = s_log.segments[s_log.current].last_ts;
+        err = open_current(false);
+    }
+
+    if (err != ESP_OK)
+    {
+        free_state();
+        return err;
+    }
+
+    s_log.running = true;
+    if (xTaskCreate(flush_task, "tslog_flush", TSLOG_TASK_STACK, NULL,
+                    TSLOG_TASK_PRIORITY, &s_log.task) != pdPASS)
+    {
+        fclose(s_log.current_file);
+        free_state();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Opened %s/%s: %lu records in %u segments",
+             s_log.base_path, s_log.name,
+             (unsigned long)s_log.stats.stored, cfg->segment_count);
+    return ESP_OK;
+}
+
+void um_tslog_deinit(void)
+{
+    if (!s_log.running)
+    {
+        return;
+    }
+
+    s_log.running = false;
+    xTaskNotifyGive(s_log.task);
+    xSemaphoreTake(s_log.stopped, portMAX_DELAY);
+
+    // Задача уже сделала последний flush
+    if (s_log.current_file != NULL)
+    {
+        fclose(s_log.current_file);
+    }
+
+    free_state();
+    ESP_LOGI(TAG, "Closed");
+}
+
+esp_err_t um_tslog_append_record(const um_tslog_record_t *record)
+{
+    if (record == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_log.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bool notify = false;
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(s_log.buf_lock, portMAX_DELAY);
+    if (s_log.buffered >= s_log.cfg.buffer_records)
+    {
+        s_log.stats.dropped++;
+        err = ESP_ERR_NO_MEM;
+    }
+    else
+    {
+        um_tslog_record_t *rec = &s_log.buffer[s_log.buffered++];
+        *rec = *record;
+
+        // Такое значение выглядит как незаписанная запись (см. record_valid)
+        if (!record_valid(rec) && rec->timestamp != TSLOG_EMPTY)
+        {
+            rec->value = NAN;
+        }
+
+        // Индекс требует неубывающего времени (например, до синхронизации NTP)
+        if (rec->timestamp < s_log.last_ts)
+        {
+            rec->timestamp = s_log.last_ts;
+            rec->flags |= UM_TSLOG_FLAG_CLAMPED;
+        }
+        s_log.last_ts = rec->timestamp;
+        s_log.stats.appended++;
+
+        notify = (s_log.buffered == s_log.cfg.flush_threshold);
+    }
+    xSemaphoreGive(s_log.buf_lock);
+
+    if (notify)
+    {
+        xTaskNotifyGive(s_log.task);
+    }
+    return err;
+}
+
+esp_err_t um_tslog_append(uint16_t channel, float value)
+{
+    time_t now = time(NULL);
+    if (now < TSLOG_TIME_VALID)
+    {
+        // Без SNTP время с 1970 года испортило бы индекс
+        if (s_log.running)
+        {
+            xSemaphoreTake(s_log.buf_lock, portMAX_DELAY);
+            s_log.stats.unsynced++;
+            xSemaphoreGive(s_log.buf_lock);
+        }
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    um_tslog_record_t rec = {
+        .timestamp = (uint32_t)now,
+        .channel = channel,
+        .flags = 0,
+        .value = value,
+    };
+    return um_tslog_append_record(&rec);
+}
+
+/**
+ * @brief First block that may contain records >= from
+ */
+static uint32_t find_start_block(const segment_t *seg, uint32_t from)
+{
+    uint32_t blocks = (seg->count + UM_TSLOG_INDEX_STRIDE - 1) / UM_TSLOG_INDEX_STRIDE;
+    uint32_t lo = 0;
+    uint32_t hi = blocks;
+
+    // Ищем первый блок, начинающийся не раньше from; нужный - перед ним
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (seg->index[mid] < from)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+/**
+ * @brief Scan one segment, returns false if callback asked to stop
+ */
+static bool query_segment(uint16_t slot, uint32_t from, uint32_t to,
+                          um_tslog_query_cb_t cb, void *ctx, esp_err_t *err)
+{
+    const segment_t *seg = &s_log.segments[slot];
+    char path[TSLOG_PATH_MAX];
+    segment_path(slot, path, sizeof(path));
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        *err = ESP_FAIL;
+        return true;
+    }
+
+    uint32_t pos = find_start_block(seg, from) * UM_TSLOG_INDEX_STRIDE;
+    bool more = true;
+    um_tslog_record_t batch[TSLOG_READ_BATCH];
+
+    if (fseek(f, record_offset(pos), SEEK_SET) != 0)
+    {
+        *err = ESP_FAIL;
+        fclose(f);
+        return true;
+    }
+
+    while (more && pos < seg->count)
+    {
+        uint32_t n = seg->count - pos;
+        if (n > TSLOG_READ_BATCH)
+        {
+            n = TSLOG_READ_BATCH;
+        }
+        if (fread(batch, sizeof(um_tslog_record_t), n, f) != n)
+        {
+            *err = ESP_FAIL;
+            break;
+        }
+        pos += n;
+
+        for (uint32_t i = 0; i < n && more; i++)
+        {
+            if (batch[i].timestamp > to)
+            {
+                fclose(f);
+                return false;
+            }
+            if (batch[i].timestamp >= from)
+            {
+                more = cb(&batch[i], ctx);
+            }
+        }
+    }
+
+    fclose(f);
+    return more;
+}
+
+esp_err_t um_tslog_query(uint32_t from, uint32_t to, um_tslog_query_cb_t cb, void *ctx)
+{
+    if (cb == NULL || from > to)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_log.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_OK;
+    bool more = true;
+
+    // Пока держим io_lock, flush не заберёт записи из буфера
+    xSemaphoreTake(s_log.io_lock, portMAX_DELAY);
+
+    // Самый старый сегмент - следующий за текущим
+    for (uint16_t i = 1; i <= s_log.cfg.segment_count && more; i++)
+    {
+        uint16_t slot = (s_log.current + i) % s_log.cfg.segment_count;
+        const segment_t *seg = &s_log.segments[slot];
+
+        if (seg->seq == 0 || seg->count == 0 || seg->last_ts < from)
+        {
+            continue;
+        }
+        if (seg->first_ts > to)
+        {
+            more = false;
+            break;
+        }
+        more = query_segment(slot, from, to, cb, ctx, &err);
+    }
+
+    // Ещё не сброшенные записи
+    um_tslog_record_t batch[TSLOG_READ_BATCH];
+    uint16_t pos = 0;
+    while (more)
+    {
+        xSemaphoreTake(s_log.buf_lock, portMAX_DELAY);
+        uint16_t n = s_log.buffered - pos;
+        if (n > TSLOG_READ_BATCH)
+        {
+            n = TSLOG_READ_BATCH;
+        }
+        memcpy(batch, &s_log.buffer[pos], n * sizeof(um_tslog_record_t));
+        xSemaphoreGive(s_log.buf_lock);
+
+        if (n == 0)
+        {
+            break;
+        }
+        pos += n;
+
+        for (uint16_t i = 0; i < n && more; i++)
+        {
+            if (batch[i].timestamp > to)
+            {
+                more = false;
+            }
+            else if (batch[i].timestamp >= from)
+            {
+                more = cb(&batch[i], ctx);
+            }
+        }
+    }
+
+    xSemaphoreGive(s_log.io_lock);
+    return err;
+}
+
+void um_tslog_get_stats(um_tslog_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    if (s_log.buf_lock == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    xSemaphoreTake(s_log.buf_lock, portMAX_DELAY);
+    *stats = s_log.stats;
+    xSemaphoreGive(s_log.buf_lock);
+}
@@ -0,0 +1,130 @@
+/*
+ * Подмены httpd, нужные нескольким тестам: заголовки запроса задаёт тест,
+ * ответ через httpd_resp_* запоминается, а не уходит в сокет.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "test_httpd.h"
+
+#define MAX_HEADERS 4
+
+static struct
+{
+    const char *field;
+    const char *value;
+} s_headers[MAX_HEADERS];
+
+test_httpd_resp_t test_httpd_resp;
+test_httpd_body_t test_httpd_body;
+
+void test_httpd_set_header(const char *field, const char *value)
+{
+    int free_slot = -1;
+    for (int i = 0; i < MAX_HEADERS; i++)
+    {
+        if (s_headers[i].field && strcmp(s_headers[i].field, field) == 0)
+        {
+            s_headers[i].value = value;
+            s_headers[i].field = value ? field : NULL;
+            return;
+        }
+        if (!s_headers[i].field && free_slot < 0)
+        {
+            free_slot = i;
+        }
+    }
+    if (value)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL(0, free_slot);
+        s_headers[free_slot].field = field;
+        s_headers[free_slot].value = value;
+    }
+}
+
+void test_httpd_reset(void)
+{
+    memset(s_headers, 0, sizeof(s_headers));
+    memset(&test_httpd_resp, 0, sizeof(test_httpd_resp));
+    memset(&test_httpd_body, 0, sizeof(test_httpd_body));
+}
+
+esp_err_t __wrap_httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t size)
+{
+    for (int i = 0; i < MAX_HEADERS; i++)
+    {
+        if (s_headers[i].field && strcmp(s_headers[i].field, field) == 0)
+        {
+            snprintf(val, size, "%s", s_headers[i].value);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int __wrap_httpd_req_recv(httpd_req_t *req, char *buf, size_t len)
+{
+    test_httpd_body_t *b = &test_httpd_body;
+    b->calls++;
+    if (b->pos == b->len)
+    {
+        return b->stall ? HTTPD_SOCK_ERR_TIMEOUT : 0;
+    }
+    if (b->waited < b->timeouts)
+    {
+        b->waited++;
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    b->waited = 0;
+    size_t n = b->len - b->pos;
+    n = n < len ? n : len;
+    n = b->piece && n > b->piece ? b->piece : n;
+    memcpy(buf, b->data + b->pos, n);
+    b->pos += n;
+    return n;
+}
+
+esp_err_t __wrap_httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    test_httpd_resp.err_sent = true;
+    test_httpd_resp.err = error;
+    test_httpd_resp.sends++;
+    return ESP_OK;
+}
+
+esp_err_t __wrap_httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    test_httpd_resp.status = status;
+    return ESP_OK;
+}
+
+esp_err_t __wrap_httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    test_httpd_resp.type = type;
+    return ESP_OK;
+}
+
+esp_err_t __wrap_httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    if (strcmp(field, "ETag") == 0)
+    {
+        snprintf(test_httpd_resp.etag, sizeof(test_httpd_resp.etag), "%s", value);
+    }
+    else if (strcmp(field, "Cache-Control") == 0)
+    {
+        test_httpd_resp.cache_control = value;
+    }
+    return ESP_OK;
+}
+
+esp_err_t __wrap_httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len)
+{
+    test_httpd_resp.len = !buf ? 0 : len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)len;
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(test_httpd_resp.body), test_httpd_resp.len);
+    if (test_httpd_resp.len)
+    {
+        memcpy(test_httpd_resp.body, buf, test_httpd_resp.len);
+    }
+    test_httpd_resp.sends++;
+    return ESP_OK;
+}
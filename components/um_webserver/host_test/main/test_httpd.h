@@ -0,0 +1,50 @@
+#pragma once
+
+// Общие подмены httpd для тестов: заголовки и тело запроса, ответ без сокета
+// (-Wl,--wrap=httpd_req_get_hdr_value_str, httpd_req_recv, httpd_resp_*, см. CMakeLists.txt)
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_http_server.h"
+
+/** Ответ, собранный подменами httpd_resp_* */
+typedef struct
+{
+    const char *status; // NULL - не задан (httpd отправит 200 OK)
+    bool err_sent;      // был httpd_resp_send_err()
+    httpd_err_code_t err;
+    const char *type;
+    const char *cache_control;
+    // Копии: ETag и тело могут жить только до возврата обработчика
+    char etag[16];
+    char body[8192];
+    size_t len;
+    int sends;
+} test_httpd_resp_t;
+
+extern test_httpd_resp_t test_httpd_resp;
+
+/** Тело запроса, которое отдаёт httpd_req_recv() */
+typedef struct
+{
+    const char *data;
+    size_t len;   // столько клиент успеет прислать; дальше - обрыв или stall
+    size_t piece; // не больше стольких байт за вызов, 0 - сколько просят
+    int timeouts; // HTTPD_SOCK_ERR_TIMEOUT перед каждым куском
+    bool stall;   // после len - таймауты, а не обрыв соединения
+    size_t pos;
+    int waited; // таймаутов перед текущим куском
+    int calls;
+} test_httpd_body_t;
+
+extern test_httpd_body_t test_httpd_body;
+
+/**
+ * @brief Задать заголовок запроса (NULL - убрать)
+ */
+void test_httpd_set_header(const char *field, const char *value);
+
+/**
+ * @brief Убрать все заголовки запроса и забыть прошлый ответ
+ */
+void test_httpd_reset(void);
@@ -0,0 +1,41 @@
+#include <stdlib.h>
+#include "unity.h"
+
+void test_um_json_writer_matches_cjson(void);
+void test_um_json_writer_heap_ttfb(void);
+void test_um_webserver_files_50mb(void);
+void test_um_webserver_files_put(void);
+void test_um_webserver_ws_fanout(void);
+void test_um_webserver_ws_slow_client(void);
+void test_um_webserver_cache_key_etag(void);
+void test_um_webserver_cache_invalidate(void);
+void test_um_webserver_cache_lru(void);
+void test_um_webserver_body_limit(void);
+void test_um_webserver_body_short_reads(void);
+void test_um_webserver_body_closed(void);
+void test_um_webserver_body_timeout(void);
+void test_um_webserver_auth_login(void);
+void test_um_webserver_auth_credentials(void);
+void test_um_webserver_auth_bench(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_um_json_writer_matches_cjson);
+    RUN_TEST(test_um_json_writer_heap_ttfb);
+    RUN_TEST(test_um_webserver_files_50mb);
+    RUN_TEST(test_um_webserver_files_put);
+    RUN_TEST(test_um_webserver_ws_fanout);
+    RUN_TEST(test_um_webserver_ws_slow_client);
+    RUN_TEST(test_um_webserver_cache_key_etag);
+    RUN_TEST(test_um_webserver_cache_invalidate);
+    RUN_TEST(test_um_webserver_cache_lru);
+    RUN_TEST(test_um_webserver_body_limit);
+    RUN_TEST(test_um_webserver_body_short_reads);
+    RUN_TEST(test_um_webserver_body_closed);
+    RUN_TEST(test_um_webserver_body_timeout);
+    RUN_TEST(test_um_webserver_auth_login);
+    RUN_TEST(test_um_webserver_auth_credentials);
+    RUN_TEST(test_um_webserver_auth_bench);
+    exit(UNITY_END());
+}
@@ -0,0 +1,269 @@
+/*
+ * um_json_writer: тот же документ, что и cJSON, но без кучи и с первыми
+ * байтами до окончания сборки ответа.
+ *
+ * Ответ - GET /api/onewire на ONEWIRE_MAX_SENSORS датчиков в конверте
+ * {"success":true,"data":[...]}. Куча считается обёртками malloc/free
+ * (-Wl,--wrap, см. CMakeLists.txt), TTFB - время до первого вызова
+ * приёмника (httpd_resp_send_chunk на устройстве).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "unity.h"
+#include "cJSON.h"
+#include "esp_timer.h"
+#include "um_json_writer.h"
+
+#define SENSORS 16
+#define RUNS 200
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static long s_heap_live;
+static long s_heap_peak;
+
+static void heap_track(long delta)
+{
+    long live = __atomic_add_fetch(&s_heap_live, delta, __ATOMIC_RELAXED);
+    long peak = __atomic_load_n(&s_heap_peak, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&s_heap_peak, &peak, live, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *p = __real_malloc(size);
+    if (p)
+        heap_track(malloc_usable_size(p));
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *p = __real_calloc(n, size);
+    if (p)
+        heap_track(malloc_usable_size(p));
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    long old = ptr ? (long)malloc_usable_size(ptr) : 0;
+    void *p = __real_realloc(ptr, size);
+    if (p)
+        heap_track((long)malloc_usable_size(p) - old);
+    return p;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr)
+        heap_track(-(long)malloc_usable_size(ptr));
+    __real_free(ptr);
+}
+
+// Для остальных тестов приложения (test_um_webserver_ws.c)
+long test_heap_live(void)
+{
+    return __atomic_load_n(&s_heap_live, __ATOMIC_RELAXED);
+}
+
+static long heap_mark(void)
+{
+    long live = __atomic_load_n(&s_heap_live, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_heap_peak, live, __ATOMIC_RELAXED);
+    return live;
+}
+
+static long heap_peak_since(long base)
+{
+    return __atomic_load_n(&s_heap_peak, __ATOMIC_RELAXED) - base;
+}
+
+typedef struct
+{
+    char serial[17];
+    const char *type;
+    bool active;
+    double temperature;
+    double calibration;
+    char label[32];
+    const char *location;
+} sensor_t;
+
+static sensor_t s_sensors[SENSORS];
+
+// Приёмник вместо сокета: копит ответ и время первого вызова
+typedef struct
+{
+    char out[4096];
+    size_t len;
+    int64_t start_us;
+    int64_t first_us;
+} sink_t;
+
+static esp_err_t sink_write(void *ctx, const char *data, size_t len)
+{
+    sink_t *sink = ctx;
+    if (sink->first_us == 0)
+    {
+        sink->first_us = esp_timer_get_time() - sink->start_us;
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(sink->out), sink->len + len);
+    memcpy(sink->out + sink->len, data, len);
+    sink->len += len;
+    return ESP_OK;
+}
+
+static void make_sensors(void)
+{
+    for (int i = 0; i < SENSORS; i++)
+    {
+        sensor_t *s = &s_sensors[i];
+        snprintf(s->serial, sizeof(s->serial), "28FF%012X", 0x641E8C00 + i);
+        s->type = "DS18B20";
+        s->active = (i % 5) != 4;
+        s->temperature = 18.0625 + i * 0.5;
+        s->calibration = -0.25;
+        snprintf(s->label, sizeof(s->label), "Sensor \"%d\"", i + 1);
+        s->location = (i % 3) ? "Boiler room" : NULL;
+    }
+}
+
+// Как get_onewire_state() в um_webserver.c
+static esp_err_t write_stream(sink_t *sink)
+{
+    um_json_writer_t w;
+    sink->len = 0;
+    sink->first_us = 0;
+    sink->start_us = esp_timer_get_time();
+    um_json_writer_init(&w, sink_write, sink);
+
+    um_json_obj_begin(&w);
+    um_json_kv_bool(&w, "success", true);
+    um_json_key(&w, "data");
+    um_json_arr_begin(&w);
+    for (int i = 0; i < SENSORS; i++)
+    {
+        const sensor_t *s = &s_sensors[i];
+        um_json_obj_begin(&w);
+        um_json_kv_str(&w, "serial", s->serial);
+        um_json_kv_str(&w, "type", s->type);
+        um_json_kv_bool(&w, "active", s->active);
+        um_json_kv_num(&w, "temperature", s->temperature);
+        um_json_kv_num(&w, "calibration", s->calibration);
+        um_json_kv_str(&w, "label", s->label);
+        um_json_kv_str(&w, "location", s->location);
+        um_json_obj_end(&w);
+    }
+    um_json_arr_end(&w);
+    um_json_obj_end(&w);
+    return um_json_writer_finish(&w);
+}
+
+// Как прежний um_webserver_base_get_handler: дерево, строка, отправка
+static esp_err_t write_tree(sink_t *sink)
+{
+    sink->len = 0;
+    sink->first_us = 0;
+    sink->start_us = esp_timer_get_time();
+
+    cJSON *root = cJSON_CreateObject();
+    TEST_ASSERT_NOT_NULL(root);
+    cJSON_AddBoolToObject(root, "success", true);
+    cJSON *data = cJSON_AddArrayToObject(root, "data");
+    for (int i = 0; i < SENSORS; i++)
+    {
+        const sensor_t *s = &s_sensors[i];
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "serial", s->serial);
+        cJSON_AddStringToObject(item, "type", s->type);
+        cJSON_AddBoolToObject(item, "active", s->active);
+        cJSON_AddNumberToObject(item, "temperature", s->temperature);
+        cJSON_AddNumberToObject(item, "calibration", s->calibration);
+        cJSON_AddStringToObject(item, "label", s->label);
+        if (s->location)
+        {
+            cJSON_AddStringToObject(item, "location", s->location);
+        }
+        else
+        {
+            cJSON_AddNullToObject(item, "location");
+        }
+        cJSON_AddItemToArray(data, item);
+    }
+    char *text = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    TEST_ASSERT_NOT_NULL(text);
+    esp_err_t ret = sink_write(sink, text, strlen(text));
+    free(text);
+    return ret;
+}
+
+static cJSON *parse_sink(sink_t *sink)
+{
+    sink->out[sink->len] = '\0';
+    cJSON *json = cJSON_Parse(sink->out);
+    TEST_ASSERT_NOT_NULL(json);
+    return json;
+}
+
+void test_um_json_writer_matches_cjson(void)
+{
+    static sink_t stream, tree;
+    make_sensors();
+    TEST_ASSERT_EQUAL(ESP_OK, write_stream(&stream));
+    TEST_ASSERT_EQUAL(ESP_OK, write_tree(&tree));
+
+    cJSON *a = parse_sink(&stream);
+    cJSON *b = parse_sink(&tree);
+    TEST_ASSERT_TRUE(cJSON_Compare(a, b, true));
+    cJSON_Delete(a);
+    cJSON_Delete(b);
+}
+
+void test_um_json_writer_heap_ttfb(void)
+{
+    static sink_t stream, tree;
+    make_sensors();
+
+    long stream_peak = 0, tree_peak = 0;
+    int64_t stream_ttfb = 0, tree_ttfb = 0;
+    int64_t stream_total = 0, tree_total = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        long base = heap_mark();
+        int64_t start = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(ESP_OK, write_stream(&stream));
+        stream_total += esp_timer_get_time() - start;
+        stream_ttfb += stream.first_us;
+        long peak = heap_peak_since(base);
+        stream_peak = peak > stream_peak ? peak : stream_peak;
+
+        base = heap_mark();
+        start = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(ESP_OK, write_tree(&tree));
+        tree_total += esp_timer_get_time() - start;
+        tree_ttfb += tree.first_us;
+        peak = heap_peak_since(base);
+        tree_peak = peak > tree_peak ? peak : tree_peak;
+    }
+
+    printf("/api/onewire, %d sensors, %u bytes, writer buffer %d B, stack %u B\n", SENSORS,
+           (unsigned)stream.len, UM_JSON_WRITER_BUF_SIZE, (unsigned)sizeof(um_json_writer_t));
+    printf("um_json_writer:           peak heap %5ld B, TTFB %6.1f us, total %6.1f us\n", stream_peak,
+           (double)stream_ttfb / RUNS, (double)stream_total / RUNS);
+    printf("cJSON + PrintUnformatted: peak heap %5ld B, TTFB %6.1f us, total %6.1f us\n", tree_peak,
+           (double)tree_ttfb / RUNS, (double)tree_total / RUNS);
+
+    TEST_ASSERT_EQUAL(0, stream_peak);
+    TEST_ASSERT_GREATER_THAN((long)stream.len, tree_peak);
+    TEST_ASSERT_LESS_THAN(tree_ttfb, stream_ttfb);
+}
@@ -0,0 +1,302 @@
+/*
+ * Авторизация API (um_webserver_auth.c): вход, сессии и подписанные токены,
+ * учётные данные в памяти до UMNI_EVENT_CONFIG_SAVED, время проверки на запрос.
+ *
+ * NVS подменена (-Wl,--wrap=um_nvs_*): тест задаёт логин и пароль и считает
+ * чтения. HMAC и SHA-256 - настоящий mbedtls; время - на хосте, на ESP32
+ * оно другое, но по нему видно, что в проверке нет NVS и malloc.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "cJSON.h"
+#include "esp_timer.h"
+#include "um_events.h"
+#include "um_nvs.h"
+#include "um_webserver.h"
+#include "test_httpd.h"
+
+#define BENCH_REQUESTS 20000
+
+um_event_handler_t test_event_handler(int32_t event_id); // test_um_webserver_cache.c
+
+// um_webserver_priv.h
+esp_err_t um_webserver_auth_start(void);
+void um_webserver_auth_stop(void);
+esp_err_t um_webserver_auth_check(httpd_req_t *req);
+esp_err_t um_webserver_auth_login(httpd_req_t *req, cJSON *input, cJSON **output);
+esp_err_t um_webserver_auth_logout(httpd_req_t *req, cJSON *input, cJSON **output);
+
+/* --- NVS --- */
+
+static struct
+{
+    bool installed;
+    const char *username;
+    const char *password;
+    uint8_t key[32];
+    bool has_key;
+    int loads; // um_nvs_is_installed(): одно на перечитывание учётных данных
+    int reads; // все чтения
+} s_nvs;
+
+bool __wrap_um_nvs_is_installed(void)
+{
+    s_nvs.loads++;
+    s_nvs.reads++;
+    return s_nvs.installed;
+}
+
+static esp_err_t read_str(const char *value, char **out)
+{
+    s_nvs.reads++;
+    if (!value)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *out = strdup(value);
+    return ESP_OK;
+}
+
+esp_err_t __wrap_um_nvs_get_username(char **username)
+{
+    return read_str(s_nvs.username, username);
+}
+
+esp_err_t __wrap_um_nvs_get_password(char **password)
+{
+    return read_str(s_nvs.password, password);
+}
+
+esp_err_t __wrap_um_nvs_read_blob(const char *key, void *out_value, size_t *length)
+{
+    s_nvs.reads++;
+    if (!s_nvs.has_key || *length < sizeof(s_nvs.key))
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memcpy(out_value, s_nvs.key, sizeof(s_nvs.key));
+    *length = sizeof(s_nvs.key);
+    return ESP_OK;
+}
+
+esp_err_t __wrap_um_nvs_write_blob(const char *key, const void *value, size_t length)
+{
+    TEST_ASSERT_EQUAL(sizeof(s_nvs.key), length);
+    memcpy(s_nvs.key, value, length);
+    s_nvs.has_key = true;
+    return ESP_OK;
+}
+
+/* --- Помощники --- */
+
+static httpd_req_t *request(const char *uri, const char *token)
+{
+    static httpd_req_t req;
+    static char bearer[64];
+    snprintf((char *)req.uri, sizeof(req.uri), "%s", uri);
+    req.method = HTTP_GET;
+    test_httpd_reset();
+    if (token)
+    {
+        snprintf(bearer, sizeof(bearer), "Bearer %s", token);
+        test_httpd_set_header("Authorization", bearer);
+    }
+    return &req;
+}
+
+static esp_err_t check(const char *token)
+{
+    return um_webserver_auth_check(request("/api/status", token));
+}
+
+// ESP_OK - токен в token
+static esp_err_t login(const char *username, const char *password, bool stateless, char *token, size_t size)
+{
+    cJSON *input = cJSON_CreateObject();
+    cJSON_AddStringToObject(input, "username", username);
+    cJSON_AddStringToObject(input, "password", password);
+    cJSON_AddBoolToObject(input, "stateless", stateless);
+    cJSON *output = NULL;
+    esp_err_t ret = um_webserver_auth_login(request("/api/login", NULL), input, &output);
+    cJSON_Delete(input);
+    if (ret == ESP_OK)
+    {
+        cJSON *value = cJSON_GetObjectItem(output, "token");
+        TEST_ASSERT_TRUE(cJSON_IsString(value));
+        snprintf(token, size, "%s", value->valuestring);
+    }
+    else
+    {
+        TEST_ASSERT_NULL(output);
+    }
+    cJSON_Delete(output);
+    return ret;
+}
+
+static esp_err_t logout(const char *token, bool all)
+{
+    cJSON *input = cJSON_CreateObject();
+    cJSON_AddBoolToObject(input, "all", all);
+    cJSON *output = NULL;
+    esp_err_t ret = um_webserver_auth_logout(request("/api/logout", token), input, &output);
+    cJSON_Delete(input);
+    cJSON_Delete(output);
+    return ret;
+}
+
+static void config_saved(void)
+{
+    um_event_handler_t handler = test_event_handler(UMNI_EVENT_CONFIG_SAVED);
+    TEST_ASSERT_NOT_NULL(handler);
+    handler(NULL, UMNI_EVENT_BASE, UMNI_EVENT_CONFIG_SAVED, NULL);
+}
+
+static void start(void)
+{
+    memset(&s_nvs, 0, sizeof(s_nvs));
+    s_nvs.installed = true;
+    s_nvs.username = "admin";
+    s_nvs.password = "secret";
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_auth_start());
+}
+
+static void stop(void)
+{
+    um_webserver_auth_stop();
+    TEST_ASSERT_NULL(test_event_handler(UMNI_EVENT_CONFIG_SAVED));
+}
+
+// Среднее время um_webserver_auth_check(), мкс
+static double bench(const char *name, const char *uri, const char *token, esp_err_t expected)
+{
+    httpd_req_t *req = request(uri, token);
+    TEST_ASSERT_EQUAL(expected, um_webserver_auth_check(req));
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < BENCH_REQUESTS; i++)
+    {
+        um_webserver_auth_check(req);
+    }
+    double us = (double)(esp_timer_get_time() - start_us) / BENCH_REQUESTS;
+    printf("auth %-16s %7.2f us/request\n", name, us);
+    return us;
+}
+
+/* --- Тесты --- */
+
+void test_um_webserver_auth_login(void)
+{
+    start();
+    char session[48];
+    char signed_token[48];
+
+    // Неверный логин или пароль - один и тот же ответ
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, login("admin", "wrong", false, session, sizeof(session)));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, login("root", "secret", false, session, sizeof(session)));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, login("admin", "secret2", false, session, sizeof(session)));
+
+    // Сессия: 16 байт hex, в заголовке или в любом месте query
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "secret", false, session, sizeof(session)));
+    TEST_ASSERT_EQUAL(32, strlen(session));
+    TEST_ASSERT_EQUAL(ESP_OK, check(session));
+    char uri[96];
+    snprintf(uri, sizeof(uri), "/api/events?a=1&token=%s&b=2", session);
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_auth_check(request(uri, NULL)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check("00000000000000000000000000000000"));
+
+    // Подписанный: срок + HMAC, без таблицы; подмена любого символа - отказ
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "secret", true, signed_token, sizeof(signed_token)));
+    TEST_ASSERT_EQUAL(40, strlen(signed_token));
+    TEST_ASSERT_EQUAL(ESP_OK, check(signed_token));
+    signed_token[39] ^= 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(signed_token));
+    signed_token[39] ^= 1;
+    signed_token[7] = signed_token[7] == 'f' ? 'e' : 'f'; // срок
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(signed_token));
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "secret", true, signed_token, sizeof(signed_token)));
+
+    // Выход удаляет сессию; "all" меняет секрет и отзывает подписанные
+    TEST_ASSERT_EQUAL(ESP_OK, logout(session, false));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(session));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, logout(signed_token, false));
+    TEST_ASSERT_EQUAL(ESP_OK, check(signed_token));
+    TEST_ASSERT_EQUAL(ESP_OK, logout(NULL, true));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(signed_token));
+
+    stop();
+}
+
+void test_um_webserver_auth_credentials(void)
+{
+    start();
+    char token[48];
+
+    // Первый запрос читает NVS, следующие - нет
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(NULL));
+    TEST_ASSERT_EQUAL(1, s_nvs.loads);
+    int reads = s_nvs.reads;
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "secret", false, token, sizeof(token)));
+    for (int i = 0; i < 100; i++)
+    {
+        TEST_ASSERT_EQUAL(ESP_OK, check(token));
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(NULL));
+    }
+    TEST_ASSERT_EQUAL(reads, s_nvs.reads);
+
+    // Пароль сменён: действует после UMNI_EVENT_CONFIG_SAVED, NVS читается один раз
+    s_nvs.password = "changed";
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "secret", false, token, sizeof(token)));
+    config_saved();
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, login("admin", "secret", false, token, sizeof(token)));
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "changed", false, token, sizeof(token)));
+    TEST_ASSERT_EQUAL(ESP_OK, check(token));
+    TEST_ASSERT_EQUAL(2, s_nvs.loads);
+
+    // Сброс: API открыт без токена; установка закрывает его со следующего запроса
+    s_nvs.installed = false;
+    s_nvs.username = NULL;
+    s_nvs.password = NULL;
+    config_saved();
+    TEST_ASSERT_EQUAL(ESP_OK, check(NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, login("admin", "changed", false, token, sizeof(token)));
+    // Пустой логин и пароль не совпадают с "нет учётных данных"
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, login("", "", false, token, sizeof(token)));
+    s_nvs.installed = true;
+    s_nvs.username = "admin";
+    s_nvs.password = "secret";
+    TEST_ASSERT_EQUAL(ESP_OK, check(NULL)); // до события - прежнее состояние
+    config_saved();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, check(NULL));
+
+    // После перезапуска учётные данные читаются заново
+    stop();
+    int loads = s_nvs.loads;
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_auth_start());
+    check(NULL);
+    TEST_ASSERT_EQUAL(loads + 1, s_nvs.loads);
+    stop();
+}
+
+void test_um_webserver_auth_bench(void)
+{
+    start();
+    char session[48];
+    char signed_token[48];
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "secret", false, session, sizeof(session)));
+    TEST_ASSERT_EQUAL(ESP_OK, login("admin", "secret", true, signed_token, sizeof(signed_token)));
+    int reads = s_nvs.reads;
+
+    // Время на хосте: по нему сравниваются способы проверки, а не платы
+    char uri[96];
+    snprintf(uri, sizeof(uri), "/api/events?ids=1,2,3&token=%s", session);
+    bench("no token", "/api/status", NULL, ESP_ERR_INVALID_STATE);
+    bench("session", "/api/status", session, ESP_OK);
+    bench("session ?token=", uri, NULL, ESP_OK);
+    bench("signed", "/api/status", signed_token, ESP_OK);
+
+    // Ни один запрос не дошёл до NVS
+    TEST_ASSERT_EQUAL(reads, s_nvs.reads);
+    stop();
+}
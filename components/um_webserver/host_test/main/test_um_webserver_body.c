@@ -0,0 +1,207 @@
+/*
+ * Чтение тела POST (um_webserver_body.c): предел размера (413 без чтения),
+ * тело кусками меньше запрошенного, обрыв соединения и таймаут сокета.
+ *
+ * httpd_req_recv подменён (test_httpd.c): тест задаёт, сколько байт клиент
+ * пришлёт, какими кусками и сколько таймаутов перед каждым. Сохранение
+ * тела идёт в каталог хоста через настоящий um_storage.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "unity.h"
+#include "um_webserver.h"
+#include "um_storage.h"
+#include "um_json_stream.h"
+#include "test_httpd.h"
+
+#define BODY_DIR "/tmp/um_web_body"
+#define BODY_FILE BODY_DIR "/conf.json"
+#define BODY_LEN 1500
+// UM_WEB_RECV_RETRIES в um_webserver_priv.h
+#define RECV_RETRIES 3
+
+// um_webserver_priv.h
+esp_err_t um_webserver_body_check(httpd_req_t *req, size_t max_body);
+esp_err_t um_webserver_recv_all(httpd_req_t *req, char *buf, size_t len);
+
+static char s_body[BODY_LEN + 1];
+
+/* --- Помощники --- */
+
+static httpd_req_t *request(size_t content_len)
+{
+    static httpd_req_t req;
+    snprintf((char *)req.uri, sizeof(req.uri), "/api/conf");
+    req.method = HTTP_POST;
+    req.content_len = content_len;
+    return &req;
+}
+
+// JSON ровно BODY_LEN байт: {"pad":"xxx..."}
+static void make_body(void)
+{
+    memset(s_body, 'x', BODY_LEN);
+    memcpy(s_body, "{\"pad\":\"", 8);
+    memcpy(s_body + BODY_LEN - 2, "\"}", 2);
+    s_body[BODY_LEN] = '\0';
+}
+
+// Клиент пришлёт sent байт из BODY_LEN кусками piece
+static void client(size_t sent, size_t piece, int timeouts, bool stall)
+{
+    test_httpd_reset();
+    test_httpd_body.data = s_body;
+    test_httpd_body.len = sent;
+    test_httpd_body.piece = piece;
+    test_httpd_body.timeouts = timeouts;
+    test_httpd_body.stall = stall;
+}
+
+static esp_err_t json_cb(void *ctx, um_json_token_t token, const char *value, int depth)
+{
+    (*(int *)ctx)++;
+    return ESP_OK;
+}
+
+static void read_file(const char *path, char *buf, size_t size)
+{
+    FILE *f = fopen(path, "r");
+    TEST_ASSERT_NOT_NULL_MESSAGE(f, path);
+    size_t n = fread(buf, 1, size - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+}
+
+/* --- Тесты --- */
+
+void test_um_webserver_body_limit(void)
+{
+    make_body();
+    client(BODY_LEN, 0, 0, false);
+
+    // Пустое тело - 400
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_webserver_body_check(request(0), 0));
+    TEST_ASSERT_TRUE(test_httpd_resp.err_sent);
+    TEST_ASSERT_EQUAL(HTTPD_400_BAD_REQUEST, test_httpd_resp.err);
+
+    // Ровно предел - можно читать, ответа ещё нет
+    test_httpd_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_body_check(request(UM_WEBSERVER_MAX_BODY), 0));
+    TEST_ASSERT_EQUAL(0, test_httpd_resp.sends);
+
+    // На байт больше - 413, тело не читается
+    client(BODY_LEN, 0, 0, false);
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_webserver_body_check(request(UM_WEBSERVER_MAX_BODY + 1), 0));
+    TEST_ASSERT_EQUAL_STRING("413 Payload Too Large", test_httpd_resp.status);
+    TEST_ASSERT_NOT_NULL(strstr(test_httpd_resp.body, "\"success\":false"));
+    TEST_ASSERT_EQUAL(0, test_httpd_body.calls);
+
+    // Свой предел endpoint заменяет общий
+    test_httpd_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_body_check(request(16384), 16384));
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_webserver_body_check(request(16385), 16384));
+    TEST_ASSERT_EQUAL_STRING("413 Payload Too Large", test_httpd_resp.status);
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_webserver_body_check(request(100), 64));
+}
+
+void test_um_webserver_body_short_reads(void)
+{
+    make_body();
+    static char buf[BODY_LEN];
+
+    // recv отдаёт по 7 байт с таймаутами перед каждым куском (меньше предела повторов)
+    client(BODY_LEN, 7, RECV_RETRIES, false);
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_recv_all(request(BODY_LEN), buf, BODY_LEN));
+    TEST_ASSERT_EQUAL_MEMORY(s_body, buf, BODY_LEN);
+    TEST_ASSERT_EQUAL(BODY_LEN, test_httpd_body.pos);
+
+    // Читатель получает сколько пришло, remaining уменьшается на столько же
+    client(BODY_LEN, 100, 0, false);
+    um_webserver_body_t body = {.req = request(BODY_LEN), .remaining = BODY_LEN};
+    size_t n;
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_body_read(&body, buf, sizeof(buf), &n));
+    TEST_ASSERT_EQUAL(100, n);
+    TEST_ASSERT_EQUAL(BODY_LEN - 100, body.remaining);
+
+    // Разбор JSON по кускам: токены на границах кусков не теряются
+    client(BODY_LEN, 13, 1, false);
+    body = (um_webserver_body_t){.req = request(BODY_LEN), .remaining = BODY_LEN};
+    int tokens = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_body_parse_json(&body, json_cb, &tokens));
+    TEST_ASSERT_EQUAL(4, tokens); // {, "pad", "xxx...", }
+    TEST_ASSERT_EQUAL(0, body.remaining);
+
+    // Тело прочитано до конца: следующий вызов - 0 байт без обращения к сокету
+    int calls = test_httpd_body.calls;
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_body_read(&body, buf, sizeof(buf), &n));
+    TEST_ASSERT_EQUAL(0, n);
+    TEST_ASSERT_EQUAL(calls, test_httpd_body.calls);
+}
+
+void test_um_webserver_body_closed(void)
+{
+    make_body();
+    static char buf[BODY_LEN];
+    mkdir(BODY_DIR, 0755);
+    FILE *f = fopen(BODY_FILE, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs("{\"old\":1}", f);
+    fclose(f);
+
+    // Соединение закрыто на середине тела
+    client(BODY_LEN / 2, 64, 0, false);
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_webserver_recv_all(request(BODY_LEN), buf, BODY_LEN));
+
+    // Сохранение не трогает старый файл и не оставляет временного
+    client(BODY_LEN / 2, 64, 0, false);
+    um_webserver_body_t body = {.req = request(BODY_LEN), .remaining = BODY_LEN};
+    TEST_ASSERT_EQUAL(ESP_FAIL, um_webserver_body_save(&body, BODY_FILE, 0, NULL));
+    TEST_ASSERT_EQUAL(BODY_LEN - BODY_LEN / 2, body.remaining);
+    char text[BODY_LEN + 1];
+    read_file(BODY_FILE, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("{\"old\":1}", text);
+    TEST_ASSERT_NOT_EQUAL(0, access(BODY_FILE UM_STORAGE_TMP_SUFFIX, F_OK));
+
+    // Целиком пришедшее тело с проверкой JSON заменяет файл
+    client(BODY_LEN, 64, 0, false);
+    body = (um_webserver_body_t){.req = request(BODY_LEN), .remaining = BODY_LEN};
+    int tokens = 0;
+    um_json_stream_t validate;
+    um_json_stream_init(&validate, json_cb, &tokens);
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_body_save(&body, BODY_FILE, 0, &validate));
+    read_file(BODY_FILE, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING(s_body, text);
+    TEST_ASSERT_EQUAL(4, tokens);
+}
+
+void test_um_webserver_body_timeout(void)
+{
+    make_body();
+    static char buf[BODY_LEN];
+
+    // Первый кусок пришёл, дальше клиент молчит
+    client(100, 0, 0, true);
+    um_webserver_body_t body = {.req = request(BODY_LEN), .remaining = BODY_LEN};
+    size_t n;
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_body_read(&body, buf, sizeof(buf), &n));
+    TEST_ASSERT_EQUAL(100, n);
+    int calls = test_httpd_body.calls;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, um_webserver_body_read(&body, buf, sizeof(buf), &n));
+    TEST_ASSERT_EQUAL(0, n);
+    // Первая попытка и UM_WEB_RECV_RETRIES повторов
+    TEST_ASSERT_EQUAL(calls + RECV_RETRIES + 1, test_httpd_body.calls);
+    TEST_ASSERT_EQUAL(BODY_LEN - 100, body.remaining);
+
+    // Таймаутов подряд больше, чем повторов - ошибка, а не бесконечное ожидание
+    client(BODY_LEN, 0, RECV_RETRIES + 1, false);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, um_webserver_recv_all(request(BODY_LEN), buf, BODY_LEN));
+    TEST_ASSERT_EQUAL(0, test_httpd_body.pos);
+
+    // Таймаут при разборе JSON доходит до обработчика как есть
+    client(100, 0, 0, true);
+    body = (um_webserver_body_t){.req = request(BODY_LEN), .remaining = BODY_LEN};
+    int tokens = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, um_webserver_body_parse_json(&body, json_cb, &tokens));
+}
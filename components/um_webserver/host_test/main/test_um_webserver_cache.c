@@ -0,0 +1,268 @@
+/*
+ * Кэш ответов GET (um_webserver_cache.c): ключ без token, ETag и 304,
+ * сброс по событию во время построения ответа, вытеснение LRU.
+ *
+ * Ответ собирают подмены httpd_resp_* (test_httpd.c), подписка на события
+ * перехватывается -Wl,--wrap=um_event_subscribe (её же использует тест
+ * авторизации, test_event_handler()). Кучу считают обёртки
+ * malloc/free из test_um_json_writer.c: после сброса кэша она пуста.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "um_events.h"
+#include "um_webserver.h"
+#include "test_httpd.h"
+
+// UM_WEB_CACHE_MAX_BYTES в um_webserver_priv.h
+#define CACHE_MAX_BYTES 16384
+#define LRU_BODY_LEN 3000
+
+long test_heap_live(void); // test_um_json_writer.c
+
+// um_webserver_priv.h
+esp_err_t um_webserver_cache_start(void);
+void um_webserver_cache_stop(void);
+void um_webserver_cache_watch(uint32_t events);
+void um_webserver_cache_invalidate(uint32_t events);
+uint32_t um_webserver_cache_generation(void);
+esp_err_t um_webserver_cache_send(httpd_req_t *req);
+esp_err_t um_webserver_cache_store_send(httpd_req_t *req, char *body, size_t len, uint32_t events, uint32_t gen);
+
+#define MAX_SUBSCRIPTIONS 4
+
+static struct
+{
+    int32_t event_id;
+    um_event_handler_t handler;
+} s_subs[MAX_SUBSCRIPTIONS];
+
+esp_err_t __wrap_um_event_subscribe(int32_t event_id, um_event_handler_t event_handler, void *handler_arg)
+{
+    for (int i = 0; i < MAX_SUBSCRIPTIONS; i++)
+    {
+        if (!s_subs[i].handler)
+        {
+            s_subs[i].event_id = event_id;
+            s_subs[i].handler = event_handler;
+            return ESP_OK;
+        }
+    }
+    TEST_FAIL_MESSAGE("Too many subscriptions");
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t __wrap_um_event_unsubscribe(int32_t event_id, um_event_handler_t event_handler)
+{
+    for (int i = 0; i < MAX_SUBSCRIPTIONS; i++)
+    {
+        if (s_subs[i].handler == event_handler && s_subs[i].event_id == event_id)
+        {
+            s_subs[i].handler = NULL;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Обработчик, подписанный ровно на event_id (UMNI_EVENT_ANY - на все), или NULL
+ */
+um_event_handler_t test_event_handler(int32_t event_id)
+{
+    for (int i = 0; i < MAX_SUBSCRIPTIONS; i++)
+    {
+        if (s_subs[i].handler && s_subs[i].event_id == event_id)
+        {
+            return s_subs[i].handler;
+        }
+    }
+    return NULL;
+}
+
+/* --- Помощники --- */
+
+static httpd_req_t *request(const char *uri)
+{
+    static httpd_req_t req;
+    snprintf((char *)req.uri, sizeof(req.uri), "%s", uri);
+    req.method = HTTP_GET;
+    return &req;
+}
+
+// Как cached_get_handler: поколение до построения ответа, тело из malloc
+static void store(const char *uri, const char *text, size_t len, uint32_t events, uint32_t gen)
+{
+    char *body = malloc(len);
+    TEST_ASSERT_NOT_NULL(body);
+    memset(body, 'x', len);
+    memcpy(body, text, strnlen(text, len));
+
+    test_httpd_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_cache_store_send(request(uri), body, len, events, gen));
+    TEST_ASSERT_EQUAL(1, test_httpd_resp.sends);
+    TEST_ASSERT_NULL(test_httpd_resp.status);
+    TEST_ASSERT_EQUAL_STRING("application/json", test_httpd_resp.type);
+    TEST_ASSERT_EQUAL_STRING("no-cache", test_httpd_resp.cache_control);
+    TEST_ASSERT_EQUAL(len, test_httpd_resp.len);
+}
+
+static void store_json(const char *uri, const char *json, uint32_t events)
+{
+    store(uri, json, strlen(json), events, um_webserver_cache_generation());
+}
+
+// ESP_OK - ответ из кэша, тело и статус в test_httpd_resp
+static esp_err_t hit(const char *uri, const char *if_none_match)
+{
+    test_httpd_reset();
+    test_httpd_set_header("If-None-Match", if_none_match);
+    return um_webserver_cache_send(request(uri));
+}
+
+static void assert_body(const char *json)
+{
+    TEST_ASSERT_EQUAL(strlen(json), test_httpd_resp.len);
+    TEST_ASSERT_EQUAL_MEMORY(json, test_httpd_resp.body, test_httpd_resp.len);
+}
+
+static void fire(int32_t event_id)
+{
+    um_event_handler_t handler = test_event_handler(UMNI_EVENT_ANY);
+    TEST_ASSERT_NOT_NULL(handler);
+    handler(NULL, UMNI_EVENT_BASE, event_id, NULL);
+}
+
+static long start(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_cache_start());
+    um_webserver_cache_watch(UM_WEBSERVER_EVENT_BIT(UMNI_EVENT_CONFIG_SAVED));
+    return test_heap_live();
+}
+
+static void stop(long base)
+{
+    um_webserver_cache_stop();
+    TEST_ASSERT_NULL(test_event_handler(UMNI_EVENT_ANY));
+    TEST_ASSERT_EQUAL(0, test_heap_live() - base);
+}
+
+/* --- Тесты --- */
+
+void test_um_webserver_cache_key_etag(void)
+{
+    long base = start();
+    store_json("/api/x?token=a&b=1", "{\"b\":1}", 0);
+    char etag[sizeof(test_httpd_resp.etag)];
+    strcpy(etag, test_httpd_resp.etag);
+    TEST_ASSERT_EQUAL(10, strlen(etag));
+
+    // Токен в ключ не входит: другой клиент получает ту же запись
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/x?b=1&token=z", NULL));
+    TEST_ASSERT_NULL(test_httpd_resp.status);
+    TEST_ASSERT_EQUAL_STRING(etag, test_httpd_resp.etag);
+    assert_body("{\"b\":1}");
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/x?b=1&token", NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/x?b=1", NULL));
+
+    // Остальные параметры - часть ключа, "tokens" - не token
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hit("/api/x?b=2", NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hit("/api/x?b=1&tokens=1", NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hit("/api/x", NULL));
+    TEST_ASSERT_EQUAL(0, test_httpd_resp.sends);
+
+    // Та же версия у клиента - 304 без тела, с тем же ETag
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/x?b=1", etag));
+    TEST_ASSERT_EQUAL_STRING("304 Not Modified", test_httpd_resp.status);
+    TEST_ASSERT_EQUAL(0, test_httpd_resp.len);
+    TEST_ASSERT_EQUAL_STRING(etag, test_httpd_resp.etag);
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/x?b=1", "*"));
+    TEST_ASSERT_EQUAL_STRING("304 Not Modified", test_httpd_resp.status);
+
+    // Другая версия - полный ответ
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/x?b=1", "\"00000000\""));
+    TEST_ASSERT_NULL(test_httpd_resp.status);
+    assert_body("{\"b\":1}");
+
+    // Новое тело - новый ETag, старый у клиента больше не совпадает
+    store_json("/api/x?b=1", "{\"b\":2}", 0);
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(etag, test_httpd_resp.etag));
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/x?b=1", etag));
+    TEST_ASSERT_NULL(test_httpd_resp.status);
+    assert_body("{\"b\":2}");
+
+    stop(base);
+}
+
+void test_um_webserver_cache_invalidate(void)
+{
+    long base = start();
+    const uint32_t saved = UM_WEBSERVER_EVENT_BIT(UMNI_EVENT_CONFIG_SAVED);
+
+    store_json("/api/config", "{\"v\":1}", saved);
+    store_json("/api/info", "{\"v\":1}", 0);
+
+    // Событие, на которое кэш не настроен, ничего не сбрасывает
+    fire(UMNI_EVENT_SDCARD_MOUNTED);
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/config", NULL));
+
+    // Сбрасываются только записи, зависящие от события
+    fire(UMNI_EVENT_CONFIG_SAVED);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hit("/api/config", NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/info", NULL));
+
+    // Событие пришло, пока ответ строился: отдаём, но не запоминаем
+    uint32_t gen = um_webserver_cache_generation();
+    fire(UMNI_EVENT_CONFIG_SAVED);
+    store("/api/config", "{\"v\":0}", 7, saved, gen);
+    assert_body("{\"v\":0}");
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hit("/api/config", NULL));
+
+    // Следующий запрос строится уже с новым поколением и кэшируется
+    store_json("/api/config", "{\"v\":2}", saved);
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/config", NULL));
+    assert_body("{\"v\":2}");
+
+    stop(base);
+}
+
+void test_um_webserver_cache_lru(void)
+{
+    long base = start();
+    static const char *uris[] = {"/api/a", "/api/b", "/api/c", "/api/d", "/api/e"};
+    const int count = sizeof(uris) / sizeof(uris[0]);
+
+    // Пять записей помещаются, шестая - уже нет
+    TEST_ASSERT_LESS_OR_EQUAL(CACHE_MAX_BYTES, count * (LRU_BODY_LEN + 128));
+    TEST_ASSERT_GREATER_THAN(CACHE_MAX_BYTES, (count + 1) * LRU_BODY_LEN);
+    for (int i = 0; i < count; i++)
+    {
+        store(uris[i], "{}", LRU_BODY_LEN, 0, um_webserver_cache_generation());
+    }
+    for (int i = 0; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE(ESP_OK, hit(uris[i], NULL), uris[i]);
+    }
+
+    // Запрос поднимает /api/a в голову: вытесняется следующий по давности /api/b
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/a", NULL));
+    store("/api/f", "{}", LRU_BODY_LEN, 0, um_webserver_cache_generation());
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hit("/api/b", NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/a", NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/c", NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/f", NULL));
+
+    // Замена записи с тем же ключом не вытесняет соседей
+    store("/api/f", "{}", LRU_BODY_LEN, 0, um_webserver_cache_generation());
+    for (int i = 0; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE(i == 1 ? ESP_ERR_NOT_FOUND : ESP_OK, hit(uris[i], NULL), uris[i]);
+    }
+
+    // Больше половины кэша - отдаётся, но не хранится и никого не вытесняет
+    store("/api/big", "{}", CACHE_MAX_BYTES / 2, 0, um_webserver_cache_generation());
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, hit("/api/big", NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, hit("/api/c", NULL));
+
+    stop(base);
+}
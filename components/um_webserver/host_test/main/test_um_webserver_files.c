@@ -0,0 +1,494 @@
+/*
+ * /api/files: файл 50 MB целиком и докачка после обрыва через Range,
+ * загрузка PUT с созданием каталогов и проверкой пути.
+ *
+ * Сокет подменён (-Wl,--wrap=httpd_send), заголовки и тело запроса задаются
+ * через test_httpd.h: тело ответа проверяется по смещению, считаются
+ * скорость и самый большой кусок, переданный в сокет.
+ *
+ * "Карта" для чтения - FAT (FatFs, как на устройстве) поверх wear levelling
+ * на разделе в памяти. Обработчик работает с картой через POSIX, а VFS на
+ * хосте нет: open/read/lseek/close/stat с путями CONFIG_UMNI_SD_MOUNT_POINT
+ * (/tmp/um_web_files, см. CMakeLists.txt) тест передаёт в FatFs. Загрузка
+ * проверяется без FAT - на каталоге хоста.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "unity.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "esp_partition.h"
+#include "wear_levelling.h"
+#include "diskio_impl.h"
+#include "diskio_wl.h"
+#include "ff.h"
+#include "mbedtls/sha256.h"
+#include "um_sd.h"
+#include "test_httpd.h"
+
+#define FILE_NAME "BIG.BIN"
+#define FILE_SIZE (50u * 1024 * 1024)
+#define CUT_AT (20u * 1024 * 1024 + 123)
+// UM_WEB_FILES_CHUNK
+#define CHUNK 4096
+// Раздел с запасом на служебные сектора wear levelling и FAT
+#define PART_SIZE (64u * 1024 * 1024)
+#define SECTOR_SIZE 4096
+// Дескриптор открытого файла FAT: вне диапазона, который выдаёт ОС
+#define FAT_FD 0x4000
+
+// um_webserver_priv.h
+esp_err_t um_webserver_files_handler(httpd_req_t *req);
+esp_err_t um_webserver_files_put_handler(httpd_req_t *req);
+
+/* --- Карта: захват всегда успешен, открытые файлы считаются --- */
+
+esp_err_t um_sd_lock(TickType_t timeout)
+{
+    return ESP_OK;
+}
+
+void um_sd_unlock(void)
+{
+}
+
+// Открытые между захватами файлы: после каждого ответа должно быть 0
+static int s_open_files;
+
+void um_sd_file_opened(void)
+{
+    s_open_files++;
+}
+
+void um_sd_file_closed(void)
+{
+    s_open_files--;
+}
+
+const char *um_webserver_content_type(const char *path)
+{
+    return "application/octet-stream";
+}
+
+/* --- Раздел во flash: буфер в куче, запись только сбрасывает биты --- */
+
+static uint8_t *s_flash;
+static const esp_partition_t s_partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = ESP_PARTITION_SUBTYPE_DATA_FAT,
+    .size = PART_SIZE,
+    .erase_size = SECTOR_SIZE,
+    .label = "sd",
+};
+
+esp_err_t __wrap_esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size)
+{
+    TEST_ASSERT_LESS_OR_EQUAL(PART_SIZE, offset + size);
+    memcpy(dst, s_flash + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t __wrap_esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size)
+{
+    TEST_ASSERT_LESS_OR_EQUAL(PART_SIZE, offset + size);
+    const uint8_t *bytes = src;
+    for (size_t i = 0; i < size; i++)
+    {
+        s_flash[offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t __wrap_esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    TEST_ASSERT_EQUAL(0, offset % SECTOR_SIZE);
+    TEST_ASSERT_EQUAL(0, size % SECTOR_SIZE);
+    TEST_ASSERT_LESS_OR_EQUAL(PART_SIZE, offset + size);
+    memset(s_flash + offset, 0xff, size);
+    return ESP_OK;
+}
+
+/* --- POSIX -> FatFs для путей карты --- */
+
+static struct
+{
+    bool mounted;
+    BYTE pdrv;
+    wl_handle_t wl;
+    FATFS fs;
+    char drv[3]; // "0:"
+    FIL file;
+    bool file_open;
+} s_fat;
+
+int __real_open(const char *path, int flags, ...);
+ssize_t __real_read(int fd, void *buf, size_t len);
+off_t __real_lseek(int fd, off_t offset, int whence);
+int __real_close(int fd);
+int __real_stat(const char *path, struct stat *st);
+
+// "/tmp/um_web_files/BIG.BIN" -> "0:/BIG.BIN"; NULL - путь не на карте
+static const char *fat_path(const char *path)
+{
+    static char buf[256];
+    size_t n = strlen(CONFIG_UMNI_SD_MOUNT_POINT);
+    if (!s_fat.mounted || strncmp(path, CONFIG_UMNI_SD_MOUNT_POINT, n) != 0 || (path[n] && path[n] != '/'))
+    {
+        return NULL;
+    }
+    snprintf(buf, sizeof(buf), "%s%s", s_fat.drv, path[n] ? path + n : "/");
+    return buf;
+}
+
+int __wrap_open(const char *path, int flags, ...)
+{
+    const char *fpath = fat_path(path);
+    if (!fpath)
+    {
+        mode_t mode = 0;
+        if (flags & O_CREAT)
+        {
+            va_list ap;
+            va_start(ap, flags);
+            mode = va_arg(ap, int);
+            va_end(ap);
+        }
+        return __real_open(path, flags, mode);
+    }
+    // Обработчик только читает и держит один файл
+    TEST_ASSERT_EQUAL(O_RDONLY, flags & O_ACCMODE);
+    TEST_ASSERT_FALSE(s_fat.file_open);
+    if (f_open(&s_fat.file, fpath, FA_READ) != FR_OK)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    s_fat.file_open = true;
+    return FAT_FD;
+}
+
+ssize_t __wrap_read(int fd, void *buf, size_t len)
+{
+    if (fd != FAT_FD)
+    {
+        return __real_read(fd, buf, len);
+    }
+    UINT n;
+    if (f_read(&s_fat.file, buf, len, &n) != FR_OK)
+    {
+        errno = EIO;
+        return -1;
+    }
+    return n;
+}
+
+off_t __wrap_lseek(int fd, off_t offset, int whence)
+{
+    if (fd != FAT_FD)
+    {
+        return __real_lseek(fd, offset, whence);
+    }
+    TEST_ASSERT_EQUAL(SEEK_SET, whence);
+    if (f_lseek(&s_fat.file, offset) != FR_OK)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return f_tell(&s_fat.file);
+}
+
+int __wrap_close(int fd)
+{
+    if (fd != FAT_FD)
+    {
+        return __real_close(fd);
+    }
+    TEST_ASSERT_TRUE(s_fat.file_open);
+    s_fat.file_open = false;
+    return f_close(&s_fat.file) == FR_OK ? 0 : -1;
+}
+
+int __wrap_stat(const char *path, struct stat *st)
+{
+    const char *fpath = fat_path(path);
+    if (!fpath)
+    {
+        return __real_stat(path, st);
+    }
+    FILINFO info;
+    if (f_stat(fpath, &info) != FR_OK)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    memset(st, 0, sizeof(*st));
+    st->st_size = info.fsize;
+    st->st_mode = (info.fattrib & AM_DIR) ? S_IFDIR | 0755 : S_IFREG | 0644;
+    // Для ETag достаточно, чтобы время менялось вместе с файлом
+    st->st_mtime = (time_t)info.fdate << 16 | info.ftime;
+    return 0;
+}
+
+static void fat_mount(void)
+{
+    s_flash = malloc(PART_SIZE);
+    TEST_ASSERT_NOT_NULL(s_flash);
+    memset(s_flash, 0xff, PART_SIZE);
+
+    TEST_ASSERT_EQUAL(ESP_OK, wl_mount(&s_partition, &s_fat.wl));
+    TEST_ASSERT_EQUAL(ESP_OK, ff_diskio_get_drive(&s_fat.pdrv));
+    TEST_ASSERT_EQUAL(ESP_OK, ff_diskio_register_wl_partition(s_fat.pdrv, s_fat.wl));
+    snprintf(s_fat.drv, sizeof(s_fat.drv), "%u:", s_fat.pdrv);
+
+    static BYTE work[FF_MAX_SS];
+    const MKFS_PARM opt = {.fmt = FM_ANY};
+    TEST_ASSERT_EQUAL(FR_OK, f_mkfs(s_fat.drv, &opt, work, sizeof(work)));
+    TEST_ASSERT_EQUAL(FR_OK, f_mount(&s_fat.fs, s_fat.drv, 1));
+    s_fat.mounted = true;
+}
+
+static void fat_unmount(void)
+{
+    s_fat.mounted = false;
+    f_mount(NULL, s_fat.drv, 0);
+    ff_diskio_unregister(s_fat.pdrv);
+    ff_diskio_clear_pdrv_wl(s_fat.wl);
+    TEST_ASSERT_EQUAL(ESP_OK, wl_unmount(s_fat.wl));
+    free(s_flash);
+    s_flash = NULL;
+}
+
+/* --- Клиент --- */
+
+static uint8_t pattern(uint64_t pos)
+{
+    return (uint8_t)(pos ^ (pos >> 8) ^ (pos >> 16));
+}
+
+static struct
+{
+    char head[512];
+    size_t head_len;
+    bool head_done;
+    uint64_t pos;      // смещение следующего байта тела в файле
+    uint64_t received; // байт тела
+    uint64_t cut_at;   // оборвать соединение после стольких байт тела, 0 - нет
+    size_t max_send;
+    uint32_t sends;
+    uint32_t mismatches;
+} s_client;
+
+int __wrap_httpd_send(httpd_req_t *req, const char *buf, size_t len)
+{
+    if (!s_client.head_done)
+    {
+        // Заголовки уходят одним куском до тела
+        TEST_ASSERT_LESS_THAN(sizeof(s_client.head), len);
+        memcpy(s_client.head, buf, len);
+        s_client.head[len] = '\0';
+        s_client.head_len = len;
+        s_client.head_done = true;
+        return len;
+    }
+    if (s_client.cut_at && s_client.received + len > s_client.cut_at)
+    {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    s_client.sends++;
+    s_client.max_send = len > s_client.max_send ? len : s_client.max_send;
+    for (size_t i = 0; i < len; i++)
+    {
+        if ((uint8_t)buf[i] != pattern(s_client.pos + i))
+        {
+            s_client.mismatches++;
+        }
+    }
+    s_client.pos += len;
+    s_client.received += len;
+    return len;
+}
+
+static void header_value(const char *name, char *out, size_t size)
+{
+    const char *p = strstr(s_client.head, name);
+    TEST_ASSERT_NOT_NULL_MESSAGE(p, name);
+    p += strlen(name);
+    size_t len = strcspn(p, "\r");
+    TEST_ASSERT_LESS_THAN(size, len);
+    memcpy(out, p, len);
+    out[len] = '\0';
+}
+
+static esp_err_t get(const char *range, const char *if_range, uint64_t start, uint64_t cut_at, double *mbps)
+{
+    static httpd_req_t req;
+    snprintf((char *)req.uri, sizeof(req.uri), "/api/files/%s", FILE_NAME);
+    req.method = HTTP_GET;
+
+    memset(&s_client, 0, sizeof(s_client));
+    test_httpd_reset();
+    test_httpd_set_header("Range", range);
+    test_httpd_set_header("If-Range", if_range);
+    s_client.pos = start;
+    s_client.cut_at = cut_at;
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = um_webserver_files_handler(&req);
+    int64_t us = esp_timer_get_time() - t0;
+    if (mbps)
+    {
+        *mbps = s_client.received / 1048576.0 / (us / 1e6);
+    }
+    TEST_ASSERT_EQUAL(0, s_open_files);
+    return ret;
+}
+
+// Запись через FatFs напрямую: обработчику нужен только готовый файл
+static void make_file(const char *name)
+{
+    char path[16];
+    snprintf(path, sizeof(path), "%s/%s", s_fat.drv, name);
+    FIL f;
+    TEST_ASSERT_EQUAL(FR_OK, f_open(&f, path, FA_WRITE | FA_CREATE_ALWAYS));
+    static uint8_t buf[64 * 1024];
+    for (uint64_t pos = 0; pos < FILE_SIZE; pos += sizeof(buf))
+    {
+        for (size_t i = 0; i < sizeof(buf); i++)
+        {
+            buf[i] = pattern(pos + i);
+        }
+        UINT written;
+        TEST_ASSERT_EQUAL(FR_OK, f_write(&f, buf, sizeof(buf), &written));
+        TEST_ASSERT_EQUAL(sizeof(buf), written);
+    }
+    TEST_ASSERT_EQUAL(FR_OK, f_close(&f));
+}
+
+static esp_err_t put(const char *uri, const char *body, const char *sha256)
+{
+    static httpd_req_t req;
+    snprintf((char *)req.uri, sizeof(req.uri), "%s", uri);
+    req.method = HTTP_PUT;
+    req.content_len = strlen(body);
+
+    test_httpd_reset();
+    test_httpd_body.data = body;
+    test_httpd_body.len = strlen(body);
+    test_httpd_set_header("X-Content-SHA256", sha256);
+    esp_err_t ret = um_webserver_files_put_handler(&req);
+    TEST_ASSERT_EQUAL(0, s_open_files);
+    return ret;
+}
+
+static void sha256_hex(const char *data, char hex[65])
+{
+    uint8_t digest[32];
+    mbedtls_sha256((const uint8_t *)data, strlen(data), digest, 0);
+    for (int i = 0; i < 32; i++)
+    {
+        sprintf(hex + 2 * i, "%02x", digest[i]);
+    }
+}
+
+static bool exists(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+/* --- Тесты --- */
+
+void test_um_webserver_files_50mb(void)
+{
+    fat_mount();
+    make_file(FILE_NAME);
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", CONFIG_UMNI_SD_MOUNT_POINT, FILE_NAME);
+
+    // Целиком; скорость зависит от машины и только печатается
+    double mbps;
+    TEST_ASSERT_EQUAL(ESP_OK, get(NULL, NULL, 0, 0, &mbps));
+    TEST_ASSERT_NOT_NULL(strstr(s_client.head, "HTTP/1.1 200 OK\r\n"));
+    char value[64];
+    header_value("Content-Length: ", value, sizeof(value));
+    TEST_ASSERT_EQUAL_UINT32(FILE_SIZE, (uint32_t)strtoull(value, NULL, 10));
+    TEST_ASSERT_EQUAL_UINT32(FILE_SIZE, (uint32_t)s_client.received);
+    TEST_ASSERT_EQUAL(0, s_client.mismatches);
+    printf("%s (FAT): %u MB in %lu sends of <= %u B, %.1f MB/s\n", path, FILE_SIZE >> 20,
+           (unsigned long)s_client.sends, (unsigned)s_client.max_send, mbps);
+    TEST_ASSERT_LESS_OR_EQUAL(CHUNK, s_client.max_send);
+
+    char etag[40];
+    header_value("ETag: ", etag, sizeof(etag));
+
+    // Обрыв посередине: обработчик сообщает об ошибке, соединение закрывается
+    TEST_ASSERT_EQUAL(ESP_FAIL, get(NULL, NULL, 0, CUT_AT, NULL));
+    uint64_t have = s_client.received;
+    TEST_ASSERT_LESS_OR_EQUAL(CUT_AT, have);
+    TEST_ASSERT_EQUAL(0, s_client.mismatches);
+
+    // Докачка с того же места (curl -C -)
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%llu-", (unsigned long long)have);
+    TEST_ASSERT_EQUAL(ESP_OK, get(range, etag, have, 0, &mbps));
+    TEST_ASSERT_NOT_NULL(strstr(s_client.head, "HTTP/1.1 206 Partial Content\r\n"));
+    header_value("Content-Range: ", value, sizeof(value));
+    char expect[64];
+    snprintf(expect, sizeof(expect), "bytes %llu-%u/%u", (unsigned long long)have, FILE_SIZE - 1, FILE_SIZE);
+    TEST_ASSERT_EQUAL_STRING(expect, value);
+    TEST_ASSERT_EQUAL_UINT32(FILE_SIZE, (uint32_t)(have + s_client.received));
+    TEST_ASSERT_EQUAL(0, s_client.mismatches);
+    printf("resumed at %llu: %llu B, %.1f MB/s\n", (unsigned long long)have, (unsigned long long)s_client.received,
+           mbps);
+
+    // Файл изменился (другой ETag) - вместо диапазона весь файл заново
+    TEST_ASSERT_EQUAL(ESP_OK, get(range, "\"0-0\"", 0, 0, NULL));
+    TEST_ASSERT_NOT_NULL(strstr(s_client.head, "HTTP/1.1 200 OK\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(FILE_SIZE, (uint32_t)s_client.received);
+
+    fat_unmount();
+}
+
+void test_um_webserver_files_put(void)
+{
+    const char *root = CONFIG_UMNI_SD_MOUNT_POINT;
+    const char *keep = CONFIG_UMNI_SD_MOUNT_POINT "/keep";
+    const char *file = CONFIG_UMNI_SD_MOUNT_POINT "/keep/new/deep/a..b.txt";
+    mkdir(root, 0775);
+    mkdir(keep, 0775);
+    unlink(file);
+    rmdir(CONFIG_UMNI_SD_MOUNT_POINT "/keep/new/deep");
+    rmdir(CONFIG_UMNI_SD_MOUNT_POINT "/keep/new");
+
+    const char *body = "{\"ok\":true}";
+    char sha[65];
+    sha256_hex(body, sha);
+
+    // Сегмент ".." - 400, обработчик не трогает карту
+    TEST_ASSERT_EQUAL(ESP_OK, put("/api/files/../x.txt", body, NULL));
+    TEST_ASSERT_EQUAL(HTTPD_400_BAD_REQUEST, test_httpd_resp.err);
+    TEST_ASSERT_EQUAL(ESP_OK, put("/api/files/keep/%2e%2e/x.txt", body, NULL));
+    TEST_ASSERT_EQUAL(HTTPD_400_BAD_REQUEST, test_httpd_resp.err);
+    TEST_ASSERT_EQUAL(ESP_OK, put("/api/files/keep/..", body, NULL));
+    TEST_ASSERT_EQUAL(HTTPD_400_BAD_REQUEST, test_httpd_resp.err);
+
+    // Хэш не совпал: файла нет, созданные для него каталоги удалены, прежний остался
+    TEST_ASSERT_EQUAL(ESP_OK, put("/api/files/keep/new/deep/a..b.txt", body,
+                                  "0000000000000000000000000000000000000000000000000000000000000000"));
+    TEST_ASSERT_TRUE(test_httpd_resp.err_sent);
+    TEST_ASSERT_EQUAL(HTTPD_400_BAD_REQUEST, test_httpd_resp.err);
+    TEST_ASSERT_FALSE(exists(CONFIG_UMNI_SD_MOUNT_POINT "/keep/new"));
+    TEST_ASSERT_TRUE(exists(keep));
+
+    // Имя с ".." внутри - обычный файл
+    TEST_ASSERT_EQUAL(ESP_OK, put("/api/files/keep/new/deep/a..b.txt", body, sha));
+    TEST_ASSERT_FALSE(test_httpd_resp.err_sent);
+    TEST_ASSERT_EQUAL_STRING("201 Created", test_httpd_resp.status);
+    TEST_ASSERT_TRUE(exists(file));
+}
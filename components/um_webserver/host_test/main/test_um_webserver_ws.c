@@ -0,0 +1,245 @@
+/*
+ * /ws: событие кодируется один раз, всем клиентам уходит общий кадр со
+ * счётчиком ссылок; медленный клиент отключается, его кадры освобождаются.
+ *
+ * httpd подменён (-Wl,--wrap=httpd_ws_send_data_async и др., см.
+ * CMakeLists.txt): отправка ставит кадр в очередь теста, drain() играет
+ * роль задачи httpd и вызывает колбэк завершения. Куча считается обёртками
+ * malloc/free из test_um_json_writer.c. Печатается время рассылки на
+ * событие и память под кадры в полёте.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "unity.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+
+// UM_WS_MAX_CLIENTS, UM_WS_CLIENT_QUEUE в um_webserver_ws.c
+#define CLIENTS 4
+#define CLIENT_QUEUE 8
+#define FIRST_FD 40
+#define EVENTS 20000
+#define EVENT_LEN 512
+
+long test_heap_live(void); // test_um_json_writer.c
+
+// um_webserver_priv.h
+typedef void (*um_web_event_sink_t)(int32_t event_id, const char *json, size_t len);
+esp_err_t um_webserver_ws_start(httpd_handle_t server);
+void um_webserver_ws_on_close(int fd);
+void um_webserver_ws_stop(void);
+
+/* --- Источник событий и авторизация --- */
+
+static um_web_event_sink_t s_sink;
+
+esp_err_t um_webserver_events_add_sink(um_web_event_sink_t sink)
+{
+    s_sink = sink;
+    return ESP_OK;
+}
+
+size_t um_webserver_events_snapshot(char *buf, size_t size)
+{
+    return snprintf(buf, size, "{\"t\":\"snapshot\"}");
+}
+
+esp_err_t um_webserver_auth_check(httpd_req_t *req)
+{
+    return ESP_OK;
+}
+
+/* --- httpd --- */
+
+typedef struct
+{
+    transfer_complete_cb cb;
+    int fd;
+    void *arg;
+    const uint8_t *payload;
+    size_t len;
+} pending_t;
+
+static struct
+{
+    esp_err_t (*handler)(httpd_req_t *req);
+    int req_fd;
+    int snapshots;
+    int closed_fd;
+    pending_t queue[CLIENTS * (CLIENT_QUEUE + 1)];
+    int queued;
+} s_httpd;
+
+esp_err_t __wrap_httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri)
+{
+    s_httpd.handler = uri->handler;
+    return ESP_OK;
+}
+
+int __wrap_httpd_req_to_sockfd(httpd_req_t *req)
+{
+    return s_httpd.req_fd;
+}
+
+esp_err_t __wrap_httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
+{
+    s_httpd.snapshots++;
+    return ESP_OK;
+}
+
+esp_err_t __wrap_httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t __wrap_httpd_ws_send_data_async(httpd_handle_t handle, int fd, httpd_ws_frame_t *frame,
+                                          transfer_complete_cb cb, void *arg)
+{
+    if (s_httpd.queued == sizeof(s_httpd.queue) / sizeof(s_httpd.queue[0]))
+    {
+        return ESP_FAIL;
+    }
+    s_httpd.queue[s_httpd.queued++] = (pending_t){cb, fd, arg, frame->payload, frame->len};
+    return ESP_OK;
+}
+
+// Сокет закрывается сразу, как сделал бы httpd через close_fn
+esp_err_t __wrap_httpd_sess_trigger_close(httpd_handle_t handle, int fd)
+{
+    s_httpd.closed_fd = fd;
+    um_webserver_ws_on_close(fd);
+    return ESP_OK;
+}
+
+/**
+ * @brief Отправить всё из очереди, кроме кадров клиента skip_fd
+ */
+static void drain(int skip_fd)
+{
+    int kept = 0;
+    for (int i = 0; i < s_httpd.queued; i++)
+    {
+        pending_t p = s_httpd.queue[i];
+        if (p.fd == skip_fd)
+        {
+            s_httpd.queue[kept++] = p;
+            continue;
+        }
+        p.cb(ESP_OK, p.fd, p.arg);
+    }
+    s_httpd.queued = kept;
+}
+
+static void connect_clients(void)
+{
+    static int server;
+    memset(&s_httpd, 0, sizeof(s_httpd));
+    TEST_ASSERT_EQUAL(ESP_OK, um_webserver_ws_start(&server));
+    TEST_ASSERT_NOT_NULL(s_httpd.handler);
+    TEST_ASSERT_NOT_NULL(s_sink);
+
+    static httpd_req_t req;
+    req.method = HTTP_GET;
+    for (int i = 0; i <= CLIENTS; i++)
+    {
+        s_httpd.req_fd = FIRST_FD + i;
+        // Сверх UM_WS_MAX_CLIENTS - отказ
+        TEST_ASSERT_EQUAL(i < CLIENTS ? ESP_OK : ESP_FAIL, s_httpd.handler(&req));
+    }
+    TEST_ASSERT_EQUAL(CLIENTS, s_httpd.snapshots);
+}
+
+static void disconnect_clients(void)
+{
+    for (int i = 0; i < CLIENTS; i++)
+    {
+        um_webserver_ws_on_close(FIRST_FD + i);
+    }
+    um_webserver_ws_stop();
+}
+
+void test_um_webserver_ws_fanout(void)
+{
+    static char json[EVENT_LEN];
+    memset(json, 'x', sizeof(json));
+    connect_clients();
+    long base = test_heap_live();
+
+    // Один кадр на событие: у всех клиентов тот же буфер и те же байты
+    s_sink(0, json, sizeof(json));
+    TEST_ASSERT_EQUAL(CLIENTS, s_httpd.queued);
+    for (int i = 0; i < CLIENTS; i++)
+    {
+        TEST_ASSERT_EQUAL(FIRST_FD + i, s_httpd.queue[i].fd);
+        TEST_ASSERT_TRUE(s_httpd.queue[i].payload == s_httpd.queue[0].payload);
+        TEST_ASSERT_EQUAL(EVENT_LEN, s_httpd.queue[i].len);
+        TEST_ASSERT_EQUAL_MEMORY(json, s_httpd.queue[i].payload, EVENT_LEN);
+    }
+    long one_frame = test_heap_live() - base;
+    drain(-1);
+    // Кадр освобождает последний колбэк отправки
+    TEST_ASSERT_EQUAL(0, test_heap_live() - base);
+
+    // Очередь httpd заполнена у всех: в памяти по кадру на событие, а не на клиента
+    for (int i = 0; i < CLIENT_QUEUE; i++)
+    {
+        s_sink(0, json, sizeof(json));
+    }
+    long in_flight = test_heap_live() - base;
+    TEST_ASSERT_EQUAL(CLIENT_QUEUE * one_frame, in_flight);
+    drain(-1);
+    TEST_ASSERT_EQUAL(0, test_heap_live() - base);
+
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < EVENTS; i++)
+    {
+        s_sink(0, json, sizeof(json));
+        drain(-1);
+    }
+    int64_t us = esp_timer_get_time() - t0;
+    TEST_ASSERT_EQUAL(0, test_heap_live() - base);
+    printf("ws fan-out: %d events x %d B to %d clients, %.2f us/event; in flight with %d queued: %ld B "
+           "(%d copies per client: %ld B)\n",
+           EVENTS, EVENT_LEN, CLIENTS, (double)us / EVENTS, CLIENT_QUEUE, in_flight, CLIENTS,
+           in_flight * CLIENTS);
+
+    disconnect_clients();
+}
+
+void test_um_webserver_ws_slow_client(void)
+{
+    static char json[EVENT_LEN];
+    memset(json, 'y', sizeof(json));
+    connect_clients();
+    long base = test_heap_live();
+    const int slow = FIRST_FD + 2;
+
+    // Медленный клиент не забирает кадры; остальные получают всё
+    for (int i = 0; i < CLIENT_QUEUE; i++)
+    {
+        s_sink(0, json, sizeof(json));
+        drain(slow);
+    }
+    TEST_ASSERT_EQUAL(CLIENT_QUEUE, s_httpd.queued);
+    TEST_ASSERT_EQUAL(0, s_httpd.closed_fd);
+
+    // Следующее событие: его очередь полна - отключаем, кадр ему не ставим
+    s_sink(0, json, sizeof(json));
+    TEST_ASSERT_EQUAL(slow, s_httpd.closed_fd);
+    TEST_ASSERT_EQUAL(CLIENT_QUEUE + CLIENTS - 1, s_httpd.queued);
+    drain(slow);
+
+    // Кадры закрытого клиента держат память, пока httpd их не отпустит
+    TEST_ASSERT_GREATER_THAN(0, test_heap_live() - base);
+    drain(-1);
+    TEST_ASSERT_EQUAL(0, test_heap_live() - base);
+
+    // После отключения рассылка идёт оставшимся клиентам
+    s_sink(0, json, sizeof(json));
+    TEST_ASSERT_EQUAL(CLIENTS - 1, s_httpd.queued);
+    drain(-1);
+    TEST_ASSERT_EQUAL(0, test_heap_live() - base);
+
+    disconnect_clients();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Size of the writer's fixed output buffer */
+#ifndef UM_JSON_WRITER_BUF_SIZE
+#define UM_JSON_WRITER_BUF_SIZE 512
+#endif
+
+/** Maximum nesting depth of objects/arrays */
+#define UM_JSON_WRITER_MAX_DEPTH 32
+
+    /**
+     * @brief Output sink: receives every full buffer and the tail on finish
+     */
+    typedef esp_err_t (*um_json_flush_fn)(void *ctx, const char *data, size_t len);
+
+    /**
+     * @brief Streaming JSON writer
+     *
+     * Values go into a fixed buffer; a full buffer is handed to the sink
+     * (httpd_resp_send_chunk for HTTP). No tree and no heap allocation,
+     * the first bytes leave as soon as the buffer fills.
+     *
+     * Errors are sticky: after the first failure all calls are no-ops and
+     * um_json_writer_finish() returns the error. Lives on the caller's stack.
+     */
+    typedef struct
+    {
+        um_json_flush_fn flush;
+        void *ctx;
+        char buf[UM_JSON_WRITER_BUF_SIZE];
+        size_t len;
+        size_t flushed;       /**< Bytes already handed to the sink */
+        uint32_t has_items;   /**< Bit per depth: container already has an item */
+        uint8_t depth;
+        bool after_key;       /**< Key written, value expected */
+        esp_err_t err;
+        int64_t start_us;
+        int64_t first_flush_us; /**< Time to first byte, 0 until the first flush */
+    } um_json_writer_t;
+
+    /**
+     * @brief Initialize writer with a custom sink
+     */
+    void um_json_writer_init(um_json_writer_t *w, um_json_flush_fn flush, void *ctx);
+
+    /**
+     * @brief Initialize writer that sends chunks of an HTTP response
+     *
+     * Response headers (type, status) must be set before the first flush.
+     */
+    void um_json_writer_init_httpd(um_json_writer_t *w, httpd_req_t *req);
+
+    /**
+     * @brief Discard buffered output (only possible while nothing was flushed)
+     *
+     * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if data already left
+     */
+    esp_err_t um_json_writer_reset(um_json_writer_t *w);
+
+    /**
+     * @brief Flush the tail; for HTTP also terminates the chunked response
+     *
+     * @return esp_err_t First error seen by the writer or ESP_OK
+     */
+    esp_err_t um_json_writer_finish(um_json_writer_t *w);
+
+    /** @brief First error seen by the writer */
+    static inline esp_err_t um_json_writer_error(const um_json_writer_t *w) { return w->err; }
+
+    /** @brief Total bytes produced so far */
+    static inline size_t um_json_writer_size(const um_json_writer_t *w) { return w->flushed + w->len; }
+
+    void um_json_obj_begin(um_json_writer_t *w);
+    void um_json_obj_end(um_json_writer_t *w);
+    void um_json_arr_begin(um_json_writer_t *w);
+    void um_json_arr_end(um_json_writer_t *w);
+
+    /** @brief Object key; must be followed by exactly one value */
+    void um_json_key(um_json_writer_t *w, const char *key);
+
+    /** @brief String value (escaped), NULL writes null */
+    void um_json_str(um_json_writer_t *w, const char *str);
+    void um_json_int(um_json_writer_t *w, int64_t value);
+    /** @brief Number; NaN and infinity are written as null like cJSON */
+    void um_json_num(um_json_writer_t *w, double value);
+    void um_json_bool(um_json_writer_t *w, bool value);
+    void um_json_null(um_json_writer_t *w);
+
+    /**
+     * @brief Already serialized JSON value, copied as is
+     */
+    void um_json_raw(um_json_writer_t *w, const char *json, size_t len);
+
+    /**
+     * @brief JSON value from a um_storage file, streamed through the buffer
+     *
+     * @return esp_err_t ESP_ERR_NOT_FOUND if the file is missing (nothing written)
+     */
+    esp_err_t um_json_raw_file(um_json_writer_t *w, const char *path);
+
+    static inline void um_json_kv_str(um_json_writer_t *w, const char *k, const char *v)
+    {
+        um_json_key(w, k);
+        um_json_str(w, v);
+    }
+
+    static inline void um_json_kv_int(um_json_writer_t *w, const char *k, int64_t v)
+    {
+        um_json_key(w, k);
+        um_json_int(w, v);
+    }
+
+    static inline void um_json_kv_num(um_json_writer_t *w, const char *k, double v)
+    {
+        um_json_key(w, k);
+        um_json_num(w, v);
+    }
+
+    static inline void um_json_kv_bool(um_json_writer_t *w, const char *k, bool v)
+    {
+        um_json_key(w, k);
+        um_json_bool(w, v);
+    }
+
+#ifdef __cplusplus
+}
+#endif
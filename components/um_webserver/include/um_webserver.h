@@ -4,6 +4,8 @@
 #include "base_config.h"
 #include "esp_http_server.h"
 #include "cJSON.h"
+#include "um_json_writer.h"
+#include "um_json_stream.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -12,16 +14,119 @@ extern "C"
 
 #if UM_FEATURE_ENABLED(WEBSERVER)
 
-    static esp_err_t um_webserver_base_get_handler(
-        httpd_req_t *req,
-        esp_err_t (*get_data)(httpd_req_t *, cJSON **));
+/** Предел тела POST по умолчанию (um_webserver_endpoint_opts_t.max_body = 0) */
+#define UM_WEBSERVER_MAX_BODY 2048
 
-    static esp_err_t um_webserver_base_post_handler(
-        httpd_req_t *req,
-        esp_err_t (*process_data)(httpd_req_t *, cJSON *input, cJSON **output));
+/** Бит события um_events для um_webserver_endpoint_opts_t.invalidate_on */
+#define UM_WEBSERVER_EVENT_BIT(id) (1u << (id))
+
+    /**
+     * @brief Опции endpoint (NULL при регистрации - значения по умолчанию)
+     */
+    typedef struct
+    {
+        bool async;             /**< Выполнять в пуле задач, а не в задаче httpd (для медленных обработчиков) */
+        bool cache;             /**< Кэшировать успешный ответ по URI с query (только GET) */
+        uint32_t invalidate_on; /**< События, сбрасывающие кэш: UM_WEBSERVER_EVENT_BIT(UMNI_EVENT_...) */
+        size_t max_body;        /**< Предел тела POST в байтах, 0 - UM_WEBSERVER_MAX_BODY; больше - 413 */
+        bool no_auth;           /**< Доступен без токена при CONFIG_UM_CFG_WEBSERVER_AUTH */
+        uint16_t rate_limit;    /**< Запросов в секунду с одного адреса, 0 - CONFIG_UM_CFG_WEBSERVER_RATE_LIMIT; больше - 429 */
+    } um_webserver_endpoint_opts_t;
+
+    /**
+     * @brief Тело POST запроса, читаемое кусками
+     */
+    typedef struct
+    {
+        httpd_req_t *req;
+        size_t remaining; /**< Ещё не прочитано байт */
+    } um_webserver_body_t;
+
+    /**
+     * @brief Прочитать следующий кусок тела
+     *
+     * Докачивает частичные чтения и повторяет при таймауте сокета.
+     * @param out_len прочитано байт, 0 - тело закончилось
+     * @return ESP_OK, ESP_ERR_TIMEOUT - клиент перестал слать данные, ESP_FAIL - соединение закрыто
+     */
+    esp_err_t um_webserver_body_read(um_webserver_body_t *body, char *buf, size_t size, size_t *out_len);
+
+    /**
+     * @brief Разобрать тело потоковым токенизатором JSON (буфер на стеке)
+     *
+     * @return ESP_OK, ESP_ERR_INVALID_ARG - синтаксическая ошибка, ошибка чтения или cb
+     */
+    esp_err_t um_webserver_body_parse_json(um_webserver_body_t *body, um_json_stream_cb_t cb, void *ctx);
+
+    /**
+     * @brief Сохранить тело в файл атомарно: оригинал заменяется только после приёма всего тела
+     *
+     * @param flags UM_STORAGE_FLAG_*
+     * @param validate инициализированный токенизатор, через который пропускается тело
+     *                 (файл не заменяется при ошибке разбора), или NULL
+     * @return ESP_OK, ошибка чтения, разбора или записи
+     */
+    esp_err_t um_webserver_body_save(um_webserver_body_t *body, const char *path, uint32_t flags,
+                                     um_json_stream_t *validate);
+
+    /**
+     * @brief Потоковый обработчик POST: сам читает тело через um_webserver_body_*
+     *
+     * Ответ формируется как для обычного POST по коду возврата и output.
+     */
+    typedef esp_err_t (*um_webserver_body_fn)(httpd_req_t *req, um_webserver_body_t *body, cJSON **output);
+
+    /**
+     * @brief Статистика endpoint
+     */
+    typedef struct
+    {
+        const char *uri;
+        httpd_method_t method;
+        bool async;
+        uint32_t requests;   /**< Выполнено запросов */
+        uint32_t errors;     /**< Обработчик вернул ошибку */
+        uint32_t rejected;   /**< Отклонено с 503: очередь пула полна или слишком много запросов в работе */
+        uint32_t limited;    /**< Отклонено с 429: клиент превысил частоту запросов */
+        uint32_t cache_hits; /**< Отдано из кэша (входит в requests) */
+        uint64_t total_us;   /**< Суммарное время ответа (для async - вместе с ожиданием в очереди) */
+        uint32_t max_us;     /**< Самый медленный ответ */
+    } um_webserver_endpoint_stats_t;
 
     esp_err_t um_webserver_register_get(const char *uri, esp_err_t (*handler)(httpd_req_t *, cJSON **));
 
+    /**
+     * @brief Зарегистрировать GET endpoint с опциями
+     */
+    esp_err_t um_webserver_register_get_ex(const char *uri, esp_err_t (*handler)(httpd_req_t *, cJSON **),
+                                           const um_webserver_endpoint_opts_t *opts);
+
+    /**
+     * @brief Потоковый обработчик: пишет значение data через writer
+     *
+     * Должен записать ровно одно значение (объект, массив, ...). Ошибку лучше
+     * вернуть до начала записи: пока ничего не отправлено, клиент получит
+     * обычный {"success":false,...}, иначе соединение будет оборвано.
+     */
+    typedef esp_err_t (*um_webserver_stream_fn)(httpd_req_t *req, um_json_writer_t *w);
+
+    /**
+     * @brief Зарегистрировать потоковый GET endpoint
+     *
+     * Ответ {"success":true,"data":...} уходит кусками через
+     * httpd_resp_send_chunk, без построения дерева cJSON.
+     * @param uri URI endpoint (например "/api/onewire")
+     * @param write_func функция записи data
+     * @return esp_err_t
+     */
+    esp_err_t um_webserver_register_get_stream(const char *uri, um_webserver_stream_fn write_func);
+
+    /**
+     * @brief Зарегистрировать потоковый GET endpoint с опциями
+     */
+    esp_err_t um_webserver_register_get_stream_ex(const char *uri, um_webserver_stream_fn write_func,
+                                                  const um_webserver_endpoint_opts_t *opts);
+
     /**
      * @brief Зарегистрировать POST endpoint
      * @param uri URI endpoint (например "/api/data")
@@ -31,6 +136,31 @@ extern "C"
     esp_err_t um_webserver_register_post(const char *uri,
                                          esp_err_t (*process_func)(httpd_req_t *, cJSON *, cJSON **));
 
+    /**
+     * @brief Зарегистрировать POST endpoint с опциями
+     */
+    esp_err_t um_webserver_register_post_ex(const char *uri,
+                                            esp_err_t (*process_func)(httpd_req_t *, cJSON *, cJSON **),
+                                            const um_webserver_endpoint_opts_t *opts);
+
+    /**
+     * @brief Зарегистрировать POST endpoint с потоковым чтением тела
+     *
+     * Тело не собирается в памяти целиком, поэтому предел (opts.max_body)
+     * может быть больше свободной кучи - например, для загрузки файлов.
+     */
+    esp_err_t um_webserver_register_post_stream_ex(const char *uri, um_webserver_body_fn process_func,
+                                                   const um_webserver_endpoint_opts_t *opts);
+
+    /**
+     * @brief Статистика всех endpoints
+     *
+     * @param stats массив для результата (NULL при max = 0)
+     * @param max размер массива
+     * @return количество endpoints; больше max - записаны только первые max
+     */
+    size_t um_webserver_get_endpoint_stats(um_webserver_endpoint_stats_t *stats, size_t max);
+
     /**
      * @brief Инициализация и запуск веб-сервера
      *
@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+# Нагрузочные проверки веб-сервера на устройстве (только стандартная библиотека)
+#
+#   webload.py assets http://umni.local [--clients 7] [--requests 50] [path ...]
+#   webload.py fanout http://umni.local [--ws 4] [--sse 3] [--events 50] [--output 8]
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import queue
+import socket
+import struct
+import sys
+import threading
+import time
+import urllib.parse
+
+DEFAULT_ASSETS = ['/', '/index.html']
+
+
+def connect(base, timeout):
+    url = urllib.parse.urlsplit(base)
+    cls = http.client.HTTPSConnection if url.scheme == 'https' else http.client.HTTPConnection
+    return cls(url.hostname, url.port, timeout=timeout)
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.status = {}
+        self.errors = []
+        self.latency = []
+        self.ttfb = []
+        self.bytes = 0
+
+    def add(self, status, ttfb, latency, size):
+        with self.lock:
+            self.status[status] = self.status.get(status, 0) + 1
+            self.ttfb.append(ttfb)
+            self.latency.append(latency)
+            self.bytes += size
+
+    def error(self, msg):
+        with self.lock:
+            self.errors.append(msg)
+
+
+def fetch(conn, path, headers):
+    """GET по keep-alive соединению: (статус, заголовки, тело, TTFB, время)"""
+    start = time.monotonic()
+    conn.request('GET', path, headers=headers)
+    resp = conn.getresponse()
+    ttfb = time.monotonic() - start
+    body = resp.read()
+    return resp.status, resp, body, ttfb, time.monotonic() - start
+
+
+def check_variant(stats, path, status, resp, gzip_ok):
+    encoding = resp.getheader('Content-Encoding', '')
+    vary = resp.getheader('Vary', '')
+    if encoding == 'gzip' and not gzip_ok:
+        stats.error('%s: gzip sent without Accept-Encoding: gzip' % path)
+    if (encoding == 'gzip' or status == 406) and 'Accept-Encoding' not in vary:
+        stats.error('%s: %d %s without Vary: Accept-Encoding' % (path, status, encoding or 'identity'))
+    if status == 304 and not resp.getheader('ETag'):
+        stats.error('%s: 304 without ETag' % path)
+
+
+def assets_client(args, stats, barrier):
+    """Один клиент браузера: свои ETag, половина запросов - повторная проверка"""
+    etags = {}
+    conn = connect(args.url, args.timeout)
+    barrier.wait()
+    for i in range(args.requests):
+        path = args.paths[i % len(args.paths)]
+        headers = {'Accept-Encoding': 'gzip, deflate'}
+        if path in etags and i % 2:
+            headers['If-None-Match'] = etags[path]
+        try:
+            status, resp, body, ttfb, latency = fetch(conn, path, headers)
+        except (OSError, http.client.HTTPException) as e:
+            stats.error('%s: %s' % (path, e))
+            conn.close()
+            conn = connect(args.url, args.timeout)
+            continue
+        stats.add(status, ttfb, latency, len(body))
+        check_variant(stats, path, status, resp, True)
+        if status == 200 and resp.getheader('ETag'):
+            etags[path] = resp.getheader('ETag')
+        if status not in (200, 304):
+            stats.error('%s: HTTP %d' % (path, status))
+        if resp.will_close:
+            conn.close()
+            conn = connect(args.url, args.timeout)
+    conn.close()
+
+
+def assets(args):
+    args.paths = args.paths or DEFAULT_ASSETS
+
+    # Клиент без gzip: несжатая копия или 406, но не gzip
+    stats = Stats()
+    conn = connect(args.url, args.timeout)
+    for path in args.paths:
+        status, resp, body, ttfb, latency = fetch(conn, path, {'Accept-Encoding': 'identity'})
+        check_variant(stats, path, status, resp, False)
+        print('%-24s identity: %d %s' % (path, status, resp.getheader('Content-Encoding', 'identity')))
+    conn.close()
+
+    barrier = threading.Barrier(args.clients + 1)
+    threads = [threading.Thread(target=assets_client, args=(args, stats, barrier))
+               for _ in range(args.clients)]
+    for t in threads:
+        t.start()
+    barrier.wait()
+    start = time.monotonic()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - start
+
+    total = sum(stats.status.values())
+    print('%d clients x %d requests: %d done in %.2f s, %.1f req/s, %.1f KB/s' %
+          (args.clients, args.requests, total, elapsed, total / elapsed, stats.bytes / 1024 / elapsed))
+    print('status: %s' % ', '.join('%d x %d' % kv for kv in sorted(stats.status.items())))
+    print('TTFB    p50 %6.1f ms  p95 %6.1f ms  max %6.1f ms' %
+          tuple(1000 * percentile(stats.ttfb, p) for p in (50, 95, 100)))
+    print('latency p50 %6.1f ms  p95 %6.1f ms  max %6.1f ms' %
+          tuple(1000 * percentile(stats.latency, p) for p in (50, 95, 100)))
+    return report_errors(stats)
+
+
+class WsClient:
+    """Минимальный клиент WebSocket: текстовые кадры сервера без маски"""
+
+    def __init__(self, base, path, timeout):
+        url = urllib.parse.urlsplit(base)
+        self.sock = socket.create_connection((url.hostname, url.port or 80), timeout)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(('GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n'
+                           'Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n' %
+                           (path, url.hostname, key)).encode())
+        self.rx = b''
+        head = self.read_until(b'\r\n\r\n')
+        if not head.startswith(b'HTTP/1.1 101'):
+            raise OSError('handshake: %s' % head.split(b'\r\n')[0].decode(errors='replace'))
+
+    def read_until(self, sep):
+        while sep not in self.rx:
+            self.recv_more()
+        head, self.rx = self.rx.split(sep, 1)
+        return head
+
+    def recv_more(self):
+        data = self.sock.recv(4096)
+        if not data:
+            raise OSError('closed')
+        self.rx += data
+
+    def read(self, n):
+        while len(self.rx) < n:
+            self.recv_more()
+        data, self.rx = self.rx[:n], self.rx[n:]
+        return data
+
+    def recv_text(self):
+        while True:
+            b0, b1 = self.read(2)
+            n = b1 & 0x7f
+            if n == 126:
+                n = struct.unpack('>H', self.read(2))[0]
+            elif n == 127:
+                n = struct.unpack('>Q', self.read(8))[0]
+            payload = self.read(n)
+            if b0 & 0x0f == 0x8:
+                raise OSError('closed by server')
+            if b0 & 0x0f == 0x1:
+                return payload.decode()
+
+    def close(self):
+        self.sock.close()
+
+
+def ws_reader(args, path, out, ready, stats):
+    try:
+        ws = WsClient(args.url, path, args.timeout)
+        ws.sock.settimeout(None)
+        ready.wait()
+        while True:
+            msg = json.loads(ws.recv_text())
+            out.put((time.monotonic(), msg))
+    except (OSError, ValueError) as e:
+        stats.error('ws: %s' % e)
+        out.put((time.monotonic(), None))
+
+
+def sse_reader(args, path, out, ready, stats):
+    try:
+        # Без таймаута: в тишине сервер шлёт только keep-alive раз в 15 с
+        conn = connect(args.url, None)
+        conn.request('GET', path, headers={'Accept': 'text/event-stream'})
+        resp = conn.getresponse()
+        if resp.status != 200:
+            raise OSError('HTTP %d' % resp.status)
+        ready.wait()
+        while True:
+            line = resp.readline()
+            if not line:
+                raise OSError('closed')
+            if line.startswith(b'data: '):
+                out.put((time.monotonic(), json.loads(line[6:])))
+    except (OSError, ValueError, http.client.HTTPException) as e:
+        stats.error('sse: %s' % e)
+        out.put((time.monotonic(), None))
+
+
+def toggle_output(args, index, state):
+    conn = connect(args.url, args.timeout)
+    headers = {'Content-Type': 'application/json'}
+    if args.token:
+        headers['Authorization'] = 'Bearer ' + args.token
+    body = json.dumps([{'op': 'output', 'index': index, 'state': state}])
+    conn.request('POST', '/api/batch', body=body, headers=headers)
+    resp = conn.getresponse()
+    resp.read()
+    conn.close()
+    return resp.status
+
+
+def wait_out(out, deadline):
+    """Следующее сообщение "out" клиента: время прихода или None"""
+    while True:
+        try:
+            ts, msg = out.get(timeout=max(0, deadline - time.monotonic()))
+        except queue.Empty:
+            return None
+        if msg is None:
+            return None
+        if msg.get('t') == 'out':
+            return ts
+
+
+def fanout(args):
+    """
+    Задержка и разброс доставки одного события всем клиентам /ws и /api/events
+
+    Событие - переключение выхода через /api/batch; время считается от отправки POST.
+    """
+    suffix = '?token=' + urllib.parse.quote(args.token) if args.token else ''
+    stats = Stats()
+    ready = threading.Event()
+    clients = []
+    for i in range(args.ws + args.sse):
+        kind = 'ws' if i < args.ws else 'sse'
+        out = queue.Queue()
+        if kind == 'ws':
+            t = threading.Thread(target=ws_reader, args=(args, '/ws' + suffix, out, ready, stats), daemon=True)
+        else:
+            path = '/api/events' + (suffix + '&' if suffix else '?') + 'ids=out'
+            t = threading.Thread(target=sse_reader, args=(args, path, out, ready, stats), daemon=True)
+        t.start()
+        clients.append((kind, out))
+
+    # Снимок при подключении приходит до начала замеров и отбрасывается
+    ready.set()
+    time.sleep(1)
+    for _, out in clients:
+        while not out.empty():
+            out.get()
+
+    latency = {'ws': [], 'sse': []}
+    spread = []
+    lost = 0
+    for i in range(args.events):
+        start = time.monotonic()
+        status = toggle_output(args, args.output, i % 2 == 0)
+        if status != 200:
+            stats.error('/api/batch: HTTP %d' % status)
+            break
+        arrivals = []
+        for kind, out in clients:
+            ts = wait_out(out, start + args.timeout)
+            if ts is None:
+                lost += 1
+                continue
+            latency[kind].append(ts - start)
+            arrivals.append(ts)
+        if arrivals:
+            spread.append(max(arrivals) - min(arrivals))
+        time.sleep(args.interval)
+
+    print('%d ws + %d sse clients, %d events, %d deliveries lost' % (args.ws, args.sse, args.events, lost))
+    for kind in ('ws', 'sse'):
+        if latency[kind]:
+            print('%-3s latency p50 %6.1f ms  p95 %6.1f ms  max %6.1f ms' %
+                  ((kind,) + tuple(1000 * percentile(latency[kind], p) for p in (50, 95, 100))))
+    print('spread      p50 %6.1f ms  p95 %6.1f ms  max %6.1f ms' %
+          tuple(1000 * percentile(spread, p) for p in (50, 95, 100)))
+    if lost:
+        stats.error('%d deliveries lost' % lost)
+    return report_errors(stats)
+
+
+def report_errors(stats):
+    for e in stats.errors[:20]:
+        print('error: ' + e, file=sys.stderr)
+    if len(stats.errors) > 20:
+        print('error: ... %d more' % (len(stats.errors) - 20), file=sys.stderr)
+    return 1 if stats.errors else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='UMNI web server load tests')
+    parser.add_argument('--timeout', type=float, default=10)
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('assets', help='concurrent static file fetches with revalidation')
+    p.add_argument('url', help='e.g. http://umni.local')
+    p.add_argument('paths', nargs='*', help='default: / /index.html')
+    p.add_argument('--clients', type=int, default=7, help='CONFIG_UM_CFG_WEBSERVER_MAX_SOCKETS')
+    p.add_argument('--requests', type=int, default=50, help='per client')
+    p.set_defaults(func=assets)
+
+    p = sub.add_parser('fanout', help='event delivery latency to all /ws and /api/events clients')
+    p.add_argument('url', help='e.g. http://umni.local')
+    p.add_argument('--ws', type=int, default=4, help='WebSocket clients (UM_WS_MAX_CLIENTS)')
+    p.add_argument('--sse', type=int, default=3, help='SSE streams (UM_SSE_MAX_STREAMS)')
+    p.add_argument('--events', type=int, default=50)
+    p.add_argument('--interval', type=float, default=0.2, help='seconds between events')
+    p.add_argument('--output', type=int, default=8, help='output index 1-8 to toggle')
+    p.add_argument('--token', default='', help='access token, if authorization is enabled')
+    p.set_defaults(func=fanout)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,376 @@
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "um_json_writer.h"
+#include "um_storage.h"
+
+static const char *TAG = "um_json_writer";
+
+static esp_err_t httpd_flush(void *ctx, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+void um_json_writer_init(um_json_writer_t *w, um_json_flush_fn flush, void *ctx)
+{
+    w->len = 0;
+    w->flushed = 0;
+    w->has_items = 0;
+    w->depth = 0;
+    w->after_key = false;
+    w->err = ESP_OK;
+    w->flush = flush;
+    w->ctx = ctx;
+    w->start_us = esp_timer_get_time();
+    w->first_flush_us = 0;
+}
+
+void um_json_writer_init_httpd(um_json_writer_t *w, httpd_req_t *req)
+{
+    um_json_writer_init(w, httpd_flush, req);
+}
+
+esp_err_t um_json_writer_reset(um_json_writer_t *w)
+{
+    if (w->flushed > 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    um_json_writer_init(w, w->flush, w->ctx);
+    return ESP_OK;
+}
+
+static void flush_buf(um_json_writer_t *w)
+{
+    if (w->err != ESP_OK || w->len == 0)
+    {
+        return;
+    }
+
+    w->err = w->flush(w->ctx, w->buf, w->len);
+    if (w->err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Sink error after %u bytes: %s", (unsigned)w->flushed, esp_err_to_name(w->err));
+        return;
+    }
+    if (w->flushed == 0)
+    {
+        w->first_flush_us = esp_timer_get_time() - w->start_us;
+    }
+    w->flushed += w->len;
+    w->len = 0;
+}
+
+static void put(um_json_writer_t *w, const char *data, size_t len)
+{
+    while (len > 0 && w->err == ESP_OK)
+    {
+        size_t room = sizeof(w->buf) - w->len;
+        if (room == 0)
+        {
+            flush_buf(w);
+            continue;
+        }
+        size_t n = len < room ? len : room;
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static inline void put_c(um_json_writer_t *w, char c)
+{
+    if (w->len == sizeof(w->buf))
+    {
+        flush_buf(w);
+    }
+    if (w->err == ESP_OK)
+    {
+        w->buf[w->len++] = c;
+    }
+}
+
+/**
+ * @brief Разделитель перед значением или ключом
+ */
+static bool begin_value(um_json_writer_t *w)
+{
+    if (w->err != ESP_OK)
+    {
+        return false;
+    }
+    if (w->after_key)
+    {
+        w->after_key = false;
+        return true;
+    }
+    if (w->has_items & (1u << w->depth))
+    {
+        put_c(w, ',');
+    }
+    w->has_items |= 1u << w->depth;
+    return true;
+}
+
+static void put_escaped(um_json_writer_t *w, const char *s)
+{
+    put_c(w, '"');
+    const char *run = s;
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+
+        put(w, run, s - run);
+        run = s + 1;
+
+        char esc[8];
+        switch (c)
+        {
+        case '"':
+            put(w, "\\\"", 2);
+            break;
+        case '\\':
+            put(w, "\\\\", 2);
+            break;
+        case '\n':
+            put(w, "\\n", 2);
+            break;
+        case '\r':
+            put(w, "\\r", 2);
+            break;
+        case '\t':
+            put(w, "\\t", 2);
+            break;
+        case '\b':
+            put(w, "\\b", 2);
+            break;
+        case '\f':
+            put(w, "\\f", 2);
+            break;
+        default:
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            put(w, esc, 6);
+            break;
+        }
+    }
+    put(w, run, s - run);
+    put_c(w, '"');
+}
+
+static void open_container(um_json_writer_t *w, char c)
+{
+    if (!begin_value(w))
+    {
+        return;
+    }
+    if (w->depth + 1 >= UM_JSON_WRITER_MAX_DEPTH)
+    {
+        w->err = ESP_ERR_INVALID_SIZE;
+        return;
+    }
+    put_c(w, c);
+    w->depth++;
+    w->has_items &= ~(1u << w->depth);
+}
+
+static void close_container(um_json_writer_t *w, char c)
+{
+    if (w->err != ESP_OK)
+    {
+        return;
+    }
+    if (w->depth == 0 || w->after_key)
+    {
+        w->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    put_c(w, c);
+    w->depth--;
+}
+
+void um_json_obj_begin(um_json_writer_t *w)
+{
+    open_container(w, '{');
+}
+
+void um_json_obj_end(um_json_writer_t *w)
+{
+    close_container(w, '}');
+}
+
+void um_json_arr_begin(um_json_writer_t *w)
+{
+    open_container(w, '[');
+}
+
+void um_json_arr_end(um_json_writer_t *w)
+{
+    close_container(w, ']');
+}
+
+void um_json_key(um_json_writer_t *w, const char *key)
+{
+    if (w->after_key)
+    {
+        w->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    if (!begin_value(w))
+    {
+        return;
+    }
+    put_escaped(w, key ? key : "");
+    put_c(w, ':');
+    w->after_key = true;
+}
+
+void um_json_str(um_json_writer_t *w, const char *str)
+{
+    if (!str)
+    {
+        um_json_null(w);
+        return;
+    }
+    if (begin_value(w))
+    {
+        put_escaped(w, str);
+    }
+}
+
+void um_json_int(um_json_writer_t *w, int64_t value)
+{
+    if (begin_value(w))
+    {
+        char num[24];
+        int n = snprintf(num, sizeof(num), "%" PRId64, value);
+        put(w, num, n);
+    }
+}
+
+void um_json_num(um_json_writer_t *w, double value)
+{
+    if (!begin_value(w))
+    {
+        return;
+    }
+
+    char num[32];
+    int n;
+    if (isnan(value) || isinf(value))
+    {
+        n = snprintf(num, sizeof(num), "null");
+    }
+    else if (value == (double)(int64_t)value && fabs(value) < 1e15)
+    {
+        n = snprintf(num, sizeof(num), "%" PRId64, (int64_t)value);
+    }
+    else
+    {
+        // Как cJSON: 15 знаков, если значение восстанавливается, иначе 17
+        n = snprintf(num, sizeof(num), "%1.15g", value);
+        double check = 0;
+        if (sscanf(num, "%lg", &check) != 1 || check != value)
+        {
+            n = snprintf(num, sizeof(num), "%1.17g", value);
+        }
+    }
+    put(w, num, n);
+}
+
+void um_json_bool(um_json_writer_t *w, bool value)
+{
+    if (begin_value(w))
+    {
+        put(w, value ? "true" : "false", value ? 4 : 5);
+    }
+}
+
+void um_json_null(um_json_writer_t *w)
+{
+    if (begin_value(w))
+    {
+        put(w, "null", 4);
+    }
+}
+
+void um_json_raw(um_json_writer_t *w, const char *json, size_t len)
+{
+    if (begin_value(w))
+    {
+        put(w, json, len);
+    }
+}
+
+esp_err_t um_json_raw_file(um_json_writer_t *w, const char *path)
+{
+    if (w->err != ESP_OK)
+    {
+        return w->err;
+    }
+
+    um_storage_stream_t stream;
+    esp_err_t ret = um_storage_open_stream(path, &stream);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    begin_value(w);
+
+    // Читаем прямо в свободную часть буфера писателя
+    while (w->err == ESP_OK)
+    {
+        if (w->len == sizeof(w->buf))
+        {
+            flush_buf(w);
+            continue;
+        }
+        size_t n = 0;
+        ret = um_storage_read_chunk(&stream, w->buf + w->len, sizeof(w->buf) - w->len, &n);
+        if (ret != ESP_OK)
+        {
+            w->err = ret;
+            break;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        w->len += n;
+    }
+    um_storage_close_stream(&stream);
+
+    return w->err;
+}
+
+esp_err_t um_json_writer_finish(um_json_writer_t *w)
+{
+    if (w->err == ESP_OK && (w->depth != 0 || w->after_key))
+    {
+        w->err = ESP_ERR_INVALID_STATE;
+    }
+
+    flush_buf(w);
+    if (w->err == ESP_OK && w->flush == httpd_flush)
+    {
+        // Завершающий пустой chunk
+        w->err = httpd_resp_send_chunk((httpd_req_t *)w->ctx, NULL, 0);
+    }
+    if (w->first_flush_us == 0 && w->err == ESP_OK)
+    {
+        w->first_flush_us = esp_timer_get_time() - w->start_us;
+    }
+
+    ESP_LOGD(TAG, "%u bytes, first byte after %" PRId64 " us, total %" PRId64 " us",
+             (unsigned)w->flushed, w->first_flush_us, esp_timer_get_time() - w->start_us);
+    return w->err;
+}
@@ -1,60 +1,339 @@
 #include <string.h>
 #include <sys/param.h>
+#include <unistd.h>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #include "base_config.h"
 
+#include "um_events.h"
+#include "um_metrics.h"
+#include "um_storage.h"
 #include "um_webserver.h"
+#include "um_webserver_priv.h"
 
 #if UM_FEATURE_ENABLED(ONEWIRE)
 #include "um_onewire_config.h"
 #endif
 
+#if UM_FEATURE_ENABLED(SDCARD)
+#include "um_sd.h"
+#endif
+
 #if UM_FEATURE_ENABLED(WEBSERVER)
 
 #define WEBSERVER_TAG "um_webserver"
 
 static const char *REST_TAG = "um_webserver";
 static httpd_handle_t server = NULL;
+// Выставляется на время um_webserver_stop(), читается задачей httpd
+static volatile bool stopping = false;
+
+static esp_err_t endpoint_handler(httpd_req_t *req);
+
+// Wildcard статики должен оставаться последним GET обработчиком;
+// user_ctx - endpoint статики, создаётся в um_webserver_start()
+static httpd_uri_t static_uri = {
+    .uri = "/*",
+    .method = HTTP_GET,
+    .handler = endpoint_handler,
+    .user_ctx = NULL};
+static bool static_registered = false;
 
 typedef esp_err_t (*um_data_provider_t)(httpd_req_t *req, cJSON **data_out);
 
-typedef struct
+typedef enum
 {
-    esp_err_t (*get_data)(httpd_req_t *, cJSON **);
-} get_ctx_t;
+    ENDPOINT_GET,
+    ENDPOINT_GET_STREAM,
+    ENDPOINT_POST,
+    ENDPOINT_POST_STREAM,
+    ENDPOINT_RAW, // обработчик сам формирует ответ (файлы)
+} endpoint_kind_t;
 
-typedef struct
+/**
+ * @brief Зарегистрированный endpoint: обработчик, опции и статистика
+ */
+typedef struct endpoint
+{
+    endpoint_kind_t kind;
+    union
+    {
+        esp_err_t (*get_data)(httpd_req_t *, cJSON **);
+        um_webserver_stream_fn write_data;
+        esp_err_t (*process_data)(httpd_req_t *, cJSON *, cJSON **);
+        um_webserver_body_fn process_body;
+        esp_err_t (*handle)(httpd_req_t *);
+    };
+    um_webserver_endpoint_opts_t opts;
+    um_webserver_endpoint_stats_t stats; // под stats_mux
+    struct endpoint *next;
+} endpoint_t;
+
+static endpoint_t *endpoints = NULL;
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint32_t http_time_bounds[] = UM_METRICS_US_BUCKETS;
+static uint32_t http_time_buckets[sizeof(http_time_bounds) / sizeof(http_time_bounds[0]) + 1];
+static um_metric_t m_http_time = UM_METRIC_HISTOGRAM("um_http_request_duration_seconds",
+                                                     "API response time incl. worker queue wait",
+                                                     http_time_bounds, http_time_buckets, 1e-6f);
+
+static esp_err_t um_webserver_base_get_handler(httpd_req_t *req, esp_err_t (*get_data)(httpd_req_t *, cJSON **));
+static esp_err_t um_webserver_base_post_handler(httpd_req_t *req,
+                                                esp_err_t (*process_data)(httpd_req_t *, cJSON *, cJSON **),
+                                                size_t max_body);
+static esp_err_t um_webserver_base_stream_handler(httpd_req_t *req, um_webserver_stream_fn write_data);
+static esp_err_t cached_get_handler(httpd_req_t *req, endpoint_t *ep);
+static esp_err_t cached_stream_handler(httpd_req_t *req, endpoint_t *ep);
+static esp_err_t um_webserver_base_post_stream_handler(httpd_req_t *req, um_webserver_body_fn process_body,
+                                                       size_t max_body);
+
+/**
+ * @brief Регистрация обработчика с сохранением статики в конце списка
+ *
+ * httpd ищет обработчик по порядку регистрации: снимаем wildcard статики,
+ * регистрируем endpoint и возвращаем статику последней.
+ */
+static esp_err_t register_handler(const httpd_uri_t *uri)
+{
+    bool move_static = static_registered && uri->method == HTTP_GET;
+    if (move_static)
+    {
+        httpd_unregister_uri_handler(server, static_uri.uri, HTTP_GET);
+    }
+    esp_err_t ret = httpd_register_uri_handler(server, uri);
+    if (move_static && httpd_register_uri_handler(server, &static_uri) != ESP_OK && ret == ESP_OK)
+    {
+        // Таблица заполнена: место остаётся за статикой, без неё нет интерфейса
+        httpd_unregister_uri_handler(server, uri->uri, uri->method);
+        httpd_register_uri_handler(server, &static_uri);
+        ret = ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(WEBSERVER_TAG, "%s %s not registered: %s", http_method_str(uri->method), uri->uri,
+                 esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static const char *get_error_message(esp_err_t ret)
+{
+    if (ret == ESP_ERR_INVALID_ARG)
+        return "Invalid arguments";
+    if (ret == ESP_ERR_NOT_FOUND)
+        return "Not found";
+    if (ret == ESP_ERR_NOT_SUPPORTED)
+        return "Feature disabled";
+    if (ret == ESP_ERR_NO_MEM)
+        return "Out of memory";
+    return "Unknown error";
+}
+
+/**
+ * @brief Кэшируется ли ответ endpoint
+ *
+ * Флаг снимает worker (ответ не поместился в кэш), читают задача httpd и
+ * другие workers - поэтому атомарно.
+ */
+static bool endpoint_cached(endpoint_t *ep)
+{
+    return __atomic_load_n(&ep->opts.cache, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Учесть выполненный запрос в статистике endpoint
+ *
+ * @param start_us время приёма запроса (для async включает ожидание в очереди)
+ */
+static void record_request(endpoint_t *ep, esp_err_t ret, int64_t start_us, bool cache_hit)
+{
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start_us);
+    um_metric_observe(&m_http_time, elapsed);
+
+    portENTER_CRITICAL(&stats_mux);
+    ep->stats.requests++;
+    if (ret != ESP_OK)
+    {
+        ep->stats.errors++;
+    }
+    if (cache_hit)
+    {
+        ep->stats.cache_hits++;
+    }
+    ep->stats.total_us += elapsed;
+    if (elapsed > ep->stats.max_us)
+    {
+        ep->stats.max_us = elapsed;
+    }
+    portEXIT_CRITICAL(&stats_mux);
+}
+
+/**
+ * @brief Выполнить endpoint и учесть время ответа
+ */
+static esp_err_t run_endpoint(httpd_req_t *req, endpoint_t *ep, int64_t start_us)
 {
-    esp_err_t (*process_data)(httpd_req_t *, cJSON *, cJSON **);
-} post_ctx_t;
+    esp_err_t ret;
+    switch (ep->kind)
+    {
+    case ENDPOINT_GET:
+        ret = endpoint_cached(ep) ? cached_get_handler(req, ep)
+                                  : um_webserver_base_get_handler(req, ep->get_data);
+        break;
+    case ENDPOINT_GET_STREAM:
+        ret = endpoint_cached(ep) ? cached_stream_handler(req, ep)
+                                  : um_webserver_base_stream_handler(req, ep->write_data);
+        break;
+    case ENDPOINT_POST:
+        ret = um_webserver_base_post_handler(req, ep->process_data, ep->opts.max_body);
+        break;
+    case ENDPOINT_RAW:
+        ret = ep->handle(req);
+        break;
+    default:
+        ret = um_webserver_base_post_stream_handler(req, ep->process_body, ep->opts.max_body);
+        break;
+    }
 
-// Простая HTML страница для теста, если нет SD карты
-static const char *TEST_HTML =
-    "<!DOCTYPE html><html><head><title>UM WebServer</title>"
-    "<meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1'>"
-    "<style>body{font-family:Arial,sans-serif;margin:40px;background:#f5f5f5;}"
-    ".container{max-width:800px;margin:0 auto;background:white;padding:30px;border-radius:10px;box-shadow:0 2px 10px rgba(0,0,0,0.1);}"
-    "h1{color:#333;border-bottom:2px solid #4CAF50;padding-bottom:10px;}"
-    ".status{background:#e8f5e9;padding:15px;border-radius:5px;margin:20px 0;}"
-    "</style></head>"
-    "<body><div class='container'>"
-    "<h1>UM WebServer</h1>"
-    "<div class='status'>Веб-сервер работает успешно!</div>"
-    "<p>Версия: 1.0.0</p>"
-    "<p>Используйте REST API для взаимодействия</p>"
-    "</div></body></html>";
+    record_request(ep, ret, start_us, false);
+    um_webserver_inflight_release();
+    return ret;
+}
 
-static esp_err_t get_wrapper(httpd_req_t *req)
+static esp_err_t run_endpoint_async(httpd_req_t *req, void *arg, int64_t start_us)
 {
-    get_ctx_t *ctx = (get_ctx_t *)req->user_ctx;
-    return um_webserver_base_get_handler(req, ctx->get_data);
+    return run_endpoint(req, (endpoint_t *)arg, start_us);
 }
 
-static esp_err_t post_wrapper(httpd_req_t *req)
+/**
+ * @brief Сервер перегружен: 503 без выполнения обработчика
+ */
+static esp_err_t send_busy(httpd_req_t *req, endpoint_t *ep)
 {
-    post_ctx_t *ctx = (post_ctx_t *)req->user_ctx;
-    return um_webserver_base_post_handler(req, ctx->process_data);
+    portENTER_CRITICAL(&stats_mux);
+    ep->stats.rejected++;
+    portEXIT_CRITICAL(&stats_mux);
+
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    return httpd_resp_sendstr(req, "{\"success\":false,\"error\":\"Server busy\"}");
+}
+
+/**
+ * @brief Клиент превысил частоту запросов: 429
+ */
+static esp_err_t send_limited(httpd_req_t *req, endpoint_t *ep, uint32_t retry_after_s)
+{
+    portENTER_CRITICAL(&stats_mux);
+    ep->stats.limited++;
+    portEXIT_CRITICAL(&stats_mux);
+
+    char retry[12];
+    snprintf(retry, sizeof(retry), "%lu", (unsigned long)retry_after_s);
+    httpd_resp_set_status(req, "429 Too Many Requests");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Retry-After", retry);
+    return httpd_resp_sendstr(req, "{\"success\":false,\"error\":\"Too many requests\"}");
+}
+
+static esp_err_t endpoint_handler(httpd_req_t *req)
+{
+    endpoint_t *ep = (endpoint_t *)req->user_ctx;
+    int64_t start_us = esp_timer_get_time();
+
+    // Идёт um_webserver_stop(): не начинаем работу, которую придётся прерывать
+    if (stopping)
+    {
+        return send_busy(req, ep);
+    }
+
+    // Частый опрос отсекается первым, до проверки токена и кэша
+    uint32_t retry_after_s;
+    uint16_t rate = ep->opts.rate_limit ? ep->opts.rate_limit : CONFIG_UM_CFG_WEBSERVER_RATE_LIMIT;
+    if (!um_webserver_rate_allow(req, ep, rate, &retry_after_s))
+    {
+        return send_limited(req, ep, retry_after_s);
+    }
+
+    // Токен проверяется до кэша и пула: чужой запрос не занимает ни то, ни другое
+    if (!ep->opts.no_auth && um_webserver_auth_check(req) != ESP_OK)
+    {
+        return um_webserver_auth_reject(req);
+    }
+
+    // Попадание в кэш отдаётся сразу, без обработчика и очереди пула
+    if (endpoint_cached(ep))
+    {
+        esp_err_t ret = um_webserver_cache_send(req);
+        if (ret != ESP_ERR_NOT_FOUND)
+        {
+            record_request(ep, ret, start_us, true);
+            return ret;
+        }
+    }
+
+    // Место освобождает run_endpoint после ответа
+    if (!um_webserver_inflight_acquire())
+    {
+        return send_busy(req, ep);
+    }
+
+    if (!ep->opts.async)
+    {
+        return run_endpoint(req, ep, start_us);
+    }
+
+    // Медленный обработчик - в пул, задача httpd свободна для других клиентов
+    esp_err_t ret = um_webserver_workers_submit(req, run_endpoint_async, ep, start_us);
+    if (ret != ESP_OK)
+    {
+        um_webserver_inflight_release();
+    }
+    if (ret == ESP_ERR_NO_MEM)
+    {
+        return send_busy(req, ep);
+    }
+    return ret;
+}
+
+/**
+ * @brief Собрать ответ GET: {"success":true,"data":...} или {"success":false,"error":...}
+ * @param result результат get_data
+ * @return строка из cJSON_PrintUnformatted или NULL, если не хватило памяти
+ */
+static char *build_get_response(httpd_req_t *req, esp_err_t (*get_data)(httpd_req_t *, cJSON **),
+                                esp_err_t *result)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+    {
+        return NULL;
+    }
+
+    cJSON *data = NULL;
+    esp_err_t ret = get_data(req, &data);
+
+    cJSON_AddBoolToObject(root, "success", (ret == ESP_OK && data));
+
+    if (ret == ESP_OK && data)
+    {
+        cJSON_AddItemToObject(root, "data", data);
+    }
+    else
+    {
+        cJSON_AddStringToObject(root, "error", get_error_message(ret));
+    }
+
+    char *response = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    *result = (ret == ESP_OK && !data) ? ESP_FAIL : ret;
+    return response;
 }
 
 /**
@@ -68,37 +347,456 @@ static esp_err_t um_webserver_base_get_handler(
 {
     httpd_resp_set_type(req, "application/json");
 
+    esp_err_t ret;
+    char *response = build_get_response(req, get_data, &ret);
+    if (!response)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, response);
+    free(response);
+
+    ESP_LOGW(REST_TAG, "Free heap size before: %ld", esp_get_free_heap_size());
+    return ESP_OK;
+}
+
+/**
+ * @brief GET с кэшем: успешный ответ запоминается и отправляется с ETag
+ */
+static esp_err_t cached_get_handler(httpd_req_t *req, endpoint_t *ep)
+{
+    // Поколение - до обработчика: сброс во время его работы не даст сохранить старые данные
+    uint32_t gen = um_webserver_cache_generation();
+
+    esp_err_t ret;
+    char *response = build_get_response(req, ep->get_data, &ret);
+    if (!response)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No memory");
+        return ESP_FAIL;
+    }
+
+    if (ret == ESP_OK)
+    {
+        return um_webserver_cache_store_send(req, response, strlen(response), ep->opts.invalidate_on, gen);
+    }
+
+    // Ошибки не кэшируются
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, response);
+    free(response);
+    return ESP_OK;
+}
+
+/**
+ * @brief Создать endpoint по шаблону (без регистрации в httpd)
+ */
+static endpoint_t *new_endpoint(const char *uri, httpd_method_t method, const endpoint_t *tmpl,
+                                const um_webserver_endpoint_opts_t *opts)
+{
+    endpoint_t *ep = malloc(sizeof(endpoint_t));
+    if (!ep)
+    {
+        return NULL;
+    }
+    *ep = *tmpl;
+    if (opts)
+    {
+        ep->opts = *opts;
+    }
+    memset(&ep->stats, 0, sizeof(ep->stats));
+    ep->stats.uri = strdup(uri);
+    ep->stats.method = method;
+    ep->stats.async = ep->opts.async;
+    if (!ep->stats.uri)
+    {
+        free(ep);
+        return NULL;
+    }
+    return ep;
+}
+
+static void free_endpoint(endpoint_t *ep)
+{
+    free((void *)ep->stats.uri);
+    free(ep);
+}
+
+/**
+ * @brief Добавить зарегистрированный endpoint в список (статистика, кэш)
+ */
+static void link_endpoint(endpoint_t *ep)
+{
+    if (ep->opts.cache)
+    {
+        um_webserver_cache_watch(ep->opts.invalidate_on);
+    }
+
+    portENTER_CRITICAL(&stats_mux);
+    ep->next = endpoints;
+    endpoints = ep;
+    portEXIT_CRITICAL(&stats_mux);
+}
+
+/**
+ * @brief Создать endpoint и зарегистрировать его в httpd
+ */
+static esp_err_t add_endpoint(const char *uri, httpd_method_t method, const endpoint_t *tmpl,
+                              const um_webserver_endpoint_opts_t *opts)
+{
+    if (opts && opts->cache && method != HTTP_GET)
+    {
+        ESP_LOGE(WEBSERVER_TAG, "%s %s: cache is GET only", http_method_str(method), uri);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    endpoint_t *ep = new_endpoint(uri, method, tmpl, opts);
+    if (!ep)
+    {
+        ESP_LOGE(WEBSERVER_TAG, "%s %s: no memory", http_method_str(method), uri);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Регистрируем
+    httpd_uri_t uri_struct = {
+        .uri = uri,
+        .method = method,
+        .handler = endpoint_handler, // ← обертка, не базовый обработчик!
+        .user_ctx = ep,
+    };
+
+    esp_err_t ret = register_handler(&uri_struct);
+    if (ret != ESP_OK)
+    {
+        free_endpoint(ep);
+        return ret;
+    }
+    link_endpoint(ep);
+    return ESP_OK;
+}
+
+/**
+ * @brief Статика как endpoint: пул задач, предел частоты, занятость сервера
+ *
+ * Регистрируется последней, после неё register_handler() переставляет
+ * wildcard в конец при каждом новом GET.
+ */
+static esp_err_t add_static_endpoint(void)
+{
+    static const endpoint_t tmpl = {.kind = ENDPOINT_RAW, .handle = um_webserver_static_handler};
+    // Интерфейс открывается без токена, файлы страницы запрашиваются залпом
+    static const um_webserver_endpoint_opts_t opts = {
+        .async = true,
+        .no_auth = true,
+        .rate_limit = UM_WEB_STATIC_RATE_LIMIT,
+    };
+
+    endpoint_t *ep = new_endpoint(static_uri.uri, HTTP_GET, &tmpl, &opts);
+    if (!ep)
+    {
+        ESP_LOGE(WEBSERVER_TAG, "GET %s: no memory", static_uri.uri);
+        return ESP_ERR_NO_MEM;
+    }
+    static_uri.user_ctx = ep;
+    esp_err_t ret = register_handler(&static_uri);
+    if (ret != ESP_OK)
+    {
+        static_uri.user_ctx = NULL;
+        free_endpoint(ep);
+        return ret;
+    }
+    static_registered = true;
+    link_endpoint(ep);
+    return ESP_OK;
+}
+
+esp_err_t um_webserver_register_get_ex(const char *uri, esp_err_t (*data_func)(httpd_req_t *, cJSON **),
+                                       const um_webserver_endpoint_opts_t *opts)
+{
+    if (!server || !uri || !data_func)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    endpoint_t tmpl = {.kind = ENDPOINT_GET, .get_data = data_func};
+    return add_endpoint(uri, HTTP_GET, &tmpl, opts);
+}
+
+esp_err_t um_webserver_register_get(const char *uri, esp_err_t (*data_func)(httpd_req_t *, cJSON **))
+{
+    return um_webserver_register_get_ex(uri, data_func, NULL);
+}
+
+/**
+ * @brief Конверт {"success":true,"data":...} вокруг значения от write_data
+ *
+ * При ошибке конверт не закрывается: вызывающий отдаёт write_stream_error().
+ */
+static esp_err_t write_stream_envelope(httpd_req_t *req, um_json_writer_t *w, um_webserver_stream_fn write_data)
+{
+    um_json_obj_begin(w);
+    um_json_kv_bool(w, "success", true);
+    um_json_key(w, "data");
+
+    esp_err_t ret = write_data(req, w);
+    if (ret == ESP_OK && w->after_key)
+    {
+        // Обработчик ничего не записал - как data == NULL в обычном GET
+        ret = ESP_FAIL;
+    }
+    if (ret == ESP_OK)
+    {
+        um_json_obj_end(w);
+    }
+    return ret;
+}
+
+static esp_err_t write_stream_error(um_json_writer_t *w, esp_err_t ret)
+{
+    um_json_obj_begin(w);
+    um_json_kv_bool(w, "success", false);
+    um_json_kv_str(w, "error", get_error_message(ret));
+    um_json_obj_end(w);
+    return um_json_writer_finish(w);
+}
+
+/**
+ * Базовый потоковый обработчик GET: ответ пишется сразу в сокет
+ * кусками по UM_JSON_WRITER_BUF_SIZE, без дерева cJSON и строки в куче
+ * @param req HTTP запрос
+ * @param write_data функция, которая пишет ровно одно значение data
+ */
+static esp_err_t um_webserver_base_stream_handler(httpd_req_t *req, um_webserver_stream_fn write_data)
+{
+    httpd_resp_set_type(req, "application/json");
+
+    um_json_writer_t w;
+    um_json_writer_init_httpd(&w, req);
+
+    esp_err_t ret = write_stream_envelope(req, &w, write_data);
+    if (ret == ESP_OK)
+    {
+        ret = um_json_writer_finish(&w);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGW(REST_TAG, "Stream %s aborted: %s", req->uri, esp_err_to_name(ret));
+            return ESP_FAIL;
+        }
+        return ESP_OK;
+    }
+
+    // Пока ничего не ушло клиенту, ошибку можно отдать обычным ответом
+    if (um_json_writer_reset(&w) != ESP_OK)
+    {
+        ESP_LOGW(REST_TAG, "Stream %s failed after %u bytes: %s",
+                 req->uri, (unsigned)w.flushed, esp_err_to_name(ret));
+        return ESP_FAIL; // httpd закроет сокет, клиент увидит обрыв
+    }
+    return write_stream_error(&w, ret);
+}
+
+/**
+ * @brief Тело ответа в памяти, не больше записи кэша
+ */
+typedef struct
+{
+    char *buf;
+    size_t len;
+    size_t cap;
+    bool overflow;
+} mem_sink_t;
+
+static esp_err_t mem_flush(void *ctx, const char *data, size_t len)
+{
+    mem_sink_t *sink = (mem_sink_t *)ctx;
+    if (sink->len + len > UM_WEB_CACHE_MAX_BYTES / 2)
+    {
+        sink->overflow = true;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (sink->len + len > sink->cap)
+    {
+        size_t cap = sink->cap ? sink->cap * 2 : UM_JSON_WRITER_BUF_SIZE * 2;
+        while (cap < sink->len + len)
+        {
+            cap *= 2;
+        }
+        char *buf = realloc(sink->buf, cap);
+        if (!buf)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+        sink->buf = buf;
+        sink->cap = cap;
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    return ESP_OK;
+}
+
+/**
+ * @brief Потоковый GET с кэшем: ответ собирается в памяти, запоминается
+ * и отправляется одним куском с ETag
+ *
+ * Ответ больше записи кэша отдаётся обычным потоком, кэш для endpoint отключается.
+ */
+static esp_err_t cached_stream_handler(httpd_req_t *req, endpoint_t *ep)
+{
+    uint32_t gen = um_webserver_cache_generation();
+
+    mem_sink_t sink = {0};
+    um_json_writer_t w;
+    um_json_writer_init(&w, mem_flush, &sink);
+
+    esp_err_t ret = write_stream_envelope(req, &w, ep->write_data);
+    if (ret == ESP_OK)
+    {
+        ret = um_json_writer_finish(&w);
+    }
+    if (ret == ESP_OK)
+    {
+        return um_webserver_cache_store_send(req, sink.buf, sink.len, ep->opts.invalidate_on, gen);
+    }
+    free(sink.buf);
+
+    if (sink.overflow)
+    {
+        ESP_LOGW(REST_TAG, "%s is too large for cache, caching disabled", req->uri);
+        __atomic_store_n(&ep->opts.cache, false, __ATOMIC_RELAXED);
+        return um_webserver_base_stream_handler(req, ep->write_data);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    um_json_writer_init_httpd(&w, req);
+    return write_stream_error(&w, ret);
+}
+
+esp_err_t um_webserver_register_get_stream_ex(const char *uri, um_webserver_stream_fn write_func,
+                                              const um_webserver_endpoint_opts_t *opts)
+{
+    if (!server || !uri || !write_func)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    endpoint_t tmpl = {.kind = ENDPOINT_GET_STREAM, .write_data = write_func};
+    return add_endpoint(uri, HTTP_GET, &tmpl, opts);
+}
+
+esp_err_t um_webserver_register_get_stream(const char *uri, um_webserver_stream_fn write_func)
+{
+    return um_webserver_register_get_stream_ex(uri, write_func, NULL);
+}
+
+esp_err_t um_webserver_register_post_ex(const char *uri,
+                                        esp_err_t (*process_func)(httpd_req_t *, cJSON *, cJSON **),
+                                        const um_webserver_endpoint_opts_t *opts)
+{
+    if (!server || !uri || !process_func)
+        return ESP_ERR_INVALID_ARG;
+
+    endpoint_t tmpl = {.kind = ENDPOINT_POST, .process_data = process_func};
+    return add_endpoint(uri, HTTP_POST, &tmpl, opts);
+}
+
+esp_err_t um_webserver_register_post(const char *uri,
+                                     esp_err_t (*process_func)(httpd_req_t *, cJSON *, cJSON **))
+{
+    return um_webserver_register_post_ex(uri, process_func, NULL);
+}
+
+esp_err_t um_webserver_register_post_stream_ex(const char *uri, um_webserver_body_fn process_func,
+                                               const um_webserver_endpoint_opts_t *opts)
+{
+    if (!server || !uri || !process_func)
+        return ESP_ERR_INVALID_ARG;
+
+    endpoint_t tmpl = {.kind = ENDPOINT_POST_STREAM, .process_body = process_func};
+    return add_endpoint(uri, HTTP_POST, &tmpl, opts);
+}
+
+size_t um_webserver_get_endpoint_stats(um_webserver_endpoint_stats_t *stats, size_t max)
+{
+    size_t n = 0;
+    portENTER_CRITICAL(&stats_mux);
+    for (endpoint_t *ep = endpoints; ep; ep = ep->next, n++)
+    {
+        if (n < max)
+        {
+            stats[n] = ep->stats;
+        }
+    }
+    portEXIT_CRITICAL(&stats_mux);
+    return n;
+}
+
+/**
+ * @brief Следующий endpoint списка со снимком его статистики
+ *
+ * Список до um_webserver_stop() только растёт (новые - в голову), поэтому
+ * обход не ограничен числом endpoints и не держит блокировку между шагами.
+ *
+ * @param ep текущий endpoint, NULL - начать с головы
+ * @return NULL - список пройден
+ */
+static const endpoint_t *next_endpoint_stats(const endpoint_t *ep, um_webserver_endpoint_stats_t *stats)
+{
+    portENTER_CRITICAL(&stats_mux);
+    ep = ep ? ep->next : endpoints;
+    if (ep)
+    {
+        *stats = ep->stats;
+    }
+    portEXIT_CRITICAL(&stats_mux);
+    return ep;
+}
+
+/**
+ * @brief Ответ POST: {"success":true,"data"/"message":...} или {"success":false,"error":...}
+ * @param output данные от обработчика (освобождаются здесь)
+ */
+static esp_err_t send_post_response(httpd_req_t *req, esp_err_t ret, cJSON *output)
+{
     cJSON *root = cJSON_CreateObject();
     if (!root)
     {
+        cJSON_Delete(output);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No memory");
         return ESP_FAIL;
     }
 
-    cJSON *data = NULL;
-    esp_err_t ret = get_data(req, &data);
-
-    cJSON_AddBoolToObject(root, "success", (ret == ESP_OK && data));
+    cJSON_AddBoolToObject(root, "success", (ret == ESP_OK));
 
-    if (ret == ESP_OK && data)
+    if (ret == ESP_OK)
     {
-        cJSON_AddItemToObject(root, "data", data);
+        if (output)
+        {
+            cJSON_AddItemToObject(root, "data", output);
+        }
+        else
+        {
+            cJSON_AddStringToObject(root, "message", "Operation successful");
+        }
     }
     else
     {
-        const char *err_msg = "Unknown error";
+        const char *err_msg = "Operation failed";
         if (ret == ESP_ERR_INVALID_ARG)
             err_msg = "Invalid arguments";
         else if (ret == ESP_ERR_NOT_FOUND)
-            err_msg = "Not found";
+            err_msg = "Resource not found";
         else if (ret == ESP_ERR_NOT_SUPPORTED)
             err_msg = "Feature disabled";
         else if (ret == ESP_ERR_NO_MEM)
             err_msg = "Out of memory";
 
         cJSON_AddStringToObject(root, "error", err_msg);
+        cJSON_Delete(output);
     }
 
+    // 5. Отправляем ответ
     char *response = cJSON_PrintUnformatted(root);
     esp_err_t http_ret = ESP_OK;
 
@@ -114,80 +812,28 @@ static esp_err_t um_webserver_base_get_handler(
     }
 
     cJSON_Delete(root);
-    ESP_LOGW(REST_TAG, "Free heap size before: %ld", esp_get_free_heap_size());
-    return http_ret;
-}
-
-esp_err_t um_webserver_register_get(const char *uri, esp_err_t (*data_func)(httpd_req_t *, cJSON **))
-{
-    if (!server || !uri || !data_func)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    // Создаем контекст
-    get_ctx_t *ctx = malloc(sizeof(get_ctx_t));
-    if (!ctx)
-    {
-        return ESP_ERR_NO_MEM;
-    }
-    ctx->get_data = data_func;
-
-    // Регистрируем
-    httpd_uri_t uri_struct = {
-        .uri = uri,
-        .method = HTTP_GET,
-        .handler = get_wrapper, // ← обертка, не базовый обработчик!
-        .user_ctx = ctx,
-        //.free_ctx = free            // ← просто free
-    };
-
-    return httpd_register_uri_handler(server, &uri_struct);
-}
-
-esp_err_t um_webserver_register_post(const char *uri,
-                                     esp_err_t (*process_func)(httpd_req_t *, cJSON *, cJSON **))
-{
-    if (!server || !uri || !process_func)
-        return ESP_ERR_INVALID_ARG;
 
-    post_ctx_t *ctx = malloc(sizeof(post_ctx_t));
-    if (!ctx)
-        return ESP_ERR_NO_MEM;
-    ctx->process_data = process_func;
-
-    httpd_uri_t uri_struct = {
-        .uri = uri,
-        .method = HTTP_POST,
-        .handler = post_wrapper,
-        .user_ctx = ctx,
-    };
+    ESP_LOGW(REST_TAG, "Free heap size before: %ld", esp_get_free_heap_size());
 
-    return httpd_register_uri_handler(server, &uri_struct);
+    return http_ret;
 }
 
 /**
- * Базовый обработчик для ВСЕХ POST запросов
+ * Базовый обработчик для POST с телом JSON
  * @param req HTTP запрос
  * @param process_data функция, которая обрабатывает входные данные и создает выходные
+ * @param max_body предел тела (0 - UM_WEBSERVER_MAX_BODY): дерево cJSON строится из тела целиком
  */
 static esp_err_t um_webserver_base_post_handler(
     httpd_req_t *req,
-    esp_err_t (*process_data)(httpd_req_t *, cJSON *input, cJSON **output))
+    esp_err_t (*process_data)(httpd_req_t *, cJSON *input, cJSON **output),
+    size_t max_body)
 {
     httpd_resp_set_type(req, "application/json");
 
     // 1. Читаем тело запроса (то, что прислал клиент)
-    if (req->content_len == 0)
-    {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty request");
-        return ESP_FAIL;
-    }
-
-    // Ограничим размер для безопасности
-    if (req->content_len > 2048)
+    if (um_webserver_body_check(req, max_body) != ESP_OK)
     {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Request too large");
         return ESP_FAIL;
     }
 
@@ -198,17 +844,17 @@ static esp_err_t um_webserver_base_post_handler(
         return ESP_FAIL;
     }
 
-    int received = httpd_req_recv(req, content, req->content_len);
-    if (received <= 0)
+    // Тело может прийти несколькими TCP сегментами
+    if (um_webserver_recv_all(req, content, req->content_len) != ESP_OK)
     {
         free(content);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Failed to read data");
         return ESP_FAIL;
     }
-    content[received] = '\0';
+    content[req->content_len] = '\0';
 
     // 2. Парсим входной JSON
-    cJSON *input = cJSON_Parse(content);
+    cJSON *input = cJSON_ParseWithLength(content, req->content_len);
     free(content);
 
     if (!input)
@@ -220,72 +866,47 @@ static esp_err_t um_webserver_base_post_handler(
     // 3. Вызываем функцию обработки
     cJSON *output = NULL;
     esp_err_t ret = process_data(req, input, &output);
+    cJSON_Delete(input);
 
     // 4. Формируем ответ (как в GET, но может включать данные от process_data)
-    cJSON *root = cJSON_CreateObject();
-    if (!root)
-    {
-        cJSON_Delete(input);
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No memory");
-        return ESP_FAIL;
-    }
+    return send_post_response(req, ret, output);
+}
 
-    cJSON_AddBoolToObject(root, "success", (ret == ESP_OK));
+/**
+ * Базовый обработчик потокового POST: тело читает сам process_body
+ * кусками, не собирая его в памяти
+ * @param max_body предел тела (0 - UM_WEBSERVER_MAX_BODY)
+ */
+static esp_err_t um_webserver_base_post_stream_handler(httpd_req_t *req, um_webserver_body_fn process_body,
+                                                       size_t max_body)
+{
+    httpd_resp_set_type(req, "application/json");
 
-    if (ret == ESP_OK)
-    {
-        if (output)
-        {
-            cJSON_AddItemToObject(root, "data", output);
-        }
-        else
-        {
-            cJSON_AddStringToObject(root, "message", "Operation successful");
-        }
-    }
-    else
+    if (um_webserver_body_check(req, max_body) != ESP_OK)
     {
-        const char *err_msg = "Operation failed";
-        if (ret == ESP_ERR_INVALID_ARG)
-            err_msg = "Invalid arguments";
-        else if (ret == ESP_ERR_NOT_FOUND)
-            err_msg = "Resource not found";
-        else if (ret == ESP_ERR_NOT_SUPPORTED)
-            err_msg = "Feature disabled";
-        else if (ret == ESP_ERR_NO_MEM)
-            err_msg = "Out of memory";
-
-        cJSON_AddStringToObject(root, "error", err_msg);
+        return ESP_FAIL;
     }
 
-    // 5. Отправляем ответ
-    char *response = cJSON_PrintUnformatted(root);
-    esp_err_t http_ret = ESP_OK;
+    um_webserver_body_t body = {.req = req, .remaining = req->content_len};
+    cJSON *output = NULL;
+    esp_err_t ret = process_body(req, &body, &output);
 
-    if (response)
-    {
-        httpd_resp_sendstr(req, response);
-        free(response);
-    }
-    else
+    esp_err_t http_ret = send_post_response(req, ret, output);
+    if (body.remaining > 0)
     {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON error");
-        http_ret = ESP_FAIL;
+        // Обработчик прочитал не всё (ошибка): остаток не нужен, закрываем соединение
+        return ESP_FAIL;
     }
-
-    cJSON_Delete(root);
-    cJSON_Delete(input);
-
-    ESP_LOGW(REST_TAG, "Free heap size before: %ld", esp_get_free_heap_size());
-
     return http_ret;
 }
 
-static esp_err_t get_config_data(httpd_req_t *req, cJSON **data)
+/**
+ * @brief Параметр ?section= запросов /api/conf
+ */
+static esp_err_t get_config_section(httpd_req_t *req, char *section, size_t size)
 {
-    char section[32] = {0};
+    section[0] = '\0';
 
-    // 1. Получаем параметры (всегда одинаково)
     size_t query_len = httpd_req_get_url_query_len(req);
     if (query_len > 0)
     {
@@ -295,49 +916,148 @@ static esp_err_t get_config_data(httpd_req_t *req, cJSON **data)
 
         if (httpd_req_get_url_query_str(req, query, query_len + 1) == ESP_OK)
         {
-            httpd_query_key_value(query, "section", section, sizeof(section));
+            httpd_query_key_value(query, "section", section, size);
         }
         free(query);
     }
 
-    // 2. Проверяем обязательные параметры
-    if (strlen(section) == 0)
+    return strlen(section) > 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+static esp_err_t get_config_data(httpd_req_t *req, um_json_writer_t *w)
+{
+    char section[32];
+
+    // 1. Получаем и проверяем обязательные параметры
+    esp_err_t ret = get_config_section(req, section, sizeof(section));
+    if (ret != ESP_OK)
     {
-        return ESP_ERR_INVALID_ARG;
+        return ret;
     }
 
-    // 3. Твоя логика получения данных
-    char *config_str = NULL;
-
+    // 3. Файл конфигурации уже JSON - копируем его в ответ как есть,
+    // без разбора в дерево и повторной печати
     if (strcmp(section, "onewire") == 0)
     {
 #if UM_FEATURE_ENABLED(ONEWIRE)
-        config_str = um_onewire_config_read();
+        return um_json_raw_file(w, um_onewire_config_path());
 #else
         return ESP_ERR_NOT_SUPPORTED;
 #endif
     }
-    else
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+#if UM_FEATURE_ENABLED(ONEWIRE)
+// Конфигурация - JSON объект; содержимое проверит загрузка
+static esp_err_t check_config_root(void *ctx, um_json_token_t token, const char *value, int depth)
+{
+    return (depth > 0 || token == UM_JSON_OBJECT_START || token == UM_JSON_OBJECT_END) ? ESP_OK
+                                                                                        : ESP_ERR_INVALID_ARG;
+}
+#endif
+
+/**
+ * @brief POST /api/conf?section=...: заменить файл конфигурации целиком
+ *
+ * Тело пишется во временный файл по мере приёма и одновременно проверяется
+ * потоковым токенизатором; оригинал заменяется только после всего тела.
+ */
+static esp_err_t post_config_data(httpd_req_t *req, um_webserver_body_t *body, cJSON **output)
+{
+    char section[32];
+    esp_err_t ret = get_config_section(req, section, sizeof(section));
+    if (ret != ESP_OK)
     {
-        return ESP_ERR_NOT_FOUND;
+        return ret;
     }
 
-    if (!config_str)
+    if (strcmp(section, "onewire") == 0)
     {
-        return ESP_FAIL;
+#if UM_FEATURE_ENABLED(ONEWIRE)
+        um_json_stream_t parser;
+        um_json_stream_init(&parser, check_config_root, NULL);
+        ret = um_webserver_body_save(body, um_onewire_config_path(), UM_STORAGE_FLAG_CRC, &parser);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+
+        ret = um_onewire_config_load();
+        if (ret == ESP_OK)
+        {
+            um_onewire_config_apply();
+        }
+        um_event_publish(UMNI_EVENT_CONFIG_SAVED, NULL, 0, portMAX_DELAY);
+        return ret;
+#else
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
     }
 
-    // 4. Парсим JSON (всегда одинаково для строк)
-    cJSON *json = cJSON_Parse(config_str);
-    free(config_str);
+    return ESP_ERR_NOT_FOUND;
+}
 
-    if (!json)
+#if UM_FEATURE_ENABLED(ONEWIRE)
+/**
+ * @brief Состояние всех датчиков 1-Wire вместе с их настройками
+ */
+static esp_err_t get_onewire_state(httpd_req_t *req, um_json_writer_t *w)
+{
+    // Копия опубликованной таблицы: опрос шины не блокирует ответ
+    um_onewire_reading_t readings[ONEWIRE_MAX_SENSORS];
+    uint8_t count = um_onewire_get_readings(readings, ONEWIRE_MAX_SENSORS);
+
+    um_json_arr_begin(w);
+    for (uint8_t i = 0; i < count; i++)
     {
-        return ESP_FAIL;
+        const um_onewire_reading_t *sensor = &readings[i];
+        char serial[17];
+        um_onewire_address_to_string(sensor->address, serial);
+        const um_onewire_sensor_config_t *cfg = um_onewire_config_get(serial);
+
+        um_json_obj_begin(w);
+        um_json_kv_str(w, "serial", serial);
+        um_json_kv_str(w, "type", um_onewire_sensor_type_to_string(sensor->type));
+        um_json_kv_bool(w, "active", sensor->active);
+        um_json_kv_num(w, "temperature", sensor->active ? sensor->temperature : 0.0f);
+        um_json_kv_num(w, "calibration", sensor->calibration);
+        um_json_kv_str(w, "label", cfg ? cfg->label : NULL);
+        um_json_kv_str(w, "location", cfg ? cfg->location : NULL);
+        um_json_obj_end(w);
     }
+    um_json_arr_end(w);
 
-    *data = json;
-    return ESP_OK;
+    return um_json_writer_error(w);
+}
+#endif
+
+/**
+ * @brief Статистика endpoints: запросы, ошибки, 503, время ответа
+ */
+static esp_err_t get_endpoint_stats(httpd_req_t *req, um_json_writer_t *w)
+{
+    um_webserver_endpoint_stats_t st;
+
+    um_json_arr_begin(w);
+    for (const endpoint_t *ep = next_endpoint_stats(NULL, &st); ep; ep = next_endpoint_stats(ep, &st))
+    {
+        um_json_obj_begin(w);
+        um_json_kv_str(w, "uri", st.uri);
+        um_json_kv_str(w, "method", http_method_str(st.method));
+        um_json_kv_bool(w, "async", st.async);
+        um_json_kv_int(w, "requests", st.requests);
+        um_json_kv_int(w, "errors", st.errors);
+        um_json_kv_int(w, "rejected", st.rejected);
+        um_json_kv_int(w, "limited", st.limited);
+        um_json_kv_int(w, "cache_hits", st.cache_hits);
+        um_json_kv_int(w, "avg_us", st.requests ? (int64_t)(st.total_us / st.requests) : 0);
+        um_json_kv_int(w, "max_us", st.max_us);
+        um_json_obj_end(w);
+    }
+    um_json_arr_end(w);
+    return um_json_writer_error(w);
 }
 
 /**
@@ -361,52 +1081,201 @@ static esp_err_t um_webserver_test_get_handler(httpd_req_t *req, cJSON **data)
 }
 
 /**
- * @brief Обработчик для входа (POST)
+ * @brief Задержки файловой системы при заполнении (POST {"fill": 50})
  */
-static esp_err_t um_webserver_login_handler(httpd_req_t *req, cJSON *input, cJSON **output)
+static esp_err_t post_storage_bench(httpd_req_t *req, cJSON *input, cJSON **output)
 {
-    // Извлекаем данные из запроса
-    cJSON *username = cJSON_GetObjectItem(input, "username");
-    cJSON *password = cJSON_GetObjectItem(input, "password");
+    uint8_t fill = 50;
+    cJSON *fill_item = cJSON_GetObjectItem(input, "fill");
+    if (cJSON_IsNumber(fill_item))
+    {
+        if (fill_item->valuedouble < 0 || fill_item->valuedouble > UM_STORAGE_BENCH_MAX_FILL)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        fill = (uint8_t)fill_item->valuedouble;
+    }
+
+    um_storage_bench_result_t res;
+    esp_err_t ret = um_storage_benchmark(NULL, fill, &res);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    if (!json)
+        return ESP_ERR_NO_MEM;
 
-    if (!username || !password || !username->valuestring || !password->valuestring)
+#if CONFIG_UM_CFG_STORAGE_LITTLEFS
+    cJSON_AddStringToObject(json, "backend", "littlefs");
+#else
+    cJSON_AddStringToObject(json, "backend", "spiffs");
+#endif
+    cJSON_AddNumberToObject(json, "fill", res.fill_percent);
+    cJSON_AddNumberToObject(json, "files", res.files);
+    cJSON_AddNumberToObject(json, "open_us", res.open_us);
+    cJSON_AddNumberToObject(json, "read_us", res.read_us);
+    cJSON_AddNumberToObject(json, "write_us", res.write_us);
+    cJSON_AddNumberToObject(json, "list_us", res.list_us);
+
+    *output = json;
+    return ESP_OK;
+}
+
+#if UM_FEATURE_ENABLED(SDCARD)
+/**
+ * @brief Тест скорости SD карты (POST {"size_kb": 1024})
+ */
+static esp_err_t post_sd_bench(httpd_req_t *req, cJSON *input, cJSON **output)
+{
+    uint32_t size_kb = 1024;
+    cJSON *size = cJSON_GetObjectItem(input, "size_kb");
+    if (cJSON_IsNumber(size))
     {
-        return ESP_ERR_INVALID_ARG;
+        if (size->valuedouble < 16 || size->valuedouble > UM_SD_BENCH_MAX_KB)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        size_kb = (uint32_t)size->valuedouble;
     }
 
-    // Проверка (в реальности - из NVS)
-    if (strcmp(username->valuestring, "admin") == 0 &&
-        strcmp(password->valuestring, "1234") == 0)
+    um_sd_bench_result_t res;
+    esp_err_t ret = um_sd_benchmark(size_kb, &res);
+    if (ret == ESP_ERR_INVALID_STATE)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret != ESP_OK)
     {
+        return ret;
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    if (!json)
+        return ESP_ERR_NO_MEM;
 
-        cJSON *data = cJSON_CreateObject();
-        cJSON_AddStringToObject(data, "token", "secret_token_12345");
-        cJSON_AddNumberToObject(data, "expires_in", 3600);
+    cJSON_AddNumberToObject(json, "size_kb", res.size_kb);
+    cJSON_AddNumberToObject(json, "freq_khz", res.freq_khz);
+    cJSON_AddNumberToObject(json, "write_mbps", res.write_kbps / 1024.0);
+    cJSON_AddNumberToObject(json, "read_mbps", res.read_kbps / 1024.0);
+    cJSON_AddBoolToObject(json, "crc_ok", res.crc_ok);
 
-        *output = data;
-        return ESP_OK;
+    *output = json;
+    return ESP_OK;
+}
+#endif
+
+#if UM_FEATURE_ENABLED(METRICS)
+/**
+ * @brief Счётчики endpoints для /metrics (семейство на каждый счётчик)
+ */
+static void collect_http(um_metrics_out_t *out)
+{
+    static const struct
+    {
+        const char *name;
+        const char *help;
+        size_t offset;
+    } counters[] = {
+        {"um_http_requests_total", "API requests", offsetof(um_webserver_endpoint_stats_t, requests)},
+        {"um_http_errors_total", "API handler errors", offsetof(um_webserver_endpoint_stats_t, errors)},
+        {"um_http_rejected_total", "Rejected with 503: server busy",
+         offsetof(um_webserver_endpoint_stats_t, rejected)},
+        {"um_http_limited_total", "Rejected with 429: client over rate limit",
+         offsetof(um_webserver_endpoint_stats_t, limited)},
+        {"um_http_cache_hits_total", "Responses served from cache",
+         offsetof(um_webserver_endpoint_stats_t, cache_hits)},
+    };
+
+    um_webserver_endpoint_stats_t st;
+
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++)
+    {
+        um_metrics_family(out, counters[c].name, counters[c].help, UM_METRIC_COUNTER);
+        for (const endpoint_t *ep = next_endpoint_stats(NULL, &st); ep; ep = next_endpoint_stats(ep, &st))
+        {
+            char uri[64];
+            char labels[96];
+            um_metrics_label_value(uri, sizeof(uri), st.uri);
+            snprintf(labels, sizeof(labels), "uri=\"%s\",method=\"%s\"", uri, http_method_str(st.method));
+            uint32_t value = *(const uint32_t *)((const uint8_t *)&st + counters[c].offset);
+            um_metrics_sample(out, counters[c].name, labels, value);
+        }
     }
+}
 
-    return ESP_ERR_NOT_FOUND; // Неверные учетные данные
+static esp_err_t metrics_write_chunk(void *ctx, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
 }
 
 /**
- * @brief Обработчик для статических файлов
+ * @brief GET /metrics: текстовый формат Prometheus, потоком
  */
-static esp_err_t um_webserver_static_handler(httpd_req_t *req)
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+    esp_err_t ret = um_metrics_write(metrics_write_chunk, req);
+    if (ret != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t register_metrics(void)
 {
-    ESP_LOGI(REST_TAG, "Statix file query: %s", req->uri);
+    static bool registered = false;
+    if (!registered)
+    {
+        um_metrics_register(&m_http_time);
+        um_metrics_register_collector(collect_http);
+        registered = true;
+    }
 
-#if UM_FEATURE_ENABLED(SDCARD)
-    // Здесь будет код для чтения файлов с SD карты
-    // Пока просто возвращаем тестовую страницу
+    // Вывод идёт кусками по мере отправки: медленный сборщик не держит задачу httpd
+    const um_webserver_endpoint_opts_t metrics_opts = {.async = true};
+    const endpoint_t tmpl = {.kind = ENDPOINT_RAW, .handle = metrics_handler};
+    return add_endpoint("/metrics", HTTP_GET, &tmpl, &metrics_opts);
+}
 #endif
 
-    // Возвращаем тестовую HTML страницу
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_sendstr(req, TEST_HTML);
+/**
+ * @brief Закрытие сокета сервером: освобождаем подписки клиента
+ */
+static void um_webserver_close_fn(httpd_handle_t hd, int sockfd)
+{
+#if CONFIG_HTTPD_WS_SUPPORT
+    um_webserver_ws_on_close(sockfd);
+#endif
+    close(sockfd);
+}
 
-    return ESP_OK;
+/**
+ * @brief Число обработчиков, которые регистрирует um_webserver_start()
+ *
+ * Таблица httpd выделяется в httpd_start() и не растёт: max_uri_handlers -
+ * это число плюс UM_WEB_APP_URI_HANDLERS для endpoints приложения.
+ */
+static size_t builtin_handlers(void)
+{
+    // /api/test, /api/conf GET и POST, /api/endpoints, /api/login, /api/logout,
+    // /api/batch, /api/storage/bench, /api/events, статика
+    size_t n = 10;
+#if UM_FEATURE_ENABLED(ONEWIRE)
+    n += 1; // /api/onewire
+#endif
+#if UM_FEATURE_ENABLED(SDCARD)
+    n += 4; // /api/sd/bench, файлы GET, HEAD и PUT
+#endif
+#if CONFIG_HTTPD_WS_SUPPORT
+    n += 1; // /ws
+#endif
+#if UM_FEATURE_ENABLED(METRICS)
+    n += 1; // /metrics
+#endif
+    return n;
 }
 
 /**
@@ -419,8 +1288,14 @@ esp_err_t um_webserver_start(void)
     // Конфигурация сервера
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
-    config.max_uri_handlers = 20;
+    config.max_uri_handlers = builtin_handlers() + UM_WEB_APP_URI_HANDLERS;
     config.stack_size = 8192;
+    config.close_fn = um_webserver_close_fn;
+    // Простаивающие keep-alive сокеты закрываются, когда нужен новый
+    config.lru_purge_enable = true;
+    config.max_open_sockets = CONFIG_UM_CFG_WEBSERVER_MAX_SOCKETS;
+    // Ядро 1 остаётся OpenTherm и MQTT
+    config.core_id = UM_WEB_TASK_CORE;
 
     // Запуск сервера
     esp_err_t ret = httpd_start(&server, &config);
@@ -430,43 +1305,84 @@ esp_err_t um_webserver_start(void)
         return ret;
     }
 
-    um_webserver_register_get("/api/test", um_webserver_test_get_handler);
-    um_webserver_register_get("/api/conf", get_config_data);
-    um_webserver_register_post("/api/login", um_webserver_login_handler);
-
-    // Регистрация обработчиков
-
-    // Тестовый GET метод
-    // httpd_uri_t test_get_uri = {
-    //     .uri = "/api/test",
-    //     .method = HTTP_GET,
-    //     .handler = um_webserver_test_get_handler,
-    //     .user_ctx = NULL};
-    // httpd_register_uri_handler(server, &test_get_uri);
-
-    // POST метод для входа
-    // httpd_uri_t login_post_uri = {
-    //     .uri = "/api/login",
-    //     .method = HTTP_POST,
-    //     .handler = um_webserver_login_handler,
-    //     .user_ctx = NULL};
-    // httpd_register_uri_handler(server, &login_post_uri);
-
-    // Обработчик для корневого пути (статический HTML)
-    httpd_uri_t root_uri = {
-        .uri = "/",
-        .method = HTTP_GET,
-        .handler = um_webserver_static_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &root_uri);
-
-    // Обработчик для index.html
-    httpd_uri_t index_uri = {
-        .uri = "/index.html",
-        .method = HTTP_GET,
-        .handler = um_webserver_static_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &index_uri);
+    // Медленные обработчики (файловая система, SD) - в пул задач
+    um_webserver_workers_start();
+    um_webserver_cache_start();
+    um_webserver_auth_start();
+
+    // Ошибка регистрации не останавливает сервер (причина уже в журнале),
+    // но отсутствующий обработчик виден сразу при старте
+    size_t registered = 0;
+
+    // Конфигурация меняется редко: повторные запросы - из кэша до следующего сохранения
+    const um_webserver_endpoint_opts_t conf_opts = {
+        .async = true,
+        .cache = true,
+        .invalidate_on = UM_WEBSERVER_EVENT_BIT(UMNI_EVENT_CONFIG_SAVED),
+    };
+
+    registered += (um_webserver_register_get("/api/test", um_webserver_test_get_handler) == ESP_OK);
+    registered += (um_webserver_register_get_stream_ex("/api/conf", get_config_data, &conf_opts) == ESP_OK);
+    // Загрузка конфигурации: тело идёт в файл кусками, куча не нужна
+    const um_webserver_endpoint_opts_t conf_upload_opts = {
+        .async = true,
+        .max_body = 16 * 1024,
+    };
+    registered += (um_webserver_register_post_stream_ex("/api/conf", post_config_data, &conf_upload_opts) == ESP_OK);
+    registered += (um_webserver_register_get_stream("/api/endpoints", get_endpoint_stats) == ESP_OK);
+#if UM_FEATURE_ENABLED(ONEWIRE)
+    // Меняется с каждым опросом датчиков, но между опросами отдаётся из кэша
+    const um_webserver_endpoint_opts_t onewire_opts = {
+        .cache = true,
+        .invalidate_on = UM_WEBSERVER_EVENT_BIT(UMNI_EVENT_ONEWIRE_TEMPERATURES) |
+                         UM_WEBSERVER_EVENT_BIT(UMNI_EVENT_CONFIG_SAVED),
+    };
+    registered += (um_webserver_register_get_stream_ex("/api/onewire", get_onewire_state, &onewire_opts) == ESP_OK);
+#endif
+    // Вход без токена и не чаще раза в секунду; перебор паролей не держит задачу httpd
+    const um_webserver_endpoint_opts_t login_opts = {.async = true, .no_auth = true, .rate_limit = 1};
+    registered += (um_webserver_register_post_ex("/api/login", um_webserver_auth_login, &login_opts) == ESP_OK);
+    registered += (um_webserver_register_post("/api/logout", um_webserver_auth_logout) == ESP_OK);
+    // Пакет операций: выходы одной записью в PCF8574, настройки одним commit
+    const um_webserver_endpoint_opts_t batch_opts = {
+        .async = true,
+        .max_body = UM_WEB_BATCH_MAX_BODY,
+    };
+    registered += (um_webserver_register_post_ex("/api/batch", um_webserver_batch_handler, &batch_opts) == ESP_OK);
+    // Тесты занимают ФС на секунды - не чаще раза в секунду
+    const um_webserver_endpoint_opts_t bench_opts = {.async = true, .rate_limit = 1};
+    registered += (um_webserver_register_post_ex("/api/storage/bench", post_storage_bench, &bench_opts) == ESP_OK);
+#if UM_FEATURE_ENABLED(SDCARD)
+    registered += (um_webserver_register_post_ex("/api/sd/bench", post_sd_bench, &bench_opts) == ESP_OK);
+    // Файлы с карты: многомегабайтные передачи идут в пуле, задача httpd свободна
+    um_webserver_files_start();
+    const um_webserver_endpoint_opts_t files_opts = {.async = true};
+    endpoint_t files_tmpl = {.kind = ENDPOINT_RAW, .handle = um_webserver_files_handler};
+    registered += (add_endpoint(UM_WEB_FILES_URI_PREFIX "/*", HTTP_GET, &files_tmpl, &files_opts) == ESP_OK);
+    registered += (add_endpoint(UM_WEB_FILES_URI_PREFIX "/*", HTTP_HEAD, &files_tmpl, &files_opts) == ESP_OK);
+    endpoint_t upload_tmpl = {.kind = ENDPOINT_RAW, .handle = um_webserver_files_put_handler};
+    registered += (add_endpoint(UM_WEB_FILES_URI_PREFIX "/*", HTTP_PUT, &upload_tmpl, &files_opts) == ESP_OK);
+#endif
+
+#if CONFIG_HTTPD_WS_SUPPORT
+    // Живое состояние для дашбордов
+    registered += (um_webserver_ws_start(server) == ESP_OK);
+#endif
+    // Поток событий для клиентов без WebSocket
+    registered += (um_webserver_sse_start(server) == ESP_OK);
+    um_webserver_events_start();
+
+#if UM_FEATURE_ENABLED(METRICS)
+    registered += (register_metrics() == ESP_OK);
+#endif
+
+    // Обработчик статических файлов - последним
+    registered += (add_static_endpoint() == ESP_OK);
+
+    if (registered != builtin_handlers())
+    {
+        ESP_LOGE(WEBSERVER_TAG, "Registered %u of %u handlers", (unsigned)registered, (unsigned)builtin_handlers());
+    }
 
     ESP_LOGI(WEBSERVER_TAG, "Web-server started successfully");
     return ESP_OK;
@@ -480,8 +1396,28 @@ esp_err_t um_webserver_stop(void)
     if (server)
     {
         ESP_LOGI(WEBSERVER_TAG, "Stopping web-server");
+        stopping = true;
+        um_webserver_events_stop();
+        um_webserver_sse_stop();
+        // Асинхронные запросы пула возвращаются httpd до httpd_stop()
+        um_webserver_workers_stop();
         httpd_stop(server);
         server = NULL;
+        stopping = false;
+        um_webserver_cache_stop();
+        um_webserver_auth_stop();
+        static_registered = false;
+        static_uri.user_ctx = NULL;
+
+        while (endpoints)
+        {
+            endpoint_t *ep = endpoints;
+            endpoints = ep->next;
+            free_endpoint(ep);
+        }
+#if CONFIG_HTTPD_WS_SUPPORT
+        um_webserver_ws_stop();
+#endif
     }
     return ESP_OK;
 }
@@ -0,0 +1,544 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/constant_time.h"
+
+#include "base_config.h"
+#include "um_events.h"
+#include "um_metrics.h"
+#include "um_nvs.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_auth";
+
+// Часы считаются установленными после 2020-01-01: до синхронизации SNTP
+// (time_sync_init() в main.c) time() считает от 1970 года
+#define AUTH_TIME_VALID 1577836800
+
+#define SESSION_HEX_LEN (UM_WEB_TOKEN_BYTES * 2)
+// Подписанный токен: срок действия (8 hex) + HMAC-SHA256, усечённый до UM_WEB_TOKEN_BYTES
+#define SIGNED_HEX_LEN (8 + UM_WEB_TOKEN_BYTES * 2)
+
+typedef enum
+{
+    SLOT_EMPTY = 0, // не использовался: поиск дальше не идёт
+    SLOT_USED,
+    SLOT_DELETED, // удалён или истёк: поиск идёт дальше, вставка занимает
+} slot_state_t;
+
+typedef struct
+{
+    uint8_t token[UM_WEB_TOKEN_BYTES];
+    int64_t expires_us; // по esp_timer: сессии не переживают перезагрузку
+    slot_state_t state;
+} session_t;
+
+static struct
+{
+    portMUX_TYPE mux;
+    session_t slots[CONFIG_UM_CFG_WEBSERVER_AUTH_SESSIONS];
+    uint8_t key[UM_WEB_HMAC_KEY_LEN]; // секрет подписанных токенов, в NVS
+    // Учётные данные из NVS: только SHA-256, пароль в памяти не хранится
+    uint8_t user_hash[32];
+    uint8_t pwd_hash[32];
+    bool creds;         // логин и пароль заданы
+    bool installed;     // um_nvs_is_installed()
+    uint32_t creds_gen; // s_creds_gen, при котором прочитаны
+    bool open;          // последнее состояние для журнала: учётных данных ещё нет
+} s_auth = {.mux = portMUX_INITIALIZER_UNLOCKED};
+
+// Растёт по UMNI_EVENT_CONFIG_SAVED: учётные данные перечитываются при следующем запросе
+static uint32_t s_creds_gen = 1;
+static bool s_subscribed;
+
+static const uint32_t auth_time_bounds[] = {10, 20, 50, 100, 200, 500, 1000};
+static uint32_t auth_time_buckets[sizeof(auth_time_bounds) / sizeof(auth_time_bounds[0]) + 1];
+static um_metric_t m_auth_time = UM_METRIC_HISTOGRAM("um_http_auth_duration_seconds",
+                                                     "Token check time per API request",
+                                                     auth_time_bounds, auth_time_buckets, 1e-6f);
+
+static void to_hex(const uint8_t *data, size_t len, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i * 2] = digits[data[i] >> 4];
+        out[i * 2 + 1] = digits[data[i] & 0x0f];
+    }
+    out[len * 2] = '\0';
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static bool from_hex(const char *hex, size_t len, uint8_t *out)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        int hi = hex_digit(hex[i * 2]);
+        int lo = hex_digit(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0)
+        {
+            return false;
+        }
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+/**
+ * @brief Загрузить секрет подписи из NVS или создать новый
+ */
+static esp_err_t load_key(bool rotate)
+{
+    uint8_t key[UM_WEB_HMAC_KEY_LEN];
+    size_t len = sizeof(key);
+    if (rotate || um_nvs_read_blob(UM_NVS_KEY_WEBSERVER_TOKEN, key, &len) != ESP_OK || len != sizeof(key))
+    {
+        esp_fill_random(key, sizeof(key));
+        esp_err_t ret = um_nvs_write_blob(UM_NVS_KEY_WEBSERVER_TOKEN, key, sizeof(key));
+        if (ret != ESP_OK)
+        {
+            // Токены будут действовать до перезагрузки
+            ESP_LOGW(TAG, "Signing key not saved: %s", esp_err_to_name(ret));
+        }
+    }
+
+    portENTER_CRITICAL(&s_auth.mux);
+    memcpy(s_auth.key, key, sizeof(key));
+    portEXIT_CRITICAL(&s_auth.mux);
+    memset(key, 0, sizeof(key));
+    return ESP_OK;
+}
+
+/**
+ * @brief Перечитать учётные данные из NVS, если было UMNI_EVENT_CONFIG_SAVED
+ *
+ * Чтение из NVS - пять ключей и четыре malloc: на каждом запросе это дороже
+ * самой проверки токена. Поколение берётся до чтения: событие во время
+ * чтения вызовет ещё одно на следующем запросе.
+ */
+static void load_credentials(void)
+{
+    uint32_t gen = __atomic_load_n(&s_creds_gen, __ATOMIC_ACQUIRE);
+    portENTER_CRITICAL(&s_auth.mux);
+    bool fresh = s_auth.creds_gen == gen;
+    portEXIT_CRITICAL(&s_auth.mux);
+    if (fresh)
+    {
+        return;
+    }
+
+    bool installed = um_nvs_is_installed();
+    char *user = NULL;
+    char *pwd = NULL;
+    uint8_t user_hash[32] = {0};
+    uint8_t pwd_hash[32] = {0};
+    bool creds = um_nvs_get_username(&user) == ESP_OK && um_nvs_get_password(&pwd) == ESP_OK;
+    if (creds)
+    {
+        mbedtls_sha256((const uint8_t *)user, strlen(user), user_hash, 0);
+        mbedtls_sha256((const uint8_t *)pwd, strlen(pwd), pwd_hash, 0);
+        memset(pwd, 0, strlen(pwd));
+    }
+    free(user);
+    free(pwd);
+
+    portENTER_CRITICAL(&s_auth.mux);
+    memcpy(s_auth.user_hash, user_hash, sizeof(user_hash));
+    memcpy(s_auth.pwd_hash, pwd_hash, sizeof(pwd_hash));
+    s_auth.creds = creds;
+    s_auth.installed = installed;
+    s_auth.creds_gen = gen;
+    portEXIT_CRITICAL(&s_auth.mux);
+    memset(pwd_hash, 0, sizeof(pwd_hash));
+}
+
+static void event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    __atomic_add_fetch(&s_creds_gen, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Система не установлена: API открыт
+ *
+ * Установка (и сброс) проходят без перезагрузки: после записи учётных данных
+ * и UMNI_EVENT_CONFIG_SAVED API закрывается со следующего запроса.
+ */
+static bool auth_open(void)
+{
+    load_credentials();
+    portENTER_CRITICAL(&s_auth.mux);
+    bool open = !s_auth.installed;
+    portEXIT_CRITICAL(&s_auth.mux);
+    if (open != s_auth.open)
+    {
+        s_auth.open = open;
+        if (open)
+        {
+            ESP_LOGW(TAG, "System not installed: API is open until credentials are set");
+        }
+        else
+        {
+            ESP_LOGI(TAG, "System installed: API requires a token");
+        }
+    }
+    return open;
+}
+
+esp_err_t um_webserver_auth_start(void)
+{
+    um_metrics_register(&m_auth_time);
+    if (!s_subscribed)
+    {
+        esp_err_t ret = um_event_subscribe(UMNI_EVENT_CONFIG_SAVED, event_handler, NULL);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Subscribe failed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        s_subscribed = true;
+    }
+#ifdef CONFIG_UM_CFG_WEBSERVER_AUTH
+    s_auth.open = false;
+    auth_open();
+#endif
+    return load_key(false);
+}
+
+void um_webserver_auth_stop(void)
+{
+    if (s_subscribed)
+    {
+        um_event_unsubscribe(UMNI_EVENT_CONFIG_SAVED, event_handler);
+        s_subscribed = false;
+    }
+    // Без подписки изменения не видны: после запуска учётные данные читаются заново
+    __atomic_add_fetch(&s_creds_gen, 1, __ATOMIC_RELEASE);
+}
+
+/* ---------- Таблица сессий ---------- */
+
+static size_t home_slot(const uint8_t *token)
+{
+    // Токен случайный: первые байты уже равномерно распределены
+    uint32_t h;
+    memcpy(&h, token, sizeof(h));
+    return h % CONFIG_UM_CFG_WEBSERVER_AUTH_SESSIONS;
+}
+
+// Вызывается под mux
+static session_t *find_session(const uint8_t *token, int64_t now)
+{
+    size_t i = home_slot(token);
+    for (size_t n = 0; n < CONFIG_UM_CFG_WEBSERVER_AUTH_SESSIONS; n++)
+    {
+        session_t *s = &s_auth.slots[i];
+        if (s->state == SLOT_EMPTY)
+        {
+            break;
+        }
+        // Сравнение без раннего выхода: время не зависит от совпавших байт
+        if (s->state == SLOT_USED && mbedtls_ct_memcmp(s->token, token, UM_WEB_TOKEN_BYTES) == 0)
+        {
+            if (s->expires_us <= now)
+            {
+                s->state = SLOT_DELETED;
+                return NULL;
+            }
+            return s;
+        }
+        i = (i + 1) % CONFIG_UM_CFG_WEBSERVER_AUTH_SESSIONS;
+    }
+    return NULL;
+}
+
+static void add_session(const uint8_t *token, int64_t expires_us)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_auth.mux);
+    size_t i = home_slot(token);
+    session_t *victim = NULL;
+    for (size_t n = 0; n < CONFIG_UM_CFG_WEBSERVER_AUTH_SESSIONS; n++)
+    {
+        session_t *s = &s_auth.slots[i];
+        if (s->state != SLOT_USED || s->expires_us <= now)
+        {
+            victim = s;
+            break;
+        }
+        // Таблица полна: вытесняется сессия, которая истечёт первой
+        if (!victim || s->expires_us < victim->expires_us)
+        {
+            victim = s;
+        }
+        i = (i + 1) % CONFIG_UM_CFG_WEBSERVER_AUTH_SESSIONS;
+    }
+    memcpy(victim->token, token, UM_WEB_TOKEN_BYTES);
+    victim->expires_us = expires_us;
+    victim->state = SLOT_USED;
+    portEXIT_CRITICAL(&s_auth.mux);
+}
+
+static void remove_session(const uint8_t *token)
+{
+    portENTER_CRITICAL(&s_auth.mux);
+    session_t *s = find_session(token, esp_timer_get_time());
+    if (s)
+    {
+        s->state = SLOT_DELETED;
+    }
+    portEXIT_CRITICAL(&s_auth.mux);
+}
+
+static bool session_valid(const uint8_t *token)
+{
+    portENTER_CRITICAL(&s_auth.mux);
+    bool valid = find_session(token, esp_timer_get_time()) != NULL;
+    portEXIT_CRITICAL(&s_auth.mux);
+    return valid;
+}
+
+/* ---------- Подписанные токены ---------- */
+
+static void sign(uint32_t expires, uint8_t *mac)
+{
+    uint8_t key[UM_WEB_HMAC_KEY_LEN];
+    portENTER_CRITICAL(&s_auth.mux);
+    memcpy(key, s_auth.key, sizeof(key));
+    portEXIT_CRITICAL(&s_auth.mux);
+
+    const uint8_t msg[] = {'u', 'm', 'v', '1', expires >> 24, expires >> 16, expires >> 8, expires};
+    uint8_t full[32];
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key, sizeof(key), msg, sizeof(msg), full);
+    memcpy(mac, full, UM_WEB_TOKEN_BYTES);
+    memset(key, 0, sizeof(key));
+}
+
+static bool signed_valid(const char *hex)
+{
+    uint8_t exp_bytes[4];
+    uint8_t mac[UM_WEB_TOKEN_BYTES];
+    if (!from_hex(hex, sizeof(exp_bytes), exp_bytes) || !from_hex(hex + 8, sizeof(mac), mac))
+    {
+        return false;
+    }
+
+    uint32_t expires = (uint32_t)exp_bytes[0] << 24 | exp_bytes[1] << 16 | exp_bytes[2] << 8 | exp_bytes[3];
+    uint8_t expected[UM_WEB_TOKEN_BYTES];
+    sign(expires, expected);
+    // Срок проверяется после подписи: без верного ключа ответ всегда одинаков
+    if (mbedtls_ct_memcmp(expected, mac, sizeof(mac)) != 0)
+    {
+        return false;
+    }
+    // До SNTP любой срок "в будущем": после перезагрузки истёкший токен снова
+    // был бы действителен. Сессионные токены (esp_timer) работают и без часов
+    time_t now = time(NULL);
+    return now >= AUTH_TIME_VALID && now < (time_t)expires;
+}
+
+/* ---------- Проверка запроса ---------- */
+
+/**
+ * @brief Значение token из query, прямо в req->uri
+ *
+ * Без копии query в буфер: при длинных ?ids=...&path=... token в конце не теряется.
+ */
+static size_t query_token(const char *uri, char *buf, size_t size)
+{
+    const char *p = strchr(uri, '?');
+    while (p && *p)
+    {
+        p++;
+        size_t len = strcspn(p, "&");
+        if (len > 6 && strncmp(p, "token=", 6) == 0)
+        {
+            // Длиннее любого токена - не токен
+            if (len - 6 >= size)
+            {
+                return 0;
+            }
+            memcpy(buf, p + 6, len - 6);
+            buf[len - 6] = '\0';
+            return len - 6;
+        }
+        p += len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Токен из "Authorization: Bearer" или ?token= (EventSource и WebSocket не задают заголовки)
+ */
+static size_t get_token(httpd_req_t *req, char *buf, size_t size)
+{
+    char header[8 + SIGNED_HEX_LEN + 1];
+    if (httpd_req_get_hdr_value_str(req, "Authorization", header, sizeof(header)) == ESP_OK &&
+        strncmp(header, "Bearer ", 7) == 0)
+    {
+        snprintf(buf, size, "%s", header + 7);
+        return strlen(buf);
+    }
+    return query_token(req->uri, buf, size);
+}
+
+esp_err_t um_webserver_auth_check(httpd_req_t *req)
+{
+#ifdef CONFIG_UM_CFG_WEBSERVER_AUTH
+    if (auth_open())
+    {
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    char token[SIGNED_HEX_LEN + 1];
+    size_t len = get_token(req, token, sizeof(token));
+
+    bool valid = false;
+    if (len == SESSION_HEX_LEN)
+    {
+        uint8_t raw[UM_WEB_TOKEN_BYTES];
+        valid = from_hex(token, sizeof(raw), raw) && session_valid(raw);
+    }
+    else if (len == SIGNED_HEX_LEN)
+    {
+        valid = signed_valid(token);
+    }
+
+    um_metric_observe(&m_auth_time, (uint32_t)(esp_timer_get_time() - start_us));
+    return valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+#else
+    return ESP_OK;
+#endif
+}
+
+esp_err_t um_webserver_auth_reject(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "401 Unauthorized");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+    return httpd_resp_sendstr(req, "{\"success\":false,\"error\":\"Unauthorized\"}");
+}
+
+/* ---------- Вход и выход ---------- */
+
+/**
+ * @brief Сравнить строку с SHA-256 из NVS за время, не зависящее от содержимого и длины
+ */
+static bool secret_matches(const char *input, const uint8_t *hash)
+{
+    uint8_t h[32];
+    mbedtls_sha256((const uint8_t *)input, strlen(input), h, 0);
+    return mbedtls_ct_memcmp(h, hash, sizeof(h)) == 0;
+}
+
+static bool credentials_valid(const char *username, const char *password)
+{
+    load_credentials();
+    uint8_t user_hash[32];
+    uint8_t pwd_hash[32];
+    portENTER_CRITICAL(&s_auth.mux);
+    bool creds = s_auth.creds;
+    memcpy(user_hash, s_auth.user_hash, sizeof(user_hash));
+    memcpy(pwd_hash, s_auth.pwd_hash, sizeof(pwd_hash));
+    portEXIT_CRITICAL(&s_auth.mux);
+
+    // Обе проверки выполняются всегда: по времени не видно, что не совпало
+    bool user_ok = secret_matches(username, user_hash);
+    bool pwd_ok = secret_matches(password, pwd_hash);
+    memset(pwd_hash, 0, sizeof(pwd_hash));
+    return creds & user_ok & pwd_ok;
+}
+
+esp_err_t um_webserver_auth_login(httpd_req_t *req, cJSON *input, cJSON **output)
+{
+    cJSON *username = cJSON_GetObjectItem(input, "username");
+    cJSON *password = cJSON_GetObjectItem(input, "password");
+    cJSON *stateless = cJSON_GetObjectItem(input, "stateless");
+    if (!cJSON_IsString(username) || !cJSON_IsString(password))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!credentials_valid(username->valuestring, password->valuestring))
+    {
+        // Без логина: в журнал не попадает пароль, введённый в поле логина
+        ESP_LOGW(TAG, "Login failed");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char token[SIGNED_HEX_LEN + 1];
+    if (cJSON_IsTrue(stateless))
+    {
+        // Проверяется без таблицы, но отозвать можно только сменой ключа
+        time_t now = time(NULL);
+        if (now < AUTH_TIME_VALID)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        uint32_t expires = (uint32_t)now + CONFIG_UM_CFG_WEBSERVER_AUTH_TTL;
+        const uint8_t exp_bytes[] = {expires >> 24, expires >> 16, expires >> 8, expires};
+        uint8_t mac[UM_WEB_TOKEN_BYTES];
+        sign(expires, mac);
+        to_hex(exp_bytes, sizeof(exp_bytes), token);
+        to_hex(mac, sizeof(mac), token + 8);
+    }
+    else
+    {
+        uint8_t raw[UM_WEB_TOKEN_BYTES];
+        esp_fill_random(raw, sizeof(raw));
+        add_session(raw, esp_timer_get_time() + (int64_t)CONFIG_UM_CFG_WEBSERVER_AUTH_TTL * 1000000);
+        to_hex(raw, sizeof(raw), token);
+    }
+
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddStringToObject(data, "token", token);
+    cJSON_AddNumberToObject(data, "expires_in", CONFIG_UM_CFG_WEBSERVER_AUTH_TTL);
+    *output = data;
+    ESP_LOGI(TAG, "Login '%s' (%s token)", username->valuestring, cJSON_IsTrue(stateless) ? "signed" : "session");
+    return ESP_OK;
+}
+
+esp_err_t um_webserver_auth_logout(httpd_req_t *req, cJSON *input, cJSON **output)
+{
+    if (cJSON_IsTrue(cJSON_GetObjectItem(input, "all")))
+    {
+        // Новый ключ отменяет все подписанные токены
+        portENTER_CRITICAL(&s_auth.mux);
+        memset(s_auth.slots, 0, sizeof(s_auth.slots));
+        portEXIT_CRITICAL(&s_auth.mux);
+        ESP_LOGI(TAG, "All tokens revoked");
+        return load_key(true);
+    }
+
+    char token[SIGNED_HEX_LEN + 1];
+    uint8_t raw[UM_WEB_TOKEN_BYTES];
+    if (get_token(req, token, sizeof(token)) != SESSION_HEX_LEN || !from_hex(token, sizeof(raw), raw))
+    {
+        // Подписанный токен истечёт сам
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    remove_session(raw);
+    return ESP_OK;
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
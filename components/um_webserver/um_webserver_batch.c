@@ -0,0 +1,287 @@
+#include <string.h>
+#include "esp_log.h"
+
+#include "base_config.h"
+#include "um_nvs.h"
+#include "um_nvs_config.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(OUTPUTS)
+#include "um_dio.h"
+#endif
+
+#if UM_FEATURE_ENABLED(OC1) || UM_FEATURE_ENABLED(OC2)
+#include "um_opencollectors.h"
+#endif
+
+#if UM_FEATURE_ENABLED(OPENTHERM)
+#include "um_opentherm.h"
+#endif
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_batch";
+
+/**
+ * @brief Ключи, которые можно писать через {"op":"nvs"}
+ *
+ * Учётные данные, сеть и служебные ключи сюда не входят: их меняют только
+ * отдельные endpoints с проверками.
+ */
+static const struct
+{
+    const char *key;
+    um_nvs_field_type_t type;
+} s_nvs_keys[] = {
+    {UM_NVS_KEY_OT_EN, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_CH, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_CH2, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_CH_SETPOINT, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_DHW_SETPOINT, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_DHW, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_COOL, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_MOD, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_OTC, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_OT_HCR, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_MQTT_ENABLED, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_MQTT_HOST, UM_NVS_FIELD_STR},
+    {UM_NVS_KEY_MQTT_PORT, UM_NVS_FIELD_U16},
+    {UM_NVS_KEY_WEBHOOKS, UM_NVS_FIELD_I8},
+    {UM_NVS_KEY_WEBHOOKS_URL, UM_NVS_FIELD_STR},
+    {UM_NVS_KEY_NTP, UM_NVS_FIELD_STR},
+    {UM_NVS_KEY_TIMEZONE, UM_NVS_FIELD_STR},
+};
+
+/**
+ * @brief Накопленные операции с выходами: пишутся в PCF8574 одной транзакцией
+ */
+typedef struct
+{
+    uint8_t mask;
+    uint8_t levels;
+    cJSON *results[UM_WEB_BATCH_MAX_OPS]; // результаты, ожидающие записи
+    uint8_t count;
+} output_group_t;
+
+static cJSON *add_result(cJSON *results, esp_err_t ret, const char *error)
+{
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddBoolToObject(item, "ok", ret == ESP_OK);
+    if (ret != ESP_OK)
+    {
+        cJSON_AddStringToObject(item, "error", error ? error : esp_err_to_name(ret));
+    }
+    cJSON_AddItemToArray(results, item);
+    return item;
+}
+
+static void flush_outputs(output_group_t *group)
+{
+    if (group->count == 0)
+    {
+        return;
+    }
+#if UM_FEATURE_ENABLED(OUTPUTS)
+    esp_err_t ret = um_dio_set_outputs_masked(group->mask, group->levels);
+#else
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Outputs 0x%02x not set: %s", group->mask, esp_err_to_name(ret));
+        for (uint8_t i = 0; i < group->count; i++)
+        {
+            cJSON_ReplaceItemInObject(group->results[i], "ok", cJSON_CreateFalse());
+            cJSON_AddStringToObject(group->results[i], "error", esp_err_to_name(ret));
+        }
+    }
+    group->mask = 0;
+    group->levels = 0;
+    group->count = 0;
+}
+
+static const char *queue_output(output_group_t *group, cJSON *op)
+{
+    cJSON *index = cJSON_GetObjectItem(op, "index");
+    cJSON *state = cJSON_GetObjectItem(op, "state");
+    if (!cJSON_IsNumber(index) || index->valueint < 1 || index->valueint > 8 || !cJSON_IsBool(state))
+    {
+        return "index 1-8 and state required";
+    }
+
+    uint8_t bit = 1 << (index->valueint - 1);
+    group->mask |= bit;
+    if (cJSON_IsTrue(state))
+        group->levels |= bit;
+    else
+        group->levels &= ~bit;
+    return NULL;
+}
+
+static esp_err_t run_oc(cJSON *op)
+{
+#if UM_FEATURE_ENABLED(OC1) || UM_FEATURE_ENABLED(OC2)
+    cJSON *channel = cJSON_GetObjectItem(op, "channel");
+    cJSON *state = cJSON_GetObjectItem(op, "state");
+    if (!cJSON_IsNumber(channel) || !cJSON_IsBool(state))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    um_oc_state_t level = cJSON_IsTrue(state) ? UM_OC_STATE_ON : UM_OC_STATE_OFF;
+
+    switch (channel->valueint)
+    {
+#if UM_FEATURE_ENABLED(OC1)
+    case 1:
+        return um_opencollectors_set(UM_OC_CHANNEL_1, level);
+#endif
+#if UM_FEATURE_ENABLED(OC2)
+    case 2:
+        return um_opencollectors_set(UM_OC_CHANNEL_2, level);
+#endif
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static esp_err_t run_ot(cJSON *op)
+{
+#if UM_FEATURE_ENABLED(OPENTHERM)
+    cJSON *ch_sp = cJSON_GetObjectItem(op, "ch_setpoint");
+    cJSON *dhw_sp = cJSON_GetObjectItem(op, "dhw_setpoint");
+    cJSON *ch = cJSON_GetObjectItem(op, "ch");
+
+    if ((ch_sp && (!cJSON_IsNumber(ch_sp) || ch_sp->valueint < 0 || ch_sp->valueint > 100)) ||
+        (dhw_sp && (!cJSON_IsNumber(dhw_sp) || dhw_sp->valueint < 0 || dhw_sp->valueint > 100)) ||
+        (ch && !cJSON_IsBool(ch)))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Новые значения применит задача OpenTherm на следующем цикле
+    um_ot_set_targets(ch_sp ? ch_sp->valueint : -1, dhw_sp ? dhw_sp->valueint : -1);
+    if (ch)
+    {
+        um_ot_set_central_heating_active(cJSON_IsTrue(ch));
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static esp_err_t run_nvs(cJSON *op)
+{
+    cJSON *key = cJSON_GetObjectItem(op, "key");
+    cJSON *value = cJSON_GetObjectItem(op, "value");
+    if (!cJSON_IsString(key) || !value)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < sizeof(s_nvs_keys) / sizeof(s_nvs_keys[0]); i++)
+    {
+        if (strcmp(s_nvs_keys[i].key, key->valuestring) != 0)
+        {
+            continue;
+        }
+        switch (s_nvs_keys[i].type)
+        {
+        case UM_NVS_FIELD_I8:
+            if (cJSON_IsBool(value))
+                return um_nvs_write_i8(key->valuestring, cJSON_IsTrue(value) ? 1 : 0);
+            if (!cJSON_IsNumber(value) || value->valueint < INT8_MIN || value->valueint > INT8_MAX)
+                return ESP_ERR_INVALID_ARG;
+            return um_nvs_write_i8(key->valuestring, (int8_t)value->valueint);
+        case UM_NVS_FIELD_U16:
+            if (!cJSON_IsNumber(value) || value->valueint < 0 || value->valueint > UINT16_MAX)
+                return ESP_ERR_INVALID_ARG;
+            return um_nvs_write_u16(key->valuestring, (uint16_t)value->valueint);
+        case UM_NVS_FIELD_STR:
+            if (!cJSON_IsString(value) || strlen(value->valuestring) >= UM_NVS_CFG_STR_MAX_LEN)
+                return ESP_ERR_INVALID_ARG;
+            return um_nvs_write_str(key->valuestring, value->valuestring);
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t um_webserver_batch_handler(httpd_req_t *req, cJSON *input, cJSON **output)
+{
+    if (!cJSON_IsArray(input))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int count = cJSON_GetArraySize(input);
+    if (count == 0 || count > UM_WEB_BATCH_MAX_OPS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cJSON *data = cJSON_CreateObject();
+    cJSON *results = cJSON_AddArrayToObject(data, "results");
+    output_group_t group = {0};
+
+    // Один commit NVS на весь пакет. Откладываются только записи этой задачи:
+    // остальные коммитят сразу, а их пакеты ждут окончания этого
+    esp_err_t ret = um_nvs_batch_begin();
+    if (ret != ESP_OK)
+    {
+        cJSON_Delete(data);
+        return ret;
+    }
+
+    cJSON *op;
+    cJSON_ArrayForEach(op, input)
+    {
+        cJSON *name = cJSON_GetObjectItem(op, "op");
+        const char *type = cJSON_IsString(name) ? name->valuestring : "";
+
+        if (strcmp(type, "output") == 0)
+        {
+            // Подряд идущие выходы собираются в одну запись PCF8574
+            const char *error = queue_output(&group, op);
+            cJSON *item = add_result(results, error ? ESP_ERR_INVALID_ARG : ESP_OK, error);
+            if (!error)
+            {
+                group.results[group.count++] = item;
+            }
+            continue;
+        }
+
+        // Порядок сохраняется: накопленные выходы пишутся до следующей операции
+        flush_outputs(&group);
+
+        if (strcmp(type, "oc") == 0)
+            ret = run_oc(op);
+        else if (strcmp(type, "ot") == 0)
+            ret = run_ot(op);
+        else if (strcmp(type, "nvs") == 0)
+            ret = run_nvs(op);
+        else
+            ret = ESP_ERR_NOT_SUPPORTED;
+
+        if (ret != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Op '%s' failed: %s", type, esp_err_to_name(ret));
+        }
+        add_result(results, ret, NULL);
+    }
+    flush_outputs(&group);
+
+    ret = um_nvs_batch_end();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Batch commit failed: %s", esp_err_to_name(ret));
+    }
+    cJSON_AddBoolToObject(data, "saved", ret == ESP_OK);
+
+    *output = data;
+    return ESP_OK;
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
@@ -0,0 +1,145 @@
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+
+#include "base_config.h"
+#include "um_storage.h"
+#include "um_webserver.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_body";
+
+esp_err_t um_webserver_body_check(httpd_req_t *req, size_t max_body)
+{
+    if (req->content_len == 0)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty request");
+        return ESP_FAIL;
+    }
+
+    if (req->content_len > (max_body ? max_body : UM_WEBSERVER_MAX_BODY))
+    {
+        ESP_LOGW(TAG, "%s: body %u bytes over limit", req->uri, (unsigned)req->content_len);
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        httpd_resp_sendstr(req, "{\"success\":false,\"error\":\"Request too large\"}");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t um_webserver_body_read(um_webserver_body_t *body, char *buf, size_t size, size_t *out_len)
+{
+    *out_len = 0;
+    if (body->remaining == 0)
+    {
+        return ESP_OK;
+    }
+
+    size_t want = MIN(size, body->remaining);
+    for (int retries = 0;; retries++)
+    {
+        // recv может вернуть меньше запрошенного: берём сколько пришло
+        int n = httpd_req_recv(body->req, buf, want);
+        if (n > 0)
+        {
+            body->remaining -= n;
+            *out_len = n;
+            return ESP_OK;
+        }
+        if (n != HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            ESP_LOGW(TAG, "%s: connection closed, %u bytes not received", body->req->uri,
+                     (unsigned)body->remaining);
+            return ESP_FAIL;
+        }
+        if (retries == UM_WEB_RECV_RETRIES)
+        {
+            ESP_LOGW(TAG, "%s: receive timeout", body->req->uri);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+esp_err_t um_webserver_recv_all(httpd_req_t *req, char *buf, size_t len)
+{
+    um_webserver_body_t body = {.req = req, .remaining = len};
+    size_t pos = 0;
+    while (body.remaining > 0)
+    {
+        size_t n;
+        esp_err_t ret = um_webserver_body_read(&body, buf + pos, body.remaining, &n);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+        pos += n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t um_webserver_body_parse_json(um_webserver_body_t *body, um_json_stream_cb_t cb, void *ctx)
+{
+    um_json_stream_t parser;
+    um_json_stream_init(&parser, cb, ctx);
+
+    char chunk[UM_WEB_BODY_CHUNK];
+    size_t n;
+    esp_err_t ret;
+    while ((ret = um_webserver_body_read(body, chunk, sizeof(chunk), &n)) == ESP_OK && n > 0)
+    {
+        ret = um_json_stream_feed(&parser, chunk, n);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+    }
+    return ret == ESP_OK ? um_json_stream_finish(&parser) : ret;
+}
+
+esp_err_t um_webserver_body_save(um_webserver_body_t *body, const char *path, uint32_t flags,
+                                 um_json_stream_t *validate)
+{
+    um_storage_writer_t writer;
+    esp_err_t ret = um_storage_writer_open(path, flags, &writer);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    char chunk[UM_WEB_BODY_CHUNK];
+    size_t n;
+    while ((ret = um_webserver_body_read(body, chunk, sizeof(chunk), &n)) == ESP_OK && n > 0)
+    {
+        if (validate)
+        {
+            ret = um_json_stream_feed(validate, chunk, n);
+            if (ret != ESP_OK)
+            {
+                break;
+            }
+        }
+        ret = um_storage_writer_write(&writer, chunk, n);
+        if (ret != ESP_OK)
+        {
+            break;
+        }
+    }
+    if (ret == ESP_OK && validate)
+    {
+        ret = um_json_stream_finish(validate);
+    }
+
+    if (ret != ESP_OK)
+    {
+        // Оригинал не тронут: старое содержимое остаётся до полного приёма нового
+        ESP_LOGW(TAG, "%s not saved: %s", path, esp_err_to_name(ret));
+        um_storage_writer_abort(&writer);
+        return ret;
+    }
+    return um_storage_writer_commit(&writer);
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
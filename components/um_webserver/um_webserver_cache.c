@@ -0,0 +1,361 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "base_config.h"
+#include "um_events.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_cache";
+
+// URI длиннее (без token) не кэшируется
+#define UM_WEB_CACHE_KEY_MAX 128
+
+/**
+ * @brief Закэшированный ответ
+ *
+ * Тело и ETag не меняются после создания, поэтому отправляются без
+ * блокировки; запись освобождается, когда её убрали из списка и
+ * закончилась последняя отправка.
+ */
+typedef struct cache_entry
+{
+    struct cache_entry *prev;
+    struct cache_entry *next;
+    uint32_t events; // маска событий, сбрасывающих запись
+    uint16_t refs;   // ссылка списка + отправки в процессе
+    size_t len;
+    char *body;
+    char etag[12];
+    char key[]; // URI вместе с query, без token
+} cache_entry_t;
+
+static struct
+{
+    SemaphoreHandle_t lock;
+    // LRU: в голове - последний использованный, вытесняется хвост
+    cache_entry_t *head;
+    cache_entry_t *tail;
+    size_t bytes;
+    uint32_t watched;    // события, на которые настроены кэшируемые endpoints
+    uint32_t generation; // растёт при каждом сбросе
+    bool subscribed;
+} s_cache;
+
+static size_t entry_size(const cache_entry_t *e)
+{
+    return sizeof(cache_entry_t) + strlen(e->key) + 1 + e->len;
+}
+
+// Вызывается под lock
+static void entry_release(cache_entry_t *e)
+{
+    if (--e->refs == 0)
+    {
+        free(e->body);
+        free(e);
+    }
+}
+
+// Вызывается под lock
+static void entry_unlink(cache_entry_t *e)
+{
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        s_cache.head = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        s_cache.tail = e->prev;
+
+    e->prev = e->next = NULL;
+    s_cache.bytes -= entry_size(e);
+    entry_release(e);
+}
+
+// Вызывается под lock
+static void entry_push_front(cache_entry_t *e)
+{
+    e->prev = NULL;
+    e->next = s_cache.head;
+    if (s_cache.head)
+        s_cache.head->prev = e;
+    s_cache.head = e;
+    if (!s_cache.tail)
+        s_cache.tail = e;
+}
+
+// Вызывается под lock
+static cache_entry_t *find_entry(const char *key)
+{
+    for (cache_entry_t *e = s_cache.head; e; e = e->next)
+    {
+        if (strcmp(e->key, key) == 0)
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Ключ записи: URI без параметра token
+ *
+ * Ответ от токена не зависит: с ним в ключе каждый клиент получал бы
+ * свою копию, а токен оставался бы в памяти кэша.
+ *
+ * @return false - ключ не помещается, запрос не кэшируется
+ */
+static bool make_key(const char *uri, char *key, size_t size)
+{
+    const char *query = strchr(uri, '?');
+    size_t n = query ? (size_t)(query - uri) : strlen(uri);
+    if (n >= size)
+    {
+        return false;
+    }
+    memcpy(key, uri, n);
+
+    char sep = '?';
+    for (const char *p = query ? query + 1 : ""; *p;)
+    {
+        size_t len = strcspn(p, "&");
+        bool token = strncmp(p, "token", 5) == 0 && (len == 5 || p[5] == '=');
+        if (!token && len > 0)
+        {
+            if (n + 1 + len >= size)
+            {
+                return false;
+            }
+            key[n++] = sep;
+            memcpy(key + n, p, len);
+            n += len;
+            sep = '&';
+        }
+        p += len;
+        if (*p == '&')
+        {
+            p++;
+        }
+    }
+    key[n] = '\0';
+    return true;
+}
+
+static bool etag_matches(httpd_req_t *req, const char *etag)
+{
+    char buf[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", buf, sizeof(buf)) != ESP_OK)
+    {
+        return false;
+    }
+    return strcmp(buf, "*") == 0 || strstr(buf, etag) != NULL;
+}
+
+/**
+ * @brief Отправить тело с ETag или 304, если у клиента та же версия
+ */
+static esp_err_t send_body(httpd_req_t *req, const char *body, size_t len, const char *etag)
+{
+    // httpd хранит указатели: etag должен жить до отправки ответа
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (etag_matches(req, etag))
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, body, len);
+}
+
+static void event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id < 0 || id >= 32 || !(s_cache.watched & (1u << id)))
+    {
+        return;
+    }
+    um_webserver_cache_invalidate((1u << id));
+}
+
+esp_err_t um_webserver_cache_start(void)
+{
+    if (!s_cache.lock)
+    {
+        s_cache.lock = xSemaphoreCreateMutex();
+        if (!s_cache.lock)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (!s_cache.subscribed)
+    {
+        esp_err_t ret = um_event_subscribe(UMNI_EVENT_ANY, event_handler, NULL);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Subscribe failed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        s_cache.subscribed = true;
+    }
+    return ESP_OK;
+}
+
+void um_webserver_cache_stop(void)
+{
+    if (s_cache.subscribed)
+    {
+        um_event_unsubscribe(UMNI_EVENT_ANY, event_handler);
+        s_cache.subscribed = false;
+    }
+    um_webserver_cache_invalidate(UINT32_MAX);
+    s_cache.watched = 0;
+}
+
+void um_webserver_cache_watch(uint32_t events)
+{
+    s_cache.watched |= events;
+}
+
+uint32_t um_webserver_cache_generation(void)
+{
+    return s_cache.generation;
+}
+
+void um_webserver_cache_invalidate(uint32_t events)
+{
+    if (!s_cache.lock)
+    {
+        return;
+    }
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    // Ответы, которые строятся прямо сейчас, уже могут быть устаревшими
+    s_cache.generation++;
+    cache_entry_t *e = s_cache.head;
+    while (e)
+    {
+        cache_entry_t *next = e->next;
+        // UINT32_MAX - все записи, в том числе не зависящие от событий
+        if ((e->events & events) || events == UINT32_MAX)
+        {
+            ESP_LOGD(TAG, "Invalidated %s", e->key);
+            entry_unlink(e);
+        }
+        e = next;
+    }
+    xSemaphoreGive(s_cache.lock);
+}
+
+esp_err_t um_webserver_cache_send(httpd_req_t *req)
+{
+    char key[UM_WEB_CACHE_KEY_MAX];
+    if (!s_cache.lock || !make_key(req->uri, key, sizeof(key)))
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    cache_entry_t *e = find_entry(key);
+    if (e)
+    {
+        e->refs++;
+        if (e != s_cache.head)
+        {
+            // Поднимаем в голову LRU (размер не меняется)
+            if (e->prev)
+                e->prev->next = e->next;
+            if (e->next)
+                e->next->prev = e->prev;
+            else
+                s_cache.tail = e->prev;
+            entry_push_front(e);
+        }
+    }
+    xSemaphoreGive(s_cache.lock);
+
+    if (!e)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = send_body(req, e->body, e->len, e->etag);
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    entry_release(e);
+    xSemaphoreGive(s_cache.lock);
+    return ret;
+}
+
+esp_err_t um_webserver_cache_store_send(httpd_req_t *req, char *body, size_t len, uint32_t events, uint32_t gen)
+{
+    char etag[12];
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)esp_rom_crc32_le(0, (const uint8_t *)body, len));
+
+    char key[UM_WEB_CACHE_KEY_MAX];
+    bool cacheable = make_key(req->uri, key, sizeof(key));
+    size_t key_len = cacheable ? strlen(key) : 0;
+    size_t size = sizeof(cache_entry_t) + key_len + 1 + len;
+    cache_entry_t *e = NULL;
+    if (s_cache.lock && cacheable && size <= UM_WEB_CACHE_MAX_BYTES / 2)
+    {
+        e = malloc(sizeof(cache_entry_t) + key_len + 1);
+    }
+
+    if (e)
+    {
+        memcpy(e->key, key, key_len + 1);
+        memcpy(e->etag, etag, sizeof(etag));
+        e->body = body;
+        e->len = len;
+        e->events = events;
+        e->refs = 2; // список + эта отправка
+
+        xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+        if (gen == s_cache.generation)
+        {
+            cache_entry_t *old = find_entry(e->key);
+            if (old)
+            {
+                entry_unlink(old);
+            }
+            while (s_cache.tail && s_cache.bytes + size > UM_WEB_CACHE_MAX_BYTES)
+            {
+                ESP_LOGD(TAG, "Evicted %s", s_cache.tail->key);
+                entry_unlink(s_cache.tail);
+            }
+            entry_push_front(e);
+            s_cache.bytes += size;
+        }
+        else
+        {
+            // Пока строили ответ, пришло событие: отдаём, но не запоминаем
+            e->refs = 1;
+        }
+        xSemaphoreGive(s_cache.lock);
+    }
+
+    esp_err_t ret = send_body(req, body, len, etag);
+
+    if (e)
+    {
+        xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+        entry_release(e);
+        xSemaphoreGive(s_cache.lock);
+    }
+    else
+    {
+        free(body);
+    }
+    return ret;
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
@@ -0,0 +1,520 @@
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "base_config.h"
+
+#include "um_webserver_priv.h"
+#include "um_json_writer.h"
+#include "um_events.h"
+
+#if UM_FEATURE_ENABLED(INPUTS) || UM_FEATURE_ENABLED(OUTPUTS)
+#include "um_dio.h"
+#endif
+
+#if UM_FEATURE_ENABLED(ONEWIRE)
+#include "um_onewire.h"
+#endif
+
+#if UM_FEATURE_ENABLED(OPENTHERM)
+#include "um_opentherm.h"
+#endif
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_events";
+
+#define UM_WEB_EVENT_MAX_SINKS 2
+
+// Кодирование и рассылка идут в своей задаче, а не в sys_evt: стеку цикла
+// событий (CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE, 2304) не хватает на
+// буфер um_json_writer, printf чисел и вызовы httpd
+#define UM_WEB_EVENT_STACK 4096
+#define UM_WEB_EVENT_PRIORITY 4
+#define UM_WEB_EVENT_QUEUE_LEN 16
+// Команда остановки задачи в очереди
+#define UM_WEB_EVENT_QUIT (-1)
+
+// Изменение температуры меньше порога не рассылается
+#define UM_WEB_TEMP_DELTA 0.1f
+
+/*
+ * Формат сообщений (компактный, одно событие - одно сообщение):
+ *   {"t":"in","v":63,"c":4}             входы: порт PCF8574 и изменившиеся биты
+ *   {"t":"out","v":254,"c":1}           выходы
+ *   {"t":"temp","s":{"28ff..":21.56}}   только изменившиеся датчики
+ *   {"t":"ot","boiler":45.6,...}        только изменившиеся поля OpenTherm
+ *   {"t":"sd","m":true}                 SD карта смонтирована/извлечена
+ *   {"t":"state",...}                   полный снимок при подключении клиента
+ */
+
+/**
+ * @brief Событие в очереди задачи web_ev
+ *
+ * Данные копируются только для входов/выходов; температуры и OpenTherm
+ * читаются в момент кодирования.
+ */
+typedef struct
+{
+    int32_t id;
+    um_event_dio_t dio;
+} ev_item_t;
+
+static struct
+{
+    um_web_event_sink_t sinks[UM_WEB_EVENT_MAX_SINKS];
+    uint8_t sink_count;
+    bool subscribed;
+    QueueHandle_t queue;
+    SemaphoreHandle_t done;
+    TaskHandle_t task;
+    uint32_t dropped;
+    // Буфер кодирования, последние отправленные значения и значения
+    // текущего сообщения: используются только из задачи web_ev
+    char buf[UM_WEB_EVENT_MAX_LEN];
+#if UM_FEATURE_ENABLED(ONEWIRE)
+    float temp_sent[ONEWIRE_MAX_SENSORS];
+    bool temp_valid[ONEWIRE_MAX_SENSORS];
+    float temp_new[ONEWIRE_MAX_SENSORS];
+    bool temp_pending[ONEWIRE_MAX_SENSORS];
+#endif
+#if UM_FEATURE_ENABLED(OPENTHERM)
+    um_ot_data_t ot_cur;
+    um_ot_data_t ot_sent;
+    bool ot_valid;
+#endif
+} s_ev;
+
+static const int32_t s_event_ids[] = {
+    UMNI_EVENT_INPUTS_CHANGED,
+    UMNI_EVENT_OUTPUTS_CHANGED,
+    UMNI_EVENT_ONEWIRE_TEMPERATURES,
+    UMNI_EVENT_OPENTHERM_SET_DATA,
+    UMNI_EVENT_SDCARD_MOUNTED,
+    UMNI_EVENT_SDCARD_UNMOUNTED,
+};
+
+/* --- Запись в буфер фиксированного размера --- */
+
+typedef struct
+{
+    char *buf;
+    size_t size;
+    size_t len;
+} mem_sink_t;
+
+static esp_err_t mem_flush(void *ctx, const char *data, size_t len)
+{
+    mem_sink_t *m = (mem_sink_t *)ctx;
+    if (m->len + len > m->size)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(m->buf + m->len, data, len);
+    m->len += len;
+    return ESP_OK;
+}
+
+// Два знака после запятой: 45.6 вместо 45.5999984741211
+static double round2(float v)
+{
+    return round((double)v * 100.0) / 100.0;
+}
+
+/* --- Содержимое сообщений --- */
+
+#if UM_FEATURE_ENABLED(ONEWIRE)
+/**
+ * @brief Температуры датчиков; only_changed - только изменившиеся с прошлой рассылки
+ *
+ * Записанные значения запоминаются в temp_new/temp_pending; в temp_sent
+ * они попадают через commit_sent(), когда сообщение поместилось и отправлено.
+ *
+ * @return количество записанных датчиков
+ */
+static int write_temperatures(um_json_writer_t *w, bool only_changed)
+{
+    um_onewire_reading_t readings[ONEWIRE_MAX_SENSORS];
+    uint8_t count = um_onewire_get_readings(readings, ONEWIRE_MAX_SENSORS);
+    int written = 0;
+
+    if (only_changed)
+    {
+        memset(s_ev.temp_pending, 0, sizeof(s_ev.temp_pending));
+    }
+
+    um_json_obj_begin(w);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const um_onewire_reading_t *sensor = &readings[i];
+        // Неактивные и ещё не измеренные не рассылаются
+        if (!sensor->active || sensor->age_ms == UM_ONEWIRE_AGE_NONE)
+        {
+            continue;
+        }
+        float t = sensor->temperature;
+        if (only_changed && s_ev.temp_valid[i] && fabsf(t - s_ev.temp_sent[i]) < UM_WEB_TEMP_DELTA)
+        {
+            continue;
+        }
+        if (only_changed)
+        {
+            s_ev.temp_new[i] = t;
+            s_ev.temp_pending[i] = true;
+        }
+        char serial[17];
+        um_onewire_address_to_string(sensor->address, serial);
+        um_json_kv_num(w, serial, round2(t));
+        written++;
+    }
+    um_json_obj_end(w);
+    return written;
+}
+#endif
+
+#if UM_FEATURE_ENABLED(OPENTHERM)
+#define OT_BOOL(key, field)                                   \
+    if (!prev || prev->field != cur->field)                   \
+    {                                                         \
+        um_json_kv_bool(w, key, cur->field);                  \
+        n++;                                                  \
+    }
+#define OT_NUM(key, field)                                    \
+    if (!prev || round2(prev->field) != round2(cur->field))   \
+    {                                                         \
+        um_json_kv_num(w, key, round2(cur->field));           \
+        n++;                                                  \
+    }
+#define OT_INT(key, field)                                    \
+    if (!prev || prev->field != cur->field)                   \
+    {                                                         \
+        um_json_kv_int(w, key, cur->field);                   \
+        n++;                                                  \
+    }
+
+/**
+ * @brief Поля OpenTherm внутри открытого объекта; prev == NULL - все поля
+ *
+ * @return количество записанных полей
+ */
+static int write_ot_fields(um_json_writer_t *w, const um_ot_data_t *cur, const um_ot_data_t *prev)
+{
+    int n = 0;
+    OT_BOOL("ready", ready);
+    OT_BOOL("ch", central_heating_active);
+    OT_BOOL("dhw", hot_water_active);
+    OT_BOOL("flame", flame_on);
+    OT_BOOL("fault", is_fault);
+    OT_INT("fault_code", fault_code);
+    OT_NUM("mod", modulation);
+    OT_NUM("boiler", boiler_temperature);
+    OT_NUM("ret", return_temperature);
+    OT_NUM("dhw_t", dhw_temperature);
+    OT_NUM("outside", outside_temperature);
+    OT_NUM("press", pressure);
+    OT_NUM("flow", flow_rate);
+    return n;
+}
+
+#undef OT_BOOL
+#undef OT_NUM
+#undef OT_INT
+#endif
+
+static void write_dio(um_json_writer_t *w, const char *type, const um_event_dio_t *dio)
+{
+    um_json_kv_str(w, "t", type);
+    um_json_kv_int(w, "v", dio->states);
+    um_json_kv_int(w, "c", dio->changed);
+}
+
+/**
+ * @brief Закодировать событие
+ *
+ * @return длина сообщения, 0 - рассылать нечего
+ */
+static size_t encode_event(int32_t id, const void *data, char *buf, size_t size)
+{
+    mem_sink_t mem = {.buf = buf, .size = size, .len = 0};
+    um_json_writer_t w;
+    um_json_writer_init(&w, mem_flush, &mem);
+
+    bool empty = false;
+    um_json_obj_begin(&w);
+
+    switch (id)
+    {
+    case UMNI_EVENT_INPUTS_CHANGED:
+    case UMNI_EVENT_OUTPUTS_CHANGED:
+        if (!data)
+        {
+            return 0;
+        }
+        write_dio(&w, id == UMNI_EVENT_INPUTS_CHANGED ? "in" : "out", (const um_event_dio_t *)data);
+        break;
+
+    case UMNI_EVENT_ONEWIRE_TEMPERATURES:
+#if UM_FEATURE_ENABLED(ONEWIRE)
+        um_json_kv_str(&w, "t", "temp");
+        um_json_key(&w, "s");
+        empty = write_temperatures(&w, true) == 0;
+        break;
+#else
+        return 0;
+#endif
+
+    case UMNI_EVENT_OPENTHERM_SET_DATA:
+#if UM_FEATURE_ENABLED(OPENTHERM)
+        s_ev.ot_cur = um_ot_get_data();
+        um_json_kv_str(&w, "t", "ot");
+        empty = write_ot_fields(&w, &s_ev.ot_cur, s_ev.ot_valid ? &s_ev.ot_sent : NULL) == 0;
+        break;
+#else
+        return 0;
+#endif
+
+    case UMNI_EVENT_SDCARD_MOUNTED:
+    case UMNI_EVENT_SDCARD_UNMOUNTED:
+        um_json_kv_str(&w, "t", "sd");
+        um_json_kv_bool(&w, "m", id == UMNI_EVENT_SDCARD_MOUNTED);
+        break;
+
+    default:
+        return 0;
+    }
+
+    um_json_obj_end(&w);
+    if (empty)
+    {
+        return 0;
+    }
+    if (um_json_writer_finish(&w) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Event %ld does not fit into %u bytes", (long)id, (unsigned)size);
+        return 0;
+    }
+    return mem.len;
+}
+
+size_t um_webserver_events_snapshot(char *buf, size_t size)
+{
+    mem_sink_t mem = {.buf = buf, .size = size, .len = 0};
+    um_json_writer_t w;
+    um_json_writer_init(&w, mem_flush, &mem);
+
+    um_json_obj_begin(&w);
+    um_json_kv_str(&w, "t", "state");
+
+#if UM_FEATURE_ENABLED(INPUTS)
+    uint8_t inputs = 0;
+    if (um_dio_get_all_inputs(&inputs) == ESP_OK)
+    {
+        um_json_kv_int(&w, "in", inputs);
+    }
+#endif
+#if UM_FEATURE_ENABLED(OUTPUTS)
+    uint8_t outputs = 0;
+    if (um_dio_get_all_outputs(&outputs) == ESP_OK)
+    {
+        um_json_kv_int(&w, "out", outputs);
+    }
+#endif
+#if UM_FEATURE_ENABLED(ONEWIRE)
+    um_json_key(&w, "temp");
+    write_temperatures(&w, false);
+#endif
+#if UM_FEATURE_ENABLED(OPENTHERM)
+    um_ot_data_t ot = um_ot_get_data();
+    um_json_key(&w, "ot");
+    um_json_obj_begin(&w);
+    write_ot_fields(&w, &ot, NULL);
+    um_json_obj_end(&w);
+#endif
+
+    um_json_obj_end(&w);
+    if (um_json_writer_finish(&w) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Snapshot does not fit into %u bytes", (unsigned)size);
+        return 0;
+    }
+    return mem.len;
+}
+
+const char *um_webserver_event_name(int32_t id)
+{
+    switch (id)
+    {
+    case UMNI_EVENT_INPUTS_CHANGED:
+        return "in";
+    case UMNI_EVENT_OUTPUTS_CHANGED:
+        return "out";
+    case UMNI_EVENT_ONEWIRE_TEMPERATURES:
+        return "temp";
+    case UMNI_EVENT_OPENTHERM_SET_DATA:
+        return "ot";
+    case UMNI_EVENT_SDCARD_MOUNTED:
+    case UMNI_EVENT_SDCARD_UNMOUNTED:
+        return "sd";
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * @brief Запомнить значения, ушедшие получателям
+ *
+ * Если сообщение не поместилось, изменения будут разосланы со следующим событием.
+ */
+static void commit_sent(int32_t id)
+{
+#if UM_FEATURE_ENABLED(ONEWIRE)
+    if (id == UMNI_EVENT_ONEWIRE_TEMPERATURES)
+    {
+        for (int i = 0; i < ONEWIRE_MAX_SENSORS; i++)
+        {
+            if (s_ev.temp_pending[i])
+            {
+                s_ev.temp_sent[i] = s_ev.temp_new[i];
+                s_ev.temp_valid[i] = true;
+            }
+        }
+    }
+#endif
+#if UM_FEATURE_ENABLED(OPENTHERM)
+    if (id == UMNI_EVENT_OPENTHERM_SET_DATA)
+    {
+        s_ev.ot_sent = s_ev.ot_cur;
+        s_ev.ot_valid = true;
+    }
+#endif
+}
+
+static void event_task(void *arg)
+{
+    ev_item_t item;
+    while (xQueueReceive(s_ev.queue, &item, portMAX_DELAY) == pdTRUE)
+    {
+        if (item.id == UM_WEB_EVENT_QUIT)
+        {
+            break;
+        }
+        // Кодируем один раз, все получатели используют одно и то же сообщение
+        size_t len = encode_event(item.id, &item.dio, s_ev.buf, sizeof(s_ev.buf));
+        if (len == 0)
+        {
+            continue;
+        }
+        for (uint8_t i = 0; i < s_ev.sink_count; i++)
+        {
+            s_ev.sinks[i](item.id, s_ev.buf, len);
+        }
+        commit_sent(item.id);
+    }
+
+    xSemaphoreGive(s_ev.done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Обработчик цикла событий: только копия в очередь, без кодирования
+ */
+static void event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    ev_item_t item = {.id = id};
+    if (id == UMNI_EVENT_INPUTS_CHANGED || id == UMNI_EVENT_OUTPUTS_CHANGED)
+    {
+        if (!data)
+        {
+            return;
+        }
+        item.dio = *(const um_event_dio_t *)data;
+    }
+    if (xQueueSend(s_ev.queue, &item, 0) != pdTRUE)
+    {
+        // Изменения температур и OpenTherm уйдут со следующим событием
+        if (s_ev.dropped++ % 16 == 0)
+        {
+            ESP_LOGW(TAG, "Event queue full, %lu events dropped", (unsigned long)s_ev.dropped);
+        }
+    }
+}
+
+esp_err_t um_webserver_events_add_sink(um_web_event_sink_t sink)
+{
+    if (!sink || s_ev.subscribed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_ev.sink_count >= UM_WEB_EVENT_MAX_SINKS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    s_ev.sinks[s_ev.sink_count++] = sink;
+    return ESP_OK;
+}
+
+esp_err_t um_webserver_events_start(void)
+{
+    if (s_ev.subscribed || s_ev.sink_count == 0)
+    {
+        return ESP_OK;
+    }
+
+    if (!s_ev.queue)
+    {
+        s_ev.queue = xQueueCreate(UM_WEB_EVENT_QUEUE_LEN, sizeof(ev_item_t));
+        s_ev.done = xSemaphoreCreateBinary();
+        if (!s_ev.queue || !s_ev.done)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (xTaskCreatePinnedToCore(event_task, "web_ev", UM_WEB_EVENT_STACK, NULL, UM_WEB_EVENT_PRIORITY, &s_ev.task,
+                                UM_WEB_TASK_CORE) != pdPASS)
+    {
+        s_ev.task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < sizeof(s_event_ids) / sizeof(s_event_ids[0]); i++)
+    {
+        esp_err_t ret = um_event_subscribe(s_event_ids[i], event_handler, NULL);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Subscribe to %ld failed: %s", (long)s_event_ids[i], esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    s_ev.subscribed = true;
+    return ESP_OK;
+}
+
+void um_webserver_events_stop(void)
+{
+    if (s_ev.subscribed)
+    {
+        for (size_t i = 0; i < sizeof(s_event_ids) / sizeof(s_event_ids[0]); i++)
+        {
+            um_event_unsubscribe(s_event_ids[i], event_handler);
+        }
+    }
+    // Команда остановки встаёт после уже принятых событий
+    if (s_ev.task)
+    {
+        ev_item_t quit = {.id = UM_WEB_EVENT_QUIT};
+        xQueueSend(s_ev.queue, &quit, portMAX_DELAY);
+        xSemaphoreTake(s_ev.done, portMAX_DELAY);
+    }
+
+    QueueHandle_t queue = s_ev.queue;
+    SemaphoreHandle_t done = s_ev.done;
+    memset(&s_ev, 0, sizeof(s_ev));
+    s_ev.queue = queue;
+    s_ev.done = done;
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
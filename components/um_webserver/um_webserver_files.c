@@ -0,0 +1,717 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mbedtls/sha256.h"
+
+#include "base_config.h"
+#include "um_json_writer.h"
+#include "um_metrics.h"
+#include "um_storage.h"
+#include "um_webserver.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(SDCARD)
+#include "um_sd.h"
+#endif
+
+#if UM_FEATURE_ENABLED(WEBSERVER) && UM_FEATURE_ENABLED(SDCARD)
+
+static const char *TAG = "um_web_files";
+
+#define UM_WEB_FILES_PATH_MAX UM_STORAGE_PATH_MAX
+#define UM_WEB_FILES_LOCK_MS 500
+#define UM_WEB_FILES_SEND_RETRIES 3
+
+static um_metric_t m_file_bytes = UM_METRIC_COUNTER("um_http_file_bytes_total", "File bytes sent by /api/files");
+static um_metric_t m_upload_bytes = UM_METRIC_COUNTER("um_http_file_upload_bytes_total",
+                                                      "File bytes stored by PUT /api/files");
+
+typedef enum
+{
+    RANGE_NONE,          // заголовка нет или он не разобран - весь файл
+    RANGE_OK,            // 206
+    RANGE_UNSATISFIABLE, // 416
+} range_result_t;
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c = tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ * @brief Есть ли в пути сегмент ".." (имя "a..b" - обычный файл)
+ */
+static bool has_parent_segment(const char *path)
+{
+    for (const char *p = strstr(path, ".."); p; p = strstr(p + 1, ".."))
+    {
+        if ((p == path || p[-1] == '/') && (p[2] == '\0' || p[2] == '/'))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief /api/files/logs/a%20b.log -> /sdcard/logs/a b.log
+ *
+ * Без query, "%XX" раскодируются, сегмент ".." и обратные слеши запрещены;
+ * завершающие "/" отбрасываются.
+ */
+static bool uri_to_fs_path(const char *uri, char *path, size_t size)
+{
+    size_t prefix = strlen(UM_WEB_FILES_URI_PREFIX);
+    if (strncmp(uri, UM_WEB_FILES_URI_PREFIX, prefix) != 0)
+    {
+        return false;
+    }
+    uri += prefix;
+
+    size_t len = snprintf(path, size, "%s", CONFIG_UMNI_SD_MOUNT_POINT);
+    for (; *uri && *uri != '?' && *uri != '#'; uri++)
+    {
+        char c = *uri;
+        if (c == '%')
+        {
+            int hi = hex_value(uri[1]);
+            int lo = hi < 0 ? -1 : hex_value(uri[2]);
+            if (lo < 0)
+            {
+                return false;
+            }
+            c = (char)(hi << 4 | lo);
+            uri += 2;
+        }
+        if (c == '\0' || c == '\\' || len + 1 >= size)
+        {
+            return false;
+        }
+        path[len++] = c;
+    }
+    while (len > 0 && path[len - 1] == '/')
+    {
+        len--;
+    }
+    path[len] = '\0';
+
+    if (has_parent_segment(path) || strncmp(path, CONFIG_UMNI_SD_MOUNT_POINT, strlen(CONFIG_UMNI_SD_MOUNT_POINT)) != 0)
+    {
+        return false;
+    }
+    // "/sdcardx" - не внутри точки монтирования
+    char next = path[strlen(CONFIG_UMNI_SD_MOUNT_POINT)];
+    return next == '\0' || next == '/';
+}
+
+/**
+ * @brief Разобрать "Range: bytes=a-b" (одиночный диапазон)
+ *
+ * Несколько диапазонов и ошибки синтаксиса игнорируются (RFC 9110 это
+ * допускает): отдаётся весь файл.
+ */
+static range_result_t parse_range(const char *value, uint64_t size, uint64_t *start, uint64_t *end)
+{
+    if (strncmp(value, "bytes=", 6) != 0 || strchr(value, ','))
+    {
+        return RANGE_NONE;
+    }
+    const char *p = value + 6;
+    char *tail;
+
+    if (*p == '-')
+    {
+        // Последние N байт
+        if (!isdigit((unsigned char)p[1]))
+        {
+            return RANGE_NONE;
+        }
+        uint64_t n = strtoull(p + 1, &tail, 10);
+        if (*tail != '\0')
+        {
+            return RANGE_NONE;
+        }
+        if (n == 0 || size == 0)
+        {
+            return RANGE_UNSATISFIABLE;
+        }
+        *start = size > n ? size - n : 0;
+        *end = size - 1;
+        return RANGE_OK;
+    }
+
+    if (!isdigit((unsigned char)*p))
+    {
+        return RANGE_NONE;
+    }
+    uint64_t first = strtoull(p, &tail, 10);
+    if (*tail != '-')
+    {
+        return RANGE_NONE;
+    }
+    p = tail + 1;
+    uint64_t last = UINT64_MAX;
+    if (*p != '\0')
+    {
+        if (!isdigit((unsigned char)*p))
+        {
+            return RANGE_NONE;
+        }
+        last = strtoull(p, &tail, 10);
+        if (*tail != '\0' || last < first)
+        {
+            return RANGE_NONE;
+        }
+    }
+    if (first >= size)
+    {
+        return RANGE_UNSATISFIABLE;
+    }
+    *start = first;
+    *end = MIN(last, size - 1);
+    return RANGE_OK;
+}
+
+/**
+ * @brief Отправить весь буфер в сокет (httpd_send может отправить часть)
+ */
+static esp_err_t send_all(httpd_req_t *req, const char *buf, size_t len)
+{
+    int retries = 0;
+    while (len > 0)
+    {
+        int n = httpd_send(req, buf, len);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && retries++ < UM_WEB_FILES_SEND_RETRIES)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return ESP_FAIL;
+        }
+        buf += n;
+        len -= n;
+        retries = 0;
+    }
+    return ESP_OK;
+}
+
+static bool sd_lock(void)
+{
+    return um_sd_lock(pdMS_TO_TICKS(UM_WEB_FILES_LOCK_MS)) == ESP_OK;
+}
+
+/**
+ * @brief Закрыть файл, отмеченный um_sd_file_opened()
+ */
+static void sd_close(int fd)
+{
+    close(fd);
+    um_sd_file_closed();
+}
+
+static void sd_closedir(DIR *dir)
+{
+    closedir(dir);
+    um_sd_file_closed();
+}
+
+static esp_err_t send_unavailable(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    return httpd_resp_sendstr(req, "SD card not available");
+}
+
+/**
+ * @brief Отдать файл целиком или диапазон с Content-Length
+ *
+ * Заголовки пишутся вручную: httpd_resp_send_chunk не позволяет указать
+ * длину, а без неё клиент не покажет прогресс и не продолжит загрузку.
+ */
+static esp_err_t send_file(httpd_req_t *req, int fd, const struct stat *st, const char *path)
+{
+    uint64_t size = st->st_size;
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"%llx-%llx\"", (unsigned long long)size, (unsigned long long)st->st_mtime);
+
+    uint64_t start = 0;
+    uint64_t end = size ? size - 1 : 0;
+    range_result_t range = RANGE_NONE;
+
+    char value[64];
+    if (httpd_req_get_hdr_value_str(req, "Range", value, sizeof(value)) == ESP_OK)
+    {
+        range = parse_range(value, size, &start, &end);
+        // Файл изменился с начала загрузки - докачка невозможна, отдаём заново
+        if (range != RANGE_NONE && httpd_req_get_hdr_value_str(req, "If-Range", value, sizeof(value)) == ESP_OK &&
+            strcmp(value, etag) != 0)
+        {
+            range = RANGE_NONE;
+            start = 0;
+            end = size ? size - 1 : 0;
+        }
+    }
+
+    char hdr[320];
+    int hdr_len;
+    if (range == RANGE_UNSATISFIABLE)
+    {
+        sd_close(fd);
+        hdr_len = snprintf(hdr, sizeof(hdr),
+                           "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                           "Content-Range: bytes */%llu\r\n"
+                           "Content-Length: 0\r\n\r\n",
+                           (unsigned long long)size);
+        return send_all(req, hdr, hdr_len);
+    }
+
+    uint64_t length = size ? end - start + 1 : 0;
+    char content_range[64] = "";
+    if (range == RANGE_OK)
+    {
+        snprintf(content_range, sizeof(content_range), "Content-Range: bytes %llu-%llu/%llu\r\n",
+                 (unsigned long long)start, (unsigned long long)end, (unsigned long long)size);
+    }
+    hdr_len = snprintf(hdr, sizeof(hdr),
+                       "HTTP/1.1 %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %llu\r\n"
+                       "Accept-Ranges: bytes\r\n"
+                       "ETag: %s\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "%s\r\n",
+                       range == RANGE_OK ? "206 Partial Content" : "200 OK", um_webserver_content_type(path),
+                       (unsigned long long)length, etag, content_range);
+
+    esp_err_t ret = send_all(req, hdr, hdr_len);
+    if (ret != ESP_OK || req->method == HTTP_HEAD || length == 0)
+    {
+        sd_close(fd);
+        return ret;
+    }
+
+    // Один буфер на запрос: память не зависит от размера файла
+    char *buf = malloc(UM_WEB_FILES_CHUNK);
+    if (!buf)
+    {
+        sd_close(fd);
+        return ESP_FAIL; // заголовки ушли - только оборвать соединение
+    }
+
+    if (start > 0)
+    {
+        if (!sd_lock())
+        {
+            ret = ESP_FAIL;
+        }
+        else
+        {
+            if (lseek(fd, (off_t)start, SEEK_SET) != (off_t)start)
+            {
+                ret = ESP_FAIL;
+            }
+            um_sd_unlock();
+        }
+    }
+
+    uint64_t left = length;
+    while (ret == ESP_OK && left > 0)
+    {
+        // Карта захватывается на одно чтение: медленный клиент не мешает её извлечь
+        if (!sd_lock())
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+        ssize_t n = read(fd, buf, MIN(left, UM_WEB_FILES_CHUNK));
+        um_sd_unlock();
+
+        if (n <= 0)
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+        ret = send_all(req, buf, n);
+        left -= n;
+        um_metric_add(&m_file_bytes, n);
+    }
+    free(buf);
+    sd_close(fd);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "%s: transfer aborted, %llu of %llu bytes not sent", path, (unsigned long long)left,
+                 (unsigned long long)length);
+    }
+    return ret;
+}
+
+/**
+ * @brief Содержимое каталога потоком: {"success":true,"data":{"path":...,"entries":[...]}}
+ */
+static esp_err_t send_listing(httpd_req_t *req, DIR *dir, const char *path)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (req->method == HTTP_HEAD)
+    {
+        sd_closedir(dir);
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    um_json_writer_t w;
+    um_json_writer_init_httpd(&w, req);
+    um_json_obj_begin(&w);
+    um_json_kv_bool(&w, "success", true);
+    um_json_key(&w, "data");
+    um_json_obj_begin(&w);
+    // Путь относительно /api/files
+    const char *rel = path + strlen(CONFIG_UMNI_SD_MOUNT_POINT);
+    um_json_kv_str(&w, "path", *rel ? rel : "/");
+    um_json_key(&w, "entries");
+    um_json_arr_begin(&w);
+
+    char entry_path[UM_WEB_FILES_PATH_MAX + 256]; // имя FAT - до 255 символов
+    esp_err_t ret = ESP_OK;
+    while (um_json_writer_error(&w) == ESP_OK)
+    {
+        if (!sd_lock())
+        {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        struct dirent *de = readdir(dir);
+        struct stat st = {0};
+        if (de)
+        {
+            snprintf(entry_path, sizeof(entry_path), "%s/%s", path, de->d_name);
+            stat(entry_path, &st);
+        }
+        um_sd_unlock();
+
+        if (!de)
+        {
+            break;
+        }
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+        {
+            continue;
+        }
+        // Запись уходит в сокет уже без захвата карты
+        um_json_obj_begin(&w);
+        um_json_kv_str(&w, "name", de->d_name);
+        um_json_kv_bool(&w, "dir", de->d_type == DT_DIR);
+        um_json_kv_int(&w, "size", st.st_size);
+        um_json_kv_int(&w, "mtime", st.st_mtime);
+        um_json_obj_end(&w);
+    }
+    sd_closedir(dir);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "%s: listing aborted: %s", path, esp_err_to_name(ret));
+        return ESP_FAIL; // часть ответа уже могла уйти
+    }
+    um_json_arr_end(&w);
+    um_json_obj_end(&w);
+    um_json_obj_end(&w);
+    return um_json_writer_finish(&w);
+}
+
+esp_err_t um_webserver_files_handler(httpd_req_t *req)
+{
+    char path[UM_WEB_FILES_PATH_MAX];
+    if (!uri_to_fs_path(req->uri, path, sizeof(path)))
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad path");
+    }
+
+    if (!sd_lock())
+    {
+        return send_unavailable(req);
+    }
+
+    // Корень FAT stat() не отдаёт - это всегда каталог
+    struct stat st;
+    bool is_root = strcmp(path, CONFIG_UMNI_SD_MOUNT_POINT) == 0;
+    bool found = is_root || stat(path, &st) == 0;
+    DIR *dir = NULL;
+    int fd = -1;
+    if (found && (is_root || S_ISDIR(st.st_mode)))
+    {
+        dir = opendir(path);
+    }
+    else if (found && S_ISREG(st.st_mode))
+    {
+        fd = open(path, O_RDONLY);
+    }
+    // Передача идёт между захватами: карту не размонтируют, пока файл открыт
+    if (dir || fd >= 0)
+    {
+        um_sd_file_opened();
+    }
+    um_sd_unlock();
+
+    if (dir)
+    {
+        return send_listing(req, dir, path);
+    }
+    if (fd >= 0)
+    {
+        return send_file(req, fd, &st, path);
+    }
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+}
+
+/**
+ * @brief 64 hex-символа -> 32 байта
+ */
+static bool parse_sha256(const char *hex, uint8_t out[32])
+{
+    if (strlen(hex) != 64)
+    {
+        return false;
+    }
+    for (int i = 0; i < 32; i++)
+    {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+        {
+            return false;
+        }
+        out[i] = hi << 4 | lo;
+    }
+    return true;
+}
+
+/**
+ * @brief Создать недостающие каталоги пути (под sd_lock)
+ *
+ * @return длина пути первого созданного каталога, 0 - все уже были
+ */
+static size_t make_parents(char *path)
+{
+    size_t created = 0;
+    for (char *p = path + strlen(CONFIG_UMNI_SD_MOUNT_POINT) + 1; (p = strchr(p, '/')) != NULL; p++)
+    {
+        *p = '\0';
+        // Уже существует - не ошибка
+        if (mkdir(path, 0775) == 0 && !created)
+        {
+            created = p - path;
+        }
+        *p = '/';
+    }
+    return created;
+}
+
+/**
+ * @brief Удалить каталоги, созданные make_parents(), от самого глубокого (под sd_lock)
+ *
+ * Каталог, в который успел записать другой запрос, rmdir() не удалит.
+ */
+static void remove_parents(char *path, size_t created)
+{
+    char *p = created ? strrchr(path, '/') : NULL;
+    while (p && (size_t)(p - path) >= created)
+    {
+        *p = '\0';
+        rmdir(path);
+        char *parent = strrchr(path, '/');
+        *p = '/';
+        p = parent;
+    }
+}
+
+/**
+ * @brief Принять тело во временный файл и заменить оригинал
+ *
+ * В памяти один кусок UM_WEB_FILES_CHUNK; SHA-256 считается по мере приёма.
+ * @param[out] size принято байт
+ * @param[out] disconnected тело не дочитано из-за клиента - ответ отправлять некому
+ */
+static esp_err_t receive_file(httpd_req_t *req, char *path, const uint8_t *expected_sha, size_t *size,
+                              bool *disconnected)
+{
+    *size = 0;
+    *disconnected = false;
+    char *buf = malloc(UM_WEB_FILES_CHUNK);
+    if (!buf)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    um_storage_writer_t writer;
+    if (!sd_lock())
+    {
+        free(buf);
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Каталоги нужны уже временному файлу; при неудаче загрузки они удаляются
+    size_t created = make_parents(path);
+    esp_err_t ret = um_storage_writer_open(path, 0, &writer);
+    if (ret == ESP_OK)
+    {
+        um_sd_file_opened();
+    }
+    else
+    {
+        remove_parents(path, created);
+    }
+    um_sd_unlock();
+    if (ret != ESP_OK)
+    {
+        free(buf);
+        return ret;
+    }
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+
+    um_webserver_body_t body = {.req = req, .remaining = req->content_len};
+    size_t n;
+    while ((ret = um_webserver_body_read(&body, buf, UM_WEB_FILES_CHUNK, &n)) == ESP_OK && n > 0)
+    {
+        mbedtls_sha256_update(&sha, (const uint8_t *)buf, n);
+        if (!sd_lock())
+        {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        ret = um_storage_writer_write(&writer, buf, n);
+        um_sd_unlock();
+        if (ret != ESP_OK)
+        {
+            break;
+        }
+    }
+    *disconnected = body.remaining > 0 && !writer.failed && ret != ESP_ERR_INVALID_STATE;
+    free(buf);
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    if (ret == ESP_OK && expected_sha && memcmp(digest, expected_sha, sizeof(digest)) != 0)
+    {
+        ret = ESP_ERR_INVALID_CRC;
+    }
+    *size = writer.written;
+
+    // Временный файл закрывается и при извлечённой карте: дескриптор не должен остаться открытым
+    bool locked = sd_lock();
+    if (ret == ESP_OK && locked)
+    {
+        ret = um_storage_writer_commit(&writer);
+    }
+    else
+    {
+        um_storage_writer_abort(&writer);
+        ret = ret == ESP_OK ? ESP_ERR_INVALID_STATE : ret;
+    }
+    if (ret != ESP_OK && locked)
+    {
+        remove_parents(path, created);
+    }
+    um_sd_file_closed();
+    if (locked)
+    {
+        um_sd_unlock();
+    }
+    return ret;
+}
+
+esp_err_t um_webserver_files_put_handler(httpd_req_t *req)
+{
+    char path[UM_WEB_FILES_PATH_MAX];
+    if (!uri_to_fs_path(req->uri, path, sizeof(path)) || strcmp(path, CONFIG_UMNI_SD_MOUNT_POINT) == 0)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad path");
+    }
+
+    uint8_t expected[32];
+    char hex[72];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, UM_WEB_FILES_SHA256_HEADER, hex, sizeof(hex));
+    bool check = ret == ESP_OK;
+    if ((check && !parse_sha256(hex, expected)) || ret == ESP_ERR_HTTPD_RESULT_TRUNC)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad " UM_WEB_FILES_SHA256_HEADER);
+    }
+
+    if (!sd_lock())
+    {
+        return send_unavailable(req);
+    }
+    struct stat st;
+    bool exists = stat(path, &st) == 0;
+    um_sd_unlock();
+    if (exists && !S_ISREG(st.st_mode))
+    {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_sendstr(req, "Is a directory");
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    size_t size;
+    bool disconnected;
+    ret = receive_file(req, path, check ? expected : NULL, &size, &disconnected);
+    if (disconnected)
+    {
+        ESP_LOGW(TAG, "%s: upload aborted after %u bytes", path, (unsigned)size);
+        return ESP_FAIL;
+    }
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+
+    switch (ret)
+    {
+    case ESP_OK:
+        break;
+    case ESP_ERR_INVALID_CRC:
+        ESP_LOGW(TAG, "%s: SHA-256 mismatch, file not replaced", path);
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "SHA-256 mismatch");
+    case ESP_ERR_INVALID_SIZE:
+        return httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, "Path too long");
+    case ESP_ERR_INVALID_STATE:
+        return send_unavailable(req);
+    default:
+        ESP_LOGE(TAG, "%s: not saved: %s", path, esp_err_to_name(ret));
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Write failed");
+    }
+
+    um_metric_add(&m_upload_bytes, size);
+    uint32_t kbps = elapsed_ms ? (uint32_t)((uint64_t)size * 1000 / 1024 / elapsed_ms) : 0;
+    ESP_LOGI(TAG, "%s: %u bytes in %lu ms (%lu KB/s)", path, (unsigned)size, (unsigned long)elapsed_ms,
+             (unsigned long)kbps);
+
+    char json[128];
+    snprintf(json, sizeof(json), "{\"success\":true,\"data\":{\"size\":%u,\"ms\":%lu,\"kbps\":%lu}}",
+             (unsigned)size, (unsigned long)elapsed_ms, (unsigned long)kbps);
+    httpd_resp_set_status(req, exists ? "200 OK" : "201 Created");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, json);
+}
+
+void um_webserver_files_start(void)
+{
+    um_metrics_register(&m_file_bytes);
+    um_metrics_register(&m_upload_bytes);
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER) && UM_FEATURE_ENABLED(SDCARD)
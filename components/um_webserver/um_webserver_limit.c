@@ -0,0 +1,139 @@
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/sockets.h"
+
+#include "base_config.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_limit";
+
+// Токены хранятся в тысячных, чтобы пополнять без дробей
+#define MILLI 1000
+
+/**
+ * @brief Корзина токенов клиента на endpoint
+ */
+typedef struct
+{
+    uint8_t ip[16]; // IPv6 или IPv4 в первых 4 байтах
+    const void *key;
+    int32_t tokens; // в тысячных
+    int64_t last_us;
+} bucket_t;
+
+static struct
+{
+    portMUX_TYPE mux;
+    bucket_t buckets[UM_WEB_RATE_BUCKETS];
+    uint32_t inflight;
+} s_limit = {.mux = portMUX_INITIALIZER_UNLOCKED};
+
+static void client_ip(httpd_req_t *req, uint8_t ip[16])
+{
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    memset(ip, 0, 16);
+    if (getpeername(httpd_req_to_sockfd(req), (struct sockaddr *)&addr, &len) != 0)
+    {
+        return;
+    }
+#if CONFIG_LWIP_IPV6
+    if (addr.ss_family == AF_INET6)
+    {
+        memcpy(ip, &((struct sockaddr_in6 *)&addr)->sin6_addr, 16);
+        return;
+    }
+#endif
+    memcpy(ip, &((struct sockaddr_in *)&addr)->sin_addr, 4);
+}
+
+// Вызывается под mux
+static bucket_t *get_bucket(const uint8_t ip[16], const void *key, int32_t burst, int64_t now)
+{
+    bucket_t *oldest = &s_limit.buckets[0];
+    for (int i = 0; i < UM_WEB_RATE_BUCKETS; i++)
+    {
+        bucket_t *b = &s_limit.buckets[i];
+        if (b->key == key && memcmp(b->ip, ip, 16) == 0)
+        {
+            return b;
+        }
+        if (b->last_us < oldest->last_us)
+        {
+            oldest = b;
+        }
+    }
+
+    // Вытесняется самая давняя корзина: за время простоя она бы всё равно наполнилась
+    memcpy(oldest->ip, ip, 16);
+    oldest->key = key;
+    oldest->tokens = burst;
+    oldest->last_us = now;
+    return oldest;
+}
+
+bool um_webserver_rate_allow(httpd_req_t *req, const void *key, uint16_t rate, uint32_t *retry_after_s)
+{
+    if (rate == 0)
+    {
+        return true;
+    }
+
+    uint8_t ip[16];
+    client_ip(req, ip);
+    int64_t now = esp_timer_get_time();
+    int32_t burst = (int32_t)rate * UM_WEB_RATE_BURST_SEC * MILLI;
+
+    portENTER_CRITICAL(&s_limit.mux);
+    bucket_t *b = get_bucket(ip, key, burst, now);
+    // rate токенов в секунду: за микросекунду rate / 1000 тысячных
+    int64_t refill = (now - b->last_us) * rate / 1000;
+    b->tokens = (int32_t)MIN((int64_t)burst, b->tokens + refill);
+    b->last_us = now;
+
+    bool allowed = b->tokens >= MILLI;
+    if (allowed)
+    {
+        b->tokens -= MILLI;
+    }
+    else
+    {
+        // Целых секунд до следующего токена (округление вверх)
+        uint32_t per_sec = (uint32_t)rate * MILLI;
+        *retry_after_s = (MILLI - b->tokens + per_sec - 1) / per_sec;
+    }
+    portEXIT_CRITICAL(&s_limit.mux);
+    return allowed;
+}
+
+bool um_webserver_inflight_acquire(void)
+{
+    bool ok = false;
+    portENTER_CRITICAL(&s_limit.mux);
+    if (s_limit.inflight < CONFIG_UM_CFG_WEBSERVER_MAX_INFLIGHT)
+    {
+        s_limit.inflight++;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_limit.mux);
+    if (!ok)
+    {
+        ESP_LOGD(TAG, "%u requests in progress", CONFIG_UM_CFG_WEBSERVER_MAX_INFLIGHT);
+    }
+    return ok;
+}
+
+void um_webserver_inflight_release(void)
+{
+    portENTER_CRITICAL(&s_limit.mux);
+    s_limit.inflight--;
+    portEXIT_CRITICAL(&s_limit.mux);
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
@@ -0,0 +1,280 @@
+#pragma once
+
+// Внутренние объявления компонента um_webserver (не для внешних модулей)
+
+#include "esp_http_server.h"
+#include "cJSON.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Обработчик статических файлов (GET, wildcard по всем адресам)
+     *
+     * Регистрируется последним, чтобы wildcard не перекрывал API. Вызывается
+     * как endpoint из пула задач: чтение с SD не держит задачу httpd.
+     */
+    esp_err_t um_webserver_static_handler(httpd_req_t *req);
+
+    /**
+     * @brief MIME-тип по расширению файла (application/octet-stream, если неизвестно)
+     */
+    const char *um_webserver_content_type(const char *path);
+
+/** Задач в пуле для async endpoints */
+#define UM_WEB_WORKERS 2
+/** Запросов, ожидающих свободную задачу; сверх - 503 */
+#define UM_WEB_WORK_QUEUE_LEN 4
+
+    /**
+     * @brief Работа для пула: выполняется в задаче пула с асинхронной копией запроса
+     */
+    typedef esp_err_t (*um_web_work_fn)(httpd_req_t *req, void *arg, int64_t start_us);
+
+    esp_err_t um_webserver_workers_start(void);
+
+    /**
+     * @brief Остановить пул, до httpd_stop
+     *
+     * Выполняемые запросы завершаются, ожидающие в очереди получают 503.
+     */
+    void um_webserver_workers_stop(void);
+
+    /**
+     * @brief Передать запрос в пул (только из задачи httpd)
+     *
+     * @return ESP_OK - запрос отвязан от httpd и поставлен в очередь,
+     *         ESP_ERR_NO_MEM - очередь полна или пул останавливается,
+     *         запрос не тронут (ответить 503)
+     */
+    esp_err_t um_webserver_workers_submit(httpd_req_t *req, um_web_work_fn fn, void *arg, int64_t start_us);
+
+/** Буфер чтения тела POST на стеке обработчика */
+#define UM_WEB_BODY_CHUNK 512
+/** Повторов recv при таймауте сокета (по recv_wait_timeout каждый) */
+#define UM_WEB_RECV_RETRIES 3
+
+    /**
+     * @brief Проверить размер тела POST до чтения
+     *
+     * Слишком большое тело не читается: 413 и ESP_FAIL (обработчик закрывает
+     * соединение, чтобы httpd не вычитывал остаток); пустое - 400.
+     *
+     * @param max_body предел в байтах, 0 - UM_WEBSERVER_MAX_BODY
+     */
+    esp_err_t um_webserver_body_check(httpd_req_t *req, size_t max_body);
+
+    /**
+     * @brief Прочитать тело запроса целиком (len = req->content_len)
+     */
+    esp_err_t um_webserver_recv_all(httpd_req_t *req, char *buf, size_t len);
+
+/** Общий объём кэша ответов; одна запись - не больше половины */
+#define UM_WEB_CACHE_MAX_BYTES 16384
+
+    esp_err_t um_webserver_cache_start(void);
+
+    /**
+     * @brief Очистить кэш и отписаться от событий (после httpd_stop)
+     */
+    void um_webserver_cache_stop(void);
+
+    /**
+     * @brief Добавить события, при которых кэш сбрасывается (при регистрации endpoint)
+     */
+    void um_webserver_cache_watch(uint32_t events);
+
+    /**
+     * @brief Сбросить записи, зависящие от событий (маска UM_WEBSERVER_EVENT_BIT)
+     *
+     * UINT32_MAX сбрасывает весь кэш.
+     */
+    void um_webserver_cache_invalidate(uint32_t events);
+
+    /**
+     * @brief Текущее поколение: берётся до построения ответа и передаётся в store_send
+     */
+    uint32_t um_webserver_cache_generation(void);
+
+    /**
+     * @brief Ответить из кэша по URI с query (200 или 304)
+     *
+     * @return ESP_ERR_NOT_FOUND - записи нет, запрос не тронут
+     */
+    esp_err_t um_webserver_cache_send(httpd_req_t *req);
+
+    /**
+     * @brief Запомнить ответ и отправить его с ETag
+     *
+     * @param body тело из malloc, переходит во владение кэша
+     * @param gen поколение на момент начала построения; если с тех пор был
+     *            сброс, ответ отправляется, но не сохраняется
+     */
+    esp_err_t um_webserver_cache_store_send(httpd_req_t *req, char *body, size_t len, uint32_t events, uint32_t gen);
+
+/** Максимальный размер сообщения о событии / снимка состояния */
+#define UM_WEB_EVENT_MAX_LEN 1024
+
+    /**
+     * @brief Получатель закодированных событий (WebSocket, SSE)
+     *
+     * Вызывается из задачи web_ev (не из цикла событий); json действителен
+     * только во время вызова.
+     */
+    typedef void (*um_web_event_sink_t)(int32_t event_id, const char *json, size_t len);
+
+    /**
+     * @brief Добавить получателя (до um_webserver_events_start)
+     */
+    esp_err_t um_webserver_events_add_sink(um_web_event_sink_t sink);
+
+    /**
+     * @brief Подписаться на um_events, если есть получатели
+     */
+    esp_err_t um_webserver_events_start(void);
+
+    /**
+     * @brief Отписаться и забыть получателей
+     */
+    void um_webserver_events_stop(void);
+
+    /**
+     * @brief Полный снимок состояния {"t":"state",...}
+     *
+     * @return длина или 0, если не поместилось
+     */
+    size_t um_webserver_events_snapshot(char *buf, size_t size);
+
+    /**
+     * @brief Короткое имя события ("in", "temp", ...) или NULL
+     */
+    const char *um_webserver_event_name(int32_t id);
+
+    /**
+     * @brief Зарегистрировать /api/events (SSE) и запустить задачу отправки
+     */
+    esp_err_t um_webserver_sse_start(httpd_handle_t server);
+
+    /**
+     * @brief Закрыть потоки и остановить задачу (до httpd_stop)
+     */
+    void um_webserver_sse_stop(void);
+
+/** Корзин (клиент, endpoint) для ограничения частоты; вытесняется самая давняя */
+#define UM_WEB_RATE_BUCKETS 16
+/** Запас корзины: столько секунд запросов можно сделать залпом */
+#define UM_WEB_RATE_BURST_SEC 2
+/** Предел частоты статики: страница загружает скрипты, стили и картинки залпом */
+#define UM_WEB_STATIC_RATE_LIMIT 50
+/** Мест в таблице httpd для endpoints приложения сверх встроенных */
+#define UM_WEB_APP_URI_HANDLERS 8
+/** Ядро задач httpd и пула: OpenTherm и MQTT работают на ядре 1 */
+#define UM_WEB_TASK_CORE 0
+
+    /**
+     * @brief Взять токен из корзины клиента для key (endpoint)
+     *
+     * @param rate запросов в секунду, 0 - без ограничения
+     * @param[out] retry_after_s через сколько секунд повторить, если false
+     * @return false - ответить 429
+     */
+    bool um_webserver_rate_allow(httpd_req_t *req, const void *key, uint16_t rate, uint32_t *retry_after_s);
+
+    /**
+     * @brief Занять место среди выполняемых запросов (CONFIG_UM_CFG_WEBSERVER_MAX_INFLIGHT)
+     *
+     * @return false - ответить 503
+     */
+    bool um_webserver_inflight_acquire(void);
+
+    void um_webserver_inflight_release(void);
+
+/** Байт случайного токена сессии и усечённой подписи */
+#define UM_WEB_TOKEN_BYTES 16
+/** Длина секрета HMAC (UM_NVS_KEY_WEBSERVER_TOKEN) */
+#define UM_WEB_HMAC_KEY_LEN 32
+
+    /**
+     * @brief Загрузить или создать секрет подписи токенов, подписаться на UMNI_EVENT_CONFIG_SAVED
+     *
+     * Учётные данные читаются из NVS при первом запросе и после каждого UMNI_EVENT_CONFIG_SAVED.
+     */
+    esp_err_t um_webserver_auth_start(void);
+
+    void um_webserver_auth_stop(void);
+
+    /**
+     * @brief Проверить токен запроса (сессия или подписанный)
+     *
+     * @return ESP_OK - доступ разрешён (или UM_CFG_WEBSERVER_AUTH выключен),
+     *         ESP_ERR_INVALID_STATE - ответить um_webserver_auth_reject()
+     */
+    esp_err_t um_webserver_auth_check(httpd_req_t *req);
+
+    /**
+     * @brief Ответ 401
+     */
+    esp_err_t um_webserver_auth_reject(httpd_req_t *req);
+
+    /**
+     * @brief POST /api/login: {"username", "password", "stateless"?} -> {"token", "expires_in"}
+     */
+    esp_err_t um_webserver_auth_login(httpd_req_t *req, cJSON *input, cJSON **output);
+
+    /**
+     * @brief POST /api/logout: удалить сессию запроса, {"all": true} - отозвать все токены
+     */
+    esp_err_t um_webserver_auth_logout(httpd_req_t *req, cJSON *input, cJSON **output);
+
+/** Файлы SD карты: /api/files/logs/x.log -> CONFIG_UMNI_SD_MOUNT_POINT/logs/x.log */
+#define UM_WEB_FILES_URI_PREFIX "/api/files"
+/** Буфер отправки файла (один на запрос, в куче) */
+#define UM_WEB_FILES_CHUNK 4096
+
+    void um_webserver_files_start(void);
+
+    /**
+     * @brief GET/HEAD /api/files/...: файл (с Range) или содержимое каталога потоком
+     */
+    esp_err_t um_webserver_files_handler(httpd_req_t *req);
+
+/** Необязательный заголовок PUT: SHA-256 тела, 64 hex-символа */
+#define UM_WEB_FILES_SHA256_HEADER "X-Content-SHA256"
+
+    /**
+     * @brief PUT /api/files/...: тело во временный файл, замена оригинала после приёма и проверки
+     */
+    esp_err_t um_webserver_files_put_handler(httpd_req_t *req);
+
+/** Операций в одном POST /api/batch */
+#define UM_WEB_BATCH_MAX_OPS 32
+/** Предел тела /api/batch */
+#define UM_WEB_BATCH_MAX_BODY 4096
+
+    /**
+     * @brief POST /api/batch: массив операций, выполняется по порядку с одним commit NVS
+     */
+    esp_err_t um_webserver_batch_handler(httpd_req_t *req, cJSON *input, cJSON **output);
+
+#if CONFIG_HTTPD_WS_SUPPORT
+    /**
+     * @brief Зарегистрировать /ws и подключиться к рассылке событий
+     */
+    esp_err_t um_webserver_ws_start(httpd_handle_t server);
+
+    /**
+     * @brief Сокет закрыт (вызывается из close_fn сервера)
+     */
+    void um_webserver_ws_on_close(int fd);
+
+    /**
+     * @brief Освободить ресурсы WebSocket после остановки сервера
+     */
+    void um_webserver_ws_stop(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
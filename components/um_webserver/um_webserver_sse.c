@@ -0,0 +1,389 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "base_config.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_sse";
+
+#define UM_SSE_URI "/api/events"
+#define UM_SSE_MAX_STREAMS 3
+#define UM_SSE_QUEUE_LEN 8
+#define UM_SSE_KEEPALIVE_MS 15000
+#define UM_SSE_TASK_STACK 3072
+#define UM_SSE_TASK_PRIORITY 4
+
+// Имена событий для фильтра ?ids=in,temp (как um_webserver_event_name)
+static const char *const s_names[] = {"in", "out", "temp", "ot", "sd"};
+#define UM_SSE_ALL_EVENTS ((1u << (sizeof(s_names) / sizeof(s_names[0]))) - 1)
+
+/**
+ * @brief Готовое сообщение "event: ...\ndata: ...\n\n"
+ *
+ * Создаётся один раз в задаче web_ev, отправляется задачей SSE всем
+ * подходящим потокам и освобождается ею же.
+ */
+typedef struct
+{
+    uint32_t mask;
+    size_t len;
+    char data[];
+} sse_msg_t;
+
+/**
+ * @brief Поток SSE
+ *
+ * Слот занимает обработчик httpd (под lock), освобождает только задача SSE,
+ * поэтому занятый слот она может читать и отправлять в него без lock.
+ */
+typedef struct
+{
+    httpd_req_t *req; // асинхронная копия запроса, NULL - свободно
+    uint32_t mask;
+    int64_t last_tx_us; // последняя отправка в этот поток
+} sse_stream_t;
+
+static struct
+{
+    QueueHandle_t queue;
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t done;
+    TaskHandle_t task;
+    sse_stream_t streams[UM_SSE_MAX_STREAMS];
+    // Объединение фильтров открытых потоков; читается без блокировки
+    // из задачи web_ev
+    volatile uint32_t active_mask;
+    uint32_t dropped;
+    // Снимок для нового потока: собирается только в задаче httpd
+    char snapshot[UM_WEB_EVENT_MAX_LEN];
+} s_sse;
+
+static int name_index(const char *name, size_t len)
+{
+    for (size_t i = 0; i < sizeof(s_names) / sizeof(s_names[0]); i++)
+    {
+        if (strlen(s_names[i]) == len && strncmp(s_names[i], name, len) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Фильтр из ?ids=in,temp; без параметра - все события
+ *
+ * @return маска или 0, если ни одно имя не распознано
+ */
+static uint32_t parse_filter(httpd_req_t *req)
+{
+    char query[96];
+    char ids[64];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "ids", ids, sizeof(ids)) != ESP_OK)
+    {
+        return UM_SSE_ALL_EVENTS;
+    }
+
+    uint32_t mask = 0;
+    const char *p = ids;
+    while (*p)
+    {
+        size_t len = strcspn(p, ",");
+        int idx = name_index(p, len);
+        if (idx >= 0)
+        {
+            mask |= 1u << idx;
+        }
+        p += len;
+        if (*p == ',')
+        {
+            p++;
+        }
+    }
+    return mask;
+}
+
+// Вызывается под lock
+static void update_active_mask(void)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < UM_SSE_MAX_STREAMS; i++)
+    {
+        if (s_sse.streams[i].req)
+        {
+            mask |= s_sse.streams[i].mask;
+        }
+    }
+    s_sse.active_mask = mask;
+}
+
+/**
+ * @brief Завершить поток: освободить слот под lock, вернуть сокет httpd и закрыть его
+ */
+static void stream_close(sse_stream_t *st)
+{
+    xSemaphoreTake(s_sse.lock, portMAX_DELAY);
+    httpd_req_t *req = st->req;
+    st->req = NULL;
+    update_active_mask();
+    xSemaphoreGive(s_sse.lock);
+    if (!req)
+    {
+        return;
+    }
+    httpd_handle_t hd = req->handle;
+    int fd = httpd_req_to_sockfd(req);
+    httpd_req_async_handler_complete(req);
+    httpd_sess_trigger_close(hd, fd);
+}
+
+// Без lock: медленный сокет не задерживает обработчик httpd, открывающий поток
+static void stream_send(sse_stream_t *st, const char *data, size_t len)
+{
+    if (httpd_resp_send_chunk(st->req, data, len) != ESP_OK)
+    {
+        ESP_LOGI(TAG, "Stream fd %d closed", httpd_req_to_sockfd(st->req));
+        stream_close(st);
+        return;
+    }
+    st->last_tx_us = esp_timer_get_time();
+}
+
+/**
+ * @brief Время до ближайшего keep-alive среди открытых потоков
+ */
+static TickType_t keepalive_wait(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t wait_us = (int64_t)UM_SSE_KEEPALIVE_MS * 1000;
+
+    xSemaphoreTake(s_sse.lock, portMAX_DELAY);
+    for (int i = 0; i < UM_SSE_MAX_STREAMS; i++)
+    {
+        const sse_stream_t *st = &s_sse.streams[i];
+        if (st->req)
+        {
+            int64_t left = st->last_tx_us + (int64_t)UM_SSE_KEEPALIVE_MS * 1000 - now;
+            wait_us = left < wait_us ? left : wait_us;
+        }
+    }
+    xSemaphoreGive(s_sse.lock);
+
+    return wait_us > 0 ? pdMS_TO_TICKS(wait_us / 1000) + 1 : 0;
+}
+
+/**
+ * @brief Задача отправки: одна на все потоки, обработчики httpd не заняты
+ */
+static void sse_task(void *arg)
+{
+    static const char keepalive[] = ": keep-alive\n\n";
+
+    while (true)
+    {
+        sse_msg_t *msg = NULL;
+        if (xQueueReceive(s_sse.queue, &msg, keepalive_wait()) == pdTRUE && msg == NULL)
+        {
+            break; // um_webserver_sse_stop()
+        }
+
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < UM_SSE_MAX_STREAMS; i++)
+        {
+            sse_stream_t *st = &s_sse.streams[i];
+            xSemaphoreTake(s_sse.lock, portMAX_DELAY);
+            bool open = st->req != NULL;
+            xSemaphoreGive(s_sse.lock);
+            if (!open)
+            {
+                continue;
+            }
+            if (msg && (st->mask & msg->mask))
+            {
+                stream_send(st, msg->data, msg->len);
+            }
+            else if (now - st->last_tx_us >= (int64_t)UM_SSE_KEEPALIVE_MS * 1000)
+            {
+                // Тишина в этом потоке: комментарий держит соединение и выявляет отключившихся
+                stream_send(st, keepalive, sizeof(keepalive) - 1);
+            }
+        }
+        free(msg);
+    }
+
+    for (int i = 0; i < UM_SSE_MAX_STREAMS; i++)
+    {
+        stream_close(&s_sse.streams[i]);
+    }
+
+    sse_msg_t *msg;
+    while (xQueueReceive(s_sse.queue, &msg, 0) == pdTRUE)
+    {
+        free(msg);
+    }
+
+    xSemaphoreGive(s_sse.done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Получатель событий (задача web_ev), не блокируется
+ */
+static void sse_sink(int32_t event_id, const char *json, size_t len)
+{
+    const char *name = um_webserver_event_name(event_id);
+    int idx = name ? name_index(name, strlen(name)) : -1;
+    if (idx < 0)
+    {
+        return;
+    }
+
+    // Нет потоков с таким событием - не занимаем память и очередь
+    if (!(s_sse.active_mask & (1u << idx)))
+    {
+        return;
+    }
+
+    size_t size = len + strlen(name) + sizeof("event: \ndata: \n\n");
+    sse_msg_t *msg = malloc(sizeof(sse_msg_t) + size);
+    if (!msg)
+    {
+        s_sse.dropped++;
+        return;
+    }
+    msg->mask = 1u << idx;
+    msg->len = snprintf(msg->data, size, "event: %s\ndata: %.*s\n\n", name, (int)len, json);
+
+    if (xQueueSend(s_sse.queue, &msg, 0) != pdTRUE)
+    {
+        // Задача не успевает - теряем событие, а не задерживаем цикл событий
+        s_sse.dropped++;
+        free(msg);
+    }
+}
+
+static esp_err_t sse_handler(httpd_req_t *req)
+{
+    if (um_webserver_auth_check(req) != ESP_OK)
+    {
+        return um_webserver_auth_reject(req);
+    }
+
+    uint32_t mask = parse_filter(req);
+    if (mask == 0)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown event id");
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(s_sse.lock, portMAX_DELAY);
+    sse_stream_t *st = NULL;
+    for (int i = 0; i < UM_SSE_MAX_STREAMS && !st; i++)
+    {
+        if (!s_sse.streams[i].req)
+        {
+            st = &s_sse.streams[i];
+        }
+    }
+    xSemaphoreGive(s_sse.lock);
+
+    if (!st || !s_sse.task)
+    {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "30");
+        httpd_resp_sendstr(req, "Too many event streams");
+        return ESP_OK;
+    }
+
+    // Отвязываем запрос от обработчика: дальше в сокет пишет задача SSE
+    httpd_req_t *async_req = NULL;
+    if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(async_req, "text/event-stream");
+    httpd_resp_set_hdr(async_req, "Cache-Control", "no-cache");
+
+    // Первое сообщение - полный снимок состояния
+    static const char head[] = "retry: 3000\nevent: state\ndata: ";
+    size_t len = um_webserver_events_snapshot(s_sse.snapshot, sizeof(s_sse.snapshot));
+    if (httpd_resp_send_chunk(async_req, head, sizeof(head) - 1) != ESP_OK ||
+        httpd_resp_send_chunk(async_req, len ? s_sse.snapshot : "{}", len ? len : 2) != ESP_OK ||
+        httpd_resp_send_chunk(async_req, "\n\n", 2) != ESP_OK)
+    {
+        httpd_req_async_handler_complete(async_req);
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTake(s_sse.lock, portMAX_DELAY);
+    st->mask = mask;
+    st->last_tx_us = esp_timer_get_time();
+    st->req = async_req;
+    update_active_mask();
+    xSemaphoreGive(s_sse.lock);
+
+    ESP_LOGI(TAG, "Stream fd %d opened, mask 0x%02lx", httpd_req_to_sockfd(async_req), (unsigned long)mask);
+    return ESP_OK;
+}
+
+esp_err_t um_webserver_sse_start(httpd_handle_t server)
+{
+    if (!s_sse.lock)
+    {
+        s_sse.lock = xSemaphoreCreateMutex();
+        s_sse.done = xSemaphoreCreateBinary();
+        s_sse.queue = xQueueCreate(UM_SSE_QUEUE_LEN, sizeof(sse_msg_t *));
+        if (!s_sse.lock || !s_sse.done || !s_sse.queue)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (xTaskCreate(sse_task, "web_sse", UM_SSE_TASK_STACK, NULL, UM_SSE_TASK_PRIORITY, &s_sse.task) != pdPASS)
+    {
+        s_sse.task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    httpd_uri_t sse_uri = {
+        .uri = UM_SSE_URI,
+        .method = HTTP_GET,
+        .handler = sse_handler,
+        .user_ctx = NULL,
+    };
+    esp_err_t ret = httpd_register_uri_handler(server, &sse_uri);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "%s not registered: %s", sse_uri.uri, esp_err_to_name(ret));
+        return ret;
+    }
+    return um_webserver_events_add_sink(sse_sink);
+}
+
+void um_webserver_sse_stop(void)
+{
+    // До httpd_stop(): асинхронные запросы нужно вернуть серверу
+    if (!s_sse.task)
+    {
+        return;
+    }
+    sse_msg_t *quit = NULL;
+    xQueueSend(s_sse.queue, &quit, portMAX_DELAY);
+    xSemaphoreTake(s_sse.done, portMAX_DELAY);
+    s_sse.task = NULL;
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
@@ -0,0 +1,483 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+
+#include "base_config.h"
+
+#include "um_webserver_priv.h"
+#include "um_assets.h"
+
+#if UM_FEATURE_ENABLED(SDCARD)
+#include "um_sd.h"
+#endif
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_static";
+
+// Каталоги с веб-интерфейсом. SD перекрывает прошитый образ assets,
+// SPIFFS - для файлов, которых в образе нет
+#if UM_FEATURE_ENABLED(SDCARD)
+#define UM_WEB_SD_ROOT CONFIG_UMNI_SD_MOUNT_POINT "/www"
+#endif
+#define UM_WEB_SPIFFS_ROOT "/spiffs/www"
+
+#define UM_WEB_PATH_MAX 128
+#define UM_WEB_ROOT_MAX 24
+#define UM_WEB_CHUNK_SIZE 2048
+#define UM_WEB_SD_LOCK_MS 500
+
+#define UM_WEB_CACHE_IMMUTABLE "public, max-age=31536000, immutable"
+#define UM_WEB_CACHE_REVALIDATE "no-cache"
+
+// Простая HTML страница для теста, если нет ни файлов, ни образа assets
+static const char *TEST_HTML =
+    "<!DOCTYPE html><html><head><title>UM WebServer</title>"
+    "<meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1'>"
+    "<style>body{font-family:Arial,sans-serif;margin:40px;background:#f5f5f5;}"
+    ".container{max-width:800px;margin:0 auto;background:white;padding:30px;border-radius:10px;box-shadow:0 2px 10px rgba(0,0,0,0.1);}"
+    "h1{color:#333;border-bottom:2px solid #4CAF50;padding-bottom:10px;}"
+    ".status{background:#e8f5e9;padding:15px;border-radius:5px;margin:20px 0;}"
+    "</style></head>"
+    "<body><div class='container'>"
+    "<h1>UM WebServer</h1>"
+    "<div class='status'>Веб-сервер работает успешно!</div>"
+    "<p>Версия: 1.0.0</p>"
+    "<p>Используйте REST API для взаимодействия</p>"
+    "</div></body></html>";
+
+typedef enum
+{
+    UM_WEB_SRC_SD,
+    UM_WEB_SRC_SPIFFS,
+} um_web_src_t;
+
+const char *um_webserver_content_type(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+    if (!ext)
+        return "application/octet-stream";
+    if (strcmp(ext, ".html") == 0 || strcmp(ext, ".htm") == 0)
+        return "text/html";
+    if (strcmp(ext, ".js") == 0 || strcmp(ext, ".mjs") == 0)
+        return "application/javascript";
+    if (strcmp(ext, ".css") == 0)
+        return "text/css";
+    if (strcmp(ext, ".json") == 0 || strcmp(ext, ".map") == 0)
+        return "application/json";
+    if (strcmp(ext, ".svg") == 0)
+        return "image/svg+xml";
+    if (strcmp(ext, ".png") == 0)
+        return "image/png";
+    if (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".jpeg") == 0)
+        return "image/jpeg";
+    if (strcmp(ext, ".gif") == 0)
+        return "image/gif";
+    if (strcmp(ext, ".webp") == 0)
+        return "image/webp";
+    if (strcmp(ext, ".ico") == 0)
+        return "image/x-icon";
+    if (strcmp(ext, ".woff2") == 0)
+        return "font/woff2";
+    if (strcmp(ext, ".woff") == 0)
+        return "font/woff";
+    if (strcmp(ext, ".txt") == 0 || strcmp(ext, ".log") == 0)
+        return "text/plain";
+    if (strcmp(ext, ".csv") == 0)
+        return "text/csv";
+    if (strcmp(ext, ".wasm") == 0)
+        return "application/wasm";
+    return "application/octet-stream";
+}
+
+/**
+ * @brief URI -> путь внутри www: без query, без "..", "/" -> "/index.html"
+ */
+static bool uri_to_path(const char *uri, char *path, size_t size)
+{
+    size_t len = strcspn(uri, "?#");
+    if (len == 0 || uri[0] != '/' || len >= size)
+    {
+        return false;
+    }
+    memcpy(path, uri, len);
+    path[len] = '\0';
+
+    if (strstr(path, "..") || strchr(path, '\\'))
+    {
+        return false;
+    }
+
+    if (path[len - 1] == '/')
+    {
+        if (len + sizeof("index.html") > size)
+        {
+            return false;
+        }
+        strcpy(path + len, "index.html");
+    }
+    return true;
+}
+
+/**
+ * @brief Имя содержит хэш сборки (app.3f2a9c1b.js, index-BXz3k1a9.js)
+ *
+ * Такой файл никогда не меняется под тем же именем, его можно
+ * кэшировать без перепроверки.
+ */
+static bool is_hashed_name(const char *path)
+{
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+
+    for (const char *p = name; *p; p++)
+    {
+        if (*p != '.' && *p != '-')
+        {
+            continue;
+        }
+
+        const char *s = p + 1;
+        size_t n = 0;
+        bool digit = false;
+        while (isalnum((unsigned char)s[n]) || s[n] == '_')
+        {
+            digit |= isdigit((unsigned char)s[n]) != 0;
+            n++;
+        }
+        if (n >= 8 && digit && s[n] == '.')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool accepts_gzip(httpd_req_t *req)
+{
+    char buf[96] = {0};
+    // Обрезанный заголовок тоже годится: ищем в том, что влезло
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", buf, sizeof(buf));
+    if (ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC)
+    {
+        return false;
+    }
+    return strstr(buf, "gzip") != NULL;
+}
+
+static bool etag_matches(httpd_req_t *req, const char *etag)
+{
+    char buf[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", buf, sizeof(buf)) != ESP_OK)
+    {
+        return false;
+    }
+    return strcmp(buf, "*") == 0 || strstr(buf, etag) != NULL;
+}
+
+/**
+ * @brief Заголовки кэширования; при совпадении ETag отправляет 304
+ *
+ * @return true - ответ уже отправлен
+ */
+static bool send_cache_headers(httpd_req_t *req, const char *path, const char *etag)
+{
+    // httpd хранит указатели: etag должен жить до отправки ответа
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control",
+                       is_hashed_name(path) ? UM_WEB_CACHE_IMMUTABLE : UM_WEB_CACHE_REVALIDATE);
+
+    if (etag_matches(req, etag))
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        return true;
+    }
+    return false;
+}
+
+static bool src_lock(um_web_src_t src)
+{
+#if UM_FEATURE_ENABLED(SDCARD)
+    if (src == UM_WEB_SRC_SD)
+    {
+        return um_sd_lock(pdMS_TO_TICKS(UM_WEB_SD_LOCK_MS)) == ESP_OK;
+    }
+#endif
+    return true;
+}
+
+static void src_unlock(um_web_src_t src)
+{
+#if UM_FEATURE_ENABLED(SDCARD)
+    if (src == UM_WEB_SRC_SD)
+    {
+        um_sd_unlock();
+    }
+#endif
+}
+
+/**
+ * @brief Закрыть файл источника; файл с карты снимается с учёта um_sd
+ */
+static void src_close(um_web_src_t src, int fd)
+{
+    close(fd);
+#if UM_FEATURE_ENABLED(SDCARD)
+    if (src == UM_WEB_SRC_SD)
+    {
+        um_sd_file_closed();
+    }
+#endif
+}
+
+/**
+ * @brief Открыть файл (предпочитая .gz рядом с ним)
+ *
+ * @return дескриптор или -1
+ */
+static int open_variant(const char *fs_path, bool gzip_ok, struct stat *st, bool *gz)
+{
+    char gz_path[UM_WEB_PATH_MAX + 16];
+
+    if (gzip_ok)
+    {
+        snprintf(gz_path, sizeof(gz_path), "%s.gz", fs_path);
+        if (stat(gz_path, st) == 0 && S_ISREG(st->st_mode))
+        {
+            int fd = open(gz_path, O_RDONLY);
+            if (fd >= 0)
+            {
+                *gz = true;
+                return fd;
+            }
+        }
+    }
+
+    if (stat(fs_path, st) == 0 && S_ISREG(st->st_mode))
+    {
+        *gz = false;
+        return open(fs_path, O_RDONLY);
+    }
+    return -1;
+}
+
+/**
+ * @brief Отдать файл из каталога root
+ *
+ * @return ESP_ERR_NOT_FOUND - файла нет, можно пробовать следующий источник
+ */
+static esp_err_t send_file(httpd_req_t *req, um_web_src_t src, const char *root,
+                           const char *path, bool gzip_ok)
+{
+    char fs_path[UM_WEB_PATH_MAX];
+    if (snprintf(fs_path, sizeof(fs_path), "%s%s", root, path) >= (int)sizeof(fs_path))
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (!src_lock(src))
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    struct stat st;
+    bool gz = false;
+    int fd = open_variant(fs_path, gzip_ok, &st, &gz);
+#if UM_FEATURE_ENABLED(SDCARD)
+    // Файл читается между захватами: карту не размонтируют, пока он открыт
+    if (fd >= 0 && src == UM_WEB_SRC_SD)
+    {
+        um_sd_file_opened();
+    }
+#endif
+    src_unlock(src);
+
+    if (fd < 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"%lx-%llx%s\"",
+             (unsigned long)st.st_size, (unsigned long long)st.st_mtime, gz ? "-gz" : "");
+
+    // Vary и в ответе 304: кэш должен различать варианты
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (send_cache_headers(req, path, etag))
+    {
+        src_close(src, fd);
+        return ESP_OK;
+    }
+
+    // Буфер на запрос: статика выполняется в пуле, несколько файлов параллельно
+    char *chunk = malloc(UM_WEB_CHUNK_SIZE);
+    if (!chunk)
+    {
+        src_close(src, fd);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+
+    httpd_resp_set_type(req, um_webserver_content_type(path));
+    if (gz)
+    {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+
+    esp_err_t ret = ESP_OK;
+    while (true)
+    {
+        // Блокировка SD только на время одного чтения: медленный клиент
+        // не должен задерживать извлечение карты
+        if (!src_lock(src))
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+        ssize_t n = read(fd, chunk, UM_WEB_CHUNK_SIZE);
+        src_unlock(src);
+
+        if (n < 0)
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        if (httpd_resp_send_chunk(req, chunk, n) != ESP_OK)
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+    }
+    src_close(src, fd);
+    free(chunk);
+
+    if (ret != ESP_OK)
+    {
+        // Заголовки уже ушли: обрываем ответ, httpd закроет сокет
+        ESP_LOGW(TAG, "Transfer aborted: %s", fs_path);
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief Отдать файл из образа assets или встроенного интерфейса
+ *
+ * @return ESP_ERR_NOT_FOUND - файла нет; ESP_ERR_NOT_SUPPORTED - в образе
+ *         только сжатый вариант, а клиент не принимает gzip
+ */
+static esp_err_t send_asset(httpd_req_t *req, const char *path, bool gzip_ok)
+{
+    um_asset_t asset;
+    if (um_assets_find(path, &asset) != ESP_OK)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (asset.gzip && !gzip_ok)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (asset.gzip)
+    {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    // Во встроенном интерфейсе ETag и тип посчитаны при сборке
+    char etag[16];
+    if (!asset.etag)
+    {
+        snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)asset.crc);
+    }
+    if (send_cache_headers(req, path, asset.etag ? asset.etag : etag))
+    {
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, asset.content_type ? asset.content_type : um_webserver_content_type(path));
+    if (asset.gzip)
+    {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+    // Данные отображены из flash - отправляем без копирования
+    return httpd_resp_send(req, (const char *)asset.data, asset.size);
+}
+
+/**
+ * @brief Обработчик для статических файлов
+ *
+ * Порядок поиска: SD (/sdcard/www), образ assets, встроенный в прошивку интерфейс,
+ * SPIFFS (/spiffs/www).
+ * Если ничего не найдено - тестовая страница для "/" и 404 для остального.
+ */
+esp_err_t um_webserver_static_handler(httpd_req_t *req)
+{
+    ESP_LOGD(TAG, "Static file query: %s", req->uri);
+
+    char path[UM_WEB_PATH_MAX - UM_WEB_ROOT_MAX];
+    if (!uri_to_path(req->uri, path, sizeof(path)))
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad path");
+    }
+
+    // Неизвестные API-адреса не ищем на файловых системах
+    if (strncmp(path, "/api/", 5) == 0)
+    {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+    }
+
+    bool gzip_ok = accepts_gzip(req);
+    esp_err_t ret;
+
+#if UM_FEATURE_ENABLED(SDCARD)
+    if (um_sd_is_mounted())
+    {
+        ret = send_file(req, UM_WEB_SRC_SD, UM_WEB_SD_ROOT, path, gzip_ok);
+        if (ret != ESP_ERR_NOT_FOUND)
+        {
+            return ret;
+        }
+    }
+#endif
+
+    ret = send_asset(req, path, gzip_ok);
+    bool gzip_only = (ret == ESP_ERR_NOT_SUPPORTED);
+    if (ret != ESP_ERR_NOT_FOUND && !gzip_only)
+    {
+        return ret;
+    }
+
+    // Несжатая копия для клиента без gzip может лежать на SPIFFS
+    ret = send_file(req, UM_WEB_SRC_SPIFFS, UM_WEB_SPIFFS_ROOT, path, gzip_ok);
+    if (ret != ESP_ERR_NOT_FOUND)
+    {
+        return ret;
+    }
+
+    if (gzip_only)
+    {
+        httpd_resp_set_status(req, "406 Not Acceptable");
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        httpd_resp_set_type(req, "text/plain");
+        return httpd_resp_sendstr(req, "Content is available with Content-Encoding: gzip only");
+    }
+
+    if (strcmp(path, "/index.html") == 0)
+    {
+        httpd_resp_set_type(req, "text/html");
+        return httpd_resp_sendstr(req, TEST_HTML);
+    }
+
+    // Ошибка клиента, соединение keep-alive не рвём
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
@@ -0,0 +1,155 @@
+#include <string.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "base_config.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(WEBSERVER)
+
+static const char *TAG = "um_web_workers";
+
+#define UM_WEB_WORKER_STACK 6144
+#define UM_WEB_WORKER_PRIORITY 5
+
+typedef struct
+{
+    httpd_req_t *req; // асинхронная копия; NULL - команда остановки
+    um_web_work_fn fn;
+    void *arg;
+    int64_t start_us;
+} work_item_t;
+
+static struct
+{
+    QueueHandle_t queue;
+    SemaphoreHandle_t done;
+    // Проверка stopping и постановка в очередь - под lock, иначе запрос
+    // может встать после команд остановки и не быть возвращён httpd
+    SemaphoreHandle_t lock;
+    bool stopping;
+    uint8_t count;
+} s_workers;
+
+static void worker_task(void *arg)
+{
+    work_item_t item;
+    while (xQueueReceive(s_workers.queue, &item, portMAX_DELAY) == pdTRUE)
+    {
+        if (!item.req)
+        {
+            break;
+        }
+        item.fn(item.req, item.arg, item.start_us);
+        // Сокет возвращается httpd: дальше он снова читает запросы клиента
+        httpd_req_async_handler_complete(item.req);
+    }
+
+    xSemaphoreGive(s_workers.done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t um_webserver_workers_start(void)
+{
+    if (s_workers.count)
+    {
+        return ESP_OK;
+    }
+    if (!s_workers.queue)
+    {
+        s_workers.queue = xQueueCreate(UM_WEB_WORK_QUEUE_LEN, sizeof(work_item_t));
+        s_workers.done = xSemaphoreCreateCounting(UM_WEB_WORKERS, 0);
+        s_workers.lock = xSemaphoreCreateMutex();
+        if (!s_workers.queue || !s_workers.done || !s_workers.lock)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    for (int i = 0; i < UM_WEB_WORKERS; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "web_worker%d", i);
+        if (xTaskCreatePinnedToCore(worker_task, name, UM_WEB_WORKER_STACK, NULL, UM_WEB_WORKER_PRIORITY, NULL,
+                                    UM_WEB_TASK_CORE) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to start %s", name);
+            break;
+        }
+        s_workers.count++;
+    }
+    return s_workers.count ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void um_webserver_workers_stop(void)
+{
+    if (s_workers.count == 0)
+    {
+        return;
+    }
+
+    // Новые запросы больше не принимаются
+    xSemaphoreTake(s_workers.lock, portMAX_DELAY);
+    s_workers.stopping = true;
+    xSemaphoreGive(s_workers.lock);
+
+    // Ожидающие запросы не выполняются: 503 и сокет обратно httpd до httpd_stop()
+    work_item_t item;
+    int dropped = 0;
+    while (xQueueReceive(s_workers.queue, &item, 0) == pdTRUE)
+    {
+        httpd_resp_set_status(item.req, "503 Service Unavailable");
+        httpd_resp_set_type(item.req, "application/json");
+        httpd_resp_set_hdr(item.req, "Retry-After", "5");
+        httpd_resp_sendstr(item.req, "{\"success\":false,\"error\":\"Server stopping\"}");
+        httpd_req_async_handler_complete(item.req);
+        um_webserver_inflight_release();
+        dropped++;
+    }
+    if (dropped)
+    {
+        ESP_LOGW(TAG, "%d queued requests dropped on stop", dropped);
+    }
+
+    // Выполняемые сейчас запросы завершаются, затем задачи выходят
+    work_item_t quit = {0};
+    for (int i = 0; i < s_workers.count; i++)
+    {
+        xQueueSend(s_workers.queue, &quit, portMAX_DELAY);
+    }
+    for (int i = 0; i < s_workers.count; i++)
+    {
+        xSemaphoreTake(s_workers.done, portMAX_DELAY);
+    }
+    s_workers.count = 0;
+    s_workers.stopping = false;
+}
+
+esp_err_t um_webserver_workers_submit(httpd_req_t *req, um_web_work_fn fn, void *arg, int64_t start_us)
+{
+    if (s_workers.count == 0)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Ставит в очередь только задача httpd, поэтому проверенное место не исчезнет
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_workers.lock, portMAX_DELAY);
+    work_item_t item = {.fn = fn, .arg = arg, .start_us = start_us};
+    if (!s_workers.stopping && uxQueueSpacesAvailable(s_workers.queue) > 0 &&
+        httpd_req_async_handler_begin(req, &item.req) == ESP_OK)
+    {
+        xQueueSend(s_workers.queue, &item, 0);
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_workers.lock);
+    return ret;
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER)
@@ -0,0 +1,309 @@
+#include <string.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "base_config.h"
+
+#include "um_webserver_priv.h"
+
+#if UM_FEATURE_ENABLED(WEBSERVER) && CONFIG_HTTPD_WS_SUPPORT
+
+static const char *TAG = "um_web_ws";
+
+#define UM_WS_URI "/ws"
+#define UM_WS_MAX_CLIENTS 4
+// Кадров в очереди httpd на одного клиента; больше - клиент не успевает и отключается
+#define UM_WS_CLIENT_QUEUE 8
+#define UM_WS_RX_MAX 64
+
+/**
+ * @brief Закодированный кадр, общий для всех клиентов
+ *
+ * Освобождается, когда httpd отправил его последнему клиенту.
+ */
+typedef struct
+{
+    uint16_t refs;
+    size_t len;
+    uint8_t data[];
+} ws_frame_t;
+
+typedef struct
+{
+    int fd; // -1 - свободно
+    uint8_t inflight;
+    bool evicting;
+} ws_client_t;
+
+static struct
+{
+    httpd_handle_t server;
+    SemaphoreHandle_t lock;
+    ws_client_t clients[UM_WS_MAX_CLIENTS];
+    uint32_t evicted;
+    // Снимок для нового клиента: собирается только в задаче httpd
+    char snapshot[UM_WEB_EVENT_MAX_LEN];
+} s_ws;
+
+static ws_client_t *find_client(int fd)
+{
+    for (int i = 0; i < UM_WS_MAX_CLIENTS; i++)
+    {
+        if (s_ws.clients[i].fd == fd)
+        {
+            return &s_ws.clients[i];
+        }
+    }
+    return NULL;
+}
+
+static bool add_client(int fd)
+{
+    bool ok = false;
+    xSemaphoreTake(s_ws.lock, portMAX_DELAY);
+    ws_client_t *c = find_client(fd);
+    if (!c)
+    {
+        c = find_client(-1);
+    }
+    if (c)
+    {
+        c->fd = fd;
+        c->inflight = 0;
+        c->evicting = false;
+        ok = true;
+    }
+    xSemaphoreGive(s_ws.lock);
+    return ok;
+}
+
+static void frame_release(ws_frame_t *frame)
+{
+    if (--frame->refs == 0)
+    {
+        free(frame);
+    }
+}
+
+static void send_done(esp_err_t err, int fd, void *arg)
+{
+    xSemaphoreTake(s_ws.lock, portMAX_DELAY);
+    ws_client_t *c = find_client(fd);
+    if (c && c->inflight > 0)
+    {
+        c->inflight--;
+    }
+    frame_release((ws_frame_t *)arg);
+    xSemaphoreGive(s_ws.lock);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGD(TAG, "Send to fd %d failed: %s", fd, esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Рассылка события всем клиентам (задача web_ev)
+ *
+ * Кадр кодируется один раз; в очередь httpd каждому клиенту ставится
+ * ссылка на него. Клиент, у которого не отправлено UM_WS_CLIENT_QUEUE
+ * кадров, отключается, чтобы не копить память под медленный сокет.
+ */
+static void ws_broadcast(int32_t event_id, const char *json, size_t len)
+{
+    int evict[UM_WS_MAX_CLIENTS];
+    int evict_count = 0;
+
+    xSemaphoreTake(s_ws.lock, portMAX_DELAY);
+
+    ws_frame_t *frame = NULL;
+    for (int i = 0; i < UM_WS_MAX_CLIENTS; i++)
+    {
+        ws_client_t *c = &s_ws.clients[i];
+        if (c->fd < 0 || c->evicting)
+        {
+            continue;
+        }
+        if (c->inflight >= UM_WS_CLIENT_QUEUE)
+        {
+            c->evicting = true;
+            evict[evict_count++] = c->fd;
+            continue;
+        }
+
+        if (!frame)
+        {
+            frame = malloc(sizeof(ws_frame_t) + len);
+            if (!frame)
+            {
+                break;
+            }
+            memcpy(frame->data, json, len);
+            frame->len = len;
+            frame->refs = 1; // ссылка рассылки, снимается в конце
+        }
+
+        httpd_ws_frame_t ws_frame = {
+            .final = true,
+            .type = HTTPD_WS_TYPE_TEXT,
+            .payload = frame->data,
+            .len = frame->len,
+        };
+        frame->refs++;
+        c->inflight++;
+        if (httpd_ws_send_data_async(s_ws.server, c->fd, &ws_frame, send_done, frame) != ESP_OK)
+        {
+            // Очередь httpd переполнена - колбэк не будет вызван
+            frame->refs--;
+            c->inflight--;
+        }
+    }
+
+    if (frame)
+    {
+        frame_release(frame);
+    }
+    s_ws.evicted += evict_count;
+    xSemaphoreGive(s_ws.lock);
+
+    for (int i = 0; i < evict_count; i++)
+    {
+        ESP_LOGW(TAG, "Slow client fd %d evicted", evict[i]);
+        httpd_sess_trigger_close(s_ws.server, evict[i]);
+    }
+}
+
+static esp_err_t send_snapshot(httpd_req_t *req)
+{
+    size_t len = um_webserver_events_snapshot(s_ws.snapshot, sizeof(s_ws.snapshot));
+    if (len == 0)
+    {
+        return ESP_OK;
+    }
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)s_ws.snapshot,
+        .len = len,
+    };
+    return httpd_ws_send_frame(req, &frame);
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET)
+    {
+        // Рукопожатие уже отправлено: без токена (?token=) соединение просто закрывается
+        if (um_webserver_auth_check(req) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
+        // Рукопожатие завершено - новый клиент
+        int fd = httpd_req_to_sockfd(req);
+        if (!add_client(fd))
+        {
+            ESP_LOGW(TAG, "Too many clients, fd %d rejected", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Client fd %d connected", fd);
+        return send_snapshot(req);
+    }
+
+    httpd_ws_frame_t frame = {0};
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    if (frame.len > UM_WS_RX_MAX)
+    {
+        return ESP_FAIL;
+    }
+
+    uint8_t buf[UM_WS_RX_MAX + 1];
+    frame.payload = buf;
+    if (frame.len > 0)
+    {
+        ret = httpd_ws_recv_frame(req, &frame, frame.len);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+    }
+    buf[frame.len] = '\0';
+
+    // Клиент может запросить полный снимок, например после перехода на вкладку
+    if (frame.type == HTTPD_WS_TYPE_TEXT && strcmp((char *)buf, "snapshot") == 0)
+    {
+        return send_snapshot(req);
+    }
+    return ESP_OK;
+}
+
+void um_webserver_ws_on_close(int fd)
+{
+    if (!s_ws.lock)
+    {
+        return;
+    }
+    xSemaphoreTake(s_ws.lock, portMAX_DELAY);
+    ws_client_t *c = find_client(fd);
+    if (c)
+    {
+        // Кадры в очереди освободит send_done
+        c->fd = -1;
+        ESP_LOGI(TAG, "Client fd %d disconnected", fd);
+    }
+    xSemaphoreGive(s_ws.lock);
+}
+
+esp_err_t um_webserver_ws_start(httpd_handle_t server)
+{
+    if (!s_ws.lock)
+    {
+        s_ws.lock = xSemaphoreCreateMutex();
+        if (!s_ws.lock)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_ws.server = server;
+    for (int i = 0; i < UM_WS_MAX_CLIENTS; i++)
+    {
+        s_ws.clients[i].fd = -1;
+    }
+
+    httpd_uri_t ws_uri = {
+        .uri = UM_WS_URI,
+        .method = HTTP_GET,
+        .handler = ws_handler,
+        .user_ctx = NULL,
+        .is_websocket = true,
+    };
+    esp_err_t ret = httpd_register_uri_handler(server, &ws_uri);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "%s not registered: %s", ws_uri.uri, esp_err_to_name(ret));
+        return ret;
+    }
+    return um_webserver_events_add_sink(ws_broadcast);
+}
+
+void um_webserver_ws_stop(void)
+{
+    // Сервер уже остановлен: все сокеты закрыты, очередь httpd пуста
+    if (s_ws.lock)
+    {
+        xSemaphoreTake(s_ws.lock, portMAX_DELAY);
+        for (int i = 0; i < UM_WS_MAX_CLIENTS; i++)
+        {
+            s_ws.clients[i].fd = -1;
+        }
+        s_ws.server = NULL;
+        xSemaphoreGive(s_ws.lock);
+    }
+}
+
+#endif // UM_FEATURE_ENABLED(WEBSERVER) && CONFIG_HTTPD_WS_SUPPORT
@@ -1,11 +1,15 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "base_config.h"
 #include "um_events.h"
 #include "um_storage.h"
+#include "um_assets.h"
 #include "um_nvs.h"
 #include "um_capabilities.h"
+#include "um_tslog.h"
 
 #if UM_FEATURE_ENABLED(ETHERNET)
 #include "um_ethernet.h"
@@ -29,6 +33,9 @@
 
 #if UM_FEATURE_ENABLED(SDCARD)
 #include "um_sd.h"
+#if CONFIG_UM_CFG_SDLOG
+#include "um_sdlog.h"
+#endif
 #endif
 
 #if UM_FEATURE_ENABLED(OPENTHERM)
@@ -64,6 +71,15 @@
 #include "um_mqtt.h"
 #endif
 
+#if UM_FEATURE_ENABLED(ETHERNET) | UM_FEATURE_ENABLED(WIFI)
+#include "esp_netif_sntp.h"
+#endif
+
+#ifdef UM_WEBUI_EMBEDDED
+// Генерируется из webui/ при сборке (см. main/CMakeLists.txt)
+extern const um_assets_bundle_t um_webui_bundle;
+#endif
+
 static const char *TAG = "MAIN";
 
 // Обработчик события 1
@@ -72,6 +88,143 @@ void handler1(void *arg, esp_event_base_t base, int32_t id, void *data)
     ESP_LOGI(TAG, "Handler1: Получено событие %ld", (long)id);
 }
 
+#if UM_FEATURE_ENABLED(ETHERNET) | UM_FEATURE_ENABLED(WIFI)
+// Часовой пояс и SNTP из NVS; журналы и токены ждут установленных часов
+static void time_sync_init(void)
+{
+    // lwIP хранит указатель на имя сервера, поэтому буфер статический
+    static char ntp_server[64];
+    char *value = NULL;
+
+    if (um_nvs_get_timezone(&value) == ESP_OK && value != NULL)
+    {
+        setenv("TZ", value, 1);
+    }
+    else
+    {
+        setenv("TZ", UM_NVS_DEFAULT_TIMEZONE, 1);
+    }
+    tzset();
+    free(value);
+    value = NULL;
+
+    bool has_ntp = um_nvs_get_ntp(&value) == ESP_OK && value != NULL && value[0] != '\0';
+    snprintf(ntp_server, sizeof(ntp_server), "%s", has_ntp ? value : UM_NVS_DEFAULT_NTP);
+    free(value);
+
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(ntp_server);
+    if (esp_netif_sntp_init(&config) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start SNTP");
+        return;
+    }
+    ESP_LOGI(TAG, "SNTP: %s", ntp_server);
+}
+#endif
+
+#if UM_FEATURE_ENABLED(ONEWIRE) && CONFIG_UM_CFG_ONEWIRE_HISTORY_S > 0
+// Канал журнала: HISTORY_CH_ONEWIRE + слот датчика из onewire.json (не меняется при
+// пересканировании и замене соседних датчиков)
+#define HISTORY_CH_ONEWIRE 0x0100
+
+static void onewire_history_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    static time_t last_logged;
+    time_t now = time(NULL);
+    if (now - last_logged < CONFIG_UM_CFG_ONEWIRE_HISTORY_S)
+    {
+        return;
+    }
+
+    um_onewire_reading_t readings[ONEWIRE_MAX_SENSORS];
+    uint8_t count = um_onewire_get_readings(readings, ONEWIRE_MAX_SENSORS);
+    bool logged = false;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const um_onewire_reading_t *sensor = &readings[i];
+        // Датчик, который давно не читается (или ещё не измерен), не повторяет старое значение
+        if (!sensor->active || sensor->age_ms > CONFIG_UM_CFG_ONEWIRE_HISTORY_S * 1000U)
+        {
+            continue;
+        }
+        char serial[17];
+        um_onewire_address_to_string(sensor->address, serial);
+        const um_onewire_sensor_config_t *cfg = um_onewire_config_get(serial);
+        if (cfg == NULL || cfg->slot == UM_ONEWIRE_SLOT_NONE)
+        {
+            continue;
+        }
+        // Только RAM: событие обрабатывается в задаче шины событий
+        if (um_tslog_append(HISTORY_CH_ONEWIRE + cfg->slot, sensor->temperature) == ESP_OK)
+        {
+            logged = true;
+        }
+    }
+
+    // До синхронизации часов um_tslog_append() отказывает - пробуем снова
+    if (logged)
+    {
+        last_logged = now;
+    }
+}
+#endif
+
+#if UM_FEATURE_ENABLED(SDCARD) && CONFIG_UM_CFG_SDLOG
+// Строки CSV "время;тип;..." в лог на SD. um_sdlog только копирует строку в
+// буфер, карту пишет его собственная задача
+static void sdlog_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    long long now = (long long)time(NULL);
+
+    switch (id)
+    {
+#if UM_FEATURE_ENABLED(INPUTS)
+    case UMNI_EVENT_INPUTS_CHANGED:
+    {
+        const um_event_dio_t *dio = data;
+        um_sdlog_printf("%lld;in;%02x;%02x\n", now, dio->states, dio->changed);
+        break;
+    }
+#endif
+#if UM_FEATURE_ENABLED(ONEWIRE)
+    case UMNI_EVENT_ONEWIRE_TEMPERATURES:
+    {
+        um_onewire_reading_t readings[ONEWIRE_MAX_SENSORS];
+        uint8_t count = um_onewire_get_readings(readings, ONEWIRE_MAX_SENSORS);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const um_onewire_reading_t *sensor = &readings[i];
+            // Только прочитанные в этом цикле
+            if (sensor->active && sensor->age_ms < CONFIG_UM_CFG_ONEWIRE_POLL_MS)
+            {
+                char serial[17];
+                um_onewire_address_to_string(sensor->address, serial);
+                um_sdlog_printf("%lld;t;%s;%.2f\n", now, serial, sensor->temperature);
+            }
+        }
+        break;
+    }
+#endif
+#if UM_FEATURE_ENABLED(OPENTHERM)
+    case UMNI_EVENT_OPENTHERM_SET_DATA:
+    {
+        // Библиотека не отдаёт сырые кадры - пишем результат опроса.
+        // Статическая копия: структура велика для стека задачи событий
+        static um_ot_data_t ot;
+        ot = um_ot_get_data();
+        um_sdlog_printf("%lld;ot;%d;%d;%d;%.1f;%.1f;%.1f;%.1f;%.2f;%d\n", now, ot.flame_on,
+                        ot.central_heating_active, ot.hot_water_active, ot.modulation,
+                        ot.boiler_temperature, ot.return_temperature, ot.dhw_temperature,
+                        ot.pressure, ot.is_fault ? ot.fault_code : 0);
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+}
+#endif
+
 void app_main(void)
 {
     ESP_LOGI(TAG, "========================================");
@@ -90,6 +243,11 @@ void app_main(void)
     um_nvs_init();
     // Spiffs
     um_storage_init("/spiffs", NULL, 5, true);
+    // Read-only ассеты (веб-интерфейс), отображаются из flash без копирования
+    um_assets_init();
+#ifdef UM_WEBUI_EMBEDDED
+    um_assets_register_bundle(&um_webui_bundle);
+#endif
 
 #if UM_FEATURE_ENABLED(NTC1) || UM_FEATURE_ENABLED(NTC2) || UM_FEATURE_ENABLED(AI1) || UM_FEATURE_ENABLED(AI2)
     esp_err_t ret_adc = um_adc_common_init();
@@ -165,6 +323,21 @@ void app_main(void)
         }
 
         um_onewire_config_apply();
+
+#if CONFIG_UM_CFG_ONEWIRE_HISTORY_S > 0
+        // История температур: кольцо сегментов на storage (см. um_tslog)
+        um_tslog_config_t history = UM_TSLOG_DEFAULT_CONFIG();
+        history.name = "temp";
+        if (um_tslog_init(&history) == ESP_OK)
+        {
+            um_event_subscribe(UMNI_EVENT_ONEWIRE_TEMPERATURES, onewire_history_handler, NULL);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Failed to open temperature history");
+        }
+#endif
+        um_onewire_start_polling(CONFIG_UM_CFG_ONEWIRE_POLL_MS);
     }
 #endif
 
@@ -172,6 +345,10 @@ void app_main(void)
     um_ethernet_init();
 #endif
 
+#if UM_FEATURE_ENABLED(ETHERNET) | UM_FEATURE_ENABLED(WIFI)
+    time_sync_init();
+#endif
+
 #if UM_FEATURE_ENABLED(ETHERNET) | UM_FEATURE_ENABLED(WIFI)
 #if UM_FEATURE_ENABLED(MQTT)
     um_mqtt_init("umni-c1");
@@ -184,6 +361,25 @@ void app_main(void)
 
 #if UM_FEATURE_ENABLED(SDCARD)
     um_sd_init();
+#if CONFIG_UM_CFG_SDLOG
+    // Непрерывный лог на карту; до SNTP файлы 000000NN.LOG (см. um_sdlog)
+    if (um_sdlog_init(NULL) == ESP_OK)
+    {
+#if UM_FEATURE_ENABLED(INPUTS)
+        um_event_subscribe(UMNI_EVENT_INPUTS_CHANGED, sdlog_handler, NULL);
+#endif
+#if UM_FEATURE_ENABLED(ONEWIRE)
+        um_event_subscribe(UMNI_EVENT_ONEWIRE_TEMPERATURES, sdlog_handler, NULL);
+#endif
+#if UM_FEATURE_ENABLED(OPENTHERM)
+        um_event_subscribe(UMNI_EVENT_OPENTHERM_SET_DATA, sdlog_handler, NULL);
+#endif
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to start SD card log");
+    }
+#endif
 #endif
 
 #if UM_FEATURE_ENABLED(NTC1) || UM_FEATURE_ENABLED(NTC1)
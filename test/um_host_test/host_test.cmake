@@ -0,0 +1,8 @@
+# Подключается из components/<компонент>/host_test/CMakeLists.txt вместо
+# project.cmake: собирается только main с тем, что он требует, и общий
+# sdkconfig.defaults для target linux. EXTRA_COMPONENT_DIRS задаётся до include.
+list(APPEND EXTRA_COMPONENT_DIRS "${CMAKE_CURRENT_LIST_DIR}")
+set(COMPONENTS main)
+set(SDKCONFIG_DEFAULTS "${CMAKE_CURRENT_LIST_DIR}/sdkconfig.defaults")
+
+include($ENV{IDF_PATH}/tools/cmake/project.cmake)
@@ -0,0 +1,15 @@
+/**
+ * @file um_host_test.c
+ * @brief Общие фикстуры Unity для host_test/ приложений
+ */
+
+#include "unity.h"
+
+// Тесты компонентов готовят состояние сами, фикстуры Unity не нужны
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}